@@ -0,0 +1,233 @@
+// diag_log.c - log record queue and the task that formats it
+#include <stdio.h>
+#include <string.h>
+#include "diag_log.h"
+#include "diag_stats.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#ifndef LOG_TASK_STACK
+#define LOG_TASK_STACK 3072   // snprintf of floats
+#endif
+#ifndef LOG_TASK_PRIO
+#define LOG_TASK_PRIO  1      // above idle only
+#endif
+#ifndef LOG_TASK_CORE
+#define LOG_TASK_CORE  tskNO_AFFINITY
+#endif
+#define LOG_LINE_MAX   192
+
+typedef struct {
+    diag_log_site_t *site;
+    uint32_t         time_ms;
+    uint32_t         suppressed;   // by the rate limit before this record
+    uint8_t          nargs;
+    uint8_t          types[DIAG_LOG_MAX_ARGS];
+    diag_log_value_t values[DIAG_LOG_MAX_ARGS];   // 4 bytes each on the ESP32
+} log_record_t;
+
+static QueueHandle_t queue;
+static diag_log_site_t *site_list;   // push-only, lock-free
+
+static diag_counter_t stat_deferred;
+static diag_counter_t stat_suppressed;
+static diag_counter_t stat_dropped;
+
+static void site_register(diag_log_site_t *site, const char *tag)
+{
+    // Racing first uses store the same tag; only one links the site
+    site->tag = tag;
+    bool expected = false;
+    if (!__atomic_compare_exchange_n(&site->registered, &expected, true, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+    diag_log_site_t *head = __atomic_load_n(&site_list, __ATOMIC_RELAXED);
+    do {
+        site->next = head;
+    } while (!__atomic_compare_exchange_n(&site_list, &head, site, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void diag_log_push(diag_log_site_t *site, const char *tag,
+                   const diag_log_arg_t *args, size_t n)
+{
+    uint32_t now = esp_log_timestamp();
+    if (!__atomic_load_n(&site->registered, __ATOMIC_ACQUIRE)) {
+        site_register(site, tag);
+    } else if (now - __atomic_load_n(&site->last_ms, __ATOMIC_RELAXED) < site->interval_ms) {
+        __atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+        diag_counter_inc(&stat_suppressed);
+        return;
+    }
+    __atomic_store_n(&site->last_ms, now, __ATOMIC_RELAXED);
+
+    log_record_t r = {
+        .site = site,
+        .time_ms = now,
+        .suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED),
+        .nargs = (uint8_t)(n > DIAG_LOG_MAX_ARGS ? DIAG_LOG_MAX_ARGS : n),
+    };
+    for (size_t i = 0; i < r.nargs; i++) {
+        r.types[i] = args[i].type;
+        r.values[i] = args[i].v;
+    }
+
+    if (!queue || xQueueSend(queue, &r, 0) != pdTRUE) {
+        // Keep the count so the summary still reports it
+        __atomic_fetch_add(&site->suppressed, r.suppressed + 1, __ATOMIC_RELAXED);
+        diag_counter_inc(&stat_dropped);
+        return;
+    }
+    diag_counter_inc(&stat_deferred);
+}
+
+/* -------------------------------------------------------------------------- */
+/*  Formatting                                                                */
+/* -------------------------------------------------------------------------- */
+
+static size_t append(char *out, size_t cap, size_t len, const char *s, size_t n)
+{
+    if (len + 1 >= cap) return len;
+    if (n > cap - 1 - len) n = cap - 1 - len;
+    memcpy(out + len, s, n);
+    return len + n;
+}
+
+size_t diag_log_format(char *out, size_t cap, const char *fmt,
+                       const diag_log_value_t *values, const uint8_t *types, size_t n)
+{
+    if (cap == 0) return 0;
+    size_t len = 0, arg = 0;
+
+    while (*fmt) {
+        const char *pct = strchr(fmt, '%');
+        if (!pct) {
+            len = append(out, cap, len, fmt, strlen(fmt));
+            break;
+        }
+        len = append(out, cap, len, fmt, (size_t)(pct - fmt));
+        if (pct[1] == '%') {
+            len = append(out, cap, len, "%", 1);
+            fmt = pct + 2;
+            continue;
+        }
+
+        // Copy flags, width and precision; drop length modifiers
+        char spec[16] = "%";
+        size_t sl = 1;
+        const char *p = pct + 1;
+        while (*p && strchr("-+ #0123456789.", *p)) {
+            if (sl < sizeof(spec) - 2) spec[sl++] = *p;
+            p++;
+        }
+        while (*p && strchr("hlLqjzt", *p)) p++;
+        char conv = *p;
+        if (!conv) break;
+        fmt = p + 1;
+        spec[sl++] = conv;
+        spec[sl] = '\0';
+
+        char buf[48];
+        int w;
+        if (arg >= n) {
+            w = snprintf(buf, sizeof(buf), "?");
+        } else {
+            diag_log_value_t v = values[arg];
+            uint8_t t = types[arg++];
+            switch (conv) {
+                case 'd': case 'i':
+                    w = snprintf(buf, sizeof(buf), spec,
+                                 t == DIAG_LOG_ARG_FLOAT ? (int)v.f : (int)(int32_t)v.u);
+                    break;
+                case 'u': case 'o': case 'x': case 'X': case 'c':
+                    w = snprintf(buf, sizeof(buf), spec,
+                                 t == DIAG_LOG_ARG_FLOAT ? (unsigned)v.f : (unsigned)v.u);
+                    break;
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+                    w = snprintf(buf, sizeof(buf), spec,
+                                 t == DIAG_LOG_ARG_FLOAT ? (double)v.f : (double)(int32_t)v.u);
+                    break;
+                case 's':
+                    w = snprintf(buf, sizeof(buf), spec,
+                                 (t == DIAG_LOG_ARG_STR && v.s) ? v.s : "?");
+                    break;
+                default:   // %p, %n and unknown conversions
+                    w = snprintf(buf, sizeof(buf), "%s", spec);
+                    break;
+            }
+        }
+        if (w > 0) len = append(out, cap, len, buf, strnlen(buf, sizeof(buf)));
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static char level_letter(esp_log_level_t level)
+{
+    switch (level) {
+        case ESP_LOG_ERROR: return 'E';
+        case ESP_LOG_WARN:  return 'W';
+        case ESP_LOG_INFO:  return 'I';
+        case ESP_LOG_DEBUG: return 'D';
+        default:            return 'V';
+    }
+}
+
+static void print_record(const log_record_t *r)
+{
+    char line[LOG_LINE_MAX];
+    diag_log_format(line, sizeof(line), r->site->fmt, r->values, r->types, r->nargs);
+    if (r->suppressed) {
+        esp_log_write(r->site->level, r->site->tag, "%c (%lu) %s: %s (+%lu suppressed)\n",
+                      level_letter(r->site->level), (unsigned long)r->time_ms, r->site->tag, line,
+                      (unsigned long)r->suppressed);
+    } else {
+        esp_log_write(r->site->level, r->site->tag, "%c (%lu) %s: %s\n",
+                      level_letter(r->site->level), (unsigned long)r->time_ms, r->site->tag, line);
+    }
+}
+
+// Report sites that went quiet with repeats still uncounted
+static void print_summaries(void)
+{
+    uint32_t now = esp_log_timestamp();
+    for (diag_log_site_t *s = __atomic_load_n(&site_list, __ATOMIC_ACQUIRE); s; s = s->next) {
+        if (!__atomic_load_n(&s->suppressed, __ATOMIC_RELAXED) ||
+            now - __atomic_load_n(&s->last_ms, __ATOMIC_RELAXED) < s->interval_ms) {
+            continue;
+        }
+        uint32_t n = __atomic_exchange_n(&s->suppressed, 0, __ATOMIC_RELAXED);
+        if (n) {
+            esp_log_write(s->level, s->tag, "%c (%lu) %s: suppressed %lu more \"%s\"\n",
+                          level_letter(s->level), (unsigned long)now, s->tag,
+                          (unsigned long)n, s->fmt);
+        }
+    }
+}
+
+static void log_task(void *arg)
+{
+    log_record_t r;
+    for (;;) {
+        if (xQueueReceive(queue, &r, pdMS_TO_TICKS(DIAG_LOG_INTERVAL_MS)) == pdTRUE) {
+            print_record(&r);
+        }
+        print_summaries();
+    }
+}
+
+void diag_log_init(void)
+{
+    if (queue) return;
+    diag_stats_register("log.deferred", &stat_deferred);
+    diag_stats_register("log.suppressed", &stat_suppressed);
+    diag_stats_register("log.dropped", &stat_dropped);
+
+    queue = xQueueCreate(DIAG_LOG_QUEUE_LEN, sizeof(log_record_t));
+    if (queue) {
+        xTaskCreatePinnedToCore(log_task, "diag_log", LOG_TASK_STACK, NULL, LOG_TASK_PRIO, NULL,
+                                LOG_TASK_CORE);
+    }
+}
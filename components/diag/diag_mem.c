@@ -0,0 +1,207 @@
+// diag_mem.c - stack and heap high-water monitor with budgets
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "diag_mem.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "diag_mem";
+
+static const struct {
+    const char       *name;
+    uint32_t          caps;
+    diag_mem_budget_t budget;
+} heap_defs[DIAG_MEM_HEAP_COUNT] = {
+    [DIAG_MEM_HEAP_INTERNAL] = { "internal", MALLOC_CAP_INTERNAL,
+                                 { DIAG_MEM_INTERNAL_WARN, DIAG_MEM_INTERNAL_CRITICAL } },
+    [DIAG_MEM_HEAP_DMA]      = { "dma", MALLOC_CAP_DMA,
+                                 { DIAG_MEM_DMA_WARN, DIAG_MEM_DMA_CRITICAL } },
+};
+
+static struct {
+    char              name[configMAX_TASK_NAME_LEN];
+    diag_mem_budget_t budget;
+} budgets[DIAG_MEM_BUDGETS_MAX];
+static size_t budget_count;
+
+typedef struct {
+    diag_mem_task_t info;
+    UBaseType_t     number;     // carries the level from one sample to the next
+} task_entry_t;
+
+// Last sample; written by the timer only, copied out under the lock
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static diag_mem_heap_t heaps[DIAG_MEM_HEAP_COUNT];
+static task_entry_t tasks[DIAG_MEM_TASKS_MAX];
+static size_t task_count;
+static int64_t sampled_at;
+
+static esp_timer_handle_t timer;
+static diag_mem_safe_mode_cb_t safe_mode_cb;
+static volatile bool safe_mode;
+static char safe_mode_reason[48];
+
+static diag_mem_level_t level_of(uint32_t free, const diag_mem_budget_t *b)
+{
+    if (free < b->critical) return DIAG_MEM_CRITICAL;
+    if (free < b->warn) return DIAG_MEM_WARN;
+    return DIAG_MEM_OK;
+}
+
+// A task or heap got to a worse level
+static void breach(const char *what, const char *name, uint32_t free, diag_mem_level_t level,
+                   const diag_mem_budget_t *b)
+{
+    if (level == DIAG_MEM_WARN) {
+        ESP_LOGW(TAG, "%s %s: %lu B free, budget %lu", what, name,
+                 (unsigned long)free, (unsigned long)b->warn);
+        return;
+    }
+    ESP_LOGE(TAG, "%s %s: %lu B free, critical budget %lu", what, name,
+             (unsigned long)free, (unsigned long)b->critical);
+    if (!safe_mode) {
+        snprintf(safe_mode_reason, sizeof(safe_mode_reason), "%s %s: %lu B free",
+                 what, name, (unsigned long)free);
+        safe_mode = true;
+        ESP_LOGE(TAG, "Safe mode");
+        if (safe_mode_cb) safe_mode_cb(safe_mode_reason);
+    }
+}
+
+static diag_mem_budget_t stack_budget(const char *name)
+{
+    for (size_t i = 0; i < budget_count; i++) {
+        if (strcmp(budgets[i].name, name) == 0) return budgets[i].budget;
+    }
+    return (diag_mem_budget_t){ DIAG_MEM_STACK_WARN, DIAG_MEM_STACK_CRITICAL };
+}
+
+static diag_mem_level_t prev_task_level(UBaseType_t number)
+{
+    for (size_t i = 0; i < task_count; i++) {
+        if (tasks[i].number == number) return tasks[i].info.level;
+    }
+    return DIAG_MEM_OK;
+}
+
+// Least headroom over the warn budget first
+static int by_headroom(const void *a, const void *b)
+{
+    const diag_mem_task_t *ta = &((const task_entry_t *)a)->info;
+    const diag_mem_task_t *tb = &((const task_entry_t *)b)->info;
+    int64_t ha = (int64_t)ta->stack_free - ta->budget.warn;
+    int64_t hb = (int64_t)tb->stack_free - tb->budget.warn;
+    return (ha > hb) - (ha < hb);
+}
+
+static void sample(void *arg)
+{
+    diag_mem_heap_t h[DIAG_MEM_HEAP_COUNT];
+    for (int i = 0; i < DIAG_MEM_HEAP_COUNT; i++) {
+        h[i].name = heap_defs[i].name;
+        h[i].free = heap_caps_get_free_size(heap_defs[i].caps);
+        h[i].min_free = heap_caps_get_minimum_free_size(heap_defs[i].caps);
+        h[i].largest = heap_caps_get_largest_free_block(heap_defs[i].caps);
+        h[i].budget = heap_defs[i].budget;
+        h[i].level = level_of(h[i].min_free, &h[i].budget);
+        if (h[i].level > heaps[i].level) {
+            breach("heap", h[i].name, h[i].min_free, h[i].level, &h[i].budget);
+        }
+    }
+
+    // Scratch for the timer task; static to keep its stack small
+    static task_entry_t t[DIAG_MEM_TASKS_MAX];
+    size_t n = 0;
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    static TaskStatus_t status[DIAG_MEM_TASKS_MAX];
+    static bool too_many;
+    UBaseType_t count = uxTaskGetSystemState(status, DIAG_MEM_TASKS_MAX, NULL);
+    if (count == 0 && !too_many) {
+        ESP_LOGW(TAG, "More than %d tasks, stacks not sampled", DIAG_MEM_TASKS_MAX);
+        too_many = true;
+    }
+    for (UBaseType_t i = 0; i < count; i++) {
+        task_entry_t *e = &t[n++];
+        memset(e->info.name, 0, sizeof(e->info.name));
+        strncpy(e->info.name, status[i].pcTaskName, sizeof(e->info.name) - 1);
+        e->number = status[i].xTaskNumber;
+        e->info.stack_free = status[i].usStackHighWaterMark;
+        e->info.budget = stack_budget(e->info.name);
+        e->info.level = level_of(e->info.stack_free, &e->info.budget);
+        if (e->info.level > prev_task_level(e->number)) {
+            breach("stack", e->info.name, e->info.stack_free, e->info.level, &e->info.budget);
+        }
+    }
+    qsort(t, n, sizeof(t[0]), by_headroom);
+#endif
+
+    portENTER_CRITICAL(&lock);
+    memcpy(heaps, h, sizeof(heaps));
+    if (n) {    // else keep the last task list (and its levels)
+        memcpy(tasks, t, n * sizeof(t[0]));
+        task_count = n;
+    }
+    sampled_at = esp_timer_get_time();
+    portEXIT_CRITICAL(&lock);
+}
+
+void diag_mem_set_stack_budget(const char *task, uint32_t warn, uint32_t critical)
+{
+    size_t i = 0;
+    while (i < budget_count && strcmp(budgets[i].name, task) != 0) i++;
+    if (i == DIAG_MEM_BUDGETS_MAX) return;
+    if (i == budget_count) {
+        memset(budgets[i].name, 0, sizeof(budgets[i].name));
+        strncpy(budgets[i].name, task, sizeof(budgets[i].name) - 1);
+        budget_count++;
+    }
+    budgets[i].budget = (diag_mem_budget_t){ warn, critical };
+}
+
+void diag_mem_start(uint32_t period_ms, diag_mem_safe_mode_cb_t on_safe_mode)
+{
+    if (timer) return;
+    safe_mode_cb = on_safe_mode;
+    sample(NULL);
+
+    const esp_timer_create_args_t args = {
+        .callback = sample,
+        .name = "diag_mem",
+    };
+    if (esp_timer_create(&args, &timer) != ESP_OK ||
+        esp_timer_start_periodic(timer, (uint64_t)period_ms * 1000) != ESP_OK) {
+        ESP_LOGE(TAG, "No sampling timer, memory checked at boot only");
+    }
+}
+
+size_t diag_mem_get(diag_mem_heap_t out_heaps[DIAG_MEM_HEAP_COUNT], diag_mem_task_t *out_tasks, size_t max)
+{
+    portENTER_CRITICAL(&lock);
+    memcpy(out_heaps, heaps, sizeof(heaps));
+    size_t n = (task_count < max) ? task_count : max;
+    for (size_t i = 0; i < n; i++) out_tasks[i] = tasks[i].info;
+    portEXIT_CRITICAL(&lock);
+    return n;
+}
+
+int64_t diag_mem_sampled_at(void)
+{
+    portENTER_CRITICAL(&lock);
+    int64_t t = sampled_at;
+    portEXIT_CRITICAL(&lock);
+    return t;
+}
+
+bool diag_mem_safe_mode(void)
+{
+    return safe_mode;
+}
+
+const char *diag_mem_safe_mode_reason(void)
+{
+    return safe_mode ? safe_mode_reason : NULL;
+}
@@ -0,0 +1,95 @@
+// diag_scope.c - latency histograms (builds on the device and the host)
+#include <string.h>
+#include "diag_scope.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_rom_sys.h"
+#endif
+
+static diag_hist_t *hist_list;   // push-only, lock-free
+
+static inline int bucket_of(uint32_t ticks)
+{
+    return ticks ? 31 - __builtin_clz(ticks) : 0;
+}
+
+static void hist_register(diag_hist_t *h)
+{
+    // Two first uses racing on one histogram: only one may link it
+    bool expected = false;
+    if (!__atomic_compare_exchange_n(&h->registered, &expected, true, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+    diag_hist_t *head = __atomic_load_n(&hist_list, __ATOMIC_RELAXED);
+    do {
+        h->next = head;
+    } while (!__atomic_compare_exchange_n(&hist_list, &head, h, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void diag_hist_record(diag_hist_t *h, uint32_t ticks)
+{
+    if (!__atomic_load_n(&h->registered, __ATOMIC_RELAXED)) {
+        hist_register(h);
+    }
+    __atomic_fetch_add(&h->bucket[bucket_of(ticks)], 1, __ATOMIC_RELAXED);
+
+    uint32_t cur = __atomic_load_n(&h->max_ticks, __ATOMIC_RELAXED);
+    while (ticks > cur &&
+           !__atomic_compare_exchange_n(&h->max_ticks, &cur, ticks, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+uint32_t diag_ticks_per_us(void)
+{
+#ifdef ESP_PLATFORM
+    return esp_rom_get_cpu_ticks_per_us();
+#else
+    return 1000;
+#endif
+}
+
+const diag_hist_t *diag_hist_first(void)
+{
+    return __atomic_load_n(&hist_list, __ATOMIC_ACQUIRE);
+}
+
+uint32_t diag_hist_count(const diag_hist_t *h)
+{
+    uint32_t n = 0;
+    for (int i = 0; i < DIAG_HIST_BUCKETS; i++) {
+        n += __atomic_load_n(&h->bucket[i], __ATOMIC_RELAXED);
+    }
+    return n;
+}
+
+uint32_t diag_hist_percentile(const diag_hist_t *h, unsigned pct)
+{
+    uint32_t total = diag_hist_count(h);
+    if (total == 0) return 0;
+
+    // The top bucket's edge is no better than the largest sample seen
+    uint32_t max = __atomic_load_n(&h->max_ticks, __ATOMIC_RELAXED);
+    uint64_t target = ((uint64_t)total * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < DIAG_HIST_BUCKETS; i++) {
+        seen += __atomic_load_n(&h->bucket[i], __ATOMIC_RELAXED);
+        if (seen >= target) {
+            uint32_t upper = (i == 31) ? UINT32_MAX : (2u << i) - 1;
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+void diag_hist_reset(void)
+{
+    for (diag_hist_t *h = (diag_hist_t *)diag_hist_first(); h; h = h->next) {
+        for (int i = 0; i < DIAG_HIST_BUCKETS; i++) {
+            __atomic_store_n(&h->bucket[i], 0, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&h->max_ticks, 0, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,101 @@
+// diag_stats.c - registry of per-core counters
+#include <stdbool.h>
+#include "diag_stats.h"
+#include "esp_timer.h"
+
+typedef struct {
+    const char     *name;
+    diag_counter_t *counter;   // plain counter, or
+    diag_timer_t   *timer;     // timer
+} stat_entry_t;
+
+static stat_entry_t entries[DIAG_STATS_MAX];
+static size_t entry_count;
+static portMUX_TYPE registry_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t window_start_us;
+
+uint32_t diag_counter_read(const diag_counter_t *c)
+{
+    uint32_t sum = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        sum += __atomic_load_n(&c->core[i], __ATOMIC_RELAXED);
+    }
+    return sum;
+}
+
+uint32_t diag_counter_read_max(const diag_counter_t *c)
+{
+    uint32_t max = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        uint32_t v = __atomic_load_n(&c->core[i], __ATOMIC_RELAXED);
+        if (v > max) max = v;
+    }
+    return max;
+}
+
+static void counter_clear(diag_counter_t *c)
+{
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        __atomic_store_n(&c->core[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+static void add_entry(const char *name, diag_counter_t *c, diag_timer_t *t)
+{
+    portENTER_CRITICAL(&registry_lock);
+    if (entry_count < DIAG_STATS_MAX) {
+        entries[entry_count] = (stat_entry_t){ .name = name, .counter = c, .timer = t };
+        __atomic_store_n(&entry_count, entry_count + 1, __ATOMIC_RELEASE);
+    }
+    portEXIT_CRITICAL(&registry_lock);
+}
+
+void diag_stats_register(const char *name, diag_counter_t *c)
+{
+    add_entry(name, c, NULL);
+}
+
+void diag_stats_register_timer(const char *name, diag_timer_t *t)
+{
+    add_entry(name, NULL, t);
+}
+
+bool diag_stats_get(size_t i, diag_stat_value_t *out)
+{
+    // Entries are never removed, so a published index stays valid
+    if (i >= __atomic_load_n(&entry_count, __ATOMIC_ACQUIRE)) return false;
+    const stat_entry_t *e = &entries[i];
+
+    out->name = e->name;
+    out->is_timer = (e->timer != NULL);
+    if (e->timer) {
+        out->value = diag_counter_read(&e->timer->count);
+        out->total_us = diag_counter_read(&e->timer->total_us);
+        out->max_us = diag_counter_read_max(&e->timer->max_us);
+    } else {
+        out->value = diag_counter_read(e->counter);
+        out->total_us = 0;
+        out->max_us = 0;
+    }
+    return true;
+}
+
+void diag_stats_reset(void)
+{
+    size_t n = __atomic_load_n(&entry_count, __ATOMIC_ACQUIRE);
+    for (size_t i = 0; i < n; i++) {
+        if (entries[i].timer) {
+            counter_clear(&entries[i].timer->count);
+            counter_clear(&entries[i].timer->total_us);
+            counter_clear(&entries[i].timer->max_us);
+        } else {
+            counter_clear(entries[i].counter);
+        }
+    }
+    window_start_us = esp_timer_get_time();
+}
+
+uint64_t diag_stats_window_us(void)
+{
+    return (uint64_t)(esp_timer_get_time() - window_start_us);
+}
@@ -0,0 +1,82 @@
+// diag_tasks.c - per-task CPU load from FreeRTOS run-time stats
+#include <stdlib.h>
+#include <string.h>
+#include "diag_tasks.h"
+#include "sdkconfig.h"
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+// Counters of the previous sample, by task number
+static struct {
+    UBaseType_t number;
+    uint32_t    run;
+} prev[DIAG_TASKS_MAX];
+static size_t prev_count;
+static uint32_t prev_total;
+
+// Zero for a task that did not exist at the previous sample
+static uint32_t prev_run(UBaseType_t number)
+{
+    for (size_t i = 0; i < prev_count; i++) {
+        if (prev[i].number == number) return prev[i].run;
+    }
+    return 0;
+}
+
+static int by_load(const void *a, const void *b)
+{
+    uint32_t ra = ((const diag_task_info_t *)a)->run_us;
+    uint32_t rb = ((const diag_task_info_t *)b)->run_us;
+    return (ra < rb) - (ra > rb);
+}
+
+size_t diag_tasks_sample(diag_task_info_t *out, size_t max, uint32_t *window_us)
+{
+    // Tasks created between the count and the snapshot are missed until the next sample
+    UBaseType_t n = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t *status = malloc(n * sizeof(TaskStatus_t));
+    if (!status) {
+        *window_us = 0;
+        return 0;
+    }
+    uint32_t total;
+    n = uxTaskGetSystemState(status, n, &total);
+
+    uint32_t window = total - prev_total;
+    size_t count = 0;
+    for (UBaseType_t i = 0; i < n && count < max; i++) {
+        const TaskStatus_t *s = &status[i];
+        diag_task_info_t *t = &out[count++];
+        memset(t->name, 0, sizeof(t->name));
+        strncpy(t->name, s->pcTaskName, sizeof(t->name) - 1);
+        BaseType_t core = xTaskGetCoreID(s->xHandle);
+        t->core = (core == tskNO_AFFINITY) ? -1 : (int)core;
+        t->priority = s->uxCurrentPriority;
+        t->stack_free = s->usStackHighWaterMark;
+        t->run_us = s->ulRunTimeCounter - prev_run(s->xTaskNumber);
+        t->load = window ? 100.0f * t->run_us / window : 0.0f;
+    }
+
+    prev_count = 0;
+    for (UBaseType_t i = 0; i < n && prev_count < DIAG_TASKS_MAX; i++) {
+        prev[prev_count].number = status[i].xTaskNumber;
+        prev[prev_count].run = status[i].ulRunTimeCounter;
+        prev_count++;
+    }
+    prev_total = total;
+    free(status);
+
+    qsort(out, count, sizeof(out[0]), by_load);
+    *window_us = window;
+    return count;
+}
+
+#else
+
+size_t diag_tasks_sample(diag_task_info_t *out, size_t max, uint32_t *window_us)
+{
+    *window_us = 0;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,218 @@
+// diag_trace.c - event capture buffer and its serialization
+#include <string.h>
+#include "diag_trace.h"
+#include "diag_scope.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "esp_ipc.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+
+bool diag_trace_active;
+
+// A power of two keeps slot = n % DIAG_TRACE_EVENTS continuous when n wraps
+_Static_assert((DIAG_TRACE_EVENTS & (DIAG_TRACE_EVENTS - 1)) == 0, "DIAG_TRACE_EVENTS must be a power of two");
+
+static diag_trace_event_t events[DIAG_TRACE_EVENTS];
+static uint32_t next_event;       // events claimed since start; slot = n % DIAG_TRACE_EVENTS
+static uint32_t written_events;   // events completely written
+
+static const char *names[DIAG_TRACE_MAX_NAMES];
+static uint16_t name_count;
+static portMUX_TYPE name_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static diag_trace_clock_t clocks[portNUM_PROCESSORS];       // at start
+static diag_trace_clock_t end_clocks[portNUM_PROCESSORS];   // at stop, if stop_sampled
+static bool stop_sampled;
+
+uint16_t diag_trace_intern(const char *name)
+{
+    uint16_t id = 0;
+    portENTER_CRITICAL(&name_lock);
+    for (uint16_t i = 0; i < name_count; i++) {
+        if (names[i] == name || strcmp(names[i], name) == 0) {
+            id = i + 1;
+            break;
+        }
+    }
+    if (!id && name_count < DIAG_TRACE_MAX_NAMES) {
+        names[name_count++] = name;
+        id = name_count;
+    }
+    portEXIT_CRITICAL(&name_lock);
+    return id;
+}
+
+void diag_trace_emit(uint16_t name, diag_trace_type_t type, uint32_t arg)
+{
+    // Overwrites the oldest event once the ring is full
+    uint32_t i = __atomic_fetch_add(&next_event, 1, __ATOMIC_RELAXED);
+    diag_trace_event_t *e = &events[i % DIAG_TRACE_EVENTS];
+    e->cycles = (uint32_t)esp_cpu_get_cycle_count();
+    e->task = (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+    e->name = name;
+    e->type = (uint8_t)type;
+    e->core = (uint8_t)xPortGetCoreID();
+    e->arg = arg;
+    __atomic_fetch_add(&written_events, 1, __ATOMIC_RELEASE);
+}
+
+// Runs on each core in turn (esp_ipc)
+static void sample_clock(void *arg)
+{
+    diag_trace_clock_t *c = arg;
+    c->cycles = (uint32_t)esp_cpu_get_cycle_count();
+    c->reserved = 0;
+    c->time_us = esp_timer_get_time();
+}
+
+static void sample_clocks(diag_trace_clock_t *out)
+{
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        if (core == xPortGetCoreID()) {
+            sample_clock(&out[core]);
+        } else {
+            esp_ipc_call_blocking(core, sample_clock, &out[core]);
+        }
+    }
+}
+
+void diag_trace_start(void)
+{
+    diag_trace_stop();
+    sample_clocks(clocks);
+    stop_sampled = false;
+    __atomic_store_n(&written_events, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&next_event, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&diag_trace_active, true, __ATOMIC_RELEASE);
+}
+
+void diag_trace_stop(void)
+{
+    // A wrapped ring keeps the newest events, which may be more than one
+    // counter wrap after start: sample the clocks again as their reference.
+    // Safe mode stops a capture by clearing diag_trace_active alone, which
+    // leaves only the start clocks.
+    if (__atomic_exchange_n(&diag_trace_active, false, __ATOMIC_ACQ_REL)) {
+        sample_clocks(end_clocks);
+        stop_sampled = true;
+    }
+
+    // Let emitters that already claimed a slot finish writing it
+    uint32_t claimed = __atomic_load_n(&next_event, __ATOMIC_ACQUIRE);
+    for (int wait = 0; wait < 10 && __atomic_load_n(&written_events, __ATOMIC_ACQUIRE) != claimed; wait++) {
+        vTaskDelay(1);
+    }
+}
+
+static bool wrapped(void)
+{
+    return __atomic_load_n(&written_events, __ATOMIC_ACQUIRE) > DIAG_TRACE_EVENTS;
+}
+
+size_t diag_trace_count(void)
+{
+    uint32_t n = __atomic_load_n(&written_events, __ATOMIC_ACQUIRE);
+    return n > DIAG_TRACE_EVENTS ? DIAG_TRACE_EVENTS : n;
+}
+
+// Distinct tasks in the capture, named while they still exist
+static size_t collect_tasks(size_t n_events, diag_trace_task_t *out, size_t max)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < n_events; i++) {
+        uint32_t handle = events[i].task;
+        size_t k = 0;
+        while (k < n && out[k].handle != handle) k++;
+        if (k < n || n == max) continue;
+
+        out[n].handle = handle;
+        memset(out[n].name, 0, sizeof(out[n].name));
+        const char *name = handle ? pcTaskGetName((TaskHandle_t)(uintptr_t)handle) : NULL;
+        strncpy(out[n].name, name ? name : "?", sizeof(out[n].name) - 1);
+        n++;
+    }
+    return n;
+}
+
+#define MAX_TRACE_TASKS 24
+
+static size_t names_size(uint16_t n_names)
+{
+    size_t len = 0;
+    for (uint16_t i = 0; i < n_names; i++) {
+        size_t l = strlen(names[i]);
+        len += 1 + (l > 255 ? 255 : l);
+    }
+    return len;
+}
+
+// Stops the capture and describes its serialized form
+static size_t layout(uint16_t *n_names, size_t *n_events, diag_trace_task_t *tasks, size_t *n_tasks)
+{
+    diag_trace_stop();
+    *n_names = __atomic_load_n(&name_count, __ATOMIC_ACQUIRE);
+    *n_events = diag_trace_count();
+    *n_tasks = collect_tasks(*n_events, tasks, MAX_TRACE_TASKS);
+    return sizeof(diag_trace_blob_hdr_t) + sizeof(clocks) + names_size(*n_names) +
+           *n_tasks * sizeof(diag_trace_task_t) + *n_events * sizeof(diag_trace_event_t) +
+           sizeof(uint32_t);
+}
+
+size_t diag_trace_blob_size(void)
+{
+    diag_trace_task_t tasks[MAX_TRACE_TASKS];
+    uint16_t n_names;
+    size_t n_events, n_tasks;
+    return layout(&n_names, &n_events, tasks, &n_tasks);
+}
+
+size_t diag_trace_serialize(uint8_t *out, size_t cap)
+{
+    diag_trace_task_t tasks[MAX_TRACE_TASKS];
+    uint16_t n_names;
+    size_t n_events, n_tasks;
+    if (layout(&n_names, &n_events, tasks, &n_tasks) > cap) return 0;
+
+    // Oldest retained event first; the clocks the converter unwraps from
+    bool ring_wrapped = wrapped();
+    bool from_end = ring_wrapped && stop_sampled;
+    uint32_t oldest = ring_wrapped ? __atomic_load_n(&next_event, __ATOMIC_ACQUIRE) % DIAG_TRACE_EVENTS : 0;
+
+    diag_trace_blob_hdr_t hdr = {
+        .magic = DIAG_TRACE_MAGIC,
+        .version = DIAG_TRACE_VERSION,
+        .cores = portNUM_PROCESSORS,
+        .flags = (ring_wrapped ? DIAG_TRACE_FLAG_WRAPPED : 0) | (from_end ? DIAG_TRACE_FLAG_END_CLOCKS : 0),
+        .ticks_per_us = diag_ticks_per_us(),
+        .event_count = (uint32_t)n_events,
+        .name_count = n_names,
+        .task_count = (uint16_t)n_tasks,
+    };
+
+    uint8_t *p = out;
+    memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+    memcpy(p, from_end ? end_clocks : clocks, sizeof(clocks));
+    p += sizeof(clocks);
+    for (uint16_t i = 0; i < n_names; i++) {
+        size_t l = strlen(names[i]);
+        if (l > 255) l = 255;
+        *p++ = (uint8_t)l;
+        memcpy(p, names[i], l);
+        p += l;
+    }
+    memcpy(p, tasks, n_tasks * sizeof(tasks[0]));
+    p += n_tasks * sizeof(tasks[0]);
+    memcpy(p, &events[oldest], (n_events - oldest) * sizeof(events[0]));
+    p += (n_events - oldest) * sizeof(events[0]);
+    memcpy(p, events, oldest * sizeof(events[0]));
+    p += oldest * sizeof(events[0]);
+
+    // Standard CRC-32 (same as zlib.crc32 on the host)
+    uint32_t crc = esp_rom_crc32_le(0, out, (uint32_t)(p - out));
+    memcpy(p, &crc, sizeof(crc));
+    p += sizeof(crc);
+    return (size_t)(p - out);
+}
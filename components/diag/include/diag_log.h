@@ -0,0 +1,146 @@
+// diag_log.h - deferred, rate-limited logging for hot paths
+//
+// ESP_LOGx formats and writes the line to the UART in the calling task; at
+// 115200 baud a 60-character line blocks for about 5 ms. DIAG_LOGx instead
+// copies the format pointer and up to DIAG_LOG_MAX_ARGS arguments into a
+// queue record, and a low-priority task formats and prints it later:
+//
+//     DIAG_LOGW(TAG, "Invalid encrypted data size: %d", encr_size);
+//
+// The timestamp is taken at the call. The format must be a string literal
+// and %s arguments must be static strings (only the pointer is queued).
+// Integer arguments are stored as 32 bits and floats as float, so length
+// modifiers (%lu, %lld) are ignored and 64-bit values are truncated.
+//
+// Each call site is its own rate-limit key: after a line is printed, further
+// lines from the same site within DIAG_LOG_INTERVAL_MS are only counted. The
+// count is appended to the next printed line ("(+12 suppressed)") or, if the
+// site falls silent, printed as a summary once the interval has passed.
+// Sites that already log once per event worth keeping (a new device) use
+// DIAG_LOG_EVERY(0, ...) to opt out of the limit.
+// The runtime level of the tag (`log <tag> <level>`) is applied when the
+// line is printed.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef DIAG_LOG_INTERVAL_MS
+#define DIAG_LOG_INTERVAL_MS 1000   // per call site
+#endif
+
+#ifndef DIAG_LOG_QUEUE_LEN
+#define DIAG_LOG_QUEUE_LEN 32       // records of 76 bytes
+#endif
+
+#define DIAG_LOG_MAX_ARGS 12
+
+typedef enum {
+    DIAG_LOG_ARG_INT,
+    DIAG_LOG_ARG_FLOAT,
+    DIAG_LOG_ARG_STR,
+} diag_log_arg_type_t;
+
+typedef union {
+    uint32_t    u;
+    float       f;
+    const char *s;
+} diag_log_value_t;
+
+typedef struct {
+    diag_log_value_t v;
+    uint8_t          type;   // diag_log_arg_type_t
+} diag_log_arg_t;
+
+// One per call site, registered on first use
+typedef struct diag_log_site {
+    const char           *fmt;
+    esp_log_level_t       level;
+    uint32_t              interval_ms;  // rate limit, 0 for none
+    const char           *tag;
+    bool                  registered;
+    uint32_t              last_ms;      // last printed record
+    uint32_t              suppressed;   // not printed since then
+    struct diag_log_site *next;
+} diag_log_site_t;
+
+static inline diag_log_arg_t diag_log_arg_int(uint32_t v)
+{
+    return (diag_log_arg_t){ .v.u = v, .type = DIAG_LOG_ARG_INT };
+}
+
+static inline diag_log_arg_t diag_log_arg_float(double v)
+{
+    return (diag_log_arg_t){ .v.f = (float)v, .type = DIAG_LOG_ARG_FLOAT };
+}
+
+static inline diag_log_arg_t diag_log_arg_str(const char *v)
+{
+    return (diag_log_arg_t){ .v.s = v, .type = DIAG_LOG_ARG_STR };
+}
+
+#define DIAG_LOG_ARG(x) _Generic((x),              \
+    float: diag_log_arg_float,                     \
+    double: diag_log_arg_float,                    \
+    char *: diag_log_arg_str,                      \
+    const char *: diag_log_arg_str,                \
+    default: diag_log_arg_int)(x)
+
+// Queue a record (or count it as suppressed); args may be NULL when n is 0
+void diag_log_push(diag_log_site_t *site, const char *tag,
+                   const diag_log_arg_t *args, size_t n);
+
+// Argument list to a diag_log_arg_t initializer, each element followed by a comma
+#define DIAG_LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, n, ...) n
+#define DIAG_LOG_NARGS(...) \
+    DIAG_LOG_NARGS_(_, ##__VA_ARGS__, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DIAG_LOG_MAP_0()
+#define DIAG_LOG_MAP_1(a)       DIAG_LOG_ARG(a),
+#define DIAG_LOG_MAP_2(a, ...)  DIAG_LOG_ARG(a), DIAG_LOG_MAP_1(__VA_ARGS__)
+#define DIAG_LOG_MAP_3(a, ...)  DIAG_LOG_ARG(a), DIAG_LOG_MAP_2(__VA_ARGS__)
+#define DIAG_LOG_MAP_4(a, ...)  DIAG_LOG_ARG(a), DIAG_LOG_MAP_3(__VA_ARGS__)
+#define DIAG_LOG_MAP_5(a, ...)  DIAG_LOG_ARG(a), DIAG_LOG_MAP_4(__VA_ARGS__)
+#define DIAG_LOG_MAP_6(a, ...)  DIAG_LOG_ARG(a), DIAG_LOG_MAP_5(__VA_ARGS__)
+#define DIAG_LOG_MAP_7(a, ...)  DIAG_LOG_ARG(a), DIAG_LOG_MAP_6(__VA_ARGS__)
+#define DIAG_LOG_MAP_8(a, ...)  DIAG_LOG_ARG(a), DIAG_LOG_MAP_7(__VA_ARGS__)
+#define DIAG_LOG_MAP_9(a, ...)  DIAG_LOG_ARG(a), DIAG_LOG_MAP_8(__VA_ARGS__)
+#define DIAG_LOG_MAP_10(a, ...) DIAG_LOG_ARG(a), DIAG_LOG_MAP_9(__VA_ARGS__)
+#define DIAG_LOG_MAP_11(a, ...) DIAG_LOG_ARG(a), DIAG_LOG_MAP_10(__VA_ARGS__)
+#define DIAG_LOG_MAP_12(a, ...) DIAG_LOG_ARG(a), DIAG_LOG_MAP_11(__VA_ARGS__)
+#define DIAG_LOG_MAP_13(a, ...) DIAG_LOG_ARG(a), DIAG_LOG_MAP_12(__VA_ARGS__)
+#define DIAG_LOG_CAT_(a, b) a##b
+#define DIAG_LOG_CAT(a, b) DIAG_LOG_CAT_(a, b)
+#define DIAG_LOG_ARGS(...) DIAG_LOG_CAT(DIAG_LOG_MAP_, DIAG_LOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+#define DIAG_LOG_EVERY(interval_, level_, tag_, fmt_, ...) do {                    \
+    if ((level_) <= LOG_LOCAL_LEVEL) {                                             \
+        _Static_assert(DIAG_LOG_NARGS(__VA_ARGS__) <= DIAG_LOG_MAX_ARGS,           \
+                       "too many DIAG_LOG arguments");                             \
+        static diag_log_site_t diag_log_site_ = {                                  \
+            .fmt = (fmt_), .level = (level_), .interval_ms = (interval_) };        \
+        const diag_log_arg_t diag_log_args_[] = { DIAG_LOG_ARGS(__VA_ARGS__) { .type = 0 } }; \
+        diag_log_push(&diag_log_site_, (tag_), diag_log_args_,                    \
+                      DIAG_LOG_NARGS(__VA_ARGS__));                                \
+    }                                                                              \
+} while (0)
+
+#define DIAG_LOGE(tag, fmt, ...) DIAG_LOG_EVERY(DIAG_LOG_INTERVAL_MS, ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define DIAG_LOGW(tag, fmt, ...) DIAG_LOG_EVERY(DIAG_LOG_INTERVAL_MS, ESP_LOG_WARN,  tag, fmt, ##__VA_ARGS__)
+#define DIAG_LOGI(tag, fmt, ...) DIAG_LOG_EVERY(DIAG_LOG_INTERVAL_MS, ESP_LOG_INFO,  tag, fmt, ##__VA_ARGS__)
+#define DIAG_LOGD(tag, fmt, ...) DIAG_LOG_EVERY(DIAG_LOG_INTERVAL_MS, ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+
+// Create the queue and the formatter task; records pushed before are dropped
+void diag_log_init(void);
+
+// Format fmt with queued values into out (always terminated); returns the length
+size_t diag_log_format(char *out, size_t cap, const char *fmt,
+                       const diag_log_value_t *values, const uint8_t *types, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
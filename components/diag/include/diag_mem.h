@@ -0,0 +1,104 @@
+// diag_mem.h - stack and heap high-water monitor with budgets
+//
+// A periodic esp_timer samples the least free stack of every task
+// (uxTaskGetSystemState, needs CONFIG_FREERTOS_USE_TRACE_FACILITY) and the
+// free, least-ever-free and largest free block of the internal and the
+// DMA-capable heap. Stacks and heaps are checked against a budget of bytes
+// that must stay free, with two levels:
+//
+//   warn      one warning per task or heap and level, in the log
+//   critical  also latches safe mode: the handler given to diag_mem_start()
+//             is called once (from the esp_timer task, so keep it short)
+//
+// Heaps are judged by their least-ever-free size and stacks by their
+// high-water mark, so a breach is permanent until reboot: it shows the
+// worst case, not the moment. Tasks use DIAG_MEM_STACK_WARN/CRITICAL unless
+// given their own budget with diag_mem_set_stack_budget().
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef DIAG_MEM_STACK_WARN
+#define DIAG_MEM_STACK_WARN        512
+#endif
+#ifndef DIAG_MEM_STACK_CRITICAL
+#define DIAG_MEM_STACK_CRITICAL    256
+#endif
+#ifndef DIAG_MEM_INTERNAL_WARN
+#define DIAG_MEM_INTERNAL_WARN     (16 * 1024)
+#endif
+#ifndef DIAG_MEM_INTERNAL_CRITICAL
+#define DIAG_MEM_INTERNAL_CRITICAL (6 * 1024)
+#endif
+#ifndef DIAG_MEM_DMA_WARN
+#define DIAG_MEM_DMA_WARN          (12 * 1024)
+#endif
+#ifndef DIAG_MEM_DMA_CRITICAL
+#define DIAG_MEM_DMA_CRITICAL      (4 * 1024)
+#endif
+
+#define DIAG_MEM_TASKS_MAX   32     // tasks sampled
+#define DIAG_MEM_BUDGETS_MAX 8      // tasks with their own stack budget
+
+typedef enum {
+    DIAG_MEM_OK = 0,
+    DIAG_MEM_WARN,
+    DIAG_MEM_CRITICAL,
+} diag_mem_level_t;
+
+typedef struct {
+    uint32_t warn;          // fewer bytes free → warning
+    uint32_t critical;      // fewer bytes free → safe mode
+} diag_mem_budget_t;
+
+typedef enum {
+    DIAG_MEM_HEAP_INTERNAL = 0,
+    DIAG_MEM_HEAP_DMA,
+    DIAG_MEM_HEAP_COUNT,
+} diag_mem_heap_id_t;
+
+typedef struct {
+    const char       *name;         // "internal", "dma"
+    uint32_t          free;
+    uint32_t          min_free;     // least free since boot (checked)
+    uint32_t          largest;      // largest free block
+    diag_mem_budget_t budget;
+    diag_mem_level_t  level;
+} diag_mem_heap_t;
+
+typedef struct {
+    char              name[configMAX_TASK_NAME_LEN];
+    uint32_t          stack_free;   // high-water mark: least free stack ever, bytes
+    diag_mem_budget_t budget;
+    diag_mem_level_t  level;
+} diag_mem_task_t;
+
+// Called once, on the first critical breach; reason is e.g. "stack display: 212 B free"
+typedef void (*diag_mem_safe_mode_cb_t)(const char *reason);
+
+// Own budget for a task (by name); call before diag_mem_start()
+void diag_mem_set_stack_budget(const char *task, uint32_t warn, uint32_t critical);
+
+// Sample now and then every period_ms; on_safe_mode may be NULL
+void diag_mem_start(uint32_t period_ms, diag_mem_safe_mode_cb_t on_safe_mode);
+
+// Last sample: heaps (DIAG_MEM_HEAP_COUNT entries) and tasks, lowest stack
+// headroom (free minus warn budget) first; returns the number of tasks
+size_t diag_mem_get(diag_mem_heap_t heaps[DIAG_MEM_HEAP_COUNT], diag_mem_task_t *tasks, size_t max);
+
+// Microseconds since boot of the last sample (0 before the first)
+int64_t diag_mem_sampled_at(void);
+
+// Safe mode latched by a critical breach; reason or NULL
+bool diag_mem_safe_mode(void);
+const char *diag_mem_safe_mode_reason(void);
+
+#ifdef __cplusplus
+}
+#endif
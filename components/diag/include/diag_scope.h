@@ -0,0 +1,112 @@
+// diag_scope.h - scope timing into log2 latency histograms
+//
+// A scope reads a free-running tick counter on entry and exit and adds the
+// difference to a per-scope histogram whose bucket i counts durations of
+// [2^i, 2^(i+1)) ticks. On the device a tick is one CPU cycle
+// (esp_cpu_get_cycle_count), on the host one nanosecond (clock_gettime), and
+// the dump converts both to microseconds so the numbers are comparable.
+//
+//     DIAG_SCOPE(aes_decrypt);              // until the end of the block
+//
+//     DIAG_SCOPE_BEGIN(draw_ui);            // explicit pair
+//     ...
+//     DIAG_SCOPE_END(draw_ui);
+//
+// Histograms are static, registered on first use and never freed. The cycle
+// counter is per core: a task that migrates inside a scope records garbage
+// (it lands in the top buckets), so scopes belong in pinned tasks or short
+// sections. Building with DIAG_SCOPE_ENABLE=0 removes every scope.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_cpu.h"
+#else
+#include <time.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef DIAG_SCOPE_ENABLE
+#define DIAG_SCOPE_ENABLE 1
+#endif
+
+#define DIAG_HIST_BUCKETS 32
+
+typedef struct diag_hist {
+    const char       *name;
+    uint32_t          bucket[DIAG_HIST_BUCKETS];
+    uint32_t          max_ticks;
+    bool              registered;
+    struct diag_hist *next;
+} diag_hist_t;
+
+#define DIAG_HIST_INIT(label) { .name = (label) }
+
+typedef struct {
+    diag_hist_t *hist;
+    uint32_t     start;
+} diag_scope_t;
+
+static inline uint32_t diag_ticks(void)
+{
+#ifdef ESP_PLATFORM
+    return (uint32_t)esp_cpu_get_cycle_count();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+// Add one duration (registers the histogram on first use)
+void diag_hist_record(diag_hist_t *h, uint32_t ticks);
+
+static inline void diag_scope_exit(diag_scope_t *s)
+{
+    diag_hist_record(s->hist, diag_ticks() - s->start);
+}
+
+#if DIAG_SCOPE_ENABLE
+
+#define DIAG_SCOPE(name)                                                        \
+    static diag_hist_t diag_hist_##name = DIAG_HIST_INIT(#name);                \
+    diag_scope_t diag_scope_##name __attribute__((cleanup(diag_scope_exit))) = \
+        { &diag_hist_##name, diag_ticks() }
+
+#define DIAG_SCOPE_BEGIN(name)                                                  \
+    static diag_hist_t diag_hist_##name = DIAG_HIST_INIT(#name);                \
+    uint32_t diag_start_##name = diag_ticks()
+
+#define DIAG_SCOPE_END(name) \
+    diag_hist_record(&diag_hist_##name, diag_ticks() - diag_start_##name)
+
+#else
+
+#define DIAG_SCOPE(name)       do { } while (0)
+#define DIAG_SCOPE_BEGIN(name) do { } while (0)
+#define DIAG_SCOPE_END(name)   do { } while (0)
+
+#endif
+
+// Ticks per microsecond (CPU MHz on the device, 1000 on the host)
+uint32_t diag_ticks_per_us(void);
+
+// Registered histograms, most recently registered first (NULL-terminated list)
+const diag_hist_t *diag_hist_first(void);
+
+// Count and approximate percentile (upper edge of the bucket, capped at the
+// maximum), in ticks
+uint32_t diag_hist_count(const diag_hist_t *h);
+uint32_t diag_hist_percentile(const diag_hist_t *h, unsigned pct);
+
+// Zero all registered histograms
+void diag_hist_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
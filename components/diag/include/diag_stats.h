@@ -0,0 +1,90 @@
+// diag_stats.h - cheap event counters and timers for the serial console
+//
+// A counter keeps one slot per core; each core only adds to its own slot
+// with a relaxed atomic, so the hot paths (GAP handler, SPI writes) never
+// contend and never take a lock. Readers sum the slots (or take the largest
+// for maxima). Counters are 32 bit and wrap; reset them before a measurement.
+//
+// Modules define their counters statically and register them once at init;
+// the console walks the registry by name.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DIAG_STATS_MAX 48   // registered counters and timers
+
+typedef struct {
+    uint32_t core[portNUM_PROCESSORS];
+} diag_counter_t;
+
+// Call count, total and maximum duration of a code section, in microseconds
+typedef struct {
+    diag_counter_t count;
+    diag_counter_t total_us;
+    diag_counter_t max_us;
+} diag_timer_t;
+
+static inline void diag_counter_add(diag_counter_t *c, uint32_t n)
+{
+    __atomic_fetch_add(&c->core[xPortGetCoreID()], n, __ATOMIC_RELAXED);
+}
+
+static inline void diag_counter_inc(diag_counter_t *c)
+{
+    diag_counter_add(c, 1);
+}
+
+// Raise the calling core's slot to v (other tasks on the core may race)
+static inline void diag_counter_max(diag_counter_t *c, uint32_t v)
+{
+    uint32_t *slot = &c->core[xPortGetCoreID()];
+    uint32_t cur = __atomic_load_n(slot, __ATOMIC_RELAXED);
+    while (v > cur &&
+           !__atomic_compare_exchange_n(slot, &cur, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static inline void diag_timer_record(diag_timer_t *t, uint32_t us)
+{
+    diag_counter_inc(&t->count);
+    diag_counter_add(&t->total_us, us);
+    diag_counter_max(&t->max_us, us);
+}
+
+// Sum of all cores
+uint32_t diag_counter_read(const diag_counter_t *c);
+
+// Largest slot (for maxima)
+uint32_t diag_counter_read_max(const diag_counter_t *c);
+
+// Register for the console; name is "module.what", kept by pointer
+void diag_stats_register(const char *name, diag_counter_t *c);
+void diag_stats_register_timer(const char *name, diag_timer_t *t);
+
+typedef struct {
+    const char *name;
+    bool        is_timer;
+    uint32_t    value;      // counters: sum; timers: call count
+    uint32_t    total_us;   // timers only
+    uint32_t    max_us;     // timers only
+} diag_stat_value_t;
+
+// Snapshot entry i of the registry; false past the end
+bool diag_stats_get(size_t i, diag_stat_value_t *out);
+
+// Zero all registered counters and timers
+void diag_stats_reset(void);
+
+// Microseconds since boot or the last reset
+uint64_t diag_stats_window_us(void);
+
+#ifdef __cplusplus
+}
+#endif
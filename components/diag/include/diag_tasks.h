@@ -0,0 +1,41 @@
+// diag_tasks.h - per-task CPU load from FreeRTOS run-time stats
+//
+// Each sample reads the run-time counters of all tasks and reports what each
+// task used since the previous sample, as a percentage of one core. The
+// IDLE task of a core gives that core's free time. Needs
+// CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+// (esp_timer clock); without them a sample returns no tasks.
+//
+// The 32-bit counters count microseconds and wrap after ~71 minutes, so
+// samples further apart than that report nonsense. Sample from one task
+// only (the console): the previous counters are kept in static storage.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DIAG_TASKS_MAX 32   // tasks tracked between samples
+
+typedef struct {
+    char        name[configMAX_TASK_NAME_LEN];
+    int         core;         // pinned core, or -1 for no affinity
+    UBaseType_t priority;     // current (may be inherited)
+    uint32_t    stack_free;   // high-water mark: least free stack ever, bytes
+    uint32_t    run_us;       // run time since the previous sample
+    float       load;         // run_us in % of the window, i.e. of one core (all
+                              // tasks add up to portNUM_PROCESSORS x 100)
+} diag_task_info_t;
+
+// Sample all tasks into out (up to max, sorted by load, highest first);
+// returns the number of tasks and sets *window_us to the time since the
+// previous sample (since boot for the first one)
+size_t diag_tasks_sample(diag_task_info_t *out, size_t max, uint32_t *window_us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,153 @@
+// diag_trace.h - in-RAM timeline of begin/end/instant events
+//
+// A capture records into a ring of DIAG_TRACE_EVENTS from `diag_trace_start()`
+// until it is stopped; once the ring is full each event overwrites the
+// oldest, so a dump holds the moments before the stop. Each event is 16
+// bytes: CPU cycle timestamp, task handle, core, event type and name id.
+// While no capture runs, a trace point costs one load and a branch.
+//
+//     DIAG_TRACE_BEGIN(render);  ...  DIAG_TRACE_END(render);
+//     DIAG_TRACE_SCOPE(ble_adv);          // until the end of the block
+//     DIAG_TRACE_INSTANT(frame, slot);    // with a 32-bit argument
+//
+// Cycle counters are per core and not synchronized, so the start of a
+// capture samples (cycles, esp_timer) on every core, and so does the stop
+// once the ring has wrapped; the host converter (scripts/trace_to_chrome.py)
+// maps each core's events onto that common clock and writes Chrome trace
+// JSON for Perfetto. Events of one core must not be further apart than one
+// counter wrap (2^32 cycles, ~27 s at 160 MHz), nor from the clock sample.
+//
+// Building with DIAG_TRACE_ENABLE=0 removes every trace point.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef DIAG_TRACE_ENABLE
+#define DIAG_TRACE_ENABLE 1
+#endif
+
+#ifndef DIAG_TRACE_EVENTS
+#define DIAG_TRACE_EVENTS 512      // 16 bytes each, a power of two
+#endif
+
+#define DIAG_TRACE_MAX_NAMES 48
+
+typedef enum {
+    DIAG_TRACE_TYPE_BEGIN = 'B',
+    DIAG_TRACE_TYPE_END = 'E',
+    DIAG_TRACE_TYPE_INSTANT = 'i',
+} diag_trace_type_t;
+
+// Blob layout (little endian), see scripts/trace_to_chrome.py:
+//   diag_trace_blob_hdr_t
+//   diag_trace_clock_t[cores]
+//   names[name_count]:  uint8 len, chars (no terminator), ids start at 1
+//   diag_trace_task_t[task_count]
+//   diag_trace_event_t[event_count], oldest first
+//   uint32 CRC-32 of everything above
+#define DIAG_TRACE_MAGIC   "VTRC"
+#define DIAG_TRACE_VERSION 2
+
+#define DIAG_TRACE_FLAG_WRAPPED    0x01   // the ring overwrote older events
+#define DIAG_TRACE_FLAG_END_CLOCKS 0x02   // clocks were sampled at the stop, after the last event
+
+typedef struct __attribute__((packed)) {
+    char     magic[4];
+    uint16_t version;
+    uint8_t  cores;
+    uint8_t  flags;            // DIAG_TRACE_FLAG_*
+    uint32_t ticks_per_us;
+    uint32_t event_count;
+    uint16_t name_count;
+    uint16_t task_count;
+} diag_trace_blob_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t cycles;
+    uint32_t reserved;
+    int64_t  time_us;          // esp_timer_get_time() at the same instant
+} diag_trace_clock_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t handle;
+    char     name[16];
+} diag_trace_task_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t cycles;
+    uint32_t task;             // TaskHandle_t of the emitting task
+    uint16_t name;             // 1-based index into the name table
+    uint8_t  type;             // diag_trace_type_t
+    uint8_t  core;
+    uint32_t arg;
+} diag_trace_event_t;
+
+extern bool diag_trace_active;
+
+// Intern a static string; returns its id (0 if the name table is full)
+uint16_t diag_trace_intern(const char *name);
+
+void diag_trace_emit(uint16_t name, diag_trace_type_t type, uint32_t arg);
+
+static inline void diag_trace_scope_exit(uint16_t *name)
+{
+    if (__atomic_load_n(&diag_trace_active, __ATOMIC_RELAXED)) {
+        diag_trace_emit(*name, DIAG_TRACE_TYPE_END, 0);
+    }
+}
+
+#if DIAG_TRACE_ENABLE
+
+// Name id of a trace point, interned once per call site
+#define DIAG_TRACE_ID(name) __extension__({                      \
+    static uint16_t diag_trace_id_;                              \
+    if (!diag_trace_id_) diag_trace_id_ = diag_trace_intern(#name); \
+    diag_trace_id_; })
+
+#define DIAG_TRACE_EVENT_(name, type, arg) do {                   \
+    if (__atomic_load_n(&diag_trace_active, __ATOMIC_RELAXED)) { \
+        diag_trace_emit(DIAG_TRACE_ID(name), (type), (arg));     \
+    }                                                            \
+} while (0)
+
+#define DIAG_TRACE_BEGIN(name)        DIAG_TRACE_EVENT_(name, DIAG_TRACE_TYPE_BEGIN, 0)
+#define DIAG_TRACE_END(name)          DIAG_TRACE_EVENT_(name, DIAG_TRACE_TYPE_END, 0)
+#define DIAG_TRACE_INSTANT(name, arg) DIAG_TRACE_EVENT_(name, DIAG_TRACE_TYPE_INSTANT, (uint32_t)(arg))
+
+#define DIAG_TRACE_SCOPE(name)                                                   \
+    DIAG_TRACE_BEGIN(name);                                                      \
+    uint16_t diag_trace_scope_##name __attribute__((cleanup(diag_trace_scope_exit))) = \
+        DIAG_TRACE_ID(name)
+
+#else
+
+#define DIAG_TRACE_BEGIN(name)        do { } while (0)
+#define DIAG_TRACE_END(name)          do { } while (0)
+#define DIAG_TRACE_INSTANT(name, arg) do { (void)(arg); } while (0)
+#define DIAG_TRACE_SCOPE(name)        do { } while (0)
+
+#endif
+
+// Clear the buffer, sample the per-core clocks and start recording
+void diag_trace_start(void);
+
+// Stop recording
+void diag_trace_stop(void);
+
+// Events held by the current or last capture (at most DIAG_TRACE_EVENTS)
+size_t diag_trace_count(void);
+
+// Size of the serialized capture; stops a running capture
+size_t diag_trace_blob_size(void);
+
+// Serialize the last capture; returns bytes written, 0 if cap is too small
+size_t diag_trace_serialize(uint8_t *out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
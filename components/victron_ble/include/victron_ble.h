@@ -4,6 +4,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
 #include "victron_records.h"
 
 #ifdef __cplusplus
@@ -14,29 +16,85 @@ extern "C" {
 // Unified Victron BLE data container
 // -----------------------------------------------------------------------------
 
-// Device identification (based on MAC address)
+// Device role (based on MAC address). Several devices may share a role.
 typedef enum {
     VICTRON_DEVICE_UNKNOWN = 0,
     VICTRON_DEVICE_MPPT,
     VICTRON_DEVICE_BATTERY_SENSE,
     VICTRON_DEVICE_SMARTSHUNT,
-    VICTRON_DEVICE_AC_CHARGER
+    VICTRON_DEVICE_AC_CHARGER,
+    VICTRON_DEVICE_DCDC_CHARGER,
+    VICTRON_DEVICE_ROLE_COUNT
 } victron_device_id_t;
 
 typedef struct {
     victron_record_type_t type;       // record type (e.g., SOLAR_CHARGER, BATTERY_MONITOR)
     uint16_t              product_id; // Victron product identifier
-    victron_device_id_t   device_id;  // Which device sent this (based on MAC)
+    victron_device_id_t   device_id;  // Role of the device that sent this (based on MAC)
+    uint8_t               mac[6];     // Sender MAC (BLE byte order), tells devices of one role apart
     victron_record_t      record;     // parsed record data (union of all device types)
 } victron_data_t;
 
+// Provisioned device: stored in NVS, editable at runtime
+#define VICTRON_MAX_DEVICES 12
+#define VICTRON_NAME_MAX    16
+
+typedef struct {
+    uint8_t             mac[6];     // BLE byte order (LSB first)
+    uint8_t             key[16];    // AES-128 advertisement key
+    victron_device_id_t role;
+    char                name[VICTRON_NAME_MAX];  // display name, may be empty
+} victron_device_config_t;
+
+// Recently seen Victron advertisers (known or not), for diagnostics/onboarding
+#define VICTRON_SEEN_RING_SIZE 16
+
+// Key state of an advertiser, from its last advertisement
+typedef enum {
+    VICTRON_KEY_NONE = 0,   // MAC not configured
+    VICTRON_KEY_OK,         // configured, key check byte matches
+    VICTRON_KEY_MISMATCH,   // configured, but the device uses another key
+} victron_key_status_t;
+
+typedef struct {
+    uint8_t  mac[6];        // BLE byte order
+    int8_t   rssi;          // dBm, last advertisement
+    uint8_t  record_type;   // victron_record_type_t of the last advertisement
+    uint16_t product_id;
+    const char *product_name;   // victron_product_name(product_id), cached; may be NULL
+    uint8_t  key_check;     // first byte of the device's key, as advertised
+    victron_key_status_t key_status;
+    uint32_t last_seen_ms;  // monotonic
+    uint32_t count;         // advertisements seen
+    uint32_t rejected;      // advertisements dropped on a key mismatch
+} victron_seen_device_t;
+
+// Advertisement capture, for replaying real traffic (scripts/adv_capture.py).
+// While a capture runs, each advertisement is printed on the console as
+// "ADV <hex>": the hex of a victron_capture_record_t and its AD payload. The
+// script stores the records in a .vcap file: "VCAP", uint16 version, uint16
+// reserved, then the records back to back (all little endian).
+typedef enum {
+    VICTRON_CAPTURE_OFF = 0,
+    VICTRON_CAPTURE_VICTRON,    // Victron product advertisements only
+    VICTRON_CAPTURE_ALL,        // every advertisement received
+} victron_capture_mode_t;
+
+#define VICTRON_CAPTURE_MAGIC   "VCAP"
+#define VICTRON_CAPTURE_VERSION 1
+#define VICTRON_CAPTURE_MAX_AD  31      // legacy advertising payload
+
+typedef struct __attribute__((packed)) {
+    uint32_t time_ms;       // since boot
+    uint8_t  mac[6];        // BLE byte order
+    int8_t   rssi;
+    uint8_t  len;           // AD payload bytes that follow
+} victron_capture_record_t;
+
 // -----------------------------------------------------------------------------
 // Public interface
 // -----------------------------------------------------------------------------
 
-// Called by BLE layer when a valid frame is received (UI can override this)
-extern void ui_set_ble_mac(const uint8_t *mac);
-
 // Callback for receiving new Victron data frames
 typedef void (*victron_data_cb_t)(const victron_data_t *data);
 
@@ -49,6 +107,34 @@ void victron_ble_register_callback(victron_data_cb_t cb);
 // Enable or disable verbose/debug logging
 void victron_ble_set_debug(bool enabled);
 
+// Discovery mode: log each unconfigured Victron advertiser once, with its
+// product and record type (the seen ring is filled either way)
+void victron_ble_set_discovery(bool enabled);
+
+// Start or stop streaming advertisements over the console UART
+void victron_ble_set_capture(victron_capture_mode_t mode);
+
+// Number of configured devices (MAC + AES key entries)
+size_t victron_ble_device_count(void);
+
+// Get MAC and role of the configured device at index; false if out of range
+bool victron_ble_device_info(size_t index, uint8_t mac[6], victron_device_id_t *role);
+
+// Full configuration of the device at index (key included); false if out of range
+bool victron_ble_device_config(size_t index, victron_device_config_t *out);
+
+// Add a device, or replace the one with the same MAC, and persist the table in NVS
+esp_err_t victron_ble_add_device(const victron_device_config_t *cfg);
+
+// Remove a device by MAC and persist the table; ESP_ERR_NOT_FOUND if absent
+esp_err_t victron_ble_remove_device(const uint8_t mac[6]);
+
+// Snapshot of recently seen Victron devices, most recent first (lock-free)
+size_t victron_ble_get_seen(victron_seen_device_t *out, size_t max);
+
+// Human-readable record type name ("Solar Charger", ...)
+const char *victron_record_type_name(uint8_t type);
+
 #ifdef __cplusplus
 }
 #endif
@@ -84,6 +84,9 @@ typedef enum {
 
 // ---------------------------------------------------------------------------
 // Record Structs (packed)
+//
+// Decoded field values, not the wire layout: victron_decode.c extracts each
+// field by bit position. Comments give the wire width where it differs.
 // ---------------------------------------------------------------------------
 
 // 0x01 - SmartSolar / BlueSolar MPPT
@@ -140,23 +143,23 @@ typedef struct __attribute__((packed)) {
     uint8_t  cell6_centi;
     uint8_t  cell7_centi;
     uint8_t  cell8_centi;
-    uint16_t battery_voltage_centi : 12;
-    uint8_t  balancer_status : 4;
-    uint8_t  temperature_c : 7; // raw + offset -40°C
+    uint16_t battery_voltage_centi;   // 12-bit
+    uint8_t  balancer_status;         // 4-bit
+    uint8_t  temperature_c;           // 7-bit raw + offset -40°C
 } victron_record_smart_lithium_t;
 
 // 0x08 - AC Charger (Phoenix IP43)
 typedef struct __attribute__((packed)) {
     uint8_t  device_state;
     uint8_t  charger_error;
-    uint16_t battery_voltage_1_centi : 13;
-    uint16_t battery_current_1_deci : 11;
-    uint16_t battery_voltage_2_centi : 13;
-    uint16_t battery_current_2_deci : 11;
-    uint16_t battery_voltage_3_centi : 13;
-    uint16_t battery_current_3_deci : 11;
-    int8_t   temperature_c;
-    uint16_t ac_current_deci : 9;
+    uint16_t battery_voltage_1_centi; // 13-bit, 0.01 V
+    uint16_t battery_current_1_deci;  // 11-bit, 0.1 A
+    uint16_t battery_voltage_2_centi;
+    uint16_t battery_current_2_deci;
+    uint16_t battery_voltage_3_centi;
+    uint16_t battery_current_3_deci;
+    int8_t   temperature_c;           // 7-bit raw - 40 (NA reads as 87)
+    uint16_t ac_current_deci;         // 9-bit, 0.1 A
 } victron_record_ac_charger_t;
 
 // 0x09 - Smart Battery Protect
@@ -1,6 +1,14 @@
 #include "victron_ble.h"
 #include "victron_records.h"
 #include "victron_products.h"
+#include "victron_seen.h"
+#include "victron_devices.h"
+#include "victron_capture.h"
+#include "victron_decode.h"
+#include "diag_stats.h"
+#include "diag_scope.h"
+#include "diag_trace.h"
+#include "diag_log.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -15,6 +23,7 @@
 static const char *TAG = "victron_ble";
 
 static bool victron_debug_enabled = false;
+static bool victron_discovery_enabled = false;
 #define VDBG(fmt, ...) do { if (victron_debug_enabled) ESP_LOGI(TAG, fmt, ##__VA_ARGS__); } while(0)
 
 #define NA_U16_SIGNED   0x7FFF
@@ -24,49 +33,43 @@ static bool victron_debug_enabled = false;
 #define NA_U10          0x3FF
 #define NA_U22          0x3FFFFF
 
-// Hardcoded AES keys with MAC addresses for identification
-// MAC address in reverse order (LSB first as received from BLE)
-static uint8_t mac_mppt[6] = { 0xb5, 0x7d, 0xb4, 0x39, 0x56, 0xc1 };  // c1:56:39:b4:7d:b5
-static uint8_t aes_key_mppt[16] = {
-    0xf2, 0xdc, 0xc3, 0xba, 0x40, 0xed, 0xb8, 0xde,
-    0x7e, 0x07, 0xd7, 0x63, 0x8f, 0x13, 0xf9, 0x71
-};
-
-static uint8_t mac_batt[6] = { 0x2b, 0x9e, 0xbd, 0x91, 0xb6, 0xc1 };  // c1:b6:91:bd:9e:2b
-static uint8_t aes_key_batt[16] = {
-    0xb7, 0xab, 0xe1, 0x9c, 0x00, 0x32, 0x40, 0xbe,
-    0x9d, 0xae, 0x89, 0xb8, 0xc3, 0x72, 0xdd, 0x43
-};
-
-static uint8_t mac_smartshunt[6] = { 0x2e, 0x1b, 0x0c, 0xcf, 0x3c, 0xf9 };  // f9:3c:cf:0c:1b:2e
-static uint8_t aes_key_smartshunt[16] = {
-    0x4c, 0x1e, 0x3c, 0xcd, 0x3d, 0x89, 0x2d, 0xb1,
-    0x3d, 0x7a, 0x43, 0x74, 0x0b, 0x7f, 0x10, 0x21
-};
-
-static uint8_t mac_charger[6] = { 0x00, 0x7b, 0xca, 0xfc, 0xa6, 0xe9 };  // e9:a6:fc:ca:7b:00
-static uint8_t aes_key_charger[16] = {
-    0x19, 0xef, 0xd0, 0xcf, 0x51, 0xbe, 0xfc, 0x3e,
-    0x2e, 0x4a, 0x2b, 0x85, 0x84, 0x14, 0x4f, 0x2a
+// Console counters (see diag_stats.h)
+typedef enum {
+    DECODED_SOLAR,
+    DECODED_BATTERY,
+    DECODED_INVERTER,
+    DECODED_DCDC,
+    DECODED_LITHIUM,
+    DECODED_AC_CHARGER,
+    DECODED_UNSUPPORTED,
+    DECODED_COUNT
+} decoded_stat_t;
+
+static const char *const decoded_stat_names[DECODED_COUNT] = {
+    "ble.decoded.solar", "ble.decoded.battery", "ble.decoded.inverter", "ble.decoded.dcdc",
+    "ble.decoded.lithium", "ble.decoded.ac_charger", "ble.decoded.unsupported",
 };
 
-static uint8_t aes_key[16]; // Working key for current decrypt
+static diag_counter_t stat_adv;          // all advertisements
+static diag_counter_t stat_victron;      // Victron product advertisements
+static diag_counter_t stat_no_key;       // filtered: MAC not configured
+static diag_counter_t stat_bad_key;      // filtered: key check byte mismatch
+static diag_counter_t stat_bad_size;     // filtered: malformed payload
+static diag_counter_t stat_decrypted;
+static diag_counter_t stat_decoded[DECODED_COUNT];
 
-typedef enum {
-    VICTRON_MANUFACTURER_RECORD_PRODUCT_ADVERTISEMENT = 0x10,
-} victron_manufacturer_record_type_t;
-
-typedef struct __attribute__((packed)) {
-    uint16_t vendorID;
-    uint8_t  manufacturer_record_type;
-    uint8_t  manufacturer_record_length;
-    uint16_t product_id;
-    uint8_t  victronRecordType;
-    uint16_t nonceDataCounter;
-    uint8_t  encryptKeyMatch;
-    uint8_t  victronEncryptedData[VICTRON_ENCRYPTED_DATA_MAX_SIZE];
-    uint8_t  nullPad;
-} victronManufacturerData;
+static decoded_stat_t decoded_stat_of(uint8_t record_type)
+{
+    switch (record_type) {
+        case VICTRON_BLE_RECORD_SOLAR_CHARGER:   return DECODED_SOLAR;
+        case VICTRON_BLE_RECORD_BATTERY_MONITOR: return DECODED_BATTERY;
+        case VICTRON_BLE_RECORD_INVERTER:        return DECODED_INVERTER;
+        case VICTRON_BLE_RECORD_DCDC_CONVERTER:  return DECODED_DCDC;
+        case VICTRON_BLE_RECORD_SMART_LITHIUM:   return DECODED_LITHIUM;
+        case VICTRON_BLE_RECORD_AC_CHARGER:      return DECODED_AC_CHARGER;
+        default:                                 return DECODED_UNSUPPORTED;
+    }
+}
 
 static victron_data_cb_t data_cb = NULL;
 void victron_ble_register_callback(victron_data_cb_t cb) { data_cb = cb; }
@@ -75,19 +78,13 @@ static void ble_host_task(void *param);
 static int ble_gap_event_handler(struct ble_gap_event *event, void *arg);
 static void ble_app_on_sync(void);
 
-static inline int32_t sign_extend(uint32_t value, uint8_t bits)
-{
-    uint32_t shift = 32u - bits;
-    return (int32_t)(value << shift) >> shift;
-}
-
 /* -------------------------------------------------------------------------- */
 /*  Initialization                                                            */
 /* -------------------------------------------------------------------------- */
 
 void victron_ble_init(void)
 {
-    ESP_LOGI(TAG, "Initializing Victron BLE with hardcoded keys");
+    ESP_LOGI(TAG, "Initializing Victron BLE");
 
     // NVS init for BLE stack
     esp_err_t ret = nvs_flash_init();
@@ -97,12 +94,24 @@ void victron_ble_init(void)
     }
     ESP_ERROR_CHECK(ret);
 
-    ESP_LOGI(TAG, "MPPT key[0]=0x%02X, Battery key[0]=0x%02X", 
-             aes_key_mppt[0], aes_key_batt[0]);
+    // Device table (MAC, key, role, name) from NVS
+    victron_devices_init();
+
+    diag_stats_register("ble.adv", &stat_adv);
+    diag_stats_register("ble.victron", &stat_victron);
+    diag_stats_register("ble.filtered.no_key", &stat_no_key);
+    diag_stats_register("ble.filtered.bad_key", &stat_bad_key);
+    diag_stats_register("ble.filtered.bad_size", &stat_bad_size);
+    diag_stats_register("ble.decrypted", &stat_decrypted);
+    for (int i = 0; i < DECODED_COUNT; i++) {
+        diag_stats_register(decoded_stat_names[i], &stat_decoded[i]);
+    }
 
     ESP_LOGI(TAG, "Initializing NimBLE stack");
     nimble_port_init();
     ble_hs_cfg.sync_cb = ble_app_on_sync;
+    // The host task, and with it decoding and the data callback, runs on
+    // CONFIG_BT_NIMBLE_PINNED_TO_CORE
     nimble_port_freertos_init(ble_host_task);
 }
 
@@ -112,6 +121,17 @@ void victron_ble_set_debug(bool enabled)
     ESP_LOGI(TAG, "Victron BLE debug set to %s", enabled ? "ENABLED" : "disabled");
 }
 
+void victron_ble_set_discovery(bool enabled)
+{
+    victron_discovery_enabled = enabled;
+    ESP_LOGI(TAG, "Discovery mode %s", enabled ? "on" : "off");
+}
+
+void victron_ble_set_capture(victron_capture_mode_t mode)
+{
+    victron_capture_set_mode(mode);
+}
+
 /* -------------------------------------------------------------------------- */
 /*  BLE Stack                                                                 */
 /* -------------------------------------------------------------------------- */
@@ -142,7 +162,7 @@ static void ble_app_on_sync(void)
 /*  Utility                                                                   */
 /* -------------------------------------------------------------------------- */
 
-static const char* get_device_type_name(uint8_t type)
+const char *victron_record_type_name(uint8_t type)
 {
     switch (type) {
         case 0x00: return "Test Record";
@@ -171,6 +191,15 @@ static int ble_gap_event_handler(struct ble_gap_event *event, void *arg)
 {
     if (event->type != BLE_GAP_EVENT_DISC)
         return 0;
+    DIAG_SCOPE(ble_gap_event);
+    DIAG_TRACE_SCOPE(ble_adv);
+    diag_counter_inc(&stat_adv);
+
+    victron_capture_mode_t capture = __atomic_load_n(&victron_capture_mode, __ATOMIC_ACQUIRE);
+    if (capture == VICTRON_CAPTURE_ALL) {
+        victron_capture_push(event->disc.addr.val, event->disc.rssi,
+                             event->disc.data, event->disc.length_data);
+    }
 
     struct ble_hs_adv_fields fields;
     int rc = ble_hs_adv_parse_fields(&fields, event->disc.data, event->disc.length_data);
@@ -179,22 +208,27 @@ static int ble_gap_event_handler(struct ble_gap_event *event, void *arg)
         return 0;
     }
 
-    if (fields.mfg_data_len < offsetof(victronManufacturerData, victronEncryptedData) + 1)
+    victron_adv_t adv;
+    victron_adv_status_t adv_status = victron_parse_adv(fields.mfg_data, fields.mfg_data_len, &adv);
+    if (adv_status == VICTRON_ADV_NOT_VICTRON)
         return 0;
 
-    victronManufacturerData *mdata = (void*)fields.mfg_data;
-    if (mdata->vendorID != VICTRON_MANUFACTURER_ID)
-        return 0;
-
-    if (mdata->manufacturer_record_type != VICTRON_MANUFACTURER_RECORD_PRODUCT_ADVERTISEMENT) {
+    if (adv_status == VICTRON_ADV_OTHER_RECORD) {
         VDBG("Skipping manufacturer record type 0x%02X",
-             (unsigned)mdata->manufacturer_record_type);
+             (unsigned)adv.manufacturer_record_type);
         return 0;
     }
+    diag_counter_inc(&stat_victron);
+    if (capture == VICTRON_CAPTURE_VICTRON) {
+        victron_capture_push(event->disc.addr.val, event->disc.rssi,
+                             event->disc.data, event->disc.length_data);
+    }
 
-    uint16_t product_id = mdata->product_id;
-    const char *product_name = victron_product_name(product_id);
+    // The name is resolved once per device in the seen ring; only the
+    // debug log looks it up per advertisement
+    uint16_t product_id = adv.product_id;
     if (victron_debug_enabled) {
+        const char *product_name = victron_product_name(product_id);
         if (product_name) {
             ESP_LOGI(TAG, "Product ID: 0x%04X (%s)", product_id, product_name);
         } else {
@@ -208,47 +242,57 @@ static int ble_gap_event_handler(struct ble_gap_event *event, void *arg)
          event->disc.addr.val[5], event->disc.addr.val[4],
          event->disc.addr.val[3], event->disc.addr.val[2],
          event->disc.addr.val[1], event->disc.addr.val[0]);
-    VDBG("Vendor ID: 0x%04X, Record: 0x%02X (%s)",
-         mdata->vendorID, mdata->victronRecordType,
-         get_device_type_name(mdata->victronRecordType));
-    VDBG("Nonce: 0x%04X, KeyMatch: 0x%02X",
-         mdata->nonceDataCounter, mdata->encryptKeyMatch);
+    VDBG("Record: 0x%02X (%s)",
+         adv.record_type, victron_record_type_name(adv.record_type));
+    VDBG("Nonce: 0x%04X, KeyMatch: 0x%02X", adv.nonce, adv.key_check);
     if (victron_debug_enabled)
         ESP_LOG_BUFFER_HEX_LEVEL(TAG, fields.mfg_data, fields.mfg_data_len, ESP_LOG_INFO);
 
     // Select correct key based on MAC address
     const uint8_t *mac = event->disc.addr.val;
-    victron_device_id_t device_id = VICTRON_DEVICE_UNKNOWN;
-    
-    if (memcmp(mac, mac_mppt, 6) == 0) {
-        memcpy(aes_key, aes_key_mppt, 16);
-        device_id = VICTRON_DEVICE_MPPT;
-    } else if (memcmp(mac, mac_batt, 6) == 0) {
-        memcpy(aes_key, aes_key_batt, 16);
-        device_id = VICTRON_DEVICE_BATTERY_SENSE;
-    } else if (memcmp(mac, mac_smartshunt, 6) == 0) {
-        memcpy(aes_key, aes_key_smartshunt, 16);
-        device_id = VICTRON_DEVICE_SMARTSHUNT;
-    } else if (memcmp(mac, mac_charger, 6) == 0) {
-        memcpy(aes_key, aes_key_charger, 16);
-        device_id = VICTRON_DEVICE_AC_CHARGER;
-        ESP_LOGI(TAG, "AC CHARGER detected - MAC: %02X:%02X:%02X:%02X:%02X:%02X",
-            mac[5], mac[4], mac[3], mac[2], mac[1], mac[0]);
-    } else {
-        ESP_LOGW(TAG, "Unknown Victron MAC: %02X:%02X:%02X:%02X:%02X:%02X - skipping",
-            mac[5], mac[4], mac[3], mac[2], mac[1], mac[0]);
+    victron_device_config_t dev;
+    victron_key_status_t key_status = VICTRON_KEY_NONE;
+    if (victron_devices_lookup(mac, &dev)) {
+        // encryptKeyMatch is the first byte of the key the device encrypts
+        // with: on a mismatch AES would only produce plausible-looking garbage
+        key_status = (adv.key_check == dev.key[0]) ? VICTRON_KEY_OK : VICTRON_KEY_MISMATCH;
+    }
+    const char *product_name = NULL;
+    bool first_seen = victron_seen_publish(mac, event->disc.rssi, adv.record_type,
+                                           product_id, adv.key_check, key_status,
+                                           &product_name);
+    if (key_status == VICTRON_KEY_NONE) {
+        diag_counter_inc(&stat_no_key);
+        if (first_seen && victron_discovery_enabled) {
+            // Once per new device: never rate-limited
+            DIAG_LOG_EVERY(0, ESP_LOG_INFO, TAG, "Discovered %02X:%02X:%02X:%02X:%02X:%02X: product 0x%04X (%s), %s, key check 0x%02X",
+                           mac[5], mac[4], mac[3], mac[2], mac[1], mac[0], product_id,
+                           product_name ? product_name : "unknown",
+                           victron_record_type_name(adv.record_type),
+                           adv.key_check);
+        }
         return 0;
     }
-
-    int encr_size = fields.mfg_data_len - offsetof(victronManufacturerData, victronEncryptedData);
-    if (encr_size <= 0 || encr_size > 25) {
-        ESP_LOGW(TAG, "Invalid encrypted data size: %d", encr_size);
+    if (key_status == VICTRON_KEY_MISMATCH) {
+        diag_counter_inc(&stat_bad_key);
+        if (first_seen) {
+            DIAG_LOG_EVERY(0, ESP_LOG_WARN, TAG, "Key mismatch for %02X:%02X:%02X:%02X:%02X:%02X: device key starts with 0x%02X, configured 0x%02X",
+                           mac[5], mac[4], mac[3], mac[2], mac[1], mac[0],
+                           adv.key_check, dev.key[0]);
+        }
         return 0;
     }
+    const victron_device_id_t device_id = dev.role;
 
-    uint8_t input[VICTRON_ENCRYPTED_DATA_MAX_SIZE] = {0};
+    // The record buffers hold VICTRON_ENCRYPTED_DATA_MAX_SIZE bytes
+    int encr_size = (int)adv.encrypted_len;
+    uint8_t input[VICTRON_ENCRYPTED_DATA_MAX_SIZE];
     uint8_t output[VICTRON_ENCRYPTED_DATA_MAX_SIZE] = {0};
-    memcpy(input, mdata->victronEncryptedData, encr_size);
+    if (!victron_adv_load_payload(&adv, input)) {
+        diag_counter_inc(&stat_bad_size);
+        DIAG_LOGW(TAG, "Invalid encrypted data size: %d", encr_size);
+        return 0;
+    }
 
     if (victron_debug_enabled) {
         ESP_LOGI(TAG, "Encrypted payload:");
@@ -256,245 +300,70 @@ static int ble_gap_event_handler(struct ble_gap_event *event, void *arg)
     }
 
     /* ---------------- AES CTR Decrypt ---------------- */
+    DIAG_SCOPE_BEGIN(aes_ctr);
     esp_aes_context ctx;
     esp_aes_init(&ctx);
-    if (esp_aes_setkey(&ctx, aes_key, 128)) {
-        ESP_LOGE(TAG, "AES setkey failed");
+    if (esp_aes_setkey(&ctx, dev.key, 128)) {
+        DIAG_LOGE(TAG, "AES setkey failed");
         esp_aes_free(&ctx);
         return 0;
     }
 
     // Only first 2 bytes used for Victron nonce; rest = zero
-    uint16_t nonce = mdata->nonceDataCounter;
+    uint16_t nonce = adv.nonce;
     uint8_t ctr_blk[16] = { (uint8_t)(nonce & 0xFF), (uint8_t)(nonce >> 8) };
     uint8_t stream_block[16] = {0};
     size_t offset = 0;
 
     rc = esp_aes_crypt_ctr(&ctx, encr_size, &offset, ctr_blk, stream_block, input, output);
     esp_aes_free(&ctx);
+    DIAG_SCOPE_END(aes_ctr);
     if (rc) {
-        ESP_LOGE(TAG, "AES CTR decrypt failed, rc=%d", rc);
+        DIAG_LOGE(TAG, "AES CTR decrypt failed, rc=%d", rc);
         return 0;
     }
 
+    diag_counter_inc(&stat_decrypted);
+    DIAG_TRACE_INSTANT(decrypted, adv.record_type);
+
     if (victron_debug_enabled) {
         ESP_LOGI(TAG, "Decrypted payload (nonce=0x%04X):", nonce);
         ESP_LOG_BUFFER_HEX_LEVEL(TAG, output, encr_size, ESP_LOG_INFO);
     }
 
-    const victron_record_type_t rec_type = (victron_record_type_t)mdata->victronRecordType;
-
     /* ---------------- Record Parsing ---------------- */
-    switch (rec_type) {
-        case VICTRON_BLE_RECORD_SOLAR_CHARGER: {
-            const victron_record_solar_charger_t *r = (const victron_record_solar_charger_t *)output;
-
-            uint16_t load_raw = (uint16_t)output[10] | ((uint16_t)(output[11] & 0x01) << 8);
-            float load_current_A = (load_raw == 0x1FF) ? 0.0f : load_raw / 10.0f;
-
-            if (data_cb) {
-                victron_data_t parsed = {
-                    .type = VICTRON_BLE_RECORD_SOLAR_CHARGER,
-                    .product_id = product_id,
-                    .device_id = device_id
-                };
-                parsed.record.solar.device_state = r->device_state;
-                parsed.record.solar.charger_error = r->charger_error;
-                parsed.record.solar.battery_voltage_centi = r->battery_voltage_centi;
-                parsed.record.solar.battery_current_deci = r->battery_current_deci;
-                parsed.record.solar.yield_today_centikwh = r->yield_today_centikwh;
-                parsed.record.solar.pv_power_w = r->pv_power_w;
-                parsed.record.solar.load_current_deci = load_raw;
-                data_cb(&parsed);
-            }
-            break;
-        }
-
-        case VICTRON_BLE_RECORD_BATTERY_MONITOR: {
-            const uint8_t *b = output;
-
-            uint16_t ttg_raw     = b[0] | (b[1] << 8);
-            uint16_t voltage_raw = b[2] | (b[3] << 8);
-            uint16_t alarm_raw   = b[4] | (b[5] << 8);
-            uint16_t aux_raw     = b[6] | (b[7] << 8);
-
-            uint64_t tail = 0;
-            for (int i = 0; i < 7; i++)
-                tail |= ((uint64_t)b[8 + i]) << (8 * i);
-
-            uint8_t aux_input = tail & 0x03; tail >>= 2;
-            int32_t current_bits  = sign_extend(tail & ((1u << 22) - 1u), 22); tail >>= 22;
-            int32_t consumed_bits = sign_extend(tail & ((1u << 20) - 1u), 20); tail >>= 20;
-            uint32_t soc_bits = tail & ((1u << 10) - 1u);
-
-            float current_A   = current_bits / 1000.0f;
-
-            if (data_cb) {
-                victron_data_t parsed = {
-                    .type = VICTRON_BLE_RECORD_BATTERY_MONITOR,
-                    .product_id = product_id,
-                    .device_id = device_id
-                };
-                parsed.record.battery.time_to_go_minutes = ttg_raw;
-                parsed.record.battery.battery_voltage_centi = voltage_raw;
-                parsed.record.battery.alarm_reason = alarm_raw;
-                parsed.record.battery.aux_value = aux_raw;
-                parsed.record.battery.aux_input = aux_input;
-                parsed.record.battery.battery_current_milli = current_bits;
-                parsed.record.battery.consumed_ah_deci = consumed_bits;
-                parsed.record.battery.soc_deci_percent = soc_bits;
-                data_cb(&parsed);
-            }
-            break;
-        }
-
-        case VICTRON_BLE_RECORD_INVERTER: {
-            if (encr_size < 11) {
-                ESP_LOGW(TAG, "Inverter payload too short: %d", encr_size);
-                break;
-            }
-
-            const uint8_t *b = output;
-            uint8_t device_state = b[0];
-            uint16_t alarm_reason = b[1] | (b[2] << 8);
-            int16_t battery_voltage_centi = (int16_t)(b[3] | (b[4] << 8));
-            uint16_t ac_apparent_power_va = b[5] | (b[6] << 8);
-
-            uint32_t tail = (uint32_t)b[7]
-                          | ((uint32_t)b[8] << 8)
-                          | ((uint32_t)b[9] << 16)
-                          | ((uint32_t)b[10] << 24);
-            uint16_t ac_voltage_centi = (uint16_t)(tail & 0x7FFFu);
-            uint16_t ac_current_deci = (uint16_t)((tail >> 15) & 0x7FFu);
-
-            if (data_cb) {
-                victron_data_t parsed = {
-                    .type = VICTRON_BLE_RECORD_INVERTER,
-                    .product_id = product_id,
-                    .device_id = device_id
-                };
-                parsed.record.inverter.device_state = device_state;
-                parsed.record.inverter.alarm_reason = alarm_reason;
-                parsed.record.inverter.battery_voltage_centi = battery_voltage_centi;
-                parsed.record.inverter.ac_apparent_power_va = ac_apparent_power_va;
-                parsed.record.inverter.ac_voltage_centi = ac_voltage_centi;
-                parsed.record.inverter.ac_current_deci = ac_current_deci;
-                data_cb(&parsed);
-            }
-            break;
-        }
-
-        case VICTRON_BLE_RECORD_DCDC_CONVERTER: {
-            if (encr_size < 10) {
-                ESP_LOGW(TAG, "DC/DC payload too short: %d", encr_size);
-                break;
-            }
-
-            const uint8_t *b = output;
-            uint8_t device_state = b[0];
-            uint8_t charger_error = b[1];
-            uint16_t input_voltage_centi = (uint16_t)(b[2] | (b[3] << 8));
-            uint16_t output_voltage_centi = (uint16_t)(b[4] | (b[5] << 8));
-            uint32_t off_reason = (uint32_t)b[6]
-                                | ((uint32_t)b[7] << 8)
-                                | ((uint32_t)b[8] << 16)
-                                | ((uint32_t)b[9] << 24);
-
-            if (data_cb) {
-                victron_data_t parsed = {
-                    .type = VICTRON_BLE_RECORD_DCDC_CONVERTER,
-                    .product_id = product_id,
-                    .device_id = device_id
-                };
-                parsed.record.dcdc.device_state = device_state;
-                parsed.record.dcdc.charger_error = charger_error;
-                parsed.record.dcdc.input_voltage_centi = input_voltage_centi;
-                parsed.record.dcdc.output_voltage_centi = output_voltage_centi;
-                parsed.record.dcdc.off_reason = off_reason;
-                data_cb(&parsed);
-            }
-            break;
-        }
-
-        case VICTRON_BLE_RECORD_SMART_LITHIUM: {
-            if (encr_size < 16) {
-                ESP_LOGW(TAG, "Smart Lithium payload too short: %d", encr_size);
-                break;
-            }
-
-            const uint8_t *b = output;
-            uint32_t bms_flags = (uint32_t)b[0]
-                               | ((uint32_t)b[1] << 8)
-                               | ((uint32_t)b[2] << 16)
-                               | ((uint32_t)b[3] << 24);
-            uint16_t error_flags = (uint16_t)(b[4] | (b[5] << 8));
-            uint8_t cell_values[8];
-            for (int i = 0; i < 8; ++i) {
-                cell_values[i] = b[6 + i];
-            }
-            uint16_t packed_voltage = (uint16_t)(b[14] | (b[15] << 8));
-            uint16_t battery_voltage_centi = (packed_voltage & 0x0FFFu);
-            uint8_t balancer_status = (uint8_t)((packed_voltage >> 12) & 0x0Fu);
-            uint8_t temperature_raw = (encr_size > 16) ? b[16] : 0;
-            int temperature_c = (int)temperature_raw - 40;
-
-            if (data_cb) {
-                victron_data_t parsed = {
-                    .type = VICTRON_BLE_RECORD_SMART_LITHIUM,
-                    .product_id = product_id,
-                    .device_id = device_id
-                };
-                parsed.record.lithium.bms_flags = bms_flags;
-                parsed.record.lithium.error_flags = error_flags;
-                parsed.record.lithium.cell1_centi = cell_values[0];
-                parsed.record.lithium.cell2_centi = cell_values[1];
-                parsed.record.lithium.cell3_centi = cell_values[2];
-                parsed.record.lithium.cell4_centi = cell_values[3];
-                parsed.record.lithium.cell5_centi = cell_values[4];
-                parsed.record.lithium.cell6_centi = cell_values[5];
-                parsed.record.lithium.cell7_centi = cell_values[6];
-                parsed.record.lithium.cell8_centi = cell_values[7];
-                parsed.record.lithium.battery_voltage_centi = battery_voltage_centi;
-                parsed.record.lithium.balancer_status = balancer_status;
-                parsed.record.lithium.temperature_c = temperature_raw;
-                data_cb(&parsed);
-            }
-            break;
-        }
+    const uint8_t rec_type = adv.record_type;
+    victron_data_t parsed = {
+        .type = (victron_record_type_t)rec_type,
+        .product_id = product_id,
+        .device_id = device_id
+    };
+    memcpy(parsed.mac, mac, 6);
 
-        case VICTRON_BLE_RECORD_AC_CHARGER: {
-            if (encr_size < 11) {
-                ESP_LOGW(TAG, "AC Charger payload too short: %d", encr_size);
-                break;
-            }
-
-            const victron_record_ac_charger_t *r = (const victron_record_ac_charger_t *)output;
-
-            ESP_LOGI(TAG, "=== AC Charger IP22 ===");
-            ESP_LOGI(TAG, "State=%u Error=0x%02X Vbat1=%.2fV Ibat1=%.1fA Temp=%dC",
-                     (unsigned)r->device_state,
-                     (unsigned)r->charger_error,
-                     r->battery_voltage_1_centi / 100.0f,
-                     r->battery_current_1_deci / 10.0f,
-                     (int)r->temperature_c);
-
-            if (data_cb) {
-                victron_data_t parsed = {
-                    .type = VICTRON_BLE_RECORD_AC_CHARGER,
-                    .product_id = product_id,
-                    .device_id = device_id
-                };
-                parsed.record.ac_charger = *r;
-                data_cb(&parsed);
-            }
-            break;
-        }
+    victron_decode_status_t status = victron_decode_record(rec_type, output, encr_size, &parsed.record);
+    diag_counter_inc(&stat_decoded[decoded_stat_of(rec_type)]);
+    if (status == VICTRON_DECODE_TOO_SHORT) {
+        DIAG_LOGW(TAG, "%s payload too short: %d", victron_record_type_name(rec_type), encr_size);
+        return 0;
+    }
+    if (status == VICTRON_DECODE_UNSUPPORTED) {
+        DIAG_LOGW(TAG, "Unsupported record type 0x%02X (%s)",
+                  rec_type, victron_record_type_name(rec_type));
+        return 0;
+    }
 
-        default:
-            ESP_LOGW(TAG, "Unsupported record type 0x%02X (%s)",
-                     rec_type, get_device_type_name(rec_type));
-            break;
+    if (rec_type == VICTRON_BLE_RECORD_AC_CHARGER) {
+        const victron_record_ac_charger_t *r = &parsed.record.ac_charger;
+        DIAG_LOGI(TAG, "AC charger %02X:%02X:%02X:%02X:%02X:%02X: State=%u Error=0x%02X Vbat1=%.2fV Ibat1=%.1fA Temp=%dC",
+                  mac[5], mac[4], mac[3], mac[2], mac[1], mac[0],
+                  (unsigned)r->device_state,
+                  (unsigned)r->charger_error,
+                  r->battery_voltage_1_centi / 100.0f,
+                  r->battery_current_1_deci / 10.0f,
+                  (int)r->temperature_c);
     }
 
+    if (data_cb)
+        data_cb(&parsed);
     return 0;
 }
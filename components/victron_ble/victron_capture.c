@@ -0,0 +1,88 @@
+// victron_capture.c - stream received advertisements over the console UART
+//
+// The GAP handler only copies the advertisement into a queue; a low-priority
+// task hex-encodes it and prints one "ADV <hex>" line. A line takes ~8 ms at
+// 115200 baud, so the UART carries roughly 120 advertisements per second;
+// anything beyond that is dropped and counted (cap.dropped).
+#include "victron_capture.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "diag_stats.h"
+
+#define CAPTURE_QUEUE_LEN   32
+#ifndef CAPTURE_TASK_STACK
+#define CAPTURE_TASK_STACK  2560
+#endif
+#ifndef CAPTURE_TASK_PRIO
+#define CAPTURE_TASK_PRIO   1
+#endif
+#ifndef CAPTURE_TASK_CORE
+#define CAPTURE_TASK_CORE   tskNO_AFFINITY
+#endif
+
+typedef struct {
+    victron_capture_record_t hdr;
+    uint8_t data[VICTRON_CAPTURE_MAX_AD];
+} capture_item_t;
+
+victron_capture_mode_t victron_capture_mode = VICTRON_CAPTURE_OFF;
+
+static QueueHandle_t queue;
+static diag_counter_t stat_records;
+static diag_counter_t stat_dropped;
+
+void victron_capture_push(const uint8_t mac[6], int8_t rssi, const uint8_t *data, uint8_t len)
+{
+    capture_item_t item;
+    if (len > VICTRON_CAPTURE_MAX_AD) len = VICTRON_CAPTURE_MAX_AD;
+    item.hdr.time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    memcpy(item.hdr.mac, mac, 6);
+    item.hdr.rssi = rssi;
+    item.hdr.len = len;
+    memcpy(item.data, data, len);
+
+    if (xQueueSend(queue, &item, 0) == pdTRUE) {
+        diag_counter_inc(&stat_records);
+    } else {
+        diag_counter_inc(&stat_dropped);
+    }
+}
+
+static void capture_task(void *arg)
+{
+    static const char hex[] = "0123456789abcdef";
+    capture_item_t item;
+    char line[4 + 2 * sizeof(item) + 2];
+
+    for (;;) {
+        xQueueReceive(queue, &item, portMAX_DELAY);
+        const uint8_t *p = (const uint8_t *)&item;
+        size_t n = sizeof(item.hdr) + item.hdr.len;
+        char *o = line;
+        memcpy(o, "ADV ", 4);
+        o += 4;
+        for (size_t i = 0; i < n; i++) {
+            *o++ = hex[p[i] >> 4];
+            *o++ = hex[p[i] & 0x0F];
+        }
+        *o++ = '\n';
+        fwrite(line, 1, (size_t)(o - line), stdout);   // one write: lines never interleave
+    }
+}
+
+void victron_capture_set_mode(victron_capture_mode_t mode)
+{
+    if (mode != VICTRON_CAPTURE_OFF && !queue) {
+        diag_stats_register("cap.records", &stat_records);
+        diag_stats_register("cap.dropped", &stat_dropped);
+        queue = xQueueCreate(CAPTURE_QUEUE_LEN, sizeof(capture_item_t));
+        if (!queue) return;
+        xTaskCreatePinnedToCore(capture_task, "capture", CAPTURE_TASK_STACK, NULL,
+                                CAPTURE_TASK_PRIO, NULL, CAPTURE_TASK_CORE);
+    }
+    __atomic_store_n(&victron_capture_mode, mode, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,12 @@
+// victron_capture.h - private: producer side of the advertisement capture
+#pragma once
+#include <stdint.h>
+
+#include "victron_ble.h"
+
+extern victron_capture_mode_t victron_capture_mode;
+
+// Queue one advertisement for the capture task (BLE host task; never blocks)
+void victron_capture_push(const uint8_t mac[6], int8_t rssi, const uint8_t *data, uint8_t len);
+
+void victron_capture_set_mode(victron_capture_mode_t mode);
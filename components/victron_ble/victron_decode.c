@@ -0,0 +1,133 @@
+// victron_decode.c - record decoders
+//
+// Builds on the device and the host (see victron_decode.h).
+//
+// Fields are read by bit position from the tables in
+// docs/extra-manufacturer-data-2022-12-14.txt (record-relative: spec start
+// bit - 32) with a little-endian bit reader, so nothing depends on the
+// compiler's bitfield layout or on unaligned loads.
+#include "victron_decode.h"
+
+// Unsigned field of `width` (1..32) bits starting at bit `pos`. Only the
+// 1..5 bytes the field spans are loaded; with constant arguments every
+// condition folds away, leaving the byte loads, one shift and one mask.
+// A 64-bit window is used only for fields that straddle five bytes, so
+// 32-bit targets keep to 32-bit arithmetic. Forced inline: the firmware
+// builds with -Os, which would otherwise keep the call.
+static inline __attribute__((always_inline))
+uint32_t bits_get(const uint8_t *b, unsigned pos, unsigned width)
+{
+    const uint8_t *p = b + (pos >> 3);
+    unsigned s = pos & 7;
+    unsigned n = (s + width + 7) >> 3;
+    uint32_t mask = (uint32_t)((1ull << width) - 1);
+
+    uint32_t window = p[0];
+    if (n > 1) window |= (uint32_t)p[1] << 8;
+    if (n > 2) window |= (uint32_t)p[2] << 16;
+    if (n > 3) window |= (uint32_t)p[3] << 24;
+    if (n > 4)
+        return (uint32_t)((((uint64_t)p[4] << 32) | window) >> s) & mask;
+    return (window >> s) & mask;
+}
+
+static inline __attribute__((always_inline))
+int32_t bits_get_signed(const uint8_t *b, unsigned pos, unsigned width)
+{
+    uint32_t shift = 32u - width;
+    return (int32_t)(bits_get(b, pos, width) << shift) >> shift;
+}
+
+victron_decode_status_t victron_decode_record(uint8_t record_type,
+                                              const uint8_t plain[VICTRON_ENCRYPTED_DATA_MAX_SIZE],
+                                              size_t len, victron_record_t *out)
+{
+    const uint8_t *b = plain;
+
+    switch (record_type) {
+        case VICTRON_BLE_RECORD_SOLAR_CHARGER:
+            out->solar.device_state = bits_get(b, 0, 8);
+            out->solar.charger_error = bits_get(b, 8, 8);
+            out->solar.battery_voltage_centi = bits_get_signed(b, 16, 16);
+            out->solar.battery_current_deci = bits_get_signed(b, 32, 16);
+            out->solar.yield_today_centikwh = bits_get(b, 48, 16);
+            out->solar.pv_power_w = bits_get(b, 64, 16);
+            out->solar.load_current_deci = bits_get(b, 80, 9);
+            break;
+
+        case VICTRON_BLE_RECORD_BATTERY_MONITOR:
+            out->battery.time_to_go_minutes = bits_get(b, 0, 16);
+            out->battery.battery_voltage_centi = bits_get(b, 16, 16);
+            out->battery.alarm_reason = bits_get(b, 32, 16);
+            out->battery.aux_value = bits_get(b, 48, 16);
+            out->battery.aux_input = bits_get(b, 64, 2);
+            out->battery.battery_current_milli = bits_get_signed(b, 66, 22);
+            out->battery.consumed_ah_deci = bits_get_signed(b, 88, 20);
+            out->battery.soc_deci_percent = bits_get(b, 108, 10);
+            break;
+
+        case VICTRON_BLE_RECORD_INVERTER:
+            if (len < 11)
+                return VICTRON_DECODE_TOO_SHORT;
+
+            out->inverter.device_state = bits_get(b, 0, 8);
+            out->inverter.alarm_reason = bits_get(b, 8, 16);
+            out->inverter.battery_voltage_centi = bits_get_signed(b, 24, 16);
+            out->inverter.ac_apparent_power_va = bits_get(b, 40, 16);
+            out->inverter.ac_voltage_centi = bits_get(b, 56, 15);
+            out->inverter.ac_current_deci = bits_get(b, 71, 11);
+            break;
+
+        case VICTRON_BLE_RECORD_DCDC_CONVERTER:
+            if (len < 10)
+                return VICTRON_DECODE_TOO_SHORT;
+
+            out->dcdc.device_state = bits_get(b, 0, 8);
+            out->dcdc.charger_error = bits_get(b, 8, 8);
+            out->dcdc.input_voltage_centi = bits_get(b, 16, 16);
+            out->dcdc.output_voltage_centi = bits_get(b, 32, 16);
+            out->dcdc.off_reason = bits_get(b, 48, 32);
+            break;
+
+        case VICTRON_BLE_RECORD_SMART_LITHIUM:
+            if (len < 16)
+                return VICTRON_DECODE_TOO_SHORT;
+
+            out->lithium.bms_flags = bits_get(b, 0, 32);
+            out->lithium.error_flags = bits_get(b, 32, 16);
+            out->lithium.cell1_centi = bits_get(b, 48, 7);
+            out->lithium.cell2_centi = bits_get(b, 55, 7);
+            out->lithium.cell3_centi = bits_get(b, 62, 7);
+            out->lithium.cell4_centi = bits_get(b, 69, 7);
+            out->lithium.cell5_centi = bits_get(b, 76, 7);
+            out->lithium.cell6_centi = bits_get(b, 83, 7);
+            out->lithium.cell7_centi = bits_get(b, 90, 7);
+            out->lithium.cell8_centi = bits_get(b, 97, 7);
+            out->lithium.battery_voltage_centi = bits_get(b, 104, 12);
+            out->lithium.balancer_status = bits_get(b, 116, 4);
+            out->lithium.temperature_c = bits_get(b, 120, 7);   // raw, offset -40
+            break;
+
+        case VICTRON_BLE_RECORD_AC_CHARGER:
+            if (len < 11)
+                return VICTRON_DECODE_TOO_SHORT;
+
+            out->ac_charger.device_state = bits_get(b, 0, 8);
+            out->ac_charger.charger_error = bits_get(b, 8, 8);
+            out->ac_charger.battery_voltage_1_centi = bits_get(b, 16, 13);
+            out->ac_charger.battery_current_1_deci = bits_get(b, 29, 11);
+            out->ac_charger.battery_voltage_2_centi = bits_get(b, 40, 13);
+            out->ac_charger.battery_current_2_deci = bits_get(b, 53, 11);
+            out->ac_charger.battery_voltage_3_centi = bits_get(b, 64, 13);
+            out->ac_charger.battery_current_3_deci = bits_get(b, 77, 11);
+            out->ac_charger.temperature_c = (int8_t)((int)bits_get(b, 88, 7) - 40);
+            out->ac_charger.ac_current_deci = bits_get(b, 95, 9);
+            break;
+
+        default:
+            return VICTRON_DECODE_UNSUPPORTED;
+    }
+
+    out->type = (victron_record_type_t)record_type;
+    return VICTRON_DECODE_OK;
+}
@@ -0,0 +1,86 @@
+// victron_decode.h - private: manufacturer data parsing and record decoders
+//
+// No ESP-IDF dependencies, so the same code builds on the host for fuzzing
+// and benchmarks (only victron_records.h is needed).
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "victron_records.h"
+
+#define VICTRON_MANUFACTURER_RECORD_PRODUCT_ADVERTISEMENT 0x10
+
+// Bytes before the encrypted record: vendor id (2), manufacturer record type,
+// record length, product id (2), record type, nonce (2), key check
+#define VICTRON_ADV_HEADER_SIZE 10
+
+typedef enum {
+    VICTRON_ADV_OK = 0,
+    VICTRON_ADV_NOT_VICTRON,        // too short or another vendor
+    VICTRON_ADV_OTHER_RECORD,       // Victron, but not a product advertisement
+} victron_adv_status_t;
+
+// Header of a Victron product advertisement; `encrypted` points into the
+// manufacturer data and is not bounds-checked against the record buffer
+typedef struct {
+    uint8_t        manufacturer_record_type;
+    uint16_t       product_id;
+    uint8_t        record_type;     // victron_record_type_t
+    uint16_t       nonce;
+    uint8_t        key_check;       // first byte of the device's AES key
+    const uint8_t *encrypted;
+    size_t         encrypted_len;   // at least 1
+} victron_adv_t;
+
+static inline uint16_t victron_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Parse manufacturer data (starting at the vendor id). Inline: it runs for
+// every advertisement, most of them not Victron
+static inline victron_adv_status_t victron_parse_adv(const uint8_t *mfg, size_t len, victron_adv_t *out)
+{
+    if (len < VICTRON_ADV_HEADER_SIZE + 1 || victron_le16(mfg) != VICTRON_MANUFACTURER_ID)
+        return VICTRON_ADV_NOT_VICTRON;
+
+    out->manufacturer_record_type = mfg[2];
+    if (mfg[2] != VICTRON_MANUFACTURER_RECORD_PRODUCT_ADVERTISEMENT)
+        return VICTRON_ADV_OTHER_RECORD;
+
+    out->product_id = victron_le16(mfg + 4);
+    out->record_type = mfg[6];
+    out->nonce = victron_le16(mfg + 7);
+    out->key_check = mfg[9];
+    out->encrypted = mfg + VICTRON_ADV_HEADER_SIZE;
+    out->encrypted_len = len - VICTRON_ADV_HEADER_SIZE;
+    return VICTRON_ADV_OK;
+}
+
+// Copy the encrypted payload into a record buffer, zero past its end (the
+// decoders read fixed offsets). False if it does not fit the buffer
+static inline bool victron_adv_load_payload(const victron_adv_t *adv,
+                                            uint8_t buf[VICTRON_ENCRYPTED_DATA_MAX_SIZE])
+{
+    if (adv->encrypted_len > VICTRON_ENCRYPTED_DATA_MAX_SIZE)
+        return false;
+
+    memset(buf, 0, VICTRON_ENCRYPTED_DATA_MAX_SIZE);   // constant size: inlined stores
+    memcpy(buf, adv->encrypted, adv->encrypted_len);
+    return true;
+}
+
+typedef enum {
+    VICTRON_DECODE_OK = 0,
+    VICTRON_DECODE_TOO_SHORT,       // shorter than the record type needs
+    VICTRON_DECODE_UNSUPPORTED,     // record type without a decoder
+} victron_decode_status_t;
+
+// Decode a decrypted record into out. `plain` must hold
+// VICTRON_ENCRYPTED_DATA_MAX_SIZE bytes, zero past `len`: decoders read
+// fixed offsets without a bounds check per field.
+victron_decode_status_t victron_decode_record(uint8_t record_type,
+                                              const uint8_t plain[VICTRON_ENCRYPTED_DATA_MAX_SIZE],
+                                              size_t len, victron_record_t *out);
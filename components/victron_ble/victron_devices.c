@@ -0,0 +1,272 @@
+// victron_devices.c - provisioned device table, persisted in NVS
+//
+// The GAP handler looks devices up without taking a lock. The table lives in
+// two buffers; readers use the one `active` points to and pin it with a
+// per-buffer reader count. Writers (console commands) build the new table in
+// the other buffer once no reader holds it any more, then publish it with a
+// single atomic store.
+//
+// Each published table carries an open-addressing hash index over the MACs,
+// so a lookup costs one hash and usually one compare, independent of the
+// number of configured devices.
+#include "victron_devices.h"
+#include <string.h>
+#include "esp_log.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+static const char *TAG = "victron_dev";
+
+#define NVS_NAMESPACE  "victron_dev"
+#define NVS_KEY        "table"
+#define TABLE_VERSION  1
+
+// Hash buckets: power of two, at least twice VICTRON_MAX_DEVICES
+#define INDEX_SIZE     32
+#define INDEX_EMPTY    0xFF
+_Static_assert(INDEX_SIZE == 32 && INDEX_SIZE >= 2 * VICTRON_MAX_DEVICES,
+               "mac_hash() returns 5 bits; keep the index at most half full");
+
+typedef struct {
+    uint8_t                 version;
+    uint8_t                 count;
+    victron_device_config_t dev[VICTRON_MAX_DEVICES];
+} device_table_t;
+
+// RAM copy of a table plus its index (the index is not persisted)
+typedef struct {
+    device_table_t t;
+    uint8_t        index[INDEX_SIZE];   // device position, or INDEX_EMPTY
+} device_set_t;
+
+// Written to NVS on first boot, so existing installations keep working.
+// MAC address in reverse order (LSB first as received from BLE).
+static const victron_device_config_t default_devices[] = {
+    {   // MPPT SmartSolar - c1:56:39:b4:7d:b5
+        .mac = { 0xb5, 0x7d, 0xb4, 0x39, 0x56, 0xc1 },
+        .key = { 0xf2, 0xdc, 0xc3, 0xba, 0x40, 0xed, 0xb8, 0xde,
+                 0x7e, 0x07, 0xd7, 0x63, 0x8f, 0x13, 0xf9, 0x71 },
+        .role = VICTRON_DEVICE_MPPT,
+        .name = "SmartSolar",
+    },
+    {   // SmartBatterySense - c1:b6:91:bd:9e:2b
+        .mac = { 0x2b, 0x9e, 0xbd, 0x91, 0xb6, 0xc1 },
+        .key = { 0xb7, 0xab, 0xe1, 0x9c, 0x00, 0x32, 0x40, 0xbe,
+                 0x9d, 0xae, 0x89, 0xb8, 0xc3, 0x72, 0xdd, 0x43 },
+        .role = VICTRON_DEVICE_BATTERY_SENSE,
+        .name = "BatterySense",
+    },
+    {   // SmartShunt - f9:3c:cf:0c:1b:2e
+        .mac = { 0x2e, 0x1b, 0x0c, 0xcf, 0x3c, 0xf9 },
+        .key = { 0x4c, 0x1e, 0x3c, 0xcd, 0x3d, 0x89, 0x2d, 0xb1,
+                 0x3d, 0x7a, 0x43, 0x74, 0x0b, 0x7f, 0x10, 0x21 },
+        .role = VICTRON_DEVICE_SMARTSHUNT,
+        .name = "SmartShunt",
+    },
+    {   // Blue Smart IP22 Charger - e9:a6:fc:ca:7b:00
+        .mac = { 0x00, 0x7b, 0xca, 0xfc, 0xa6, 0xe9 },
+        .key = { 0x19, 0xef, 0xd0, 0xcf, 0x51, 0xbe, 0xfc, 0x3e,
+                 0x2e, 0x4a, 0x2b, 0x85, 0x84, 0x14, 0x4f, 0x2a },
+        .role = VICTRON_DEVICE_AC_CHARGER,
+        .name = "IP22 Charger",
+    },
+};
+
+#define DEFAULT_DEVICE_COUNT (sizeof(default_devices) / sizeof(default_devices[0]))
+
+static device_set_t tables[2];
+static uint32_t active;                 // index of the published table
+static uint32_t readers[2];             // lookups in progress, per table
+static SemaphoreHandle_t write_lock;    // serializes writers only
+
+// Pin the published table; the GAP handler never blocks here
+static uint32_t reader_enter(void)
+{
+    for (;;) {
+        uint32_t idx = __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+        __atomic_add_fetch(&readers[idx], 1, __ATOMIC_ACQ_REL);
+        if (__atomic_load_n(&active, __ATOMIC_ACQUIRE) == idx) return idx;
+        // A writer swapped in between; it may be about to reuse idx
+        __atomic_sub_fetch(&readers[idx], 1, __ATOMIC_RELEASE);
+    }
+}
+
+static inline void reader_exit(uint32_t idx)
+{
+    __atomic_sub_fetch(&readers[idx], 1, __ATOMIC_RELEASE);
+}
+
+// Victron MACs share their vendor prefix in the upper bytes (BLE order: the
+// last three), so the hash mixes the device-specific lower three
+static inline uint32_t mac_hash(const uint8_t mac[6])
+{
+    uint32_t h = (uint32_t)mac[0] | (uint32_t)mac[1] << 8 | (uint32_t)mac[2] << 16;
+    h ^= (uint32_t)mac[3] << 5 ^ (uint32_t)mac[4] << 13 ^ (uint32_t)mac[5] << 21;
+    h *= 0x9E3779B1u;
+    return h >> 27;   // top 5 bits: 0 .. INDEX_SIZE - 1
+}
+
+static void build_index(device_set_t *set)
+{
+    memset(set->index, INDEX_EMPTY, sizeof(set->index));
+    for (int i = 0; i < set->t.count; i++) {
+        uint32_t b = mac_hash(set->t.dev[i].mac);
+        while (set->index[b] != INDEX_EMPTY) {
+            b = (b + 1) & (INDEX_SIZE - 1);
+        }
+        set->index[b] = (uint8_t)i;
+    }
+}
+
+// Position of a MAC in the set, or -1
+static int find(const device_set_t *set, const uint8_t mac[6])
+{
+    uint32_t b = mac_hash(mac);
+    for (int probe = 0; probe < INDEX_SIZE; probe++) {
+        uint8_t i = set->index[b];
+        if (i == INDEX_EMPTY) return -1;
+        if (memcmp(set->t.dev[i].mac, mac, 6) == 0) return i;
+        b = (b + 1) & (INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+// Writer: fill the inactive buffer and make it the published one
+static void publish(const device_table_t *next)
+{
+    uint32_t other = __atomic_load_n(&active, __ATOMIC_RELAXED) ^ 1;
+    while (__atomic_load_n(&readers[other], __ATOMIC_ACQUIRE) != 0) {
+        vTaskDelay(1);   // lookups take microseconds
+    }
+    tables[other].t = *next;
+    build_index(&tables[other]);
+    __atomic_store_n(&active, other, __ATOMIC_RELEASE);
+}
+
+static esp_err_t save(const device_table_t *t)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(h, NVS_KEY, t, sizeof(*t));
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
+
+static bool load(device_table_t *t)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return false;
+    size_t len = sizeof(*t);
+    esp_err_t err = nvs_get_blob(h, NVS_KEY, t, &len);
+    nvs_close(h);
+    return err == ESP_OK && len == sizeof(*t) && t->version == TABLE_VERSION &&
+           t->count <= VICTRON_MAX_DEVICES;
+}
+
+void victron_devices_init(void)
+{
+    write_lock = xSemaphoreCreateMutex();
+
+    device_table_t t;
+    if (!load(&t)) {
+        memset(&t, 0, sizeof(t));
+        t.version = TABLE_VERSION;
+        t.count = DEFAULT_DEVICE_COUNT;
+        memcpy(t.dev, default_devices, sizeof(default_devices));
+        esp_err_t err = save(&t);
+        ESP_LOGI(TAG, "No device table in NVS, stored %u defaults (%s)",
+                 (unsigned)t.count, esp_err_to_name(err));
+    }
+    for (int i = 0; i < t.count; i++) {
+        t.dev[i].name[VICTRON_NAME_MAX - 1] = '\0';
+    }
+    publish(&t);
+    ESP_LOGI(TAG, "%u devices configured", (unsigned)t.count);
+}
+
+bool victron_devices_lookup(const uint8_t mac[6], victron_device_config_t *out)
+{
+    uint32_t idx = reader_enter();
+    int pos = find(&tables[idx], mac);
+    if (pos >= 0 && out) *out = tables[idx].t.dev[pos];
+    reader_exit(idx);
+    return pos >= 0;
+}
+
+size_t victron_ble_device_count(void)
+{
+    uint32_t idx = reader_enter();
+    size_t n = tables[idx].t.count;
+    reader_exit(idx);
+    return n;
+}
+
+bool victron_ble_device_config(size_t index, victron_device_config_t *out)
+{
+    uint32_t idx = reader_enter();
+    bool ok = index < tables[idx].t.count;
+    if (ok && out) *out = tables[idx].t.dev[index];
+    reader_exit(idx);
+    return ok;
+}
+
+bool victron_ble_device_info(size_t index, uint8_t mac[6], victron_device_id_t *role)
+{
+    victron_device_config_t cfg;
+    if (!victron_ble_device_config(index, &cfg)) return false;
+    if (mac) memcpy(mac, cfg.mac, 6);
+    if (role) *role = cfg.role;
+    return true;
+}
+
+// Apply a change to a copy of the published table, persist it, then publish
+static esp_err_t modify(const victron_device_config_t *add, const uint8_t *remove_mac)
+{
+    if (!write_lock) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+
+    // Only writers change tables, and they hold the lock: no pinning needed
+    const device_set_t *cur = &tables[__atomic_load_n(&active, __ATOMIC_RELAXED)];
+    device_table_t t = cur->t;
+    int pos = find(cur, add ? add->mac : remove_mac);
+
+    esp_err_t err = ESP_OK;
+    if (add) {
+        if (pos < 0 && t.count >= VICTRON_MAX_DEVICES) {
+            err = ESP_ERR_NO_MEM;
+        } else {
+            if (pos < 0) pos = t.count++;
+            t.dev[pos] = *add;
+            t.dev[pos].name[VICTRON_NAME_MAX - 1] = '\0';
+        }
+    } else if (pos < 0) {
+        err = ESP_ERR_NOT_FOUND;
+    } else {
+        memmove(&t.dev[pos], &t.dev[pos + 1], (t.count - pos - 1) * sizeof(t.dev[0]));
+        t.count--;
+    }
+
+    if (err == ESP_OK) err = save(&t);
+    if (err == ESP_OK) publish(&t);
+
+    xSemaphoreGive(write_lock);
+    return err;
+}
+
+esp_err_t victron_ble_add_device(const victron_device_config_t *cfg)
+{
+    if (!cfg || cfg->role == VICTRON_DEVICE_UNKNOWN || cfg->role >= VICTRON_DEVICE_ROLE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return modify(cfg, NULL);
+}
+
+esp_err_t victron_ble_remove_device(const uint8_t mac[6])
+{
+    if (!mac) return ESP_ERR_INVALID_ARG;
+    return modify(NULL, mac);
+}
@@ -0,0 +1,11 @@
+// victron_devices.h - private: provisioned device table (MAC, key, role, name)
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "victron_ble.h"
+
+// Load the table from NVS (seeding it from the built-in defaults on first boot)
+void victron_devices_init(void);
+
+// Copy the entry for a MAC; lock-free, safe from the GAP handler
+bool victron_devices_lookup(const uint8_t mac[6], victron_device_config_t *out);
@@ -1,4 +1,4 @@
-// Auto-generated from upstream Victron product list
+// Generated by scripts/gen_products.py from include/victron_products.h - do not edit
 #include "victron_products.h"
 #include <stddef.h>
 
@@ -7,6 +7,7 @@ typedef struct {
     const char *name;
 } victron_product_name_entry_t;
 
+// Sorted by id (binary search below)
 static const victron_product_name_entry_t kProductNames[] = {
     { 0x0203, "BMV-700" },
     { 0x0204, "BMV-702" },
@@ -144,13 +145,21 @@ static const victron_product_name_entry_t kProductNames[] = {
     { 0xA3F0, "Smart BuckBoost 12V/12V-50A" },
 };
 
+#define PRODUCT_COUNT (sizeof(kProductNames) / sizeof(kProductNames[0]))
+
 const char *victron_product_name(uint16_t product_id)
 {
-    for (size_t i = 0; i < (sizeof(kProductNames) / sizeof(kProductNames[0])); ++i) {
-        if (kProductNames[i].id == product_id) {
-            return kProductNames[i].name;
+    size_t lo = 0, hi = PRODUCT_COUNT;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (kProductNames[mid].id < product_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
+    if (lo < PRODUCT_COUNT && kProductNames[lo].id == product_id) {
+        return kProductNames[lo].name;
+    }
     return NULL;
 }
-
@@ -0,0 +1,105 @@
+// victron_seen.c - lock-free ring of recently seen Victron devices
+//
+// Single writer (BLE host task), any number of readers. Each slot carries a
+// sequence counter (seqlock): odd while the writer is updating it, so readers
+// retry instead of blocking the GAP handler.
+#include "victron_seen.h"
+#include "victron_ble.h"
+#include "victron_products.h"
+#include <string.h>
+#include "esp_timer.h"
+
+typedef struct {
+    uint32_t seq;                  // even = stable, odd = write in progress
+    victron_seen_device_t dev;
+} seen_slot_t;
+
+static seen_slot_t seen_ring[VICTRON_SEEN_RING_SIZE];
+
+static void slot_write(seen_slot_t *slot, const victron_seen_device_t *dev)
+{
+    uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->dev = *dev;
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+bool victron_seen_publish(const uint8_t mac[6], int8_t rssi, uint8_t record_type,
+                          uint16_t product_id, uint8_t key_check,
+                          victron_key_status_t key_status, const char **product_name)
+{
+    // The writer owns the ring, so it may read slots without the seqlock.
+    // A new device takes a free slot, else the least recently seen one, so
+    // devices that keep advertising are not evicted and reported new again
+    seen_slot_t *slot = NULL, *free_slot = NULL, *oldest = NULL;
+    for (int i = 0; i < VICTRON_SEEN_RING_SIZE; i++) {
+        seen_slot_t *s = &seen_ring[i];
+        if (s->dev.count == 0) {
+            if (!free_slot) free_slot = s;
+            continue;
+        }
+        if (memcmp(s->dev.mac, mac, 6) == 0) {
+            slot = s;
+            break;
+        }
+        if (!oldest || (int32_t)(s->dev.last_seen_ms - oldest->dev.last_seen_ms) < 0) oldest = s;
+    }
+
+    victron_seen_device_t dev;
+    bool is_new = (slot == NULL);
+    if (slot) {
+        dev = slot->dev;
+    } else {
+        slot = free_slot ? free_slot : oldest;
+        memset(&dev, 0, sizeof(dev));
+        memcpy(dev.mac, mac, 6);
+    }
+
+    // Resolve the product name only when the device is new to the ring
+    if (is_new || dev.product_id != product_id) {
+        dev.product_name = victron_product_name(product_id);
+    }
+    if (product_name) *product_name = dev.product_name;
+
+    dev.rssi = rssi;
+    dev.record_type = record_type;
+    dev.product_id = product_id;
+    dev.key_check = key_check;
+    dev.key_status = key_status;
+    dev.last_seen_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    dev.count++;
+    if (key_status == VICTRON_KEY_MISMATCH) dev.rejected++;
+    slot_write(slot, &dev);
+    return is_new;
+}
+
+size_t victron_ble_get_seen(victron_seen_device_t *out, size_t max)
+{
+    size_t n = 0;
+    if (max == 0) return 0;
+    for (int i = 0; i < VICTRON_SEEN_RING_SIZE; i++) {
+        seen_slot_t *slot = &seen_ring[i];
+        victron_seen_device_t copy;
+        uint32_t before, after;
+        do {
+            before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+            copy = slot->dev;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+        } while ((before & 1u) || before != after);
+
+        if (copy.count == 0) continue;
+
+        // Keep the `max` most recently seen, newest first: insertion sort,
+        // the oldest kept entry drops out when the output is full
+        if (n == max && (int32_t)(copy.last_seen_ms - out[max - 1].last_seen_ms) <= 0) continue;
+        size_t pos = (n < max) ? n++ : max - 1;
+        while (pos > 0 && (int32_t)(copy.last_seen_ms - out[pos - 1].last_seen_ms) > 0) {
+            out[pos] = out[pos - 1];
+            pos--;
+        }
+        out[pos] = copy;
+    }
+    return n;
+}
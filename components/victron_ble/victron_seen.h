@@ -0,0 +1,13 @@
+// victron_seen.h - private: publisher side of the "last seen devices" ring
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "victron_ble.h"
+
+// Record one Victron advertisement (BLE host task only - single writer)
+// Returns true if the MAC was not in the ring yet; *product_name is set to
+// the device's cached product name (NULL for an unlisted product id)
+bool victron_seen_publish(const uint8_t mac[6], int8_t rssi, uint8_t record_type,
+                          uint16_t product_id, uint8_t key_check,
+                          victron_key_status_t key_status, const char **product_name);
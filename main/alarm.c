@@ -0,0 +1,443 @@
+/**
+ * Alarm - Implementation
+ */
+#include "alarm.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
+#include "nvs.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "diag_log.h"
+#include "device_table.h"
+#include "event_log.h"
+
+static const char *TAG = "ALARM";
+
+#define NVS_NAMESPACE "alarms"
+#define NVS_KEY_RULES "rules"
+
+// Record types 0x00..0x0F index the compiled table
+#define RECORD_TYPES 16
+
+typedef enum { F_U8, F_S8, F_U16, F_S16, F_S32 } field_type_t;
+
+// A decoded field: raw = (value + bias) * scale. Rules are stored with the
+// field's index, so entries are only ever appended.
+typedef struct {
+    const char *name;
+    uint8_t     record;     // victron_record_type_t
+    uint8_t     offset;     // in victron_record_t's union
+    uint8_t     type;       // field_type_t
+    bool        aux_temp;   // battery monitor aux_value, valid only with aux_input 2
+    float       scale;
+    float       bias;
+    int32_t     na;         // raw "not available" value
+    const char *unit;
+} alarm_field_t;
+
+#define REC(t)  VICTRON_BLE_RECORD_##t
+#define OFF(m)  offsetof(victron_record_t, m)
+
+static const alarm_field_t fields[] = {
+    { "solar.state",    REC(SOLAR_CHARGER),   OFF(solar.device_state),          F_U8,  false, 1,    0,      0xFF,     "" },
+    { "solar.error",    REC(SOLAR_CHARGER),   OFF(solar.charger_error),         F_U8,  false, 1,    0,      0xFF,     "" },
+    { "solar.volt",     REC(SOLAR_CHARGER),   OFF(solar.battery_voltage_centi), F_S16, false, 100,  0,      0x7FFF,   "V" },
+    { "solar.amps",     REC(SOLAR_CHARGER),   OFF(solar.battery_current_deci),  F_S16, false, 10,   0,      0x7FFF,   "A" },
+    { "solar.power",    REC(SOLAR_CHARGER),   OFF(solar.pv_power_w),            F_U16, false, 1,    0,      0xFFFF,   "W" },
+    { "solar.yield",    REC(SOLAR_CHARGER),   OFF(solar.yield_today_centikwh),  F_U16, false, 100,  0,      0xFFFF,   "kWh" },
+    { "battery.soc",    REC(BATTERY_MONITOR), OFF(battery.soc_deci_percent),    F_U16, false, 10,   0,      0x3FF,    "%" },
+    { "battery.volt",   REC(BATTERY_MONITOR), OFF(battery.battery_voltage_centi), F_U16, false, 100, 0,     0xFFFF,   "V" },
+    { "battery.amps",   REC(BATTERY_MONITOR), OFF(battery.battery_current_milli), F_S32, false, 1000, 0,    0x1FFFFF, "A" },
+    { "battery.ttg",    REC(BATTERY_MONITOR), OFF(battery.time_to_go_minutes),  F_U16, false, 1,    0,      0xFFFF,   "min" },
+    { "battery.alarm",  REC(BATTERY_MONITOR), OFF(battery.alarm_reason),        F_U16, false, 1,    0,      0xFFFF,   "" },
+    { "battery.temp",   REC(BATTERY_MONITOR), OFF(battery.aux_value),           F_U16, true,  100,  273.15f, 0xFFFF,  "C" },
+    { "inverter.state", REC(INVERTER),        OFF(inverter.device_state),       F_U8,  false, 1,    0,      0xFF,     "" },
+    { "inverter.volt",  REC(INVERTER),        OFF(inverter.battery_voltage_centi), F_S16, false, 100, 0,    0x7FFF,   "V" },
+    { "inverter.va",    REC(INVERTER),        OFF(inverter.ac_apparent_power_va), F_U16, false, 1,  0,      0xFFFF,   "VA" },
+    { "inverter.alarm", REC(INVERTER),        OFF(inverter.alarm_reason),       F_U16, false, 1,    0,      0xFFFF,   "" },
+    { "dcdc.state",     REC(DCDC_CONVERTER),  OFF(dcdc.device_state),           F_U8,  false, 1,    0,      0xFF,     "" },
+    { "dcdc.error",     REC(DCDC_CONVERTER),  OFF(dcdc.charger_error),          F_U8,  false, 1,    0,      0xFF,     "" },
+    { "dcdc.in",        REC(DCDC_CONVERTER),  OFF(dcdc.input_voltage_centi),    F_U16, false, 100,  0,      0xFFFF,   "V" },
+    { "dcdc.out",       REC(DCDC_CONVERTER),  OFF(dcdc.output_voltage_centi),   F_U16, false, 100,  0,      0xFFFF,   "V" },
+    { "ac.state",       REC(AC_CHARGER),      OFF(ac_charger.device_state),     F_U8,  false, 1,    0,      0xFF,     "" },
+    { "ac.error",       REC(AC_CHARGER),      OFF(ac_charger.charger_error),    F_U8,  false, 1,    0,      0xFF,     "" },
+    { "ac.volt",        REC(AC_CHARGER),      OFF(ac_charger.battery_voltage_1_centi), F_U16, false, 100, 0, 0x1FFF,  "V" },
+    { "ac.amps",        REC(AC_CHARGER),      OFF(ac_charger.battery_current_1_deci),  F_U16, false, 10,  0, 0x7FF,   "A" },
+    { "ac.temp",        REC(AC_CHARGER),      OFF(ac_charger.temperature_c),    F_S8,  false, 1,    0,      87,       "C" },
+};
+
+#define FIELD_COUNT (int)(sizeof(fields) / sizeof(fields[0]))
+
+_Static_assert(FIELD_COUNT <= UINT8_MAX, "field index is stored in a byte");
+
+// Built-in rules, used until the first change
+static const struct {
+    const char *field;
+    alarm_op_t  op;
+    float       threshold, hysteresis;
+    uint16_t    debounce_s;
+    uint8_t     outputs;
+} default_rules[] = {
+    { "battery.soc",   ALARM_BELOW,    20,     2, 60, ALARM_OUT_BUZZER },
+    { "battery.alarm", ALARM_ANY_BITS, 0xFFFF, 0, 0,  ALARM_OUT_BUZZER },
+    { "battery.temp",  ALARM_ABOVE,    45,     3, 60, ALARM_OUT_BUZZER },
+    { "solar.error",   ALARM_ABOVE,    0,      0, 10, 0 },
+};
+
+// A rule with its thresholds in raw field units
+typedef struct {
+    uint8_t  rule;
+    uint8_t  field;
+    uint8_t  op;
+    uint32_t debounce_ms;
+    int32_t  trip;          // BELOW: raw < trip, ABOVE: raw > trip, ANY_BITS: raw & trip
+    int32_t  clear;         // BELOW: raw >= clear, ABOVE: raw <= clear
+} compiled_rule_t;
+
+typedef struct {
+    bool     active;
+    bool     pending;       // condition holds, debounce running
+    uint32_t since_ms;
+} rule_state_t;
+
+static SemaphoreHandle_t mutex;
+static alarm_rule_t rules[ALARM_MAX_RULES];
+static int rule_count;
+
+// Rules sorted by record type; those of type t are table[first[t] .. first[t + 1])
+static compiled_rule_t table[ALARM_MAX_RULES];
+static uint8_t first[RECORD_TYPES + 1];
+
+static rule_state_t state[ALARM_MAX_RULES][DEVICE_TABLE_MAX];
+static uint32_t active_slots;
+static bool buzzer_acked;
+
+static inline uint32_t now_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// Raw value of a field; the record is packed, so fields are copied out
+static int32_t field_raw(const alarm_field_t *f, const victron_record_t *r) {
+    const uint8_t *p = (const uint8_t *)r + f->offset;
+    switch (f->type) {
+        case F_U8:  return p[0];
+        case F_S8:  return (int8_t)p[0];
+        case F_U16: { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+        case F_S16: { int16_t v; memcpy(&v, p, sizeof(v)); return v; }
+        default:    { int32_t v; memcpy(&v, p, sizeof(v)); return v; }
+    }
+}
+
+// Threshold in raw units: exact values stay exact, others round toward the
+// side that keeps the comparison in field units ("below 20.05 %" is raw < 201)
+static int32_t to_raw(const alarm_field_t *f, float value, bool up) {
+    double x = ((double)value + f->bias) * f->scale;
+    double r = round(x);
+    if (fabs(x - r) < 1e-3) return (int32_t)r;
+    return (int32_t)(up ? ceil(x) : floor(x));
+}
+
+static void compile(void) {
+    int n = 0;
+    for (int t = 0; t < RECORD_TYPES; t++) {
+        first[t] = (uint8_t)n;
+        for (int i = 0; i < rule_count; i++) {
+            const alarm_rule_t *r = &rules[i];
+            const alarm_field_t *f = &fields[r->field];
+            if (f->record != t) continue;
+
+            compiled_rule_t *c = &table[n++];
+            c->rule = (uint8_t)i;
+            c->field = r->field;
+            c->op = r->op;
+            c->debounce_ms = r->debounce_s * 1000u;
+            switch (r->op) {
+                case ALARM_BELOW:
+                    c->trip = to_raw(f, r->threshold, true);
+                    c->clear = to_raw(f, r->threshold + r->hysteresis, true);
+                    break;
+                case ALARM_ABOVE:
+                    c->trip = to_raw(f, r->threshold, false);
+                    c->clear = to_raw(f, r->threshold - r->hysteresis, false);
+                    break;
+                default:
+                    c->trip = (int32_t)r->threshold;
+                    c->clear = 0;
+                    break;
+            }
+        }
+    }
+    first[RECORD_TYPES] = (uint8_t)n;
+
+    // Alarms of the old rule set end without a log entry
+    memset(state, 0, sizeof(state));
+    active_slots = 0;
+}
+
+static void set_output(int gpio, bool on) {
+    if (gpio >= 0) {
+        gpio_set_level(gpio, on ? ALARM_OUTPUT_ACTIVE_LEVEL : !ALARM_OUTPUT_ACTIVE_LEVEL);
+    }
+}
+
+// Outputs and the slot mask from the rule states; called with the mutex held
+static void update_outputs(void) {
+    uint8_t outputs = 0;
+    uint32_t slots = 0;
+    for (int i = 0; i < rule_count; i++) {
+        for (int s = 0; s < DEVICE_TABLE_MAX; s++) {
+            if (state[i][s].active) {
+                outputs |= rules[i].outputs;
+                slots |= 1u << s;
+            }
+        }
+    }
+    active_slots = slots;
+    set_output(ALARM_BUZZER_GPIO, (outputs & ALARM_OUT_BUZZER) && !buzzer_acked);
+    set_output(ALARM_RELAY_GPIO, outputs & ALARM_OUT_RELAY);
+}
+
+static void rule_text(const alarm_rule_t *r, char *buf, size_t len) {
+    const alarm_field_t *f = &fields[r->field];
+    const char *name = strchr(f->name, '.') + 1;
+    if (r->op == ALARM_ANY_BITS) {
+        snprintf(buf, len, "%s&%X", name, (unsigned)r->threshold);
+    } else {
+        snprintf(buf, len, "%s%c%g%s", name, r->op == ALARM_BELOW ? '<' : '>',
+                 (double)r->threshold, f->unit);
+    }
+}
+
+static void raise_or_clear(int k, int slot, bool raised) {
+    const alarm_rule_t *r = &rules[table[k].rule];
+    char text[12];
+    rule_text(r, text, sizeof(text));
+    event_log_rule(slot, text, raised);
+    if (raised) {
+        if (r->outputs & ALARM_OUT_BUZZER) buzzer_acked = false;
+        DIAG_LOG_EVERY(0, ESP_LOG_WARN, TAG, "Raised %s (slot %d)", fields[r->field].name, slot);
+    } else {
+        DIAG_LOG_EVERY(0, ESP_LOG_INFO, TAG, "Cleared %s (slot %d)", fields[r->field].name, slot);
+    }
+}
+
+void alarm_update(int slot, const victron_data_t *data) {
+    if (!mutex || slot < 0 || slot >= DEVICE_TABLE_MAX || data->type >= RECORD_TYPES) return;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint32_t now = now_ms();
+    bool changed = false;
+    for (int k = first[data->type]; k < first[data->type + 1]; k++) {
+        const compiled_rule_t *c = &table[k];
+        const alarm_field_t *f = &fields[c->field];
+        rule_state_t *st = &state[c->rule][slot];
+
+        // Not available: keep the alarm as it is, restart the debounce
+        if (f->aux_temp && data->record.battery.aux_input != 2) {
+            st->pending = false;
+            continue;
+        }
+        int32_t v = field_raw(f, &data->record);
+        if (v == f->na) {
+            st->pending = false;
+            continue;
+        }
+
+        bool trip, clear;
+        switch (c->op) {
+            case ALARM_BELOW: trip = v < c->trip;  clear = v >= c->clear; break;
+            case ALARM_ABOVE: trip = v > c->trip;  clear = v <= c->clear; break;
+            default:          trip = (v & c->trip) != 0; clear = !trip; break;
+        }
+
+        if (st->active) {
+            if (clear) {
+                st->active = false;
+                raise_or_clear(k, slot, false);
+                changed = true;
+            }
+        } else if (trip) {
+            if (!st->pending) {
+                st->pending = true;
+                st->since_ms = now;
+            }
+            if (now - st->since_ms >= c->debounce_ms) {
+                st->active = true;
+                st->pending = false;
+                raise_or_clear(k, slot, true);
+                changed = true;
+            }
+        } else {
+            st->pending = false;
+        }
+    }
+    if (changed) update_outputs();
+    xSemaphoreGive(mutex);
+}
+
+// Called with the mutex held
+static esp_err_t save_rules(void) {
+    compile();
+    update_outputs();
+
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(h, NVS_KEY_RULES, rules, rule_count * sizeof(rules[0]));
+        if (err == ESP_OK) err = nvs_commit(h);
+        nvs_close(h);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Saving rules failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+static bool rule_valid(const alarm_rule_t *r) {
+    if (r->field >= FIELD_COUNT || r->op > ALARM_ANY_BITS) return false;
+    if (!isfinite(r->threshold) || !isfinite(r->hysteresis) || r->hysteresis < 0) return false;
+    // A bit mask is a positive integer
+    return r->op != ALARM_ANY_BITS ||
+           (r->threshold >= 1 && r->threshold <= 0xFFFFFF && r->threshold == floorf(r->threshold));
+}
+
+static void load_defaults(void) {
+    rule_count = 0;
+    for (size_t i = 0; i < sizeof(default_rules) / sizeof(default_rules[0]); i++) {
+        alarm_rule_t *r = &rules[rule_count++];
+        r->field = (uint8_t)alarm_field_find(default_rules[i].field);
+        r->op = default_rules[i].op;
+        r->outputs = default_rules[i].outputs;
+        r->debounce_s = default_rules[i].debounce_s;
+        r->threshold = default_rules[i].threshold;
+        r->hysteresis = default_rules[i].hysteresis;
+    }
+}
+
+void alarm_init(void) {
+    mutex = xSemaphoreCreateMutex();
+
+    load_defaults();
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) == ESP_OK) {
+        alarm_rule_t stored[ALARM_MAX_RULES];
+        size_t len = sizeof(stored);
+        if (nvs_get_blob(h, NVS_KEY_RULES, stored, &len) == ESP_OK && len % sizeof(stored[0]) == 0) {
+            int n = 0;
+            for (size_t i = 0; i < len / sizeof(stored[0]); i++) {
+                if (rule_valid(&stored[i])) rules[n++] = stored[i];
+            }
+            rule_count = n;
+        }
+        nvs_close(h);
+    }
+    compile();
+
+    uint64_t pins = 0;
+#if ALARM_BUZZER_GPIO >= 0
+    pins |= 1ULL << ALARM_BUZZER_GPIO;
+#endif
+#if ALARM_RELAY_GPIO >= 0
+    pins |= 1ULL << ALARM_RELAY_GPIO;
+#endif
+    if (pins) {
+        gpio_config_t io_conf = {
+            .pin_bit_mask = pins,
+            .mode = GPIO_MODE_OUTPUT,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_DISABLE,
+        };
+        gpio_config(&io_conf);
+    }
+    update_outputs();
+    ESP_LOGI(TAG, "%d rules", rule_count);
+}
+
+int alarm_field_find(const char *name) {
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (strcmp(fields[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+bool alarm_field_info(int i, const char **name, const char **unit) {
+    if (i < 0 || i >= FIELD_COUNT) return false;
+    *name = fields[i].name;
+    *unit = fields[i].unit;
+    return true;
+}
+
+esp_err_t alarm_add(const alarm_rule_t *rule) {
+    if (!rule_valid(rule)) return ESP_ERR_INVALID_ARG;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    esp_err_t err = ESP_ERR_NO_MEM;
+    if (rule_count < ALARM_MAX_RULES) {
+        rules[rule_count++] = *rule;
+        err = save_rules();
+    }
+    xSemaphoreGive(mutex);
+    return err;
+}
+
+esp_err_t alarm_remove(int i) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (i >= 0 && i < rule_count) {
+        memmove(&rules[i], &rules[i + 1], (rule_count - i - 1) * sizeof(rules[0]));
+        rule_count--;
+        err = save_rules();
+    }
+    xSemaphoreGive(mutex);
+    return err;
+}
+
+esp_err_t alarm_reset_defaults(void) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    load_defaults();
+    esp_err_t err = save_rules();
+    xSemaphoreGive(mutex);
+    return err;
+}
+
+bool alarm_get_rule(int i, alarm_rule_t *out) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    bool ok = (i >= 0 && i < rule_count);
+    if (ok) *out = rules[i];
+    xSemaphoreGive(mutex);
+    return ok;
+}
+
+void alarm_rule_text(int i, char *buf, size_t len) {
+    alarm_rule_t r;
+    if (alarm_get_rule(i, &r)) {
+        rule_text(&r, buf, len);
+    } else if (len) {
+        buf[0] = '\0';
+    }
+}
+
+uint32_t alarm_active_slots(void) {
+    return active_slots;
+}
+
+int alarm_active_count(int i) {
+    int n = 0;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (i >= 0 && i < rule_count) {
+        for (int s = 0; s < DEVICE_TABLE_MAX; s++) n += state[i][s].active;
+    }
+    xSemaphoreGive(mutex);
+    return n;
+}
+
+void alarm_ack(void) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    buzzer_acked = true;
+    update_outputs();
+    xSemaphoreGive(mutex);
+}
@@ -0,0 +1,120 @@
+/**
+ * Alarm - Threshold rules over decoded fields, with hysteresis and debounce
+ * A rule names a field ("battery.soc"), a condition (below / above a
+ * threshold, or any of a bit mask set), a hysteresis band, a debounce time
+ * and the outputs it drives. Rules are compiled into a flat table sorted by
+ * record type with thresholds converted to raw field units, so a frame costs
+ * integer compares for the rules over fields that its record carries.
+ *
+ * Each rule is tracked per device slot: it is raised once its condition has
+ * held for the debounce time (measured on frame arrival) and cleared when
+ * the value is back past the hysteresis band. Raising and clearing are
+ * logged to the event log; active alarms drive the optional buzzer and
+ * relay GPIOs until `alarm ack` (buzzer only) or the alarm clears.
+ *
+ * Rules are stored in NVS (namespace "alarms"); defaults apply until the
+ * first change. Thread-safe: rule edits (console) and evaluation (data
+ * callback) take the module's own mutex.
+ */
+#ifndef ALARM_H
+#define ALARM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "victron_ble.h"
+
+#define ALARM_MAX_RULES 16
+
+// Output pins; -1 leaves the output unused
+#ifndef ALARM_BUZZER_GPIO
+#define ALARM_BUZZER_GPIO -1
+#endif
+#ifndef ALARM_RELAY_GPIO
+#define ALARM_RELAY_GPIO  -1
+#endif
+#ifndef ALARM_OUTPUT_ACTIVE_LEVEL
+#define ALARM_OUTPUT_ACTIVE_LEVEL 1
+#endif
+
+typedef enum {
+    ALARM_BELOW,        // value < threshold, clears at >= threshold + hysteresis
+    ALARM_ABOVE,        // value > threshold, clears at <= threshold - hysteresis
+    ALARM_ANY_BITS,     // value & threshold != 0, clears when no bit is set
+} alarm_op_t;
+
+#define ALARM_OUT_BUZZER 0x01
+#define ALARM_OUT_RELAY  0x02
+
+typedef struct {
+    uint8_t  field;         // index from alarm_field_find()
+    uint8_t  op;            // alarm_op_t
+    uint8_t  outputs;       // ALARM_OUT_* (the screen always shows it)
+    uint16_t debounce_s;
+    float    threshold;     // field units; ALARM_ANY_BITS: the bit mask
+    float    hysteresis;    // field units, >= 0
+} alarm_rule_t;
+
+/**
+ * @brief Load the rules from NVS (NVS must already be initialized), set up the outputs
+ */
+void alarm_init(void);
+
+/**
+ * @brief Evaluate the rules for one decoded frame; cheap, meant for the data callback
+ * @param slot device table slot (from device_table_update); the caller holds the UI data mutex
+ */
+void alarm_update(int slot, const victron_data_t *data);
+
+/**
+ * @brief Field index by name ("battery.soc"), -1 if unknown
+ */
+int alarm_field_find(const char *name);
+
+/**
+ * @brief Name and unit of field index i; false past the last field
+ */
+bool alarm_field_info(int i, const char **name, const char **unit);
+
+/**
+ * @brief Add a rule (persisted)
+ * @return ESP_ERR_INVALID_ARG for a bad field or hysteresis, ESP_ERR_NO_MEM when full
+ */
+esp_err_t alarm_add(const alarm_rule_t *rule);
+
+/**
+ * @brief Remove rule i (persisted); later rules move down by one
+ */
+esp_err_t alarm_remove(int i);
+
+/**
+ * @brief Replace all rules with the built-in defaults (persisted)
+ */
+esp_err_t alarm_reset_defaults(void);
+
+/**
+ * @brief Copy rule i; false past the last rule
+ */
+bool alarm_get_rule(int i, alarm_rule_t *out);
+
+/**
+ * @brief Short text of rule i ("soc<20%"), for the event log
+ */
+void alarm_rule_text(int i, char *buf, size_t len);
+
+/**
+ * @brief Device slots with at least one active alarm (bit per slot)
+ */
+uint32_t alarm_active_slots(void);
+
+/**
+ * @brief Number of device slots for which rule i is active
+ */
+int alarm_active_count(int i);
+
+/**
+ * @brief Silence the buzzer until the next alarm is raised
+ */
+void alarm_ack(void);
+
+#endif // ALARM_H
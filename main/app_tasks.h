@@ -0,0 +1,79 @@
+/**
+ * Task placement - core, priority and stack of the application's tasks
+ *
+ * Core 0 (PRO): BT controller and NimBLE host (CONFIG_BTDM_CTRL_PINNED_TO_CORE,
+ *   CONFIG_BT_NIMBLE_PINNED_TO_CORE; host stack CONFIG_BT_NIMBLE_HOST_TASK_STACK_SIZE).
+ *   Advertisements are decrypted and decoded in the GAP callback, so decode and
+ *   victron_data_callback run there too.
+ * Core 1 (APP): display task - history, rendering and SPI. The display driver
+ *   uses polling transactions, which busy-wait in the calling task, so the SPI
+ *   work stays on this core.
+ * Core 0 also runs the render helper, which rasterizes every other strip of
+ *   full-screen frames (display_frame_begin/end) at a priority below NimBLE's.
+ * Console, log and capture tasks are low priority and mostly blocked; they are
+ *   left to the scheduler unless overridden.
+ *
+ * Every value can be overridden with a compile definition. The NimBLE host
+ * priority is fixed by ESP-IDF (configMAX_PRIORITIES - 4) and preempts all of these.
+ * The console `tasks` command shows where each task runs and its CPU load.
+ */
+#ifndef APP_TASKS_H
+#define APP_TASKS_H
+
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+#if CONFIG_FREERTOS_UNICORE
+#define APP_CORE_BLE 0
+#define APP_CORE_UI  0
+#else
+#define APP_CORE_BLE CONFIG_BT_NIMBLE_PINNED_TO_CORE
+#ifndef APP_CORE_UI
+#define APP_CORE_UI  (1 - APP_CORE_BLE)
+#endif
+#endif
+
+#ifndef APP_DISPLAY_TASK_CORE
+#define APP_DISPLAY_TASK_CORE  APP_CORE_UI
+#endif
+#ifndef APP_DISPLAY_TASK_PRIO
+#define APP_DISPLAY_TASK_PRIO  5
+#endif
+#ifndef APP_DISPLAY_TASK_STACK
+#define APP_DISPLAY_TASK_STACK 4096
+#endif
+
+#ifndef APP_RENDER_TASK_CORE
+#define APP_RENDER_TASK_CORE   APP_CORE_BLE
+#endif
+#ifndef APP_RENDER_TASK_PRIO
+#define APP_RENDER_TASK_PRIO   APP_DISPLAY_TASK_PRIO
+#endif
+#ifndef APP_RENDER_TASK_STACK
+#define APP_RENDER_TASK_STACK  2048
+#endif
+
+#ifndef APP_CONSOLE_TASK_CORE
+#define APP_CONSOLE_TASK_CORE  tskNO_AFFINITY
+#endif
+#ifndef APP_CONSOLE_TASK_PRIO
+#define APP_CONSOLE_TASK_PRIO  2
+#endif
+#ifndef APP_CONSOLE_TASK_STACK
+#define APP_CONSOLE_TASK_STACK 4096
+#endif
+
+/**
+ * @brief Redraw the whole screen back to back (render load for measurements)
+ * Refused in memory safe mode (diag_mem).
+ */
+void app_set_render_stress(bool on);
+
+/**
+ * @brief Restart from the display task after writing out the flash log and energy totals
+ * Returns at once; the restart follows within one display poll.
+ */
+void app_request_restart(void);
+
+#endif // APP_TASKS_H
@@ -0,0 +1,736 @@
+/**
+ * Console - Implementation
+ */
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "console.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "victron_ble.h"
+#include "diag_stats.h"
+#include "diag_scope.h"
+#include "diag_trace.h"
+#include "diag_tasks.h"
+#include "diag_mem.h"
+#include "app_tasks.h"
+#include "simple_display.h"
+#include "alarm.h"
+#include "flash_log.h"
+#include "driver/uart.h"
+#include "sdkconfig.h"
+#include <stdlib.h>
+#include "esp_timer.h"
+
+static const char *TAG = "CONSOLE";
+
+static const struct {
+    const char          *name;
+    victron_device_id_t  role;
+} role_names[] = {
+    { "mppt",      VICTRON_DEVICE_MPPT },
+    { "shunt",     VICTRON_DEVICE_SMARTSHUNT },
+    { "battsense", VICTRON_DEVICE_BATTERY_SENSE },
+    { "ac",        VICTRON_DEVICE_AC_CHARGER },
+    { "dcdc",      VICTRON_DEVICE_DCDC_CHARGER },
+};
+
+#define ROLE_NAME_COUNT (sizeof(role_names) / sizeof(role_names[0]))
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// "aa:bb:cc:dd:ee:ff" (display order) → BLE byte order
+static bool parse_mac(const char *s, uint8_t mac[6]) {
+    for (int i = 5; i >= 0; i--) {
+        int hi = hex_nibble(s[0]);
+        int lo = (hi < 0) ? -1 : hex_nibble(s[1]);
+        if (lo < 0) return false;
+        mac[i] = (uint8_t)(hi << 4 | lo);
+        s += 2;
+        if (i > 0 && *s++ != ':') return false;
+    }
+    return *s == '\0';
+}
+
+static bool parse_key(const char *s, uint8_t key[16]) {
+    if (strlen(s) != 32) return false;
+    for (int i = 0; i < 16; i++) {
+        int hi = hex_nibble(s[2 * i]);
+        int lo = hex_nibble(s[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        key[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+static const char *role_short_name(victron_device_id_t role) {
+    for (size_t i = 0; i < ROLE_NAME_COUNT; i++) {
+        if (role_names[i].role == role) return role_names[i].name;
+    }
+    return "?";
+}
+
+static int dev_list(void) {
+    victron_device_config_t cfg;
+    size_t n = victron_ble_device_count();
+    for (size_t i = 0; i < n; i++) {
+        if (!victron_ble_device_config(i, &cfg)) break;
+        // The key is not printed; it can only be replaced
+        printf("%2u  %02x:%02x:%02x:%02x:%02x:%02x  %-9s  %s\n", (unsigned)i,
+               cfg.mac[5], cfg.mac[4], cfg.mac[3], cfg.mac[2], cfg.mac[1], cfg.mac[0],
+               role_short_name(cfg.role), cfg.name);
+    }
+    printf("%u of %u devices\n", (unsigned)n, VICTRON_MAX_DEVICES);
+    return 0;
+}
+
+static int dev_add(int argc, char **argv) {
+    victron_device_config_t cfg = { 0 };
+
+    if (argc < 5) {
+        printf("usage: dev add <mac> <key> <role> [name]\n");
+        return 1;
+    }
+    if (!parse_mac(argv[2], cfg.mac)) {
+        printf("invalid MAC '%s'\n", argv[2]);
+        return 1;
+    }
+    if (!parse_key(argv[3], cfg.key)) {
+        printf("invalid key: expected 32 hex digits\n");
+        return 1;
+    }
+    for (size_t i = 0; i < ROLE_NAME_COUNT; i++) {
+        if (strcasecmp(argv[4], role_names[i].name) == 0) cfg.role = role_names[i].role;
+    }
+    if (cfg.role == VICTRON_DEVICE_UNKNOWN) {
+        printf("invalid role '%s' (mppt, shunt, battsense, ac, dcdc)\n", argv[4]);
+        return 1;
+    }
+    if (argc > 5) {
+        snprintf(cfg.name, sizeof(cfg.name), "%s", argv[5]);
+    }
+
+    esp_err_t err = victron_ble_add_device(&cfg);
+    if (err != ESP_OK) {
+        printf("add failed: %s\n", esp_err_to_name(err));
+        return 1;
+    }
+    printf("saved; the device appears on the display with its first frame\n");
+    return 0;
+}
+
+static int dev_remove(int argc, char **argv) {
+    uint8_t mac[6];
+
+    if (argc < 3 || !parse_mac(argv[2], mac)) {
+        printf("usage: dev remove <mac>\n");
+        return 1;
+    }
+    esp_err_t err = victron_ble_remove_device(mac);
+    if (err != ESP_OK) {
+        printf("remove failed: %s\n", esp_err_to_name(err));
+        return 1;
+    }
+    printf("removed; frames are ignored from now on (display cell stays until restart)\n");
+    return 0;
+}
+
+// Advertisers that cannot be decoded: not configured, or configured with another key
+static int dev_scan(int argc, char **argv) {
+    if (argc >= 3) {
+        if (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "off") == 0) {
+            victron_ble_set_discovery(strcmp(argv[2], "on") == 0);
+            return 0;
+        }
+        printf("usage: dev scan [on|off]\n");
+        return 1;
+    }
+
+    victron_seen_device_t seen[VICTRON_SEEN_RING_SIZE];
+    size_t n = victron_ble_get_seen(seen, VICTRON_SEEN_RING_SIZE);
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+    int listed = 0;
+    for (size_t i = 0; i < n; i++) {
+        const victron_seen_device_t *d = &seen[i];
+        if (d->key_status == VICTRON_KEY_OK) continue;
+        const char *product = d->product_name;
+        printf("%02x:%02x:%02x:%02x:%02x:%02x  %-7s  key %02x..  %4ddBm %4lus  0x%04X %s / %s\n",
+               d->mac[5], d->mac[4], d->mac[3], d->mac[2], d->mac[1], d->mac[0],
+               d->key_status == VICTRON_KEY_MISMATCH ? "BAD KEY" : "NO KEY",
+               d->key_check, d->rssi, (unsigned long)((now - d->last_seen_ms) / 1000),
+               d->product_id, product ? product : "Unknown product",
+               victron_record_type_name(d->record_type));
+        listed++;
+    }
+    printf("%d undecodable of %u recently seen advertisers\n", listed, (unsigned)n);
+    return 0;
+}
+
+static int cmd_dev(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "list") == 0) return dev_list();
+    if (argc >= 2 && strcmp(argv[1], "add") == 0) return dev_add(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "remove") == 0) return dev_remove(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "scan") == 0) return dev_scan(argc, argv);
+    printf("usage: dev list | dev add <mac> <key> <role> [name] | dev remove <mac> | dev scan [on|off]\n");
+    return 1;
+}
+
+static int cmd_stats(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+        diag_stats_reset();
+        printf("counters reset\n");
+        return 0;
+    }
+    if (argc >= 2) {
+        printf("usage: stats [reset]\n");
+        return 1;
+    }
+
+    uint64_t window_us = diag_stats_window_us();
+    float window_s = window_us / 1e6f;
+    printf("window %.1f s\n", window_s);
+
+    diag_stat_value_t v;
+    for (size_t i = 0; diag_stats_get(i, &v); i++) {
+        if (v.is_timer) {
+            printf("%-26s %10lu calls  avg %6lu us  max %6lu us  busy %5.2f%%\n", v.name,
+                   (unsigned long)v.value,
+                   (unsigned long)(v.value ? v.total_us / v.value : 0),
+                   (unsigned long)v.max_us,
+                   window_us ? 100.0f * v.total_us / window_us : 0.0f);
+        } else {
+            printf("%-26s %10lu  %8.1f/s\n", v.name, (unsigned long)v.value,
+                   window_s > 0 ? v.value / window_s : 0.0f);
+        }
+    }
+    return 0;
+}
+
+static float ticks_to_us(uint32_t ticks) {
+    return ticks == UINT32_MAX ? INFINITY : (float)ticks / diag_ticks_per_us();
+}
+
+// One bar per non-empty bucket of a histogram
+static void print_buckets(const diag_hist_t *h) {
+    uint32_t peak = 1;
+    for (int i = 0; i < DIAG_HIST_BUCKETS; i++) {
+        if (h->bucket[i] > peak) peak = h->bucket[i];
+    }
+    for (int i = 0; i < DIAG_HIST_BUCKETS; i++) {
+        uint32_t n = h->bucket[i];
+        if (n == 0) continue;
+        char bar[41];
+        int len = (int)((uint64_t)n * 40 / peak);
+        memset(bar, '#', len);
+        bar[len] = '\0';
+        printf("  < %10.2f us %10lu %s\n", ticks_to_us(i == 31 ? UINT32_MAX : (2u << i) - 1),
+               (unsigned long)n, bar);
+    }
+}
+
+static int cmd_scope(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+        diag_hist_reset();
+        printf("histograms reset\n");
+        return 0;
+    }
+
+    printf("%-22s %9s %10s %10s %10s %10s\n", "scope", "count", "p50 us", "p90 us", "p99 us", "max us");
+    for (const diag_hist_t *h = diag_hist_first(); h; h = h->next) {
+        if (argc >= 2 && strcmp(argv[1], h->name) != 0) continue;
+        printf("%-22s %9lu %10.2f %10.2f %10.2f %10.2f\n", h->name,
+               (unsigned long)diag_hist_count(h),
+               ticks_to_us(diag_hist_percentile(h, 50)),
+               ticks_to_us(diag_hist_percentile(h, 90)),
+               ticks_to_us(diag_hist_percentile(h, 99)),
+               ticks_to_us(h->max_ticks));
+        if (argc >= 2) print_buckets(h);
+    }
+    return 0;
+}
+
+// Raw blob on the console UART, framed by text lines for scripts/trace_to_chrome.py
+static int trace_dump(void) {
+    size_t len = diag_trace_blob_size();
+    uint8_t *blob = malloc(len);
+    if (!blob) {
+        printf("trace dump: no memory for %u bytes\n", (unsigned)len);
+        return 1;
+    }
+    len = diag_trace_serialize(blob, len);
+    if (len == 0) {
+        free(blob);
+        printf("trace dump: capture changed, retry\n");
+        return 1;
+    }
+
+    // One uart_write_bytes() call, so log output cannot interleave with the blob;
+    // the driver bypasses the VFS newline conversion
+    printf("TRACE %u\n", (unsigned)len);
+    fflush(stdout);
+    uart_wait_tx_done(CONFIG_ESP_CONSOLE_UART_NUM, portMAX_DELAY);
+    uart_write_bytes(CONFIG_ESP_CONSOLE_UART_NUM, blob, len);
+    uart_wait_tx_done(CONFIG_ESP_CONSOLE_UART_NUM, portMAX_DELAY);
+    printf("\nTRACE END\n");
+    free(blob);
+    return 0;
+}
+
+static int cmd_trace(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "start") == 0) {
+        diag_trace_start();
+        printf("tracing (newest %u events kept)\n", (unsigned)DIAG_TRACE_EVENTS);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "stop") == 0) {
+        diag_trace_stop();
+        printf("%u events\n", (unsigned)diag_trace_count());
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "dump") == 0) return trace_dump();
+    printf("usage: trace start | stop | dump\n");
+    return 1;
+}
+
+static int cmd_capture(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "start") == 0) {
+        bool all = (argc >= 3 && strcmp(argv[2], "all") == 0);
+        victron_ble_set_capture(all ? VICTRON_CAPTURE_ALL : VICTRON_CAPTURE_VICTRON);
+        return 0;
+    }
+    if (argc >= 2 && strcmp(argv[1], "stop") == 0) {
+        victron_ble_set_capture(VICTRON_CAPTURE_OFF);
+        return 0;
+    }
+    printf("usage: capture start [all] | stop\n");
+    return 1;
+}
+
+static int cmd_tasks(int argc, char **argv) {
+    static diag_task_info_t tasks[DIAG_TASKS_MAX];
+    uint32_t window_us;
+    size_t n = diag_tasks_sample(tasks, DIAG_TASKS_MAX, &window_us);
+    if (n == 0) {
+        printf("no run-time stats (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)\n");
+        return 1;
+    }
+
+    // A core's load is what its IDLE task did not get
+    printf("window %.1f s", window_us / 1e6f);
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        char idle[8];
+        snprintf(idle, sizeof(idle), "IDLE%d", c);
+        for (size_t i = 0; i < n; i++) {
+            if (strcmp(tasks[i].name, idle) == 0) printf("  core %d %5.1f%%", c, 100.0f - tasks[i].load);
+        }
+    }
+    // Task load is in % of one core: all tasks add up to portNUM_PROCESSORS x 100
+    printf("\n%-16s %4s %4s %10s %6s\n", "task", "core", "prio", "stack free", "%core");
+    for (size_t i = 0; i < n; i++) {
+        char core[4] = "-";
+        if (tasks[i].core >= 0) snprintf(core, sizeof(core), "%d", tasks[i].core);
+        printf("%-16s %4s %4u %10lu %6.1f\n", tasks[i].name, core, (unsigned)tasks[i].priority,
+               (unsigned long)tasks[i].stack_free, tasks[i].load);
+    }
+    return 0;
+}
+
+static int cmd_stress(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "render") == 0 &&
+        (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "off") == 0)) {
+        bool on = strcmp(argv[2], "on") == 0;
+        if (on && diag_mem_safe_mode()) {
+            printf("render stress unavailable in safe mode (see 'mem')\n");
+            return 1;
+        }
+        app_set_render_stress(on);
+        printf("render stress %s\n", on ? "on" : "off");
+        return 0;
+    }
+    printf("usage: stress render on|off\n");
+    return 1;
+}
+
+static bool flog_print(const flash_log_record_t *rec, void *ctx) {
+    size_t *n = ctx;
+    printf("%lu,%04x,%u,%u,%u,%u,%.2f,%.3f,%u,%.1f,%d\n", (unsigned long)rec->time_s,
+           (unsigned)rec->mac_tail, (unsigned)rec->role, (unsigned)rec->flags,
+           (unsigned)rec->state, (unsigned)rec->error, rec->voltage_centi / 100.0f,
+           rec->current_milli / 1000.0f, (unsigned)rec->power_w,
+           rec->soc_deci == 0xFFFF ? -1.0f : rec->soc_deci / 10.0f, rec->aux);
+    (*n)++;
+    return true;
+}
+
+static bool parse_u32(const char *s, uint32_t *out) {
+    char *end;
+    unsigned long v = strtoul(s, &end, 10);
+    if (*s == '\0' || *s == '-' || *end != '\0') return false;
+    *out = (uint32_t)v;
+    return true;
+}
+
+// Flash history log: stats, or the records as CSV (times in seconds, see FLASH_LOG_REC_WALLCLOCK)
+static int cmd_flog(int argc, char **argv) {
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "stats") == 0)) {
+        flash_log_stats_t s;
+        flash_log_get_stats(&s);
+        printf("sectors %lu used %lu  next seq %lu  write page %lu  torn %lu\n"
+               "encoded %lu records in %lu bytes  dropped %lu  write errors %lu\n",
+               (unsigned long)s.sectors, (unsigned long)s.sectors_used, (unsigned long)s.next_seq,
+               (unsigned long)s.write_page, (unsigned long)s.pages_torn,
+               (unsigned long)s.records_encoded, (unsigned long)s.bytes_encoded,
+               (unsigned long)s.records_dropped, (unsigned long)s.write_errors);
+        return 0;
+    }
+    if (argc >= 2 && argc <= 4 && strcmp(argv[1], "dump") == 0) {
+        uint32_t from = 0, to = UINT32_MAX;
+        if ((argc >= 3 && !parse_u32(argv[2], &from)) || (argc == 4 && !parse_u32(argv[3], &to))) {
+            printf("usage: flog dump [from_s [to_s]]\n");
+            return 1;
+        }
+        size_t n = 0;
+        printf("time_s,mac,role,flags,state,error,V,A,W,soc,aux\n");
+        flash_log_read_range(from, to, flog_print, &n);
+        printf("%u records\n", (unsigned)n);
+        return 0;
+    }
+    printf("usage: flog [stats] | flog dump [from_s [to_s]]\n");
+    return 1;
+}
+
+static int cmd_restart(int argc, char **argv) {
+    app_request_restart();
+    return 0;
+}
+
+static const char *mem_level_name(diag_mem_level_t level) {
+    switch (level) {
+        case DIAG_MEM_WARN:     return "WARN";
+        case DIAG_MEM_CRITICAL: return "CRITICAL";
+        default:                return "ok";
+    }
+}
+
+// Last diag_mem sample: heaps, then stacks with the least headroom first
+static int cmd_mem(int argc, char **argv) {
+    static diag_mem_task_t tasks[DIAG_MEM_TASKS_MAX];   // console task only
+    diag_mem_heap_t heaps[DIAG_MEM_HEAP_COUNT];
+    size_t n = diag_mem_get(heaps, tasks, DIAG_MEM_TASKS_MAX);
+    int64_t age_ms = (esp_timer_get_time() - diag_mem_sampled_at()) / 1000;
+
+    printf("sampled %lld ms ago", (long long)age_ms);
+    if (diag_mem_safe_mode()) printf("  SAFE MODE: %s", diag_mem_safe_mode_reason());
+    printf("\nheap           free   min free    largest  budget warn/crit\n");
+    for (int i = 0; i < DIAG_MEM_HEAP_COUNT; i++) {
+        const diag_mem_heap_t *h = &heaps[i];
+        printf("%-10s %8lu %10lu %10lu  %6lu/%-6lu %s\n", h->name, (unsigned long)h->free,
+               (unsigned long)h->min_free, (unsigned long)h->largest,
+               (unsigned long)h->budget.warn, (unsigned long)h->budget.critical,
+               mem_level_name(h->level));
+    }
+    printf("task             stack free  budget warn/crit\n");
+    for (size_t i = 0; i < n; i++) {
+        const diag_mem_task_t *t = &tasks[i];
+        printf("%-16s %10lu  %6lu/%-6lu %s\n", t->name, (unsigned long)t->stack_free,
+               (unsigned long)t->budget.warn, (unsigned long)t->budget.critical,
+               mem_level_name(t->level));
+    }
+    return 0;
+}
+
+static int cmd_render(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "cores") == 0 &&
+        (strcmp(argv[2], "1") == 0 || strcmp(argv[2], "2") == 0)) {
+        display_set_render_cores(atoi(argv[2]));
+    } else if (argc != 1) {
+        printf("usage: render [cores 1|2]\n");
+        return 1;
+    }
+    printf("frames rasterized on %d core(s)\n", display_get_render_cores());
+    return 0;
+}
+
+static int alarm_list(void) {
+    alarm_rule_t r;
+    int i;
+    for (i = 0; alarm_get_rule(i, &r); i++) {
+        const char *name, *unit;
+        alarm_field_info(r.field, &name, &unit);
+        if (r.op == ALARM_ANY_BITS) {
+            printf("%2d  %-14s & 0x%X", i, name, (unsigned)r.threshold);
+        } else {
+            printf("%2d  %-14s %c %g%s", i, name, r.op == ALARM_BELOW ? '<' : '>',
+                   (double)r.threshold, unit);
+            if (r.hysteresis > 0) printf(" hyst %g", (double)r.hysteresis);
+        }
+        if (r.debounce_s) printf(" for %us", (unsigned)r.debounce_s);
+        if (r.outputs & ALARM_OUT_BUZZER) printf(" buzzer");
+        if (r.outputs & ALARM_OUT_RELAY) printf(" relay");
+        int active = alarm_active_count(i);
+        if (active) printf("  ACTIVE (%d)", active);
+        printf("\n");
+    }
+    printf("%d of %d rules\n", i, ALARM_MAX_RULES);
+    return 0;
+}
+
+static int alarm_add_rule(int argc, char **argv) {
+    alarm_rule_t r = { 0 };
+
+    if (argc < 5) {
+        printf("usage: alarm add <field> <|>|& <value> [hyst <h>] [for <s>] [buzzer] [relay]\n");
+        return 1;
+    }
+    int field = alarm_field_find(argv[2]);
+    if (field < 0) {
+        printf("unknown field '%s' (alarm fields)\n", argv[2]);
+        return 1;
+    }
+    r.field = (uint8_t)field;
+    if (strcmp(argv[3], "<") == 0) {
+        r.op = ALARM_BELOW;
+    } else if (strcmp(argv[3], ">") == 0) {
+        r.op = ALARM_ABOVE;
+    } else if (strcmp(argv[3], "&") == 0) {
+        r.op = ALARM_ANY_BITS;
+    } else {
+        printf("invalid condition '%s' (<, > or &)\n", argv[3]);
+        return 1;
+    }
+    char *end;
+    r.threshold = (r.op == ALARM_ANY_BITS) ? (float)strtoul(argv[4], &end, 0) : strtof(argv[4], &end);
+    if (end == argv[4] || *end || !isfinite(r.threshold)) {
+        printf("invalid value '%s'\n", argv[4]);
+        return 1;
+    }
+    for (int i = 5; i < argc; i++) {
+        if (strcmp(argv[i], "hyst") == 0 && i + 1 < argc) {
+            const char *arg = argv[++i];
+            r.hysteresis = strtof(arg, &end);
+            if (end == arg || *end || !isfinite(r.hysteresis) || r.hysteresis < 0) {
+                printf("invalid hysteresis '%s' (a value >= 0 in field units)\n", arg);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "for") == 0 && i + 1 < argc) {
+            const char *arg = argv[++i];
+            unsigned long s = strtoul(arg, &end, 10);
+            if (end == arg || *end || arg[0] == '-' || s > UINT16_MAX) {
+                printf("invalid debounce '%s' (0 to %u seconds)\n", arg, (unsigned)UINT16_MAX);
+                return 1;
+            }
+            r.debounce_s = (uint16_t)s;
+        } else if (strcmp(argv[i], "buzzer") == 0) {
+            r.outputs |= ALARM_OUT_BUZZER;
+        } else if (strcmp(argv[i], "relay") == 0) {
+            r.outputs |= ALARM_OUT_RELAY;
+        } else {
+            printf("unexpected '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    esp_err_t err = alarm_add(&r);
+    if (err != ESP_OK) {
+        printf("add failed: %s\n", esp_err_to_name(err));
+        return 1;
+    }
+    return alarm_list();
+}
+
+static int cmd_alarm(int argc, char **argv) {
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "list") == 0)) return alarm_list();
+    if (argc >= 2 && strcmp(argv[1], "add") == 0) return alarm_add_rule(argc, argv);
+    if (argc == 3 && strcmp(argv[1], "remove") == 0) {
+        // atoi() would turn a typo into rule 0
+        char *end;
+        long n = strtol(argv[2], &end, 10);
+        if (argv[2][0] == '\0' || *end != '\0' || n < 0 || n > INT_MAX) {
+            printf("usage: alarm remove <n> (rule number from 'alarm list')\n");
+            return 1;
+        }
+        esp_err_t err = alarm_remove((int)n);
+        if (err != ESP_OK) {
+            printf("remove failed: %s\n", esp_err_to_name(err));
+            return 1;
+        }
+        return alarm_list();
+    }
+    if (argc == 2 && strcmp(argv[1], "defaults") == 0) {
+        alarm_reset_defaults();
+        return alarm_list();
+    }
+    if (argc == 2 && strcmp(argv[1], "ack") == 0) {
+        alarm_ack();
+        printf("buzzer silenced until the next alarm\n");
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "fields") == 0) {
+        const char *name, *unit;
+        for (int i = 0; alarm_field_info(i, &name, &unit); i++) {
+            printf("%-14s %s\n", name, unit);
+        }
+        return 0;
+    }
+    printf("usage: alarm [list] | alarm add <field> <|>|& <value> [hyst <h>] [for <s>] [buzzer] [relay]\n"
+           "       alarm remove <n> | alarm defaults | alarm ack | alarm fields\n");
+    return 1;
+}
+
+static const struct {
+    const char     *name;
+    esp_log_level_t level;
+} log_levels[] = {
+    { "none",    ESP_LOG_NONE },
+    { "error",   ESP_LOG_ERROR },
+    { "warn",    ESP_LOG_WARN },
+    { "info",    ESP_LOG_INFO },
+    { "debug",   ESP_LOG_DEBUG },
+    { "verbose", ESP_LOG_VERBOSE },
+};
+
+// Levels above CONFIG_LOG_MAXIMUM_LEVEL are compiled out and cannot be enabled here
+static int cmd_log(int argc, char **argv) {
+    if (argc != 3) {
+        printf("usage: log <tag|*> <none|error|warn|info|debug|verbose>\n"
+               "tags: victron_ble victron_dev VICTRON DISPLAY HISTORY FLASH_LOG ENERGY ALARM CONSOLE ...\n");
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(log_levels) / sizeof(log_levels[0]); i++) {
+        if (strcasecmp(argv[2], log_levels[i].name) == 0) {
+            esp_log_level_set(argv[1], log_levels[i].level);
+            printf("%s: %s\n", argv[1], log_levels[i].name);
+            return 0;
+        }
+    }
+    printf("invalid level '%s'\n", argv[2]);
+    return 1;
+}
+
+void console_init(void) {
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "victron>";
+    repl_config.task_stack_size = APP_CONSOLE_TASK_STACK;
+    repl_config.task_priority = APP_CONSOLE_TASK_PRIO;
+    repl_config.task_core_id = APP_CONSOLE_TASK_CORE;
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+
+    esp_err_t err = esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Console init failed: %s", esp_err_to_name(err));
+        return;
+    }
+
+    esp_console_register_help_command();
+    const esp_console_cmd_t dev_cmd = {
+        .command = "dev",
+        .help = "Device table: dev list | dev add <mac> <key> <role> [name] | dev remove <mac>\n"
+                "dev scan lists advertisers without a matching key; dev scan on|off logs new ones",
+        .func = &cmd_dev,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&dev_cmd));
+
+    const esp_console_cmd_t stats_cmd = {
+        .command = "stats",
+        .help = "Print counters (advertisements, decodes, callback/render time, SPI bytes); "
+                "stats reset zeroes them",
+        .func = &cmd_stats,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&stats_cmd));
+
+    const esp_console_cmd_t scope_cmd = {
+        .command = "scope",
+        .help = "Latency histograms of timed scopes (percentiles are bucket upper bounds); "
+                "scope <name> adds the buckets, scope reset zeroes them",
+        .func = &cmd_scope,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&scope_cmd));
+
+    const esp_console_cmd_t trace_cmd = {
+        .command = "trace",
+        .help = "Event timeline: trace start (keep the newest events until stop) | stop | "
+                "dump (binary, for scripts/trace_to_chrome.py)",
+        .func = &cmd_trace,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&trace_cmd));
+
+    const esp_console_cmd_t capture_cmd = {
+        .command = "capture",
+        .help = "Stream advertisements as \"ADV <hex>\" lines (for scripts/adv_capture.py): "
+                "capture start [all] (Victron only unless 'all') | stop",
+        .func = &cmd_capture,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&capture_cmd));
+
+    const esp_console_cmd_t log_cmd = {
+        .command = "log",
+        .help = "Set the log level of one module: log <tag|*> <none|error|warn|info|debug|verbose>",
+        .func = &cmd_log,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&log_cmd));
+
+    const esp_console_cmd_t tasks_cmd = {
+        .command = "tasks",
+        .help = "CPU load per task (in % of one core) and per core since the previous 'tasks', "
+                "with core, priority and least free stack",
+        .func = &cmd_tasks,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&tasks_cmd));
+
+    const esp_console_cmd_t stress_cmd = {
+        .command = "stress",
+        .help = "Load for measurements: stress render on|off redraws the whole screen "
+                "back to back (compare ble.adv/s in 'stats')",
+        .func = &cmd_stress,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&stress_cmd));
+
+    const esp_console_cmd_t mem_cmd = {
+        .command = "mem",
+        .help = "Heap (internal, DMA) and stack high-water marks against their budgets, "
+                "and the safe mode reason",
+        .func = &cmd_mem,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&mem_cmd));
+
+    const esp_console_cmd_t flog_cmd = {
+        .command = "flog",
+        .help = "Flash history log: flog [stats] | flog dump [from_s [to_s]] prints the records "
+                "as CSV, oldest first",
+        .func = &cmd_flog,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&flog_cmd));
+
+    const esp_console_cmd_t restart_cmd = {
+        .command = "restart",
+        .help = "Write out the flash log and energy totals, then restart",
+        .func = &cmd_restart,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&restart_cmd));
+
+    const esp_console_cmd_t render_cmd = {
+        .command = "render",
+        .help = "Cores that rasterize full-screen frames: render cores 1|2 "
+                "(compare display.frame in 'stats')",
+        .func = &cmd_render,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&render_cmd));
+
+    const esp_console_cmd_t alarm_cmd = {
+        .command = "alarm",
+        .help = "Threshold rules: alarm [list] | add <field> <|>|& <value> [hyst <h>] [for <s>] "
+                "[buzzer] [relay] | remove <n> | defaults | ack (silence the buzzer) | fields",
+        .func = &cmd_alarm,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&alarm_cmd));
+
+    ESP_ERROR_CHECK(esp_console_start_repl(repl));
+}
@@ -0,0 +1,34 @@
+/**
+ * Console - Serial command line (UART0, 115200 baud)
+ * Commands:
+ *   dev list                                  configured devices
+ *   dev add <mac> <key> <role> [name]         add or replace a device
+ *   dev remove <mac>                          remove a device
+ *   dev scan [on|off]                         undecodable advertisers / log new ones
+ *   stats [reset]                             counters and timers since the last reset
+ *   scope [name|reset]                        latency histograms of DIAG_SCOPE sections
+ *   trace start|stop|dump                     event timeline capture (binary dump)
+ *   capture start [all]|stop                  stream advertisements as "ADV <hex>" lines
+ *   log <tag|*> <level>                       per-module log level
+ *   tasks                                     CPU load per task and core, stack high-water marks
+ *   mem                                       heap and stack high-water marks against budgets
+ *   flog [stats] | flog dump [from_s [to_s]]  flash history log statistics / records as CSV
+ *   restart                                   write out the flash log, then restart
+ *   stress render on|off                      back-to-back full redraws (render load)
+ *   render [cores 1|2]                        cores that rasterize full-screen frames
+ *   alarm [list]                              threshold rules and how many devices trip them
+ *   alarm add <field> <|>|& <value> [hyst <h>] [for <s>] [buzzer] [relay]
+ *                                             add a rule (alarm fields lists the fields)
+ *   alarm remove <n> | defaults | ack         remove a rule / built-in rules / silence the buzzer
+ * MACs are written as shown by the BLE device list (aa:bb:cc:dd:ee:ff),
+ * keys as 32 hex digits; roles: mppt, shunt, battsense, ac, dcdc.
+ */
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+/**
+ * @brief Register all commands and start the REPL task
+ */
+void console_init(void);
+
+#endif // CONSOLE_H
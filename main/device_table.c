@@ -0,0 +1,224 @@
+/**
+ * Device Table - Implementation
+ */
+#include "device_table.h"
+#include "timer_wheel.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static device_entry_t entries[DEVICE_TABLE_MAX];
+static int entry_count = 0;
+
+// Display order: entry indices sorted by role rank, then role_index
+static uint8_t order[DEVICE_TABLE_MAX];
+
+// Role rank keeps the classic 2x2 arrangement: MPPT, SmartShunt / BatterySense, AC charger
+static int role_rank(victron_device_id_t role) {
+    switch (role) {
+        case VICTRON_DEVICE_MPPT: return 0;
+        case VICTRON_DEVICE_SMARTSHUNT: return 1;
+        case VICTRON_DEVICE_BATTERY_SENSE: return 2;
+        case VICTRON_DEVICE_AC_CHARGER: return 3;
+        case VICTRON_DEVICE_DCDC_CHARGER: return 4;
+        default: return 5;
+    }
+}
+
+// What each entry currently adds to the totals, so an update is subtract-old/add-new
+static device_totals_t contrib[DEVICE_TABLE_MAX];
+static device_totals_t totals;
+
+// Stale watchdog: one wheel node per entry, re-armed on every frame
+#define WATCHDOG_TICK_MS 1000
+static timer_wheel_t watchdog;
+static timer_wheel_node_t watchdog_nodes[DEVICE_TABLE_MAX];
+static uint32_t stale_timeout_ms = DEVICE_STALE_TIMEOUT_MS;
+
+static uint32_t now_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// The watchdog runs on 64-bit time: 32-bit milliseconds wrap after 49.7 days
+static uint64_t now_ms64(void) {
+    return (uint64_t)(esp_timer_get_time() / 1000);
+}
+
+static int find_entry(const uint8_t *mac) {
+    for (int i = 0; i < entry_count; i++) {
+        if (memcmp(entries[i].mac, mac, 6) == 0) return i;
+    }
+    return -1;
+}
+
+static int add_entry(const uint8_t *mac, victron_device_id_t role) {
+    if (entry_count >= DEVICE_TABLE_MAX) return -1;
+
+    int idx = entry_count++;
+    device_entry_t *e = &entries[idx];
+    memset(e, 0, sizeof(*e));
+    memcpy(e->mac, mac, 6);
+    e->role = role;
+    e->role_index = (uint8_t)(device_table_count_role(role) - 1);
+    memset(&contrib[idx], 0, sizeof(contrib[idx]));
+    timer_wheel_node_init(&watchdog_nodes[idx]);
+
+    // Insert after the last device ranked <= ours (stable per role)
+    int pos = idx;
+    while (pos > 0 && role_rank(entries[order[pos - 1]].role) > role_rank(role)) {
+        order[pos] = order[pos - 1];
+        pos--;
+    }
+    order[pos] = (uint8_t)idx;
+    return idx;
+}
+
+// Contribution of one frame to the totals; N/A fields contribute nothing
+static void compute_contrib(const victron_data_t *d, device_totals_t *c) {
+    memset(c, 0, sizeof(*c));
+
+    if (d->device_id == VICTRON_DEVICE_MPPT && d->type == VICTRON_BLE_RECORD_SOLAR_CHARGER) {
+        const victron_record_solar_charger_t *s = &d->record.solar;
+        if (s->pv_power_w != 0xFFFF) c->pv_power_w = s->pv_power_w;
+        if (s->battery_current_deci != 0x7FFF) c->solar_current_deci = s->battery_current_deci;
+        if (s->yield_today_centikwh != 0xFFFF) c->yield_today_centikwh = s->yield_today_centikwh;
+        c->mppt_count = 1;
+    } else if (d->device_id == VICTRON_DEVICE_AC_CHARGER && d->type == VICTRON_BLE_RECORD_AC_CHARGER) {
+        uint16_t current = d->record.ac_charger.battery_current_1_deci;
+        if (current != 0x7FF) c->charger_current_deci = current;
+    }
+}
+
+static void apply_contrib(const device_totals_t *c, int sign) {
+    totals.pv_power_w           += sign * c->pv_power_w;
+    totals.solar_current_deci   += sign * c->solar_current_deci;
+    totals.yield_today_centikwh += sign * c->yield_today_centikwh;
+    totals.charger_current_deci += sign * c->charger_current_deci;
+    totals.mppt_count           += sign * c->mppt_count;
+}
+
+void device_table_init(void) {
+    memset(entries, 0, sizeof(entries));
+    memset(contrib, 0, sizeof(contrib));
+    memset(&totals, 0, sizeof(totals));
+    entry_count = 0;
+    timer_wheel_init(&watchdog, WATCHDOG_TICK_MS, now_ms64());
+
+    size_t n = victron_ble_device_count();
+    for (size_t i = 0; i < n; i++) {
+        uint8_t mac[6];
+        victron_device_id_t role;
+        if (victron_ble_device_info(i, mac, &role) && find_entry(mac) < 0) {
+            add_entry(mac, role);
+        }
+    }
+}
+
+int device_table_update(const victron_data_t *data) {
+    int idx = find_entry(data->mac);
+    if (idx < 0) {
+        idx = add_entry(data->mac, data->device_id);
+        if (idx < 0) return -1;
+    }
+
+    device_entry_t *e = &entries[idx];
+    memcpy(&e->data, data, sizeof(victron_data_t));
+
+    // Age tracking: moving average of the interval (1/8 weight for the new sample)
+    uint64_t now64 = now_ms64();
+    uint32_t now = (uint32_t)now64;
+    if (e->frame_count > 0) {
+        uint32_t interval = now - e->last_seen_ms;
+        if (e->frame_count == 1) {
+            e->mean_interval_ms = interval;
+        } else {
+            e->mean_interval_ms = (uint32_t)((int32_t)e->mean_interval_ms +
+                                             ((int32_t)(interval - e->mean_interval_ms) / 8));
+        }
+    }
+    e->last_seen_ms = now;
+    e->frame_count++;
+    e->has_data = true;
+    e->stale = false;
+    timer_wheel_arm(&watchdog, &watchdog_nodes[idx], now64, stale_timeout_ms);
+
+    device_totals_t c;
+    compute_contrib(data, &c);
+    apply_contrib(&contrib[idx], -1);
+    apply_contrib(&c, +1);
+    contrib[idx] = c;
+
+    return idx;
+}
+
+static void on_watchdog_expired(timer_wheel_node_t *node, void *ctx) {
+    int *became_stale = ctx;
+    device_entry_t *e = &entries[node - watchdog_nodes];
+    if (e->has_data && !e->stale) {
+        e->stale = true;
+        (*became_stale)++;
+    }
+}
+
+int device_table_tick(void) {
+    int became_stale = 0;
+    timer_wheel_advance(&watchdog, now_ms64(), on_watchdog_expired, &became_stale);
+    return became_stale;
+}
+
+void device_table_set_stale_timeout(uint32_t timeout_ms) {
+    stale_timeout_ms = timeout_ms;
+    uint64_t now64 = now_ms64();
+    for (int i = 0; i < entry_count; i++) {
+        if (timer_wheel_armed(&watchdog_nodes[i])) {
+            // Last frame time on the 64-bit clock (the 32-bit age is wrap-safe)
+            uint32_t age = (uint32_t)now64 - entries[i].last_seen_ms;
+            timer_wheel_arm(&watchdog, &watchdog_nodes[i], now64 - age, timeout_ms);
+        }
+    }
+}
+
+uint32_t device_table_age_ms(const device_entry_t *entry) {
+    if (!entry->frame_count) return UINT32_MAX;
+    return now_ms() - entry->last_seen_ms;
+}
+
+int device_table_count(void) {
+    return entry_count;
+}
+
+const device_entry_t *device_table_get(int pos) {
+    if (pos < 0 || pos >= entry_count) return NULL;
+    return &entries[order[pos]];
+}
+
+const device_entry_t *device_table_entry(int slot) {
+    if (slot < 0 || slot >= entry_count) return NULL;
+    return &entries[slot];
+}
+
+int device_table_slot(const device_entry_t *entry) {
+    return (int)(entry - entries);
+}
+
+int device_table_count_role(victron_device_id_t role) {
+    int n = 0;
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].role == role) n++;
+    }
+    return n;
+}
+
+const device_totals_t *device_table_totals(void) {
+    return &totals;
+}
+
+const char *device_role_name(victron_device_id_t role) {
+    switch (role) {
+        case VICTRON_DEVICE_MPPT: return "MPPT SOLAR CHARGER";
+        case VICTRON_DEVICE_BATTERY_SENSE: return "BATTERY SENSE";
+        case VICTRON_DEVICE_SMARTSHUNT: return "SMARTSHUNT";
+        case VICTRON_DEVICE_AC_CHARGER: return "AC CHARGER IP22";
+        case VICTRON_DEVICE_DCDC_CHARGER: return "DC-DC CHARGER";
+        default: return "UNKNOWN DEVICE";
+    }
+}
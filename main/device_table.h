@@ -0,0 +1,105 @@
+/**
+ * Device Table - Runtime registry of Victron devices
+ * Any number of devices per role (victron_device_id_t), keyed by MAC address,
+ * plus aggregated totals that are updated incrementally on every frame.
+ *
+ * Not thread-safe: callers hold the UI data mutex.
+ */
+#ifndef DEVICE_TABLE_H
+#define DEVICE_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "victron_ble.h"
+
+#define DEVICE_TABLE_MAX 12
+
+// A device is marked stale when no frame arrived for this long (default)
+#ifndef DEVICE_STALE_TIMEOUT_MS
+#define DEVICE_STALE_TIMEOUT_MS 60000
+#endif
+
+typedef struct {
+    uint8_t             mac[6];      // BLE byte order
+    victron_device_id_t role;
+    uint8_t             role_index;  // 0-based position among devices of the same role
+    bool                has_data;
+    bool                stale;       // no frame within the stale timeout
+    uint32_t            last_seen_ms;      // monotonic time of the last frame
+    uint32_t            mean_interval_ms;  // moving average of the frame interval
+    uint32_t            frame_count;
+    victron_data_t      data;        // last decoded frame
+} device_entry_t;
+
+// Totals across all devices (sum of PV power across MPPTs, etc.)
+typedef struct {
+    int32_t pv_power_w;            // 1 W, all MPPTs
+    int32_t solar_current_deci;    // 0.1 A, all MPPTs
+    int32_t yield_today_centikwh;  // 0.01 kWh, all MPPTs
+    int32_t charger_current_deci;  // 0.1 A, all AC chargers (output 1)
+    uint8_t mppt_count;            // MPPTs currently contributing
+} device_totals_t;
+
+/**
+ * @brief Clear the table and register all devices configured in the BLE layer
+ */
+void device_table_init(void);
+
+/**
+ * @brief Store a decoded frame, adding its device if unseen
+ * @return slot of the device, -1 if the table is full
+ */
+int device_table_update(const victron_data_t *data);
+
+/**
+ * @brief Run the stale watchdog; call periodically (e.g. once per UI refresh)
+ * @return number of devices that became stale during this call
+ */
+int device_table_tick(void);
+
+/**
+ * @brief Change the stale timeout; re-arms all watchdog entries
+ */
+void device_table_set_stale_timeout(uint32_t timeout_ms);
+
+/**
+ * @brief Milliseconds since the device's last frame (UINT32_MAX if never seen)
+ */
+uint32_t device_table_age_ms(const device_entry_t *entry);
+
+/**
+ * @brief Number of devices in the table
+ */
+int device_table_count(void);
+
+/**
+ * @brief Get the device at display position (grouped by role, then role_index)
+ */
+const device_entry_t *device_table_get(int pos);
+
+/**
+ * @brief Get the device in a slot (as returned by device_table_update), or NULL
+ */
+const device_entry_t *device_table_entry(int slot);
+
+/**
+ * @brief Slot of a device returned by device_table_get / device_table_entry
+ */
+int device_table_slot(const device_entry_t *entry);
+
+/**
+ * @brief Number of devices with the given role
+ */
+int device_table_count_role(victron_device_id_t role);
+
+/**
+ * @brief Aggregated totals (valid until the next update)
+ */
+const device_totals_t *device_table_totals(void);
+
+/**
+ * @brief Human-readable role name ("MPPT SOLAR CHARGER", ...)
+ */
+const char *device_role_name(victron_device_id_t role);
+
+#endif // DEVICE_TABLE_H
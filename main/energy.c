@@ -0,0 +1,268 @@
+/**
+ * Energy - Implementation
+ */
+#include "energy.h"
+#include <string.h>
+#include <time.h>
+#include "nvs.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "victron_records.h"
+
+static const char *TAG = "ENERGY";
+
+#define NVS_NAMESPACE "energy"
+
+// time() values below this mean the wall clock was never set
+#define WALLCLOCK_VALID_S 1700000000
+
+// Period ids: yyyymmdd / yyyymm from the wall clock, or a day counter
+// (month = counter / 30) with this flag when there is no clock
+#define PERIOD_COUNTER   0x80000000u
+#define COUNTER_MONTH_DAYS 30
+
+// A second yield reset within this time is another MPPT, not a new day
+#define YIELD_RESET_HOLDOFF_MS (12UL * 3600 * 1000)
+
+typedef struct {
+    uint32_t period;
+    int64_t  uj[ENERGY_COUNTER_COUNT];   // mW * ms
+    int64_t  uc[ENERGY_COUNTER_COUNT];   // mA * ms
+} energy_period_t;
+
+typedef struct {
+    bool     valid;        // previous sample below can be integrated from
+    uint32_t t_ms;
+    int32_t  p_mw;
+    int32_t  i_ma;
+    int64_t  today_uj;
+    bool     has_yield;
+    uint16_t yield;        // last yield_today (MPPT)
+} energy_dev_t;
+
+static energy_period_t day, month;
+static energy_dev_t devs[ENERGY_MAX_DEVICES];
+
+// Snapshot handed from energy_service() to energy_persist()
+static energy_period_t save_day, save_month;
+static bool save_now;          // rollover happened, save at the next service
+static bool dirty;             // counters changed since the last snapshot
+static uint32_t last_save_s;
+
+static bool has_rollover;
+static uint32_t last_rollover_ms;
+
+static inline uint32_t now_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void load_period(nvs_handle_t h, const char *key, energy_period_t *p) {
+    size_t len = sizeof(*p);
+    if (nvs_get_blob(h, key, p, &len) != ESP_OK || len != sizeof(*p)) {
+        memset(p, 0, sizeof(*p));
+        p->period = PERIOD_COUNTER;
+    }
+}
+
+void energy_init(void) {
+    memset(devs, 0, sizeof(devs));
+    memset(&day, 0, sizeof(day));
+    memset(&month, 0, sizeof(month));
+    day.period = PERIOD_COUNTER;
+    month.period = PERIOD_COUNTER;
+
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) == ESP_OK) {
+        load_period(h, "day", &day);
+        load_period(h, "month", &month);
+        nvs_close(h);
+    }
+    last_save_s = (uint32_t)(esp_timer_get_time() / 1000000);
+
+    ESP_LOGI(TAG, "Restored day %08lx: solar %.2f kWh, month %08lx: solar %.2f kWh",
+             (unsigned long)day.period, day.uj[ENERGY_SOLAR] / 3.6e12,
+             (unsigned long)month.period, month.uj[ENERGY_SOLAR] / 3.6e12);
+}
+
+static void rollover(uint32_t new_day, uint32_t new_month) {
+    ESP_LOGI(TAG, "Day %08lx -> %08lx", (unsigned long)day.period, (unsigned long)new_day);
+
+    memset(&day, 0, sizeof(day));
+    day.period = new_day;
+    for (int i = 0; i < ENERGY_MAX_DEVICES; i++) {
+        devs[i].today_uj = 0;
+    }
+    if (new_month != month.period) {
+        memset(&month, 0, sizeof(month));
+        month.period = new_month;
+    }
+    has_rollover = true;
+    last_rollover_ms = now_ms();
+    save_now = true;
+}
+
+// Power/current of a frame and the counter it feeds; false if not applicable
+static bool frame_power(const victron_data_t *data, int32_t *p_mw, int32_t *i_ma,
+                        energy_counter_t *counter) {
+    int32_t mv, ma;
+
+    switch (data->device_id) {
+        case VICTRON_DEVICE_MPPT: {
+            const victron_record_solar_charger_t *r = &data->record.solar;
+            if (r->battery_voltage_centi == 0x7FFF) return false;
+            mv = r->battery_voltage_centi * 10;
+            ma = r->battery_current_deci * 100;
+            *counter = ENERGY_SOLAR;
+            break;
+        }
+        case VICTRON_DEVICE_SMARTSHUNT: {
+            const victron_record_battery_monitor_t *r = &data->record.battery;
+            if (r->battery_voltage_centi == 0xFFFF) return false;
+            mv = r->battery_voltage_centi * 10;
+            ma = r->battery_current_milli;
+            *counter = ENERGY_BATTERY_IN;   // sign decides in/out
+            break;
+        }
+        case VICTRON_DEVICE_AC_CHARGER: {
+            const victron_record_ac_charger_t *r = &data->record.ac_charger;
+            if (r->battery_voltage_1_centi == 0x1FFF || r->battery_current_1_deci == 0x7FF) {
+                return false;
+            }
+            mv = r->battery_voltage_1_centi * 10;
+            ma = r->battery_current_1_deci * 100;
+            *counter = ENERGY_CHARGER;
+            break;
+        }
+        default:
+            return false;   // no current in the record
+    }
+    *p_mw = (int32_t)((int64_t)mv * ma / 1000);
+    *i_ma = ma;
+    return true;
+}
+
+static void accumulate(energy_counter_t counter, int64_t uj, int64_t uc) {
+    if (counter == ENERGY_BATTERY_IN && uj < 0) {
+        counter = ENERGY_BATTERY_OUT;
+        uj = -uj;
+        uc = -uc;
+    } else if (uj < 0) {
+        return;   // sources never count negative
+    }
+    day.uj[counter] += uj;
+    day.uc[counter] += uc;
+    month.uj[counter] += uj;
+    month.uc[counter] += uc;
+    dirty = true;
+}
+
+// Without a wall clock, the MPPT resetting yield_today marks a new day
+static void check_yield_reset(energy_dev_t *d, const victron_data_t *data, uint32_t now) {
+    uint16_t yield = data->record.solar.yield_today_centikwh;
+    bool reset = d->has_yield && d->yield >= 10 && yield < d->yield / 2;
+    d->yield = yield;
+    d->has_yield = true;
+
+    if (!reset || !(day.period & PERIOD_COUNTER)) return;
+    if (has_rollover && now - last_rollover_ms < YIELD_RESET_HOLDOFF_MS) return;
+
+    uint32_t n = (day.period & ~PERIOD_COUNTER) + 1;
+    rollover(PERIOD_COUNTER | n, PERIOD_COUNTER | (n / COUNTER_MONTH_DAYS));
+}
+
+void energy_update(int slot, const victron_data_t *data) {
+    if (slot < 0 || slot >= ENERGY_MAX_DEVICES || !data) return;
+
+    energy_dev_t *d = &devs[slot];
+    uint32_t now = now_ms();
+    int32_t p_mw, i_ma;
+    energy_counter_t counter;
+
+    if (data->device_id == VICTRON_DEVICE_MPPT) {
+        check_yield_reset(d, data, now);
+    }
+    if (!frame_power(data, &p_mw, &i_ma, &counter)) {
+        d->valid = false;
+        return;
+    }
+
+    // Trapezoid between the previous and this frame
+    if (d->valid) {
+        uint32_t dt = now - d->t_ms;
+        if (dt <= ENERGY_MAX_GAP_MS) {
+            int64_t uj = ((int64_t)d->p_mw + p_mw) * dt / 2;
+            int64_t uc = ((int64_t)d->i_ma + i_ma) * dt / 2;
+            accumulate(counter, uj, uc);
+            d->today_uj += uj;
+        }
+    }
+    d->valid = true;
+    d->t_ms = now;
+    d->p_mw = p_mw;
+    d->i_ma = i_ma;
+}
+
+bool energy_service(void) {
+    time_t now = time(NULL);
+    if (now >= WALLCLOCK_VALID_S) {
+        struct tm tm;
+        localtime_r(&now, &tm);
+        uint32_t ymd = (uint32_t)((tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday);
+
+        if (day.period & PERIOD_COUNTER) {
+            // Clock just became valid: label the running day instead of resetting it
+            day.period = ymd;
+            if (month.period & PERIOD_COUNTER) month.period = ymd / 100;
+            save_now = true;
+        } else if (day.period != ymd) {
+            rollover(ymd, ymd / 100);
+        }
+    }
+
+    uint32_t now_s = (uint32_t)(esp_timer_get_time() / 1000000);
+    if (!save_now && (!dirty || now_s - last_save_s < ENERGY_SAVE_INTERVAL_S)) return false;
+
+    save_day = day;
+    save_month = month;
+    save_now = false;
+    dirty = false;
+    last_save_s = now_s;
+    return true;
+}
+
+void energy_persist(void) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(h, "day", &save_day, sizeof(save_day));
+        if (err == ESP_OK) err = nvs_set_blob(h, "month", &save_month, sizeof(save_month));
+        if (err == ESP_OK) err = nvs_commit(h);
+        nvs_close(h);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Saving totals failed: %s", esp_err_to_name(err));
+    }
+}
+
+static void totals(const energy_period_t *p, energy_totals_t *out) {
+    for (int c = 0; c < ENERGY_COUNTER_COUNT; c++) {
+        out->wh[c] = p->uj[c] / 3.6e9f;
+        out->ah[c] = p->uc[c] / 3.6e9f;
+    }
+    out->consumed_wh = out->wh[ENERGY_SOLAR] + out->wh[ENERGY_CHARGER] -
+                       (out->wh[ENERGY_BATTERY_IN] - out->wh[ENERGY_BATTERY_OUT]);
+    if (out->consumed_wh < 0) out->consumed_wh = 0;
+}
+
+void energy_get_today(energy_totals_t *out) {
+    totals(&day, out);
+}
+
+void energy_get_month(energy_totals_t *out) {
+    totals(&month, out);
+}
+
+float energy_device_today_wh(int slot) {
+    if (slot < 0 || slot >= ENERGY_MAX_DEVICES) return 0.0f;
+    return devs[slot].today_uj / 3.6e9f;
+}
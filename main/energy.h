@@ -0,0 +1,81 @@
+/**
+ * Energy - Integrated Wh/Ah counters per device, per day and per month
+ * Every decoded frame contributes P = V * I over the time since the
+ * previous frame of the same device (trapezoidal rule, monotonic
+ * timestamps). Gaps longer than ENERGY_MAX_GAP_MS are not bridged.
+ *
+ * Day boundaries come from the wall clock when it is set; otherwise a reset
+ * of an MPPT's yield_today (which the charger does once per day) is taken
+ * as the day change, and a month is counted as 30 such days. Day and month
+ * totals are persisted in NVS at most every ENERGY_SAVE_INTERVAL_S and at
+ * each rollover.
+ *
+ * Not thread-safe: callers hold the UI data mutex (except energy_persist).
+ */
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "victron_ble.h"
+
+// Frames further apart than this are not integrated across
+#ifndef ENERGY_MAX_GAP_MS
+#define ENERGY_MAX_GAP_MS 60000
+#endif
+
+// Minimum interval between two NVS writes (rollovers are saved immediately)
+#ifndef ENERGY_SAVE_INTERVAL_S
+#define ENERGY_SAVE_INTERVAL_S (15 * 60)
+#endif
+
+#define ENERGY_MAX_DEVICES 12    // matches DEVICE_TABLE_MAX slots
+
+typedef enum {
+    ENERGY_SOLAR,         // MPPT output into the battery
+    ENERGY_CHARGER,       // AC charger output (output 1)
+    ENERGY_BATTERY_IN,    // SmartShunt, charging
+    ENERGY_BATTERY_OUT,   // SmartShunt, discharging
+    ENERGY_COUNTER_COUNT
+} energy_counter_t;
+
+typedef struct {
+    float wh[ENERGY_COUNTER_COUNT];
+    float ah[ENERGY_COUNTER_COUNT];
+    float consumed_wh;    // solar + charger - (battery in - battery out)
+} energy_totals_t;
+
+/**
+ * @brief Restore day/month totals from NVS (NVS must already be initialized)
+ */
+void energy_init(void);
+
+/**
+ * @brief Integrate one decoded frame; cheap, meant for the data callback
+ * @param slot device table slot (from device_table_update)
+ */
+void energy_update(int slot, const victron_data_t *data);
+
+/**
+ * @brief Periodic housekeeping: wall-clock rollover and save scheduling
+ * @return true if a snapshot was taken and energy_persist() should be called
+ */
+bool energy_service(void);
+
+/**
+ * @brief Write the last snapshot to NVS; call outside of the UI data lock
+ */
+void energy_persist(void);
+
+/**
+ * @brief Totals of the current day / month
+ */
+void energy_get_today(energy_totals_t *out);
+void energy_get_month(energy_totals_t *out);
+
+/**
+ * @brief Energy integrated today for one device slot (Wh, signed for the shunt)
+ */
+float energy_device_today_wh(int slot);
+
+#endif // ENERGY_H
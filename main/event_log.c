@@ -0,0 +1,209 @@
+/**
+ * Event Log - Implementation
+ */
+#include <stdio.h>
+#include "event_log.h"
+#include "device_table.h"
+#include "ui_cells.h"
+#include "simple_display.h"
+#include "esp_timer.h"
+
+static event_log_entry_t ring[EVENT_LOG_SIZE];
+static uint32_t count;      // events since boot
+
+// Fields of the previous frame per device slot; -1 = not known yet
+static struct {
+    bool    valid;
+    uint8_t type;           // record type the fields came from
+    int     state;
+    int     error;
+    int     alarm;
+} prev[DEVICE_TABLE_MAX];
+
+// Fields a record carries; -1 where it has none or reports "not available"
+static void record_fields(const victron_data_t *d, int *state, int *error, int *alarm) {
+    *state = *error = *alarm = -1;
+    switch (d->type) {
+        case VICTRON_BLE_RECORD_SOLAR_CHARGER:
+            *state = d->record.solar.device_state;
+            *error = d->record.solar.charger_error;
+            break;
+        case VICTRON_BLE_RECORD_BATTERY_MONITOR:
+            *alarm = d->record.battery.alarm_reason;
+            break;
+        case VICTRON_BLE_RECORD_INVERTER:
+            *state = d->record.inverter.device_state;
+            *alarm = d->record.inverter.alarm_reason;
+            break;
+        case VICTRON_BLE_RECORD_DCDC_CONVERTER:
+            *state = d->record.dcdc.device_state;
+            *error = d->record.dcdc.charger_error;
+            break;
+        case VICTRON_BLE_RECORD_AC_CHARGER:
+            *state = d->record.ac_charger.device_state;
+            *error = d->record.ac_charger.charger_error;
+            break;
+        default:
+            break;
+    }
+    if (*state == VIC_STATE_NOT_AVAILABLE) *state = -1;
+    if (*error == VIC_ERR_UNKNOWN) *error = -1;
+    if (*alarm == 0xFFFF) *alarm = -1;
+}
+
+static void log_event(const device_entry_t *dev, event_kind_t kind, int from, int to) {
+    event_log_entry_t *e = &ring[count % EVENT_LOG_SIZE];
+    e->time_s = (uint32_t)(esp_timer_get_time() / 1000000);
+    e->role = dev->role;
+    e->role_index = dev->role_index;
+    e->kind = kind;
+    e->from = (uint16_t)from;
+    e->to = (uint16_t)to;
+    e->rule[0] = '\0';
+    count++;
+}
+
+void event_log_rule(int slot, const char *text, bool raised) {
+    const device_entry_t *dev = device_table_entry(slot);
+    if (!dev) return;
+    event_log_entry_t *e = &ring[count % EVENT_LOG_SIZE];
+    log_event(dev, EVENT_RULE, !raised, raised);
+    snprintf(e->rule, sizeof(e->rule), "%s", text);
+}
+
+void event_log_update(int slot, const victron_data_t *data) {
+    const device_entry_t *dev = device_table_entry(slot);
+    if (!dev || slot >= DEVICE_TABLE_MAX) return;
+
+    int state, error, alarm;
+    record_fields(data, &state, &error, &alarm);
+
+    // First frame: no state to change from, no error or alarm yet
+    if (!prev[slot].valid || prev[slot].type != data->type) {
+        prev[slot].valid = true;
+        prev[slot].type = data->type;
+        prev[slot].state = -1;
+        prev[slot].error = 0;
+        prev[slot].alarm = 0;
+    }
+
+    if (state >= 0) {
+        if (prev[slot].state >= 0 && state != prev[slot].state) {
+            log_event(dev, EVENT_STATE, prev[slot].state, state);
+        }
+        prev[slot].state = state;
+    }
+    if (error >= 0) {
+        if (error != prev[slot].error) {
+            log_event(dev, EVENT_ERROR, prev[slot].error, error);
+        }
+        prev[slot].error = error;
+    }
+    if (alarm >= 0) {
+        int changed = alarm ^ prev[slot].alarm;
+        for (int bit = 1; changed; bit <<= 1) {
+            if (changed & bit) {
+                log_event(dev, EVENT_ALARM, prev[slot].alarm & bit, alarm & bit);
+                changed &= ~bit;
+            }
+        }
+        prev[slot].alarm = alarm;
+    }
+}
+
+uint32_t event_log_count(void) {
+    return count;
+}
+
+bool event_log_get(uint32_t seq, event_log_entry_t *out) {
+    if (seq >= count || count - seq > EVENT_LOG_SIZE) return false;
+    *out = ring[seq % EVENT_LOG_SIZE];
+    return true;
+}
+
+static const char *role_short(victron_device_id_t role) {
+    switch (role) {
+        case VICTRON_DEVICE_MPPT: return "MPPT";
+        case VICTRON_DEVICE_BATTERY_SENSE: return "SENSE";
+        case VICTRON_DEVICE_SMARTSHUNT: return "SHUNT";
+        case VICTRON_DEVICE_AC_CHARGER: return "IP22";
+        case VICTRON_DEVICE_DCDC_CHARGER: return "DC-DC";
+        default: return "DEVICE";
+    }
+}
+
+static const char *error_name(int code) {
+    switch (code) {
+        case VIC_ERR_BAT_TEMP_HIGH: return "BATT HOT";
+        case VIC_ERR_BAT_VOLT_HIGH: return "BATT V HI";
+        case VIC_ERR_REMOTE_TEMP_SENSOR: return "T SENSOR";
+        case VIC_ERR_REMOTE_BAT_SENSE: return "V SENSE";
+        case VIC_ERR_HIGH_RIPPLE: return "RIPPLE";
+        case VIC_ERR_TEMP_LOW: return "BATT COLD";
+        case VIC_ERR_TEMP_CHARGER: return "CHGR HOT";
+        case VIC_ERR_OVER_CURRENT: return "OVERCURR";
+        case VIC_ERR_POLARITY: return "POLARITY";
+        case VIC_ERR_OVERHEATED: return "OVERHEAT";
+        case VIC_ERR_SHORT_CIRCUIT: return "SHORT";
+        case VIC_ERR_INPUT_VOLT_HIGH: return "IN V HI";
+        case VIC_ERR_INPUT_CURR_HIGH: return "IN I HI";
+        case VIC_ERR_INPUT_SHUTDOWN: return "IN SHUTDN";
+        case VIC_ERR_CPU_TEMP: return "CPU HOT";
+        case VIC_ERR_CALIBRATION_LOST: return "CAL LOST";
+        default: return "";
+    }
+}
+
+static const char *alarm_name(int bit) {
+    switch (bit) {
+        case VIC_ALARM_LOW_VOLTAGE: return "LOW V";
+        case VIC_ALARM_HIGH_VOLTAGE: return "HIGH V";
+        case VIC_ALARM_LOW_SOC: return "LOW SOC";
+        case VIC_ALARM_LOW_TEMP: return "LOW TEMP";
+        case VIC_ALARM_HIGH_TEMP: return "HIGH TEMP";
+        case VIC_ALARM_OVERLOAD: return "OVERLOAD";
+        case VIC_ALARM_DC_RIPPLE: return "DC RIPPLE";
+        case VIC_ALARM_SHORT_CIRCUIT: return "SHORT";
+        case VIC_ALARM_BMS_LOCKOUT: return "BMS LOCK";
+        default: return NULL;
+    }
+}
+
+uint16_t event_log_format(const event_log_entry_t *e, char *head, size_t head_len,
+                          char *text, size_t text_len) {
+    unsigned long t = e->time_s;
+    if (device_table_count_role(e->role) > 1) {
+        snprintf(head, head_len, "%02lu:%02lu:%02lu %s %d", t / 3600, t / 60 % 60, t % 60,
+                 role_short(e->role), e->role_index + 1);
+    } else {
+        snprintf(head, head_len, "%02lu:%02lu:%02lu %s", t / 3600, t / 60 % 60, t % 60,
+                 role_short(e->role));
+    }
+
+    switch (e->kind) {
+        case EVENT_STATE:
+            snprintf(text, text_len, "%s > %s", ui_state_string(e->from), ui_state_string(e->to));
+            return (e->to == VIC_STATE_FAULT) ? COLOR_RED : COLOR_WHITE;
+        case EVENT_ERROR:
+            if (e->to) {
+                snprintf(text, text_len, "ERR %u %s", (unsigned)e->to, error_name(e->to));
+                return COLOR_RED;
+            }
+            snprintf(text, text_len, "ERR %u CLEARED", (unsigned)e->from);
+            return COLOR_GREEN;
+        case EVENT_RULE:
+            snprintf(text, text_len, "%s %s", e->to ? "ALARM" : "CLEAR", e->rule);
+            return e->to ? COLOR_RED : COLOR_GREEN;
+        default: {
+            int bit = e->from | e->to;
+            const char *name = alarm_name(bit);
+            char other[12];
+            if (!name) {
+                snprintf(other, sizeof(other), "BIT %d", __builtin_ctz(bit));
+                name = other;
+            }
+            snprintf(text, text_len, "%s %s", e->to ? "ALARM" : "CLEAR", name);
+            return e->to ? COLOR_RED : COLOR_GREEN;
+        }
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * Event Log - Ring of device state, charger error and alarm transitions
+ * Every decoded frame is compared with the previous frame of the same
+ * device; each change of device_state or charger_error, and each alarm_reason
+ * bit that is raised or cleared, becomes one event. The first frame of a
+ * device only logs errors and alarms that are already active. Threshold
+ * rules (alarm.h) add their own raise and clear events.
+ *
+ * Events are numbered from boot (seq); the ring keeps the last
+ * EVENT_LOG_SIZE of them.
+ *
+ * Not thread-safe: callers hold the UI data mutex.
+ */
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "victron_ble.h"
+
+#ifndef EVENT_LOG_SIZE
+#define EVENT_LOG_SIZE 32
+#endif
+
+typedef enum {
+    EVENT_STATE,          // device_state from -> to
+    EVENT_ERROR,          // charger_error from -> to
+    EVENT_ALARM,          // one alarm_reason bit: raised (to != 0) or cleared
+    EVENT_RULE,           // threshold rule: raised (to != 0) or cleared
+} event_kind_t;
+
+#define EVENT_RULE_TEXT 12
+
+typedef struct {
+    uint32_t            time_s;      // uptime
+    victron_device_id_t role;
+    uint8_t             role_index;
+    uint8_t             kind;        // event_kind_t
+    uint16_t            from, to;    // EVENT_ALARM: the bit's old and new value
+    char                rule[EVENT_RULE_TEXT];   // EVENT_RULE: "soc<20%"
+} event_log_entry_t;
+
+/**
+ * @brief Compare a decoded frame with the device's previous one and log changes
+ * @param slot device table slot (from device_table_update)
+ */
+void event_log_update(int slot, const victron_data_t *data);
+
+/**
+ * @brief Log a threshold rule of device `slot` being raised or cleared
+ * @param text short rule text (alarm_rule_text), truncated to EVENT_RULE_TEXT - 1
+ */
+void event_log_rule(int slot, const char *text, bool raised);
+
+/**
+ * @brief Number of events since boot (seq of the next event)
+ */
+uint32_t event_log_count(void);
+
+/**
+ * @brief Get event seq; false if it is not logged yet or was overwritten
+ */
+bool event_log_get(uint32_t seq, event_log_entry_t *out);
+
+/**
+ * @brief Describe an event: "hh:mm:ss MPPT 2" and "BULK > FLOAT"
+ * @return colour for the description (red for a new error or alarm)
+ */
+uint16_t event_log_format(const event_log_entry_t *e, char *head, size_t head_len,
+                          char *text, size_t text_len);
+
+#endif // EVENT_LOG_H
@@ -0,0 +1,432 @@
+/**
+ * Flash Log - Implementation
+ */
+#include "flash_log.h"
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "FLASH_LOG";
+
+#define PAGES_PER_SECTOR (FLASH_LOG_SECTOR_SIZE / FLASH_LOG_PAGE_SIZE)
+
+// time() values below this mean the wall clock was never set
+#define WALLCLOCK_VALID_S 1700000000
+
+static const esp_partition_t *part;
+static uint32_t page_count;
+static uint32_t write_page;       // absolute page index of the next write
+static uint32_t head_sector;      // sector holding the newest page
+static uint32_t next_seq;
+static bool has_pages;
+
+// Guards the head position (head_sector, has_pages, write_page, next_seq)
+// against readers in another task
+static portMUX_TYPE head_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Full page waiting for flash_log_flush()
+static uint8_t pending[FLASH_LOG_PAGE_SIZE];
+static bool pending_ready;
+
+static flash_log_stats_t stats;
+
+// Per device: time of the last staged sample (uptime, for decimation) and
+// the samples collected for its next columnar block
+static struct {
+    uint8_t            mac[6];
+    bool               used;
+    uint32_t           last_s;
+    uint8_t            count;
+    flash_log_record_t rows[CODEC_BLOCK_MAX_SAMPLES];
+} dev[FLASH_LOG_MAX_DEVICES];
+
+// Codec input for one block (writer), decode output (reader)
+static codec_sample_t scratch[CODEC_BLOCK_MAX_SAMPLES];
+static codec_sample_t read_scratch[CODEC_BLOCK_MAX_SAMPLES];
+
+#define BLOCK_OFFSET (sizeof(flash_log_page_hdr_t) + sizeof(flash_log_block_id_t))
+
+static uint32_t page_crc(uint8_t *page) {
+    flash_log_page_hdr_t *hdr = (flash_log_page_hdr_t *)page;
+    uint32_t saved = hdr->crc;
+    hdr->crc = 0;
+    uint32_t crc = esp_rom_crc32_le(0, page, FLASH_LOG_PAGE_SIZE);
+    hdr->crc = saved;
+    return crc;
+}
+
+static bool page_erased(const uint8_t *page) {
+    for (size_t i = 0; i < sizeof(flash_log_page_hdr_t); i++) {
+        if (page[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+static bool page_valid(uint8_t *page) {
+    const flash_log_page_hdr_t *hdr = (const flash_log_page_hdr_t *)page;
+    if (hdr->magic != FLASH_LOG_PAGE_MAGIC) return false;
+    return page_crc(page) == hdr->crc;
+}
+
+static esp_err_t read_page(uint32_t page, uint8_t *buf) {
+    return esp_partition_read(part, (size_t)page * FLASH_LOG_PAGE_SIZE, buf, FLASH_LOG_PAGE_SIZE);
+}
+
+esp_err_t flash_log_init(void) {
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS,
+                                    FLASH_LOG_PARTITION);
+    if (!part) {
+        ESP_LOGE(TAG, "Partition '%s' not found", FLASH_LOG_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    stats.sectors = part->size / FLASH_LOG_SECTOR_SIZE;
+    page_count = stats.sectors * PAGES_PER_SECTOR;
+
+    // Pass 1: the sector whose first page has the highest sequence number is the head
+    uint8_t buf[FLASH_LOG_PAGE_SIZE];
+    const flash_log_page_hdr_t *hdr = (const flash_log_page_hdr_t *)buf;
+    uint32_t best_seq = 0;
+    has_pages = false;
+    for (uint32_t s = 0; s < stats.sectors; s++) {
+        if (read_page(s * PAGES_PER_SECTOR, buf) != ESP_OK || !page_valid(buf)) continue;
+        stats.sectors_used++;
+        if (!has_pages || (int32_t)(hdr->seq - best_seq) > 0) {
+            best_seq = hdr->seq;
+            head_sector = s;
+            has_pages = true;
+        }
+    }
+
+    if (!has_pages) {
+        write_page = 0;
+        next_seq = 1;
+        ESP_LOGI(TAG, "Empty log, %lu sectors", (unsigned long)stats.sectors);
+        return ESP_OK;
+    }
+
+    // Pass 2: resume after the last written page of the head sector; pages
+    // torn by a power loss fail the CRC and are skipped
+    next_seq = best_seq + 1;
+    write_page = ((head_sector + 1) % stats.sectors) * PAGES_PER_SECTOR;
+    for (uint32_t p = 0; p < PAGES_PER_SECTOR; p++) {
+        uint32_t page = head_sector * PAGES_PER_SECTOR + p;
+        if (read_page(page, buf) != ESP_OK) continue;
+        if (page_erased(buf)) {
+            write_page = page;
+            break;
+        }
+        if (page_valid(buf)) {
+            next_seq = hdr->seq + 1;
+        } else {
+            stats.pages_torn++;
+        }
+    }
+
+    ESP_LOGI(TAG, "Recovered: %lu/%lu sectors used, head %lu, next page %lu, seq %lu, torn %lu",
+             (unsigned long)stats.sectors_used, (unsigned long)stats.sectors,
+             (unsigned long)head_sector, (unsigned long)write_page,
+             (unsigned long)next_seq, (unsigned long)stats.pages_torn);
+    return ESP_OK;
+}
+
+static void encode(const victron_data_t *data, flash_log_record_t *rec) {
+    memset(rec, 0, sizeof(*rec));
+
+    time_t now = time(NULL);
+    if (now >= WALLCLOCK_VALID_S) {
+        rec->time_s = (uint32_t)now;
+        rec->flags |= FLASH_LOG_REC_WALLCLOCK;
+    } else {
+        rec->time_s = (uint32_t)(esp_timer_get_time() / 1000000);
+    }
+    rec->mac_tail = (uint16_t)(data->mac[1] << 8 | data->mac[0]);
+    rec->role = (uint8_t)data->device_id;
+    rec->state = 0xFF;
+    rec->soc_deci = 0xFFFF;
+    rec->aux = INT16_MIN;
+
+    switch (data->device_id) {
+        case VICTRON_DEVICE_MPPT: {
+            const victron_record_solar_charger_t *r = &data->record.solar;
+            rec->state = r->device_state;
+            rec->error = r->charger_error;
+            rec->voltage_centi = r->battery_voltage_centi;
+            rec->current_milli = r->battery_current_deci * 100;
+            rec->power_w = r->pv_power_w;
+            rec->aux = (int16_t)r->yield_today_centikwh;
+            break;
+        }
+        case VICTRON_DEVICE_SMARTSHUNT: {
+            const victron_record_battery_monitor_t *r = &data->record.battery;
+            rec->voltage_centi = (int16_t)r->battery_voltage_centi;
+            rec->current_milli = r->battery_current_milli;
+            rec->soc_deci = r->soc_deci_percent;
+            int32_t consumed = r->consumed_ah_deci;
+            if (consumed < -INT16_MAX) consumed = -INT16_MAX;
+            if (consumed > INT16_MAX) consumed = INT16_MAX;
+            rec->aux = (int16_t)consumed;
+            break;
+        }
+        case VICTRON_DEVICE_BATTERY_SENSE: {
+            const victron_record_battery_monitor_t *r = &data->record.battery;
+            rec->voltage_centi = (int16_t)r->battery_voltage_centi;
+            if (r->aux_input == 2) {
+                rec->aux = (int16_t)((int32_t)r->aux_value - 27315);   // 0.01 K → 0.01 °C
+            }
+            break;
+        }
+        case VICTRON_DEVICE_AC_CHARGER: {
+            const victron_record_ac_charger_t *r = &data->record.ac_charger;
+            rec->state = r->device_state;
+            rec->error = r->charger_error;
+            rec->voltage_centi = (int16_t)r->battery_voltage_1_centi;
+            rec->current_milli = r->battery_current_1_deci * 100;
+            break;
+        }
+        case VICTRON_DEVICE_DCDC_CHARGER: {
+            const victron_record_dcdc_converter_t *r = &data->record.dcdc;
+            rec->state = r->device_state;
+            rec->error = r->charger_error;
+            rec->voltage_centi = (int16_t)r->output_voltage_centi;
+            rec->aux = (int16_t)r->input_voltage_centi;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Slot of a device if it is due for another sample (and records the time), else -1
+static int device_due(const uint8_t mac[6], uint32_t now_s) {
+    int free_slot = -1;
+    for (int i = 0; i < FLASH_LOG_MAX_DEVICES; i++) {
+        if (!dev[i].used) {
+            if (free_slot < 0) free_slot = i;
+            continue;
+        }
+        if (memcmp(dev[i].mac, mac, 6) == 0) {
+            if (now_s - dev[i].last_s < FLASH_LOG_INTERVAL_S) return -1;
+            dev[i].last_s = now_s;
+            return i;
+        }
+    }
+    if (free_slot < 0) return -1;
+    memcpy(dev[free_slot].mac, mac, 6);
+    dev[free_slot].used = true;
+    dev[free_slot].last_s = now_s;
+    dev[free_slot].count = 0;
+    return free_slot;
+}
+
+static void record_to_sample(const flash_log_record_t *rec, codec_sample_t *s) {
+    s->time_s = rec->time_s;
+    s->col[CODEC_COL_VOLTAGE] = rec->voltage_centi;
+    s->col[CODEC_COL_CURRENT] = rec->current_milli;
+    s->col[CODEC_COL_POWER] = rec->power_w;
+    s->col[CODEC_COL_SOC] = rec->soc_deci;
+    s->col[CODEC_COL_STATE] = rec->state;
+    s->col[CODEC_COL_ERROR] = rec->error;
+    s->col[CODEC_COL_AUX] = rec->aux;
+}
+
+static void sample_to_record(const codec_sample_t *s, const flash_log_block_id_t *id,
+                             flash_log_record_t *rec) {
+    rec->time_s = s->time_s;
+    rec->mac_tail = id->mac_tail;
+    rec->role = id->role;
+    rec->flags = id->flags;
+    rec->voltage_centi = (int16_t)s->col[CODEC_COL_VOLTAGE];
+    rec->current_milli = s->col[CODEC_COL_CURRENT];
+    rec->power_w = (uint16_t)s->col[CODEC_COL_POWER];
+    rec->soc_deci = (uint16_t)s->col[CODEC_COL_SOC];
+    rec->state = (uint8_t)s->col[CODEC_COL_STATE];
+    rec->error = (uint8_t)s->col[CODEC_COL_ERROR];
+    rec->aux = (int16_t)s->col[CODEC_COL_AUX];
+}
+
+// Encode a device's collected samples into the pending page (as many as fit)
+static bool seal_device(int slot) {
+    if (pending_ready || dev[slot].count == 0) return false;
+
+    const flash_log_record_t *rows = dev[slot].rows;
+    for (int i = 0; i < dev[slot].count; i++) {
+        record_to_sample(&rows[i], &scratch[i]);
+    }
+
+    memset(pending, 0xFF, sizeof(pending));
+    flash_log_page_hdr_t *hdr = (flash_log_page_hdr_t *)pending;
+    flash_log_block_id_t *id = (flash_log_block_id_t *)(pending + sizeof(*hdr));
+    hdr->magic = FLASH_LOG_PAGE_MAGIC;
+    hdr->format = FLASH_LOG_FORMAT_COLUMNAR;
+    id->mac_tail = rows[0].mac_tail;
+    id->role = rows[0].role;
+    id->flags = rows[0].flags;
+
+    size_t used = 0;
+    codec_encode_block(scratch, dev[slot].count, pending + BLOCK_OFFSET,
+                       FLASH_LOG_PAGE_SIZE - BLOCK_OFFSET, &used);
+    if (used == 0) {
+        // Cannot happen with sane values; drop rather than block the device forever
+        stats.records_dropped += dev[slot].count;
+        dev[slot].count = 0;
+        return false;
+    }
+    hdr->count = (uint8_t)used;
+
+    dev[slot].count -= (uint8_t)used;
+    memmove(dev[slot].rows, rows + used, dev[slot].count * sizeof(flash_log_record_t));
+    stats.records_encoded += used;
+    stats.bytes_encoded += FLASH_LOG_PAGE_SIZE;
+    pending_ready = true;
+    return true;
+}
+
+// Seal the first device whose block is complete
+static void seal_full(void) {
+    for (int i = 0; i < FLASH_LOG_MAX_DEVICES && !pending_ready; i++) {
+        if (dev[i].used && dev[i].count >= CODEC_BLOCK_MAX_SAMPLES) seal_device(i);
+    }
+}
+
+bool flash_log_append(const victron_data_t *data) {
+    if (!part || !data) return false;
+
+    uint32_t now_s = (uint32_t)(esp_timer_get_time() / 1000000);
+    int slot = device_due(data->mac, now_s);
+    if (slot < 0) return false;
+
+    flash_log_record_t rec;
+    encode(data, &rec);
+
+    // A block has one time base: close it when the wall clock becomes valid
+    if (dev[slot].count > 0 && dev[slot].rows[0].flags != rec.flags) {
+        seal_device(slot);
+    }
+    if (dev[slot].count >= CODEC_BLOCK_MAX_SAMPLES ||
+        (dev[slot].count > 0 && dev[slot].rows[0].flags != rec.flags)) {
+        stats.records_dropped++;   // flush has not caught up
+        return false;
+    }
+    dev[slot].rows[dev[slot].count++] = rec;
+    seal_full();
+    return true;
+}
+
+esp_err_t flash_log_flush(void) {
+    if (!part || !pending_ready) return ESP_OK;
+
+    // Entering a new sector: erase it first (this is the only erase)
+    esp_err_t err = ESP_OK;
+    if (write_page % PAGES_PER_SECTOR == 0) {
+        err = esp_partition_erase_range(part, (size_t)write_page * FLASH_LOG_PAGE_SIZE,
+                                        FLASH_LOG_SECTOR_SIZE);
+        if (err == ESP_OK && stats.sectors_used < stats.sectors) stats.sectors_used++;
+    }
+
+    flash_log_page_hdr_t *hdr = (flash_log_page_hdr_t *)pending;
+    hdr->seq = next_seq;
+    hdr->crc = page_crc(pending);
+    if (err == ESP_OK) {
+        err = esp_partition_write(part, (size_t)write_page * FLASH_LOG_PAGE_SIZE,
+                                  pending, FLASH_LOG_PAGE_SIZE);
+    }
+    if (err != ESP_OK) {
+        stats.write_errors++;
+        ESP_LOGE(TAG, "Write page %lu failed: %s", (unsigned long)write_page, esp_err_to_name(err));
+    }
+
+    // Advance even on error so a bad page is not retried forever
+    portENTER_CRITICAL(&head_lock);
+    head_sector = write_page / PAGES_PER_SECTOR;
+    has_pages = true;
+    write_page = (write_page + 1) % page_count;
+    next_seq++;
+    portEXIT_CRITICAL(&head_lock);
+    pending_ready = false;
+
+    // A full block may have been waiting for the pending buffer
+    seal_full();
+    return err;
+}
+
+esp_err_t flash_log_sync(void) {
+    esp_err_t err = flash_log_flush();
+    for (int i = 0; i < FLASH_LOG_MAX_DEVICES; i++) {
+        while (dev[i].used && seal_device(i)) {
+            esp_err_t e = flash_log_flush();
+            if (e != ESP_OK) err = e;
+        }
+    }
+    return err;
+}
+
+// Visit the records of one page that fall into [t_from, t_to]
+static bool visit_page(uint8_t *buf, uint32_t t_from, uint32_t t_to,
+                       flash_log_visit_t visit, void *ctx, size_t *visited) {
+    const flash_log_page_hdr_t *hdr = (const flash_log_page_hdr_t *)buf;
+
+    if (hdr->format != FLASH_LOG_FORMAT_COLUMNAR) return true;
+
+    const flash_log_block_id_t *id = (const flash_log_block_id_t *)(buf + sizeof(*hdr));
+    const uint8_t *block = buf + BLOCK_OFFSET;
+    codec_block_hdr_t bh;
+    memcpy(&bh, block, sizeof(bh));
+    // Skip blocks outside the range without decoding them
+    if (bh.t_last < t_from || bh.t_first > t_to) return true;
+
+    size_t n = codec_decode_block(block, FLASH_LOG_PAGE_SIZE - BLOCK_OFFSET,
+                                  read_scratch, CODEC_BLOCK_MAX_SAMPLES);
+    for (size_t i = 0; i < n; i++) {
+        if (read_scratch[i].time_s < t_from || read_scratch[i].time_s > t_to) continue;
+        flash_log_record_t rec;
+        sample_to_record(&read_scratch[i], id, &rec);
+        (*visited)++;
+        if (!visit(&rec, ctx)) return false;
+    }
+    return true;
+}
+
+size_t flash_log_read_range(uint32_t t_from, uint32_t t_to, flash_log_visit_t visit, void *ctx) {
+    if (!part) return 0;
+
+    portENTER_CRITICAL(&head_lock);
+    bool any = has_pages;
+    uint32_t head = head_sector;
+    portEXIT_CRITICAL(&head_lock);
+    if (!any) return 0;
+
+    uint8_t buf[FLASH_LOG_PAGE_SIZE];
+    size_t visited = 0;
+
+    // Oldest sector is the one after the head; the head sector comes last.
+    // Pages written meanwhile fail the CRC mid-write or end the sector scan
+    // while erased, so a concurrent flush costs at most the newest pages
+    for (uint32_t i = 1; i <= stats.sectors; i++) {
+        uint32_t s = (head + i) % stats.sectors;
+        for (uint32_t p = 0; p < PAGES_PER_SECTOR; p++) {
+            if (read_page(s * PAGES_PER_SECTOR + p, buf) != ESP_OK) continue;
+            if (page_erased(buf)) break;
+            if (!page_valid(buf)) continue;
+            if (!visit_page(buf, t_from, t_to, visit, ctx, &visited)) return visited;
+        }
+    }
+    return visited;
+}
+
+size_t flash_log_read(flash_log_visit_t visit, void *ctx) {
+    return flash_log_read_range(0, UINT32_MAX, visit, ctx);
+}
+
+void flash_log_get_stats(flash_log_stats_t *out) {
+    portENTER_CRITICAL(&head_lock);
+    *out = stats;
+    out->next_seq = next_seq;
+    out->write_page = write_page;
+    portEXIT_CRITICAL(&head_lock);
+}
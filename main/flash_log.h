@@ -0,0 +1,130 @@
+/**
+ * Flash Log - Append-only history of decoded samples in the spiffs partition
+ * The partition is used as a circular log of 4 KB sectors, each holding
+ * 16 pages of 256 bytes. Samples are collected per device in RAM and
+ * written as one columnar block (sample_codec.h) per page; every page
+ * carries a sequence number, a format id and a CRC32, so torn writes are
+ * detected and skipped. At boot the page with the highest valid sequence
+ * number marks where appending resumes. Sectors are erased just before
+ * reuse, which spreads erases evenly over the partition.
+ *
+ * Writing (append, flush, sync) is not thread-safe: call it from one task
+ * (the display task). One other task at a time (the console) may read the
+ * log and the stats.
+ */
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "victron_ble.h"
+#include "sample_codec.h"
+
+#define FLASH_LOG_PARTITION    "spiffs"
+#define FLASH_LOG_SECTOR_SIZE  4096
+#define FLASH_LOG_PAGE_SIZE    256
+#define FLASH_LOG_PAGE_MAGIC   0x564C   // "LV"
+
+// Page payload formats (1 was a fixed-record format that never shipped)
+#define FLASH_LOG_FORMAT_COLUMNAR 2     // flash_log_block_id_t + one sample_codec block
+
+// Minimum interval between two logged samples of the same device
+#ifndef FLASH_LOG_INTERVAL_S
+#define FLASH_LOG_INTERVAL_S 60
+#endif
+
+#define FLASH_LOG_MAX_DEVICES 12
+
+// Record flags
+#define FLASH_LOG_REC_WALLCLOCK 0x01    // time_s is UTC epoch, else uptime seconds
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;         // FLASH_LOG_PAGE_MAGIC
+    uint8_t  format;        // FLASH_LOG_FORMAT_*
+    uint8_t  count;         // records in the payload
+    uint32_t seq;           // page sequence number, +1 per page written
+    uint32_t crc;           // CRC32 of the page with this field set to 0
+} flash_log_page_hdr_t;
+
+// Device a columnar block belongs to (precedes the codec block)
+typedef struct __attribute__((packed)) {
+    uint16_t mac_tail;
+    uint8_t  role;
+    uint8_t  flags;         // FLASH_LOG_REC_*, same for all samples of the block
+} flash_log_block_id_t;
+
+// Decoded sample as handed to readers: the fields the UI and energy accounting use, per role
+typedef struct __attribute__((packed)) {
+    uint32_t time_s;
+    uint16_t mac_tail;      // mac[1] << 8 | mac[0] (BLE byte order)
+    uint8_t  role;          // victron_device_id_t
+    uint8_t  flags;         // FLASH_LOG_REC_*
+    uint8_t  state;         // device state, 0xFF if not reported
+    uint8_t  error;         // charger error, 0 if not reported
+    int16_t  voltage_centi; // 0.01 V battery / output voltage
+    int32_t  current_milli; // 0.001 A battery / output current
+    uint16_t power_w;       // 1 W PV power (MPPT)
+    uint16_t soc_deci;      // 0.1 % (SmartShunt), 0xFFFF if not reported
+    int16_t  aux;           // MPPT: yield 0.01 kWh, shunt: consumed 0.1 Ah,
+                            // BatterySense: 0.01 °C, DC-DC: input 0.01 V
+} flash_log_record_t;
+
+typedef struct {
+    uint32_t sectors;        // sectors in the partition
+    uint32_t sectors_used;   // sectors holding log pages
+    uint32_t pages_torn;     // pages with a bad CRC in the head sector at boot
+    uint32_t next_seq;
+    uint32_t write_page;     // absolute page index of the next write
+    uint32_t records_dropped;// staging full while a page was pending
+    uint32_t write_errors;
+    uint32_t records_encoded;// samples packed into pages since boot
+    uint32_t bytes_encoded;  // flash bytes used for them (whole pages)
+} flash_log_stats_t;
+
+/**
+ * @brief Return false from a visitor to stop the iteration
+ */
+typedef bool (*flash_log_visit_t)(const flash_log_record_t *rec, void *ctx);
+
+/**
+ * @brief Find the partition and recover the append position
+ * @return ESP_ERR_NOT_FOUND if the partition is missing
+ */
+esp_err_t flash_log_init(void);
+
+/**
+ * @brief Stage a sample for logging, at most once per FLASH_LOG_INTERVAL_S per device
+ * @return true if the sample was staged
+ */
+bool flash_log_append(const victron_data_t *data);
+
+/**
+ * @brief Write staged pages that are full; call outside of the UI data lock
+ */
+esp_err_t flash_log_flush(void);
+
+/**
+ * @brief Write the partially filled page too (e.g. before a planned restart)
+ */
+esp_err_t flash_log_sync(void);
+
+/**
+ * @brief Visit all records on flash, oldest first
+ * @return number of records visited
+ */
+size_t flash_log_read(flash_log_visit_t visit, void *ctx);
+
+/**
+ * @brief Visit records with time_s in [t_from, t_to], oldest first
+ * Columnar blocks outside the range are skipped using their header.
+ */
+size_t flash_log_read_range(uint32_t t_from, uint32_t t_to, flash_log_visit_t visit, void *ctx);
+
+/**
+ * @brief Log statistics
+ */
+void flash_log_get_stats(flash_log_stats_t *out);
+
+#endif // FLASH_LOG_H
@@ -0,0 +1,221 @@
+/**
+ * History - Implementation
+ */
+#include "history.h"
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "HISTORY";
+
+// Reserved delta value marking a sample without data
+#define DELTA_GAP INT16_MIN
+
+typedef struct {
+    int16_t *deltas;
+    uint16_t capacity;
+    uint16_t count;
+    uint16_t head;      // next write position
+    int32_t  last;      // absolute value of the newest valid sample
+    uint32_t total;     // samples pushed since init (wraps)
+} hist_ring_t;
+
+// Averages feeding the next coarser tier
+typedef struct {
+    int64_t  sum;
+    uint16_t valid;
+    uint16_t samples;
+} hist_acc_t;
+
+static int16_t buf_1s[HISTORY_METRIC_COUNT][HISTORY_1S_SAMPLES];
+static int16_t buf_1min[HISTORY_METRIC_COUNT][HISTORY_1MIN_SAMPLES];
+static int16_t buf_15min[HISTORY_METRIC_COUNT][HISTORY_15MIN_SAMPLES];
+
+static hist_ring_t rings[HISTORY_METRIC_COUNT][HISTORY_TIER_COUNT];
+static hist_acc_t acc[HISTORY_METRIC_COUNT][HISTORY_TIER_COUNT]; // acc[m][t] feeds tier t+1
+
+_Static_assert(sizeof(buf_1s) + sizeof(buf_1min) + sizeof(buf_15min) + sizeof(rings) + sizeof(acc)
+               <= HISTORY_SRAM_BUDGET, "history rings exceed HISTORY_SRAM_BUDGET");
+
+// Samples of tier t that make up one sample of tier t+1
+static const uint16_t tier_ratio[HISTORY_TIER_COUNT] = { 60, 15, 0 };
+static const uint32_t tier_period_s[HISTORY_TIER_COUNT] = { 1, 60, 900 };
+
+static uint32_t last_record_s;
+static bool has_record;
+
+static void ring_push(hist_ring_t *r, bool valid, int32_t value) {
+    int16_t delta = DELTA_GAP;
+    if (valid) {
+        // Clamp large jumps; the ring converges over the next samples
+        int32_t d = value - r->last;
+        if (d > INT16_MAX) d = INT16_MAX;
+        if (d < -INT16_MAX) d = -INT16_MAX;
+        delta = (int16_t)d;
+        r->last += d;
+    }
+    r->deltas[r->head] = delta;
+    r->head = (uint16_t)((r->head + 1) % r->capacity);
+    if (r->count < r->capacity) r->count++;
+    r->total++;
+}
+
+// Walk newest to oldest; visit(value, valid) for up to n samples
+typedef void (*ring_visit_t)(int32_t value, bool valid, void *ctx);
+
+static size_t ring_walk(const hist_ring_t *r, size_t n, ring_visit_t visit, void *ctx) {
+    if (n > r->count) n = r->count;
+    int32_t cur = r->last;
+    int idx = r->head;
+    for (size_t i = 0; i < n; i++) {
+        idx = (idx == 0) ? r->capacity - 1 : idx - 1;
+        int16_t d = r->deltas[idx];
+        if (d == DELTA_GAP) {
+            visit(0, false, ctx);
+        } else {
+            visit(cur, true, ctx);
+            cur -= d;
+        }
+    }
+    return n;
+}
+
+static void push_sample(history_metric_t m, history_tier_t t, bool valid, int32_t value) {
+    ring_push(&rings[m][t], valid, value);
+
+    if (tier_ratio[t] == 0) return;
+    hist_acc_t *a = &acc[m][t];
+    if (valid) {
+        a->sum += value;
+        a->valid++;
+    }
+    if (++a->samples >= tier_ratio[t]) {
+        bool avg_valid = a->valid > 0;
+        int32_t avg = avg_valid ? (int32_t)(a->sum / a->valid) : 0;
+        memset(a, 0, sizeof(*a));
+        push_sample(m, (history_tier_t)(t + 1), avg_valid, avg);
+    }
+}
+
+void history_init(uint32_t now_s) {
+    int16_t *bufs[HISTORY_TIER_COUNT];
+    const uint16_t caps[HISTORY_TIER_COUNT] = {
+        HISTORY_1S_SAMPLES, HISTORY_1MIN_SAMPLES, HISTORY_15MIN_SAMPLES
+    };
+
+    for (int m = 0; m < HISTORY_METRIC_COUNT; m++) {
+        bufs[HISTORY_TIER_1S] = buf_1s[m];
+        bufs[HISTORY_TIER_1MIN] = buf_1min[m];
+        bufs[HISTORY_TIER_15MIN] = buf_15min[m];
+        for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+            hist_ring_t *r = &rings[m][t];
+            memset(r, 0, sizeof(*r));
+            r->deltas = bufs[t];
+            r->capacity = caps[t];
+            memset(&acc[m][t], 0, sizeof(acc[m][t]));
+        }
+    }
+    last_record_s = now_s;
+    has_record = false;
+}
+
+void history_record(uint32_t now_s, const int32_t values[HISTORY_METRIC_COUNT],
+                    const bool valid[HISTORY_METRIC_COUNT]) {
+    uint32_t steps = 1;
+    if (has_record) {
+        steps = now_s - last_record_s;
+        if ((int32_t)steps <= 0) return;   // already recorded this second
+        // Longer outages only need to flush the 1 s and 1 min tiers
+        if (steps > HISTORY_1MIN_SAMPLES * 60) steps = HISTORY_1MIN_SAMPLES * 60;
+    }
+    last_record_s = now_s;
+    has_record = true;
+
+    for (uint32_t s = 0; s < steps; s++) {
+        for (int m = 0; m < HISTORY_METRIC_COUNT; m++) {
+            push_sample((history_metric_t)m, HISTORY_TIER_1S, valid[m], values[m]);
+        }
+    }
+}
+
+typedef struct {
+    history_stats_t stats;
+    int64_t sum;
+} stats_ctx_t;
+
+static void stats_visit(int32_t value, bool valid, void *p) {
+    stats_ctx_t *c = p;
+    if (!valid) return;
+    if (c->stats.count == 0 || value < c->stats.min) c->stats.min = value;
+    if (c->stats.count == 0 || value > c->stats.max) c->stats.max = value;
+    c->sum += value;
+    c->stats.count++;
+}
+
+bool history_stats(history_metric_t metric, history_tier_t tier, uint32_t window_samples,
+                   history_stats_t *out) {
+    if (metric >= HISTORY_METRIC_COUNT || tier >= HISTORY_TIER_COUNT) return false;
+
+    stats_ctx_t c = {0};
+    ring_walk(&rings[metric][tier], window_samples, stats_visit, &c);
+    c.stats.avg = c.stats.count ? (int32_t)(c.sum / c.stats.count) : 0;
+    if (out) *out = c.stats;
+    return c.stats.count > 0;
+}
+
+bool history_stats_window(history_metric_t metric, uint32_t window_s, history_stats_t *out) {
+    const uint32_t span_1s = HISTORY_1S_SAMPLES * tier_period_s[HISTORY_TIER_1S];
+    const uint32_t span_1min = HISTORY_1MIN_SAMPLES * tier_period_s[HISTORY_TIER_1MIN];
+
+    history_tier_t tier = HISTORY_TIER_15MIN;
+    if (window_s <= span_1s) tier = HISTORY_TIER_1S;
+    else if (window_s <= span_1min) tier = HISTORY_TIER_1MIN;
+
+    uint32_t samples = (window_s + tier_period_s[tier] - 1) / tier_period_s[tier];
+    return history_stats(metric, tier, samples, out);
+}
+
+typedef struct {
+    int32_t *out;
+    size_t pos;   // filled from the end, so output ends up oldest first
+} last_n_ctx_t;
+
+static void last_n_visit(int32_t value, bool valid, void *p) {
+    last_n_ctx_t *c = p;
+    c->out[--c->pos] = valid ? value : HISTORY_NO_VALUE;
+}
+
+size_t history_last_n(history_metric_t metric, history_tier_t tier, int32_t *out, size_t n) {
+    if (metric >= HISTORY_METRIC_COUNT || tier >= HISTORY_TIER_COUNT) return 0;
+
+    const hist_ring_t *r = &rings[metric][tier];
+    if (n > r->count) n = r->count;
+    last_n_ctx_t c = { .out = out, .pos = n };
+    return ring_walk(r, n, last_n_visit, &c);
+}
+
+uint32_t history_sample_count(history_metric_t metric, history_tier_t tier) {
+    if (metric >= HISTORY_METRIC_COUNT || tier >= HISTORY_TIER_COUNT) return 0;
+    return rings[metric][tier].total;
+}
+
+uint32_t history_tier_period_s(history_tier_t tier) {
+    return (tier < HISTORY_TIER_COUNT) ? tier_period_s[tier] : 0;
+}
+
+size_t history_footprint(void) {
+    return sizeof(buf_1s) + sizeof(buf_1min) + sizeof(buf_15min) + sizeof(rings) + sizeof(acc);
+}
+
+void history_log_footprint(void) {
+    ESP_LOGI(TAG, "Tier 1s:    %u B (%u x %u metrics, %u min)",
+             (unsigned)sizeof(buf_1s), HISTORY_1S_SAMPLES, HISTORY_METRIC_COUNT,
+             HISTORY_1S_SAMPLES / 60);
+    ESP_LOGI(TAG, "Tier 1min:  %u B (%u x %u metrics, %u h)",
+             (unsigned)sizeof(buf_1min), HISTORY_1MIN_SAMPLES, HISTORY_METRIC_COUNT,
+             HISTORY_1MIN_SAMPLES / 60);
+    ESP_LOGI(TAG, "Tier 15min: %u B (%u x %u metrics, %u days)",
+             (unsigned)sizeof(buf_15min), HISTORY_15MIN_SAMPLES, HISTORY_METRIC_COUNT,
+             HISTORY_15MIN_SAMPLES / 96);
+    ESP_LOGI(TAG, "Total: %u B of %u B budget", (unsigned)history_footprint(),
+             (unsigned)HISTORY_SRAM_BUDGET);
+}
@@ -0,0 +1,102 @@
+/**
+ * History - In-RAM time series per metric
+ * Delta-encoded int16 samples in fixed-size rings, three tiers:
+ *   1 s  x 600  (10 min)
+ *   1 min x 1440 (24 h)   - average of 60 one-second samples
+ *   15 min x 672 (7 days) - average of 15 one-minute samples
+ * All rings are static; the total is checked against HISTORY_SRAM_BUDGET
+ * at compile time and reported by history_log_footprint().
+ *
+ * Not thread-safe: callers hold the UI data mutex.
+ */
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    HISTORY_PV_POWER,          // 1 W, sum of all MPPTs
+    HISTORY_SOC,               // 0.1 %
+    HISTORY_SHUNT_CURRENT,     // 0.01 A (+ charge, - discharge)
+    HISTORY_BATTERY_VOLTAGE,   // 0.01 V
+    HISTORY_METRIC_COUNT
+} history_metric_t;
+
+typedef enum {
+    HISTORY_TIER_1S,
+    HISTORY_TIER_1MIN,
+    HISTORY_TIER_15MIN,
+    HISTORY_TIER_COUNT
+} history_tier_t;
+
+#define HISTORY_1S_SAMPLES      600
+#define HISTORY_1MIN_SAMPLES    1440
+#define HISTORY_15MIN_SAMPLES   672
+
+#define HISTORY_SRAM_BUDGET     (24 * 1024)
+
+// Marker for "no data" in history_last_n() output
+#define HISTORY_NO_VALUE        INT32_MIN
+
+typedef struct {
+    int32_t  min;
+    int32_t  max;
+    int32_t  avg;
+    uint32_t count;    // valid samples in the window (0 = no data)
+} history_stats_t;
+
+/**
+ * @brief Clear all rings
+ */
+void history_init(uint32_t now_s);
+
+/**
+ * @brief Record the current value of every metric at time now_s (seconds)
+ * Seconds skipped since the last call are filled with the same values.
+ * @param values one value per metric
+ * @param valid  false for metrics without (fresh) data; stored as gaps
+ */
+void history_record(uint32_t now_s, const int32_t values[HISTORY_METRIC_COUNT],
+                    const bool valid[HISTORY_METRIC_COUNT]);
+
+/**
+ * @brief Min/max/avg over the newest window_samples samples of a tier
+ * @return false if the window holds no valid sample
+ */
+bool history_stats(history_metric_t metric, history_tier_t tier, uint32_t window_samples,
+                   history_stats_t *out);
+
+/**
+ * @brief Min/max/avg over the last window_s seconds, using the finest tier that covers it
+ */
+bool history_stats_window(history_metric_t metric, uint32_t window_s, history_stats_t *out);
+
+/**
+ * @brief Copy the newest n samples of a tier, oldest first; gaps are HISTORY_NO_VALUE
+ * @return number of samples written (may be less than n early on)
+ */
+size_t history_last_n(history_metric_t metric, history_tier_t tier, int32_t *out, size_t n);
+
+/**
+ * @brief Samples pushed into a tier since init (wraps); a change means new data
+ */
+uint32_t history_sample_count(history_metric_t metric, history_tier_t tier);
+
+/**
+ * @brief Seconds covered by one sample of the tier
+ */
+uint32_t history_tier_period_s(history_tier_t tier);
+
+/**
+ * @brief Bytes of SRAM used by the rings
+ */
+size_t history_footprint(void);
+
+/**
+ * @brief Log the per-tier memory footprint and time coverage
+ */
+void history_log_footprint(void);
+
+#endif // HISTORY_H
@@ -1,6 +1,6 @@
 /**
  * Victron Solar Display - Simple Version
- * No LVGL, direct display driver, hardcoded AES keys
+ * No LVGL, direct display driver, device keys in NVS (serial console)
  */
 #include <stdio.h>
 #include <string.h>
@@ -12,387 +12,365 @@
 #include "simple_display.h"
 #include "victron_ble.h"
 #include "victron_records.h"
-#include "ui_bars.h"
+#include "device_table.h"
+#include "ui_layout.h"
+#include "ui_cells.h"
+#include "ui_diag.h"
+#include "ui_trends.h"
+#include "ui_events.h"
+#include "event_log.h"
+#include "history.h"
+#include "flash_log.h"
+#include "energy.h"
+#include "alarm.h"
+#include "console.h"
+#include "app_tasks.h"
+#include "diag_stats.h"
+#include "diag_scope.h"
+#include "diag_trace.h"
+#include "diag_log.h"
+#include "diag_mem.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
 
 static const char *TAG = "VICTRON";
 
-// Current data storage
+// Current data storage (device table is guarded by data_mutex)
 static SemaphoreHandle_t data_mutex = NULL;
-static victron_data_t current_solar = {0};
-static victron_data_t current_battery = {0};
-static victron_data_t current_smartshunt = {0};
-static victron_data_t current_charger = {0};
-static bool has_solar_data = false;
-static bool has_battery_data = false;
-static bool has_smartshunt_data = false;
-static bool has_charger_data = false;
-
-// Debug: last seen MAC addresses
-static uint8_t last_unknown_mac[6] = {0};
-static uint32_t last_unknown_mac_time = 0;
-static bool has_unknown_mac = false;
-
-// Stub for ui_set_ble_mac - now captures ALL MACs for debug display
-void ui_set_ble_mac(const uint8_t *mac) {
-    if (!data_mutex) return;
-    
+
+// Screens, cycled with the BOOT button
+#define PIN_BOOT_BUTTON 0
+#define UI_REFRESH_MS   1000
+#define UI_POLL_MS      50
+#define MEM_SAMPLE_MS   5000   // stack/heap budget check (diag_mem)
+
+typedef enum {
+    SCREEN_DASHBOARD,
+    SCREEN_TRENDS_HOUR,
+    SCREEN_TRENDS_DAY,
+    SCREEN_DEVICES,
+    SCREEN_EVENTS,
+    SCREEN_COUNT
+} ui_screen_t;
+
+static ui_screen_t ui_screen = SCREEN_DASHBOARD;
+
+// Layout state
+#define UI_PAGE_ROTATE_MS 8000   // Auto-rotate interval when devices span several pages
+#define UI_SEPARATOR_COLOR 0x528A // Light gray
+#define UI_ALARM_BORDER    2      // outline of a cell whose device has an active alarm
+
+static bool ui_initialized = false;
+static volatile bool render_stress = false;   // console: full redraw every tick
+static volatile bool restart_requested;       // console: sync, then esp_restart()
+static ui_layout_t layout;
+static ui_cell_t cells[UI_LAYOUT_MAX_CELLS];
+static int ui_page = 0;
+static TickType_t page_shown_at = 0;
+static uint32_t alarm_outlined;   // cells (bit per cell) drawn with the alarm outline
+
+// Console timers (see diag_stats.h)
+static diag_timer_t stat_callback;   // data callback, including the wait for data_mutex
+static diag_timer_t stat_render;     // one screen refresh
+
+// data_mutex, with the wait and the hold visible in traces
+static void data_lock(void) {
+    DIAG_TRACE_BEGIN(mutex_wait);
     xSemaphoreTake(data_mutex, portMAX_DELAY);
-    
-    // Known MACs (reversed byte order LSB first)
-    static const uint8_t mac_mppt[6] = { 0xb5, 0x7d, 0xb4, 0x39, 0x56, 0xc1 };
-    static const uint8_t mac_batt[6] = { 0x2b, 0x9e, 0xbd, 0x91, 0xb6, 0xc1 };
-    static const uint8_t mac_smartshunt[6] = { 0x2e, 0x1b, 0x0c, 0xcf, 0x3c, 0xf9 };
-    static const uint8_t mac_charger[6] = { 0x00, 0x7b, 0xca, 0xfc, 0xa6, 0xe9 };
-    
-    // Store ALL MACs for debugging (update every time we see a Victron device)
-    memcpy(last_unknown_mac, mac, 6);
-    last_unknown_mac_time = xTaskGetTickCount();
-    has_unknown_mac = true;
-    
-    xSemaphoreGive(data_mutex);
+    DIAG_TRACE_END(mutex_wait);
+    DIAG_TRACE_BEGIN(mutex_held);
 }
 
-// Previous values for change detection
-static bool ui_initialized = false;
-static int prev_pv_power = -999;
-static float prev_solar_voltage = -999;
-static float prev_solar_current = -999;
-static float prev_solar_yield = -999;
-static uint8_t prev_solar_state = 0xFF;
-static float prev_soc = -999;
-static float prev_shunt_voltage = -999;
-static float prev_shunt_current = -999;
-static uint16_t prev_ttg = 0xFFFF;
-static float prev_consumed = -999;
-static float prev_bat_voltage = -999;
-static float prev_bat_temp = -999;
-static float prev_charger_voltage = -999;
-static float prev_charger_current = -999;
-static uint8_t prev_charger_state = 0xFF;
-static bool prev_has_solar = false;
-static bool prev_has_battery = false;
-static bool prev_has_shunt = false;
-static bool prev_has_charger = false;
-
-// Helper to get state string
-static const char* get_state_string(uint8_t state) {
-    switch (state) {
-        case VIC_STATE_OFF: return "OFF";
-        case VIC_STATE_LOW_POWER: return "LOW PWR";
-        case VIC_STATE_FAULT: return "FAULT";
-        case VIC_STATE_BULK: return "BULK";
-        case VIC_STATE_ABSORPTION: return "ABSORB";
-        case VIC_STATE_FLOAT: return "FLOAT";
-        case VIC_STATE_STORAGE: return "STORAGE";
-        case VIC_STATE_EQUALIZE: return "EQUAL";
-        case VIC_STATE_POWER_SUPPLY: return "PSU";
-        default: return "---";
-    }
+static void data_unlock(void) {
+    DIAG_TRACE_END(mutex_held);
+    xSemaphoreGive(data_mutex);
 }
 
 // Victron data callback
 static void victron_data_callback(const victron_data_t *data) {
     if (!data || !data_mutex) return;
+    DIAG_TRACE_SCOPE(data_callback);
+    int64_t start_us = esp_timer_get_time();
     
-    xSemaphoreTake(data_mutex, portMAX_DELAY);
+    data_lock();
     
-    if (data->device_id == VICTRON_DEVICE_MPPT) {
-        memcpy(&current_solar, data, sizeof(victron_data_t));
-        has_solar_data = true;
-    }
-    else if (data->device_id == VICTRON_DEVICE_SMARTSHUNT) {
-        memcpy(&current_smartshunt, data, sizeof(victron_data_t));
-        has_smartshunt_data = true;
-    }
-    else if (data->device_id == VICTRON_DEVICE_BATTERY_SENSE) {
-        // SmartBatterySense - only voltage and temperature
-        memcpy(&current_battery, data, sizeof(victron_data_t));
-        has_battery_data = true;
+    int slot = device_table_update(data);
+    energy_update(slot, data);
+    event_log_update(slot, data);
+    alarm_update(slot, data);
+    
+    data_unlock();
+    diag_timer_record(&stat_callback, (uint32_t)(esp_timer_get_time() - start_us));
+}
+
+// Safe mode mark and page number along the bottom edge
+static void draw_page_labels(void) {
+    if (diag_mem_safe_mode()) {
+        display_string(0, DISPLAY_HEIGHT - 16, "SAFE MODE", COLOR_RED, COLOR_BLACK);
     }
-    else if (data->device_id == VICTRON_DEVICE_AC_CHARGER) {
-        memcpy(&current_charger, data, sizeof(victron_data_t));
-        has_charger_data = true;
-        ESP_LOGI(TAG, "AC Charger: %.2fV %.1fA State:%d", 
-            data->record.ac_charger.battery_voltage_1_centi / 100.0f,
-            data->record.ac_charger.battery_current_1_deci / 10.0f,
-            data->record.ac_charger.device_state);
+
+    if (layout.page_count > 1) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "%d/%d", layout.page + 1, layout.page_count);
+        display_string(DISPLAY_WIDTH - 8 * 4, DISPLAY_HEIGHT - 16, buf, 0x8410, COLOR_BLACK);
     }
-    
-    xSemaphoreGive(data_mutex);
 }
 
-// Draw the main UI - optimized to update only changed values
-static void draw_ui(void) {
-    char buf[64];
+// Lay out the current page: clear, draw separators and bind devices to cells
+static void ui_build_page(void) {
+    ui_layout_compute(&layout, device_table_count(), ui_page);
+    ui_page = layout.page;
 
-    // Landscape layout: 4 quadranti (2x2)
-    const int half_w = DISPLAY_WIDTH / 2;   // 240
-    const int half_h = DISPLAY_HEIGHT / 2;  // 160
-    const int pad = 8;
-    const int inner_w = half_w - pad * 2;
-    const int bar_w = inner_w - 4;
+    display_fill(COLOR_BLACK);
+    ui_layout_draw_separators(&layout, UI_SEPARATOR_COLOR);
 
-    xSemaphoreTake(data_mutex, portMAX_DELAY);
-    
-    // First time initialization - draw static elements once
-    if (!ui_initialized) {
-        display_fill(COLOR_BLACK);
-        
-        // Draw all section headers (static)
-        display_string(pad, pad, "MPPT SOLAR CHARGER", COLOR_YELLOW, COLOR_BLACK);
-        display_string(half_w + pad, pad, "SMARTSHUNT", COLOR_YELLOW, COLOR_BLACK);
-        display_string(pad, half_h + pad, "BATTERY SENSE", COLOR_YELLOW, COLOR_BLACK);
-        display_string(half_w + pad, half_h + pad, "AC CHARGER IP22", COLOR_YELLOW, COLOR_BLACK);
-        
-        // Draw cross separator (light gray lines between quadrants)
-        uint16_t separator_color = 0x528A; // Light gray
-        // Vertical line (center)
-        display_fill_rect(half_w - 1, 0, 2, DISPLAY_HEIGHT, separator_color);
-        // Horizontal line (center)
-        display_fill_rect(0, half_h - 1, DISPLAY_WIDTH, 2, separator_color);
-        
-        ui_initialized = true;
-    }
-    
-    // === Q1: MPPT SOLAR CHARGER (top-left) ===
-    int base_x = 0;
-    int base_y = 0;
-    
-    // Only update status indicator if changed
-    if (has_solar_data != prev_has_solar) {
-        display_string(base_x + half_w - pad - 24, base_y + pad, has_solar_data ? "    " : "(--)", has_solar_data ? COLOR_BLACK : COLOR_RED, COLOR_BLACK);
-        prev_has_solar = has_solar_data;
+    for (int i = 0; i < UI_LAYOUT_MAX_CELLS; i++) {
+        const device_entry_t *dev = (i < layout.cell_count) ? device_table_get(layout.first + i) : NULL;
+        ui_cell_bind(&cells[i], &layout.cells[i], dev);
     }
 
-    int y = base_y + pad + 18;
-    {
-        int pv_power = has_solar_data ? current_solar.record.solar.pv_power_w : 0;
-        uint8_t state = has_solar_data ? current_solar.record.solar.device_state : VIC_STATE_OFF;
-        const char *state_str = get_state_string(state);
-        float voltage = has_solar_data ? current_solar.record.solar.battery_voltage_centi / 100.0f : 0.0f;
-        float current = has_solar_data ? current_solar.record.solar.battery_current_deci / 10.0f : 0.0f;
-        float yield = has_solar_data ? current_solar.record.solar.yield_today_centikwh / 100.0f : 0.0f;
-
-        // PV Power - only update if changed
-        if (pv_power != prev_pv_power) {
-            snprintf(buf, sizeof(buf), "%4dW", pv_power);
-            display_string_large(base_x + pad, y, buf, COLOR_GREEN, COLOR_BLACK);
-            draw_mppt_power_bar(base_x + pad, y + 34, bar_w, pv_power);
-            prev_pv_power = pv_power;
-        }
+    draw_page_labels();
 
-        // State - only update if changed
-        if (state != prev_solar_state) {
-            snprintf(buf, sizeof(buf), "%-8s", state_str);
-            display_string(base_x + pad + inner_w - 70, y + 8, buf, COLOR_WHITE, COLOR_BLACK);
-            prev_solar_state = state;
-        }
-        y += 34 + 14;
+    page_shown_at = xTaskGetTickCount();
+    alarm_outlined = 0;
+    ui_initialized = true;
+}
 
-        // Battery Current - only update if changed
-        if (current != prev_solar_current) {
-            snprintf(buf, sizeof(buf), "%.1fA ", current);
-            display_string_large(base_x + pad, y, buf, COLOR_CYAN, COLOR_BLACK);
-            prev_solar_current = current;
-        }
+static void draw_cell_outline(const ui_rect_t *r, uint16_t color) {
+    display_fill_rect(r->x, r->y, r->w, UI_ALARM_BORDER, color);
+    display_fill_rect(r->x, r->y + r->h - UI_ALARM_BORDER, r->w, UI_ALARM_BORDER, color);
+    display_fill_rect(r->x, r->y, UI_ALARM_BORDER, r->h, color);
+    display_fill_rect(r->x + r->w - UI_ALARM_BORDER, r->y, UI_ALARM_BORDER, r->h, color);
+}
 
-        // Battery Voltage - only update if changed
-        if (voltage != prev_solar_voltage) {
-            snprintf(buf, sizeof(buf), "%.2fV", voltage);
-            display_string(base_x + pad + inner_w - 70, y + 8, buf, COLOR_WHITE, COLOR_BLACK);
-            prev_solar_voltage = voltage;
-        }
-        y += 34;
+// Outline the cells of devices with an active alarm rule; only changes are drawn
+static void draw_alarm_outlines(void) {
+    uint32_t slots = alarm_active_slots();
+    uint32_t outlined = 0;
+    for (int i = 0; i < layout.cell_count; i++) {
+        if (cells[i].dev && (slots >> device_table_slot(cells[i].dev)) & 1) outlined |= 1u << i;
+    }
 
-        // Yield Today - only update if changed
-        if (yield != prev_solar_yield) {
-            snprintf(buf, sizeof(buf), "Today: %.2f kWh    ", yield);
-            display_string(base_x + pad, y, buf, COLOR_WHITE, COLOR_BLACK);
-            prev_solar_yield = yield;
+    uint32_t changed = outlined ^ alarm_outlined;
+    if (!changed) return;
+    for (int i = 0; i < layout.cell_count; i++) {
+        if ((changed >> i) & 1) {
+            draw_cell_outline(&layout.cells[i], (outlined >> i) & 1 ? COLOR_RED : COLOR_BLACK);
         }
     }
-    
-    // === Q2: SMARTSHUNT (top-right) ===
-    base_x = half_w;
-    base_y = 0;
-    
-    // Only update status indicator if changed
-    if (has_smartshunt_data != prev_has_shunt) {
-        display_string(base_x + half_w - pad - 32, base_y + pad, has_smartshunt_data ? "      " : "(--)", has_smartshunt_data ? COLOR_BLACK : COLOR_RED, COLOR_BLACK);
-        prev_has_shunt = has_smartshunt_data;
+    // A removed outline also took the edge of the separators and labels
+    if (changed & alarm_outlined) {
+        ui_layout_draw_separators(&layout, UI_SEPARATOR_COLOR);
+        draw_page_labels();
     }
+    alarm_outlined = outlined;
+}
 
-    y = base_y + pad + 18;
-    {
-        float soc = has_smartshunt_data ? current_smartshunt.record.battery.soc_deci_percent / 10.0f : 0.0f;
-        float voltage = has_smartshunt_data ? current_smartshunt.record.battery.battery_voltage_centi / 100.0f : 0.0f;
-        float curr = has_smartshunt_data ? current_smartshunt.record.battery.battery_current_milli / 1000.0f : 0.0f;
-        uint16_t ttg = has_smartshunt_data ? current_smartshunt.record.battery.time_to_go_minutes : 0;
-        float consumed = has_smartshunt_data ? current_smartshunt.record.battery.consumed_ah_deci / -10.0f : 0.0f;
-
-        // SOC - only update if changed
-        if (soc != prev_soc) {
-            snprintf(buf, sizeof(buf), "%.0f%% ", soc);
-            uint16_t soc_color = get_soc_color(soc);
-            display_string_large(base_x + pad, y, buf, has_smartshunt_data ? soc_color : COLOR_WHITE, COLOR_BLACK);
-            draw_smartshunt_soc_bar(base_x + pad, y + 34, bar_w, has_smartshunt_data ? soc : 0.0f);
-            prev_soc = soc;
-        }
-
-        // Voltage - only update if changed
-        if (voltage != prev_shunt_voltage) {
-            snprintf(buf, sizeof(buf), "%.2fV ", voltage);
-            display_string(base_x + pad + inner_w - 70, y + 8, buf, COLOR_CYAN, COLOR_BLACK);
-            prev_shunt_voltage = voltage;
-        }
-        y += 34 + 14;
-
-        // Current - only update if changed
-        if (curr != prev_shunt_current) {
-            snprintf(buf, sizeof(buf), "%+.2fA   ", curr);
-            uint16_t curr_color = get_current_color(curr);
-            display_string_large(base_x + pad, y, buf, has_smartshunt_data ? curr_color : COLOR_WHITE, COLOR_BLACK);
-            draw_smartshunt_current_bar(base_x + pad, y + 34, bar_w, has_smartshunt_data ? curr : 0.0f);
-            prev_shunt_current = curr;
-        }
+// Draw the main UI - optimized to update only changed values
+static void draw_ui(void) {
+    DIAG_SCOPE(draw_ui);
+    data_lock();
+
+    // Stale watchdog: expired devices are picked up by the cells' change detection
+    device_table_tick();
+
+    // Relayout when devices appear, or rotate pages when they don't fit one screen
+    bool relayout = !ui_initialized || device_table_count() != layout.device_count;
+    if (!relayout && layout.page_count > 1 &&
+        (xTaskGetTickCount() - page_shown_at) >= pdMS_TO_TICKS(UI_PAGE_ROTATE_MS)) {
+        ui_page = (ui_page + 1) % layout.page_count;
+        relayout = true;
+    }
+    // A new page is drawn as one frame (strips rasterized on both cores)
+    if (relayout) {
+        display_frame_begin();
+        ui_build_page();
+    }
 
-        // TTG - only update if changed
-        if (ttg != prev_ttg) {
-            if (ttg != 0xFFFF && ttg > 0) {
-                snprintf(buf, sizeof(buf), "TTG:%dh%02dm ", ttg/60, ttg%60);
-            } else {
-                snprintf(buf, sizeof(buf), "TTG:---    ");
-            }
-            display_string(base_x + pad + inner_w - 90, y + 8, buf, COLOR_WHITE, COLOR_BLACK);
-            prev_ttg = ttg;
-        }
-        y += 34 + 14;
+    for (int i = 0; i < layout.cell_count; i++) {
+        ui_cell_draw(&cells[i]);
+    }
+    draw_alarm_outlines();
 
-        // Consumed - only update if changed
-        if (consumed != prev_consumed) {
-            snprintf(buf, sizeof(buf), "Used: %.1fAh         ", consumed);
-            display_string(base_x + pad, y, buf, COLOR_WHITE, COLOR_BLACK);
-            prev_consumed = consumed;
-        }
+    if (relayout) {
+        display_frame_end();
     }
-    
-    // === Q3: BATTERY SENSE (bottom-left) ===
-    base_x = 0;
-    base_y = half_h;
-    
-    // Only update status indicator if changed
-    if (has_battery_data != prev_has_battery) {
-        display_string(base_x + half_w - pad - 24, base_y + pad, has_battery_data ? "    " : "(--)", has_battery_data ? COLOR_BLACK : COLOR_RED, COLOR_BLACK);
-        prev_has_battery = has_battery_data;
+
+    data_unlock();
+}
+
+// First fresh device of a role, or NULL
+static const device_entry_t *fresh_device(victron_device_id_t role) {
+    for (int i = 0; i < device_table_count(); i++) {
+        const device_entry_t *e = device_table_get(i);
+        if (e->role == role && e->has_data && !e->stale) return e;
     }
+    return NULL;
+}
 
-    y = base_y + pad + 18;
-    {
-        float voltage = has_battery_data ? current_battery.record.battery.battery_voltage_centi / 100.0f : 0.0f;
-        float temp_k = has_battery_data ? current_battery.record.battery.aux_value / 100.0f : 273.15f;
-        float temp_c = temp_k - 273.15f;
+// Feed the history store once per second, independent of the visible screen
+static void record_history(void) {
+    static uint32_t last_s = UINT32_MAX;
+    uint32_t now_s = (uint32_t)(esp_timer_get_time() / 1000000);
+    if (now_s == last_s) return;
+    last_s = now_s;
+    DIAG_TRACE_SCOPE(record_history);
 
-        bool temp_valid = has_battery_data && (current_battery.record.battery.aux_input == 2);
-        if (!temp_valid && has_battery_data) {
-            temp_c = 0.0f;
-        }
+    int32_t values[HISTORY_METRIC_COUNT] = {0};
+    bool valid[HISTORY_METRIC_COUNT] = {false};
 
-        // TEMPERATURE - only update if changed
-        if (temp_c != prev_bat_temp) {
-            snprintf(buf, sizeof(buf), "%.1f C ", temp_c);
-            uint16_t temp_color = get_battery_temp_color(temp_c);
-            uint16_t temp_fg = has_battery_data ? temp_color : COLOR_WHITE;
-            display_string_large(base_x + pad, y, buf, temp_fg, COLOR_BLACK);
-            display_string(base_x + pad + 110, y, "o", temp_fg, COLOR_BLACK);
-            draw_battery_temp_bar(base_x + pad, y + 34, bar_w, has_battery_data ? temp_c : 0.0f);
-            prev_bat_temp = temp_c;
-        }
-        y += 34 + 14;
+    data_lock();
 
-        // VOLTAGE - only update if changed
-        if (voltage != prev_bat_voltage) {
-            snprintf(buf, sizeof(buf), "%.2fV     ", voltage);
-            display_string_large(base_x + pad, y, buf, COLOR_CYAN, COLOR_BLACK);
-            prev_bat_voltage = voltage;
-        }
-        y += 34;
+    const device_totals_t *totals = device_table_totals();
+    if (fresh_device(VICTRON_DEVICE_MPPT)) {
+        values[HISTORY_PV_POWER] = totals->pv_power_w;
+        valid[HISTORY_PV_POWER] = true;
+    }
 
-        // Status line - update only on data status change
-        static bool last_bat_status = false;
-        if (has_battery_data != last_bat_status) {
-            if (has_battery_data) {
-                display_string(base_x + pad, y, "Battery OK              ", COLOR_GREEN, COLOR_BLACK);
-            } else {
-                display_string(base_x + pad, y, "No data                 ", COLOR_ORANGE, COLOR_BLACK);
-            }
-            last_bat_status = has_battery_data;
+    const device_entry_t *shunt = fresh_device(VICTRON_DEVICE_SMARTSHUNT);
+    if (shunt) {
+        const victron_record_battery_monitor_t *b = &shunt->data.record.battery;
+        if (b->soc_deci_percent != 0x3FF) {
+            values[HISTORY_SOC] = b->soc_deci_percent;
+            valid[HISTORY_SOC] = true;
         }
+        values[HISTORY_SHUNT_CURRENT] = b->battery_current_milli / 10;
+        valid[HISTORY_SHUNT_CURRENT] = true;
     }
 
-    // === Q4: AC CHARGER IP22 (bottom-right) ===
-    base_x = half_w;
-    base_y = half_h;
-    
-    // Only update status indicator if changed
-    if (has_charger_data != prev_has_charger) {
-        display_string(base_x + half_w - pad - 24, base_y + pad, has_charger_data ? "    " : "(--)", has_charger_data ? COLOR_BLACK : COLOR_RED, COLOR_BLACK);
-        prev_has_charger = has_charger_data;
+    // Battery voltage from the shunt, else from the BatterySense
+    const device_entry_t *vsrc = shunt ? shunt : fresh_device(VICTRON_DEVICE_BATTERY_SENSE);
+    if (vsrc && vsrc->data.record.battery.battery_voltage_centi != 0xFFFF) {
+        values[HISTORY_BATTERY_VOLTAGE] = vsrc->data.record.battery.battery_voltage_centi;
+        valid[HISTORY_BATTERY_VOLTAGE] = true;
     }
 
-    y = base_y + pad + 18;
-    
-    if (!has_charger_data) {
-        display_string(base_x + pad, y, "Waiting for", COLOR_ORANGE, COLOR_BLACK);
-        y += 18;
-        display_string(base_x + pad, y, "AC Charger BLE...", COLOR_ORANGE, COLOR_BLACK);
-    } else {
-        // Normal display mode when charger is detected
-        uint8_t state = current_charger.record.ac_charger.device_state;
-        const char *state_str = get_state_string(state);
-        float voltage = current_charger.record.ac_charger.battery_voltage_1_centi / 100.0f;
-        float current = current_charger.record.ac_charger.battery_current_1_deci / 10.0f;
-
-        // State - only update if changed
-        if (state != prev_charger_state) {
-            snprintf(buf, sizeof(buf), "%-8s", state_str);
-            display_string_large(base_x + pad, y, buf, COLOR_CYAN, COLOR_BLACK);
-            prev_charger_state = state;
-        }
-        y += 34;
+    history_record(now_s, values, valid);
 
-        // Voltage - only update if changed
-        if (voltage != prev_charger_voltage) {
-            snprintf(buf, sizeof(buf), "%.2fV     ", voltage);
-            display_string_large(base_x + pad, y, buf, COLOR_GREEN, COLOR_BLACK);
-            prev_charger_voltage = voltage;
+    // Stage the latest frame of each live device for the flash log (decimated inside)
+    for (int i = 0; i < device_table_count(); i++) {
+        const device_entry_t *e = device_table_get(i);
+        if (e->has_data && !e->stale) {
+            flash_log_append(&e->data);
         }
-        y += 34;
+    }
 
-        // Current - only update if changed  
-        if (current != prev_charger_current) {
-            snprintf(buf, sizeof(buf), "%.1fA      ", current);
-            display_string_large(base_x + pad, y, buf, COLOR_YELLOW, COLOR_BLACK);
-            prev_charger_current = current;
-        }
-        y += 34;
+    bool save_energy = energy_service();
+
+    data_unlock();
 
-        // Status line
-        display_string(base_x + pad, y, "Charging OK         ", COLOR_GREEN, COLOR_BLACK);
+    // Flash writes stall the caches for ~1 ms; keep them out of the lock
+    DIAG_TRACE_BEGIN(flash_flush);
+    flash_log_flush();
+    DIAG_TRACE_END(flash_flush);
+    if (save_energy) {
+        energy_persist();
     }
+}
 
-    xSemaphoreGive(data_mutex);
+// BOOT button (active low) - true once per press
+static bool boot_button_pressed(void) {
+    static int prev_level = 1;
+    int level = gpio_get_level(PIN_BOOT_BUTTON);
+    bool pressed = (prev_level == 1 && level == 0);
+    prev_level = level;
+    return pressed;
 }
 
 // Display update task
 static void display_task(void *arg) {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << PIN_BOOT_BUTTON),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    gpio_config(&io_conf);
+
+    TickType_t last_draw = 0;
+    bool full = true;
+    bool safe_mode_shown = false;
     while (1) {
-        draw_ui();
-        vTaskDelay(pdMS_TO_TICKS(1000));  // Update every second
+        if (restart_requested) {
+            // The flash log writer is this task: write out what is staged
+            ESP_LOGI(TAG, "Restarting");
+            flash_log_sync();
+            energy_persist();
+            esp_restart();
+        }
+        record_history();
+
+        if (diag_mem_safe_mode() && !safe_mode_shown) {
+            safe_mode_shown = true;
+            full = true;
+        }
+
+        if (boot_button_pressed()) {
+            ui_screen = (ui_screen + 1) % SCREEN_COUNT;
+            display_set_scroll_start(0);    // only the events screen scrolls
+            full = true;
+        }
+        if (render_stress) {
+            full = true;
+        }
+
+        if (full || (xTaskGetTickCount() - last_draw) >= pdMS_TO_TICKS(UI_REFRESH_MS)) {
+            int64_t start_us = esp_timer_get_time();
+            DIAG_TRACE_BEGIN(render);
+            if (ui_screen == SCREEN_DEVICES) {
+                if (full) display_frame_begin();
+                ui_diag_draw(full);  // lock-free, no data_mutex
+                display_frame_end();
+            } else if (ui_screen == SCREEN_TRENDS_HOUR || ui_screen == SCREEN_TRENDS_DAY) {
+                data_lock();
+                if (full) display_frame_begin();
+                ui_trends_draw(full, ui_screen == SCREEN_TRENDS_DAY ? UI_TRENDS_DAY : UI_TRENDS_HOUR);
+                display_frame_end();
+                data_unlock();
+            } else if (ui_screen == SCREEN_EVENTS) {
+                data_lock();
+                if (full) display_frame_begin();
+                ui_events_draw(full);
+                display_frame_end();
+                data_unlock();
+            } else {
+                if (full) ui_initialized = false;
+                draw_ui();
+            }
+            DIAG_TRACE_END(render);
+            full = false;
+            last_draw = xTaskGetTickCount();
+            diag_timer_record(&stat_render, (uint32_t)(esp_timer_get_time() - start_us));
+        }
+        // One tick under stress keeps the core's idle task (and its watchdog) fed
+        vTaskDelay(render_stress ? 1 : pdMS_TO_TICKS(UI_POLL_MS));
     }
 }
 
+// A memory budget was breached (diag_mem, esp_timer task): drop the optional
+// load and mark the dashboard; the rest keeps running until a reboot. Runs
+// in the esp_timer task, so nothing here may block: the trace is ended by
+// clearing its flag (diag_trace_stop() waits for emitters; the dump does
+// that later)
+static void enter_safe_mode(const char *reason) {
+    render_stress = false;
+    victron_ble_set_capture(VICTRON_CAPTURE_OFF);
+    __atomic_store_n(&diag_trace_active, false, __ATOMIC_RELEASE);
+    ESP_LOGW(TAG, "Safe mode (%s): render stress, capture and trace off", reason);
+}
+
+void app_set_render_stress(bool on) {
+    render_stress = on && !diag_mem_safe_mode();
+}
+
+void app_request_restart(void) {
+    restart_requested = true;
+}
+
 void app_main(void) {
-    ESP_LOGI(TAG, "=== Victron Solar Display (Hardcoded Keys) ===");
+    ESP_LOGI(TAG, "=== Victron Solar Display ===");
+    diag_log_init();
     
     // Create mutex
     data_mutex = xSemaphoreCreateMutex();
@@ -407,9 +385,17 @@ void app_main(void) {
     display_string(80, 250, "Solar Display", COLOR_WHITE, COLOR_BLACK);
     display_string(50, 290, "Initializing BLE...", COLOR_YELLOW, COLOR_BLACK);
     
-    // Initialize Victron BLE (keys are hardcoded)
+    // Initialize Victron BLE (device table from NVS)
     ESP_LOGI(TAG, "Initializing Victron BLE...");
+    history_init((uint32_t)(esp_timer_get_time() / 1000000));
+    history_log_footprint();
+    flash_log_init();
     victron_ble_init();
+    energy_init();       // after NVS init in victron_ble_init
+    alarm_init();        // rules from NVS, buzzer/relay outputs
+    device_table_init();
+    diag_stats_register_timer("app.callback", &stat_callback);
+    diag_stats_register_timer("ui.render", &stat_render);
     victron_ble_register_callback(victron_data_callback);
     
     vTaskDelay(pdMS_TO_TICKS(1500));
@@ -417,8 +403,15 @@ void app_main(void) {
     // Clear and start UI
     display_fill(COLOR_BLACK);
     
-    // Start display task
-    xTaskCreate(display_task, "display", 4096, NULL, 5, NULL);
+    // Start display task (placement: app_tasks.h)
+    xTaskCreatePinnedToCore(display_task, "display", APP_DISPLAY_TASK_STACK, NULL,
+                            APP_DISPLAY_TASK_PRIO, NULL, APP_DISPLAY_TASK_CORE);
+
+    // Serial console (device provisioning, counters, log levels)
+    console_init();
+
+    // Stack and heap budgets (`mem` on the console)
+    diag_mem_start(MEM_SAMPLE_MS, enter_safe_mode);
     
     ESP_LOGI(TAG, "System running. Waiting for Victron BLE data...");
 }
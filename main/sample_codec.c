@@ -0,0 +1,209 @@
+/**
+ * Sample Codec - Implementation
+ */
+#include "sample_codec.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define STREAM_COLUMNS (1 + CODEC_VALUE_COLUMNS)   // time + value columns
+
+// Byte sink; with buf == NULL only the length is counted
+typedef struct {
+    uint8_t *buf;
+    size_t   len;
+    size_t   cap;
+} writer_t;
+
+typedef struct {
+    const uint8_t *buf;
+    size_t         len;
+    size_t         pos;
+    bool           error;
+} reader_t;
+
+static inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static void put_varint(writer_t *w, uint64_t v) {
+    do {
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        if (v) b |= 0x80;
+        if (w->buf && w->len < w->cap) w->buf[w->len] = b;
+        w->len++;
+    } while (v);
+}
+
+static uint64_t get_varint(reader_t *r) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (r->pos >= r->len) break;
+        uint8_t b = r->buf[r->pos++];
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r->error = true;
+    return 0;
+}
+
+// Stream column 0 is the timestamp, 1.. the value columns
+static inline int64_t value_at(const codec_sample_t *s, int col) {
+    return col == 0 ? (int64_t)s->time_s : (int64_t)s->col[col - 1];
+}
+
+static void flush_zeros(writer_t *w, uint32_t *zeros) {
+    if (*zeros == 0) return;
+    put_varint(w, 0);             // zero token, followed by the extra run length
+    put_varint(w, *zeros - 1);
+    *zeros = 0;
+}
+
+// First value, first delta, then delta-of-delta with zero runs collapsed
+static void encode_column(writer_t *w, const codec_sample_t *samples, size_t n, int col) {
+    int64_t prev = 0, prev_d = 0;
+    uint32_t zeros = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        int64_t x = value_at(&samples[i], col);
+        if (i == 0) {
+            put_varint(w, zigzag(x));
+        } else if (i == 1) {
+            prev_d = x - prev;
+            put_varint(w, zigzag(prev_d));
+        } else {
+            int64_t d = x - prev;
+            int64_t dod = d - prev_d;
+            prev_d = d;
+            if (dod == 0) {
+                zeros++;
+            } else {
+                flush_zeros(w, &zeros);
+                put_varint(w, zigzag(dod));
+            }
+        }
+        prev = x;
+    }
+    flush_zeros(w, &zeros);
+}
+
+// Sums wrap in uint64_t: valid blocks never overflow and only the low 32 bits
+// are kept, while a corrupt block must not overflow a signed integer
+static bool decode_column(reader_t *r, codec_sample_t *out, size_t n, int col) {
+    uint64_t prev = 0, prev_d = 0;
+    uint64_t run = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t x;
+        if (i == 0) {
+            x = (uint64_t)unzigzag(get_varint(r));
+        } else if (i == 1) {
+            prev_d = (uint64_t)unzigzag(get_varint(r));
+            x = prev + prev_d;
+        } else {
+            uint64_t dod = 0;
+            if (run > 0) {
+                run--;
+            } else {
+                uint64_t token = get_varint(r);
+                if (token == 0) {
+                    run = get_varint(r);
+                } else {
+                    dod = (uint64_t)unzigzag(token);
+                }
+            }
+            prev_d += dod;
+            x = prev + prev_d;
+        }
+        if (r->error) return false;
+
+        if (col == 0) {
+            out[i].time_s = (uint32_t)x;
+        } else {
+            out[i].col[col - 1] = (int32_t)x;
+        }
+        prev = x;
+    }
+    return run == 0 && r->pos == r->len;
+}
+
+// Stream lengths for the first n samples; false if a stream exceeds 255 bytes
+static bool stream_sizes(const codec_sample_t *samples, size_t n, size_t len[STREAM_COLUMNS],
+                         size_t *total) {
+    *total = sizeof(codec_block_hdr_t);
+    for (int c = 0; c < STREAM_COLUMNS; c++) {
+        writer_t w = { 0 };
+        encode_column(&w, samples, n, c);
+        if (w.len > UINT8_MAX) return false;
+        len[c] = w.len;
+        *total += w.len;
+    }
+    return true;
+}
+
+size_t codec_encode_block(const codec_sample_t *samples, size_t n, uint8_t *out, size_t cap,
+                          size_t *consumed) {
+    size_t len[STREAM_COLUMNS];
+    size_t total = 0;
+
+    if (n > CODEC_BLOCK_MAX_SAMPLES) n = CODEC_BLOCK_MAX_SAMPLES;
+
+    // Largest prefix that fits (size grows with the sample count)
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = (lo + hi + 1) / 2;
+        if (stream_sizes(samples, mid, len, &total) && total <= cap) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    *consumed = lo;
+    if (lo == 0) return 0;
+    stream_sizes(samples, lo, len, &total);
+
+    codec_block_hdr_t hdr = { 0 };
+    hdr.count = (uint8_t)lo;
+    hdr.t_first = samples[0].time_s;
+    hdr.t_last = samples[lo - 1].time_s;
+    for (int c = 0; c < CODEC_RANGE_COLUMNS; c++) {
+        hdr.min[c] = hdr.max[c] = samples[0].col[c];
+    }
+    for (size_t i = 1; i < lo; i++) {
+        for (int c = 0; c < CODEC_RANGE_COLUMNS; c++) {
+            if (samples[i].col[c] < hdr.min[c]) hdr.min[c] = samples[i].col[c];
+            if (samples[i].col[c] > hdr.max[c]) hdr.max[c] = samples[i].col[c];
+        }
+    }
+    for (int c = 0; c < STREAM_COLUMNS; c++) {
+        hdr.col_len[c] = (uint8_t)len[c];
+    }
+    memcpy(out, &hdr, sizeof(hdr));
+
+    writer_t w = { .buf = out, .len = sizeof(hdr), .cap = cap };
+    for (int c = 0; c < STREAM_COLUMNS; c++) {
+        encode_column(&w, samples, lo, c);
+    }
+    return w.len;
+}
+
+size_t codec_decode_block(const uint8_t *in, size_t len, codec_sample_t *out, size_t max) {
+    codec_block_hdr_t hdr;
+
+    if (len < sizeof(hdr)) return 0;
+    memcpy(&hdr, in, sizeof(hdr));
+    if (hdr.count == 0 || hdr.count > max || hdr.count > CODEC_BLOCK_MAX_SAMPLES) return 0;
+
+    size_t pos = sizeof(hdr);
+    for (int c = 0; c < STREAM_COLUMNS; c++) {
+        if (pos + hdr.col_len[c] > len) return 0;
+        reader_t r = { .buf = in + pos, .len = hdr.col_len[c] };
+        if (!decode_column(&r, out, hdr.count, c)) return 0;
+        pos += hdr.col_len[c];
+    }
+    return hdr.count;
+}
@@ -0,0 +1,62 @@
+/**
+ * Sample Codec - Columnar block encoding of one device's samples
+ * A block stores each column (time, voltage, current, ...) as its own byte
+ * stream: first value, first delta, then delta-of-delta, all zigzag/varint
+ * encoded, with runs of zero delta-of-delta collapsed into one token. Slowly
+ * changing or regular columns (time, SOC, state) shrink to a few bytes per
+ * block. The block header keeps the time range and the min/max of the
+ * measurement columns so readers can skip blocks without decoding them.
+ *
+ * Plain C with no ESP-IDF dependencies, so it also builds on the host.
+ */
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    CODEC_COL_VOLTAGE,     // 0.01 V
+    CODEC_COL_CURRENT,     // 0.001 A
+    CODEC_COL_POWER,       // 1 W
+    CODEC_COL_SOC,         // 0.1 %
+    CODEC_COL_STATE,
+    CODEC_COL_ERROR,
+    CODEC_COL_AUX,
+    CODEC_VALUE_COLUMNS
+} codec_column_t;
+
+// Columns with min/max in the block header (voltage .. SOC)
+#define CODEC_RANGE_COLUMNS 4
+
+#define CODEC_BLOCK_MAX_SAMPLES 32
+
+typedef struct {
+    uint32_t time_s;
+    int32_t  col[CODEC_VALUE_COLUMNS];
+} codec_sample_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  count;                              // samples in the block
+    uint8_t  col_len[1 + CODEC_VALUE_COLUMNS];   // stream bytes: time, then value columns
+    uint32_t t_first;
+    uint32_t t_last;
+    int32_t  min[CODEC_RANGE_COLUMNS];
+    int32_t  max[CODEC_RANGE_COLUMNS];
+} codec_block_hdr_t;
+
+/**
+ * @brief Encode as many of the n samples as fit into cap bytes
+ * @param consumed set to the number of samples encoded (0 if not even one fits)
+ * @return bytes written (header + streams)
+ */
+size_t codec_encode_block(const codec_sample_t *samples, size_t n, uint8_t *out, size_t cap,
+                          size_t *consumed);
+
+/**
+ * @brief Decode a block
+ * @return samples written to out, or 0 if the block is malformed or larger than max
+ */
+size_t codec_decode_block(const uint8_t *in, size_t len, codec_sample_t *out, size_t max);
+
+#endif // SAMPLE_CODEC_H
@@ -8,8 +8,15 @@
 #include "driver/gpio.h"
 #include "driver/ledc.h"
 #include "esp_log.h"
+#include "diag_stats.h"
+#include "diag_scope.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "app_tasks.h"
 #include <string.h>
 
 static const char *TAG = "DISPLAY";
@@ -34,7 +41,9 @@ static const char *TAG = "DISPLAY";
 #define CMD_CASET     0x2A
 #define CMD_RASET     0x2B
 #define CMD_RAMWR     0x2C
+#define CMD_VSCRDEF   0x33
 #define CMD_MADCTL    0x36
+#define CMD_VSCSAD    0x37
 #define CMD_COLMOD    0x3A
 
 // MADCTL bits
@@ -241,18 +250,185 @@ static const uint8_t font_8x16[] = {
     0x00,0x00,0x3B,0x6E,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
 };
 
+// Console counters: every SPI transaction goes through spi_tx()
+static diag_counter_t stat_spi_bytes;
+static diag_counter_t stat_spi_transactions;
+
+static inline void spi_tx(spi_transaction_t *t) {
+    diag_counter_add(&stat_spi_bytes, t->length / 8);
+    diag_counter_inc(&stat_spi_transactions);
+    spi_device_polling_transmit(spi_dev, t);
+}
+
 // Swap bytes for RGB565
 static inline uint16_t swap_bytes(uint16_t color) {
     return (color >> 8) | (color << 8);
 }
 
+// Pixel packing. Colours are swapped to bus byte order once per call and
+// buffers are written two pixels per 32-bit store where the destination is
+// word-aligned (pool, fill and strip buffers are; odd x in a strip is not).
+// The first pixel of a pair is the low half (little endian).
+static inline uint32_t pixel_pair(uint16_t a, uint16_t b) {
+    return a | ((uint32_t)b << 16);
+}
+
+static void fill_pixels(uint16_t *dst, int n, uint16_t swapped) {
+    if (n > 0 && ((uintptr_t)dst & 3)) {
+        *dst++ = swapped;
+        n--;
+    }
+    uint32_t pair = pixel_pair(swapped, swapped);
+    uint32_t *d = (uint32_t *)dst;
+    for (int i = 0; i < n / 2; i++) d[i] = pair;
+    if (n & 1) dst[n - 1] = swapped;
+}
+
+// Copy native pixels in bus byte order, swapping two per word when both
+// pointers are word-aligned
+static void swap_pixels(uint16_t *dst, const uint16_t *src, int n) {
+    int i = 0;
+    if ((((uintptr_t)dst | (uintptr_t)src) & 3) == 0) {
+        const uint32_t *s = (const uint32_t *)src;
+        uint32_t *d = (uint32_t *)dst;
+        for (; i < n / 2; i++) {
+            uint32_t w = s[i];
+            d[i] = ((w & 0x00FF00FFu) << 8) | ((w >> 8) & 0x00FF00FFu);
+        }
+        i *= 2;
+    }
+    for (; i < n; i++) dst[i] = swap_bytes(src[i]);
+}
+
+// Glyph rows expanded for one fg/bg pair: a row byte is two nibbles, and a
+// nibble is four pixels, two words. A table indexed by the whole byte would
+// be 4 KB per colour pair; this one is 128 bytes and rebuilt only when the
+// colours change. Each drawing context (the direct primitives, each frame
+// worker) has its own.
+typedef struct {
+    uint16_t fg, bg;        // bus byte order
+    bool     valid;
+    uint32_t nibble[16][2]; // 4 pixels, MSB first
+    uint32_t wide[2];       // one pixel doubled: bg, fg
+} glyph_lut_t;
+
+static void glyph_lut_set(glyph_lut_t *lut, uint16_t fg, uint16_t bg) {
+    if (lut->valid && lut->fg == fg && lut->bg == bg) return;
+    for (int n = 0; n < 16; n++) {
+        lut->nibble[n][0] = pixel_pair((n & 8) ? fg : bg, (n & 4) ? fg : bg);
+        lut->nibble[n][1] = pixel_pair((n & 2) ? fg : bg, (n & 1) ? fg : bg);
+    }
+    lut->wide[0] = pixel_pair(bg, bg);
+    lut->wide[1] = pixel_pair(fg, fg);
+    lut->fg = fg;
+    lut->bg = bg;
+    lut->valid = true;
+}
+
+// 8 pixels of one glyph row
+static inline void glyph_row(uint16_t *dst, uint8_t bits, const glyph_lut_t *lut) {
+    const uint32_t *hi = lut->nibble[bits >> 4];
+    const uint32_t *lo = lut->nibble[bits & 15];
+    if (((uintptr_t)dst & 3) == 0) {
+        uint32_t *d = (uint32_t *)dst;
+        d[0] = hi[0];
+        d[1] = hi[1];
+        d[2] = lo[0];
+        d[3] = lo[1];
+    } else {
+        for (int col = 0; col < 8; col++) {
+            dst[col] = (bits & (0x80 >> col)) ? lut->fg : lut->bg;
+        }
+    }
+}
+
+// 16 pixels of one glyph row at 2x
+static inline void glyph_row_wide(uint16_t *dst, uint8_t bits, const glyph_lut_t *lut) {
+    if (((uintptr_t)dst & 3) == 0) {
+        uint32_t *d = (uint32_t *)dst;
+        for (int col = 0; col < 8; col++) d[col] = lut->wide[(bits >> (7 - col)) & 1];
+    } else {
+        for (int col = 0; col < 16; col++) {
+            dst[col] = (bits & (0x80 >> (col / 2))) ? lut->fg : lut->bg;
+        }
+    }
+}
+
+// Line buffers for the primitives, in word-aligned DMA-capable RAM. The SPI
+// driver bounce-copies every DMA buffer that is not (a heap allocation and a
+// memcpy per transaction), which includes most uint16_t arrays on the stack.
+// Polling transactions are finished when spi_tx() returns, so a buffer is
+// released right after its last transfer.
+#define LINE_PIXELS 512
+#ifndef LINE_POOL_SIZE
+#define LINE_POOL_SIZE 2
+#endif
+
+static DMA_ATTR uint16_t line_pool[LINE_POOL_SIZE][LINE_PIXELS];
+static SemaphoreHandle_t line_pool_free;
+static uint32_t line_pool_busy;     // bit per buffer
+static portMUX_TYPE line_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint16_t *line_acquire(void) {
+    xSemaphoreTake(line_pool_free, portMAX_DELAY);
+    portENTER_CRITICAL(&line_pool_lock);
+    int i = __builtin_ctz(~line_pool_busy);
+    line_pool_busy |= 1u << i;
+    portEXIT_CRITICAL(&line_pool_lock);
+    return line_pool[i];
+}
+
+static void line_release(uint16_t *buf) {
+    int i = (int)((buf - line_pool[0]) / LINE_PIXELS);
+    portENTER_CRITICAL(&line_pool_lock);
+    line_pool_busy &= ~(1u << i);
+    portEXIT_CRITICAL(&line_pool_lock);
+    xSemaphoreGive(line_pool_free);
+}
+
+// Solid-colour lines for display_fill_rect. The UI fills with few colours
+// (black, separator gray, bar zones), so these stay pre-filled and a fill
+// only writes a line on a miss; the least recently used colour is replaced.
+// Like the window state, only one task may draw at a time.
+#ifndef FILL_CACHE_SIZE
+#define FILL_CACHE_SIZE 4
+#endif
+
+static DMA_ATTR uint16_t fill_lines[FILL_CACHE_SIZE][LINE_PIXELS];
+static struct {
+    uint16_t color;     // bus byte order
+    uint32_t used;      // fill_clock at the last use, 0 = empty
+} fill_cache[FILL_CACHE_SIZE];
+static uint32_t fill_clock;
+static diag_counter_t stat_fill_hits;
+static diag_counter_t stat_fill_misses;
+
+static const uint16_t *fill_line(uint16_t swapped) {
+    int slot = 0;
+    for (int i = 0; i < FILL_CACHE_SIZE; i++) {
+        if (fill_cache[i].used && fill_cache[i].color == swapped) {
+            fill_cache[i].used = ++fill_clock;
+            diag_counter_inc(&stat_fill_hits);
+            return fill_lines[i];
+        }
+        if (fill_cache[i].used < fill_cache[slot].used) slot = i;
+    }
+    diag_counter_inc(&stat_fill_misses);
+    fill_pixels(fill_lines[slot], LINE_PIXELS, swapped);
+    fill_cache[slot].color = swapped;
+    fill_cache[slot].used = ++fill_clock;
+    return fill_lines[slot];
+}
+
+// Command and parameter bytes go in the transaction itself (no DMA buffer)
 static void spi_write_cmd(uint8_t cmd) {
     gpio_set_level(PIN_DC, 0);  // Command mode
     spi_transaction_t t = {
+        .flags = SPI_TRANS_USE_TXDATA,
         .length = 8,
-        .tx_buffer = &cmd,
+        .tx_data = { cmd },
     };
-    spi_device_polling_transmit(spi_dev, &t);
+    spi_tx(&t);
 }
 
 static void spi_write_data(const uint8_t *data, size_t len) {
@@ -262,7 +438,11 @@ static void spi_write_data(const uint8_t *data, size_t len) {
         .length = len * 8,
         .tx_buffer = data,
     };
-    spi_device_polling_transmit(spi_dev, &t);
+    if (len <= sizeof(t.tx_data)) {
+        t.flags = SPI_TRANS_USE_TXDATA;
+        memcpy(t.tx_data, data, len);
+    }
+    spi_tx(&t);
 }
 
 static void spi_write_data_byte(uint8_t data) {
@@ -289,8 +469,334 @@ static void set_window(int x0, int y0, int x1, int y1) {
     spi_write_cmd(CMD_RAMWR);
 }
 
+// ---------------------------------------------------------------------------
+// Frame rendering: display_frame_begin() records the drawing calls into a
+// display list; display_frame_end() rasterizes it in horizontal strips into
+// DMA buffers and streams them as one RAMWR over the whole screen. The
+// display task rasterizes even strips, the render helper on the other core
+// odd ones. Each core has two strip buffers, so it fills one while the other
+// is on the bus; the SPI post callback hands a sent buffer back to its core.
+
+#ifndef FRAME_STRIP_ROWS
+#define FRAME_STRIP_ROWS 10     // 9.6 KB per strip buffer
+#endif
+#ifndef FRAME_MAX_CMDS
+#define FRAME_MAX_CMDS   1024   // drawing calls per frame
+#endif
+#ifndef FRAME_TEXT_SIZE
+#define FRAME_TEXT_SIZE  2048   // characters per frame
+#endif
+#ifndef FRAME_PIXELS
+#define FRAME_PIXELS     1024   // blit pixels per frame
+#endif
+
+#define FRAME_STRIPS     ((DISPLAY_HEIGHT + FRAME_STRIP_ROWS - 1) / FRAME_STRIP_ROWS)
+#define FRAME_BUFS       2      // strip buffers per core
+#if CONFIG_FREERTOS_UNICORE
+#define FRAME_WORKERS    1
+#else
+#define FRAME_WORKERS    2
+#endif
+
+typedef enum {
+    FRAME_FILL,
+    FRAME_TEXT,             // 8x16 font
+    FRAME_TEXT_LARGE,       // 8x16 font at 2x
+    FRAME_BLIT,
+} frame_op_t;
+
+// One drawing call. Bounds are as drawn (not clipped); colors and blit
+// pixels are in bus byte order.
+typedef struct {
+    uint8_t  op;
+    int16_t  x, y, w, h;
+    uint16_t fg, bg;
+    uint16_t data;          // TEXT: offset in text (w / 8 / scale chars), BLIT: offset in pixels
+} frame_cmd_t;
+
+static struct {
+    bool        active;
+    uint16_t    cmd_count;
+    uint16_t    text_used;
+    uint16_t    pixels_used;
+    frame_cmd_t cmds[FRAME_MAX_CMDS];
+    char        text[FRAME_TEXT_SIZE];
+    uint16_t    pixels[FRAME_PIXELS];
+} frame;
+
+typedef struct {
+    uint16_t         *buf[FRAME_BUFS];
+    spi_transaction_t trans[FRAME_BUFS];
+    SemaphoreHandle_t free;     // buffers off the bus, given by the SPI post callback
+    int               next;     // buffer for the next strip (sent in order)
+    glyph_lut_t       lut;
+    uint32_t          raster_us;
+} frame_worker_t;
+
+static DMA_ATTR uint16_t strip_buf[FRAME_WORKERS][FRAME_BUFS][DISPLAY_WIDTH * FRAME_STRIP_ROWS];
+static frame_worker_t workers[FRAME_WORKERS];
+static volatile int render_cores = FRAME_WORKERS;
+static bool frame_ready;        // buffers and helper set up
+#if FRAME_WORKERS > 1
+static TaskHandle_t render_task_handle;
+static QueueHandle_t strip_done;    // helper → display task, in strip order
+#endif
+
+static diag_timer_t stat_frame;     // display_frame_end: rasterize + send
+static diag_timer_t stat_raster;    // CPU time per core and frame
+static diag_counter_t stat_frame_overflow;
+
+// SPI ISR, after every transaction; only strip transactions carry a user
+static void IRAM_ATTR frame_strip_sent(spi_transaction_t *t) {
+    if (t->user) {
+        BaseType_t woken = pdFALSE;
+        xSemaphoreGiveFromISR((SemaphoreHandle_t)t->user, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+}
+
+static void raster_text(uint16_t *buf, int y0, int top, int bottom, const frame_cmd_t *c,
+                        glyph_lut_t *lut) {
+    const bool large = (c->op == FRAME_TEXT_LARGE);
+    const int scale = large ? 2 : 1;
+    const int cw = 8 * scale;
+    const char *s = &frame.text[c->data];
+    const int len = c->w / cw;
+    glyph_lut_set(lut, c->fg, c->bg);
+
+    for (int y = top; y < bottom; y++) {
+        const uint8_t *glyph_rows = &font_8x16[(y - c->y) / scale];
+        uint16_t *row = buf + (y - y0) * DISPLAY_WIDTH;
+        for (int i = 0; i < len; i++) {
+            int gx = c->x + i * cw;
+            uint8_t bits = glyph_rows[(s[i] - 32) * 16];
+            if (gx >= 0 && gx + cw <= DISPLAY_WIDTH) {
+                if (large) glyph_row_wide(row + gx, bits, lut);
+                else glyph_row(row + gx, bits, lut);
+                continue;
+            }
+            // Cut by a screen edge
+            int col0 = (gx < 0) ? -gx : 0;
+            int col1 = (gx + cw > DISPLAY_WIDTH) ? DISPLAY_WIDTH - gx : cw;
+            for (int col = col0; col < col1; col++) {
+                row[gx + col] = (bits & (0x80 >> (col / scale))) ? c->fg : c->bg;
+            }
+        }
+    }
+}
+
+// Rasterize display rows [y0, y0 + rows) of the recorded frame into buf
+static void raster_strip(uint16_t *buf, int y0, int rows, glyph_lut_t *lut) {
+    const int y1 = y0 + rows;
+    memset(buf, 0, rows * DISPLAY_WIDTH * sizeof(uint16_t));   // black
+
+    for (int i = 0; i < frame.cmd_count; i++) {
+        const frame_cmd_t *c = &frame.cmds[i];
+        int top = (c->y > y0) ? c->y : y0;
+        int bottom = (c->y + c->h < y1) ? c->y + c->h : y1;
+        if (top >= bottom) continue;
+        int left = (c->x > 0) ? c->x : 0;
+        int right = (c->x + c->w < DISPLAY_WIDTH) ? c->x + c->w : DISPLAY_WIDTH;
+        if (left >= right) continue;
+
+        switch (c->op) {
+            case FRAME_FILL:
+                for (int y = top; y < bottom; y++) {
+                    fill_pixels(buf + (y - y0) * DISPLAY_WIDTH + left, right - left, c->fg);
+                }
+                break;
+            case FRAME_TEXT:
+            case FRAME_TEXT_LARGE:
+                raster_text(buf, y0, top, bottom, c, lut);
+                break;
+            case FRAME_BLIT:
+                for (int y = top; y < bottom; y++) {
+                    const uint16_t *src = &frame.pixels[c->data + (y - c->y) * c->w + (left - c->x)];
+                    memcpy(buf + (y - y0) * DISPLAY_WIDTH + left, src, (right - left) * sizeof(uint16_t));
+                }
+                break;
+        }
+    }
+}
+
+// Rasterize strip s into worker w's next buffer once it is off the bus
+static spi_transaction_t *strip_render(int w, int s) {
+    frame_worker_t *wk = &workers[w];
+    xSemaphoreTake(wk->free, portMAX_DELAY);
+    int b = wk->next;
+    wk->next = (b + 1) % FRAME_BUFS;
+
+    int y0 = s * FRAME_STRIP_ROWS;
+    int rows = (DISPLAY_HEIGHT - y0 < FRAME_STRIP_ROWS) ? DISPLAY_HEIGHT - y0 : FRAME_STRIP_ROWS;
+    int64_t start = esp_timer_get_time();
+    raster_strip(wk->buf[b], y0, rows, &wk->lut);
+    wk->raster_us += (uint32_t)(esp_timer_get_time() - start);
+
+    wk->trans[b].length = rows * DISPLAY_WIDTH * 16;
+    return &wk->trans[b];
+}
+
+#if FRAME_WORKERS > 1
+static void render_task(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (int s = 1; s < FRAME_STRIPS; s += 2) {
+            spi_transaction_t *t = strip_render(1, s);
+            xQueueSend(strip_done, &t, portMAX_DELAY);
+        }
+    }
+}
+#endif
+
+static void frame_setup(void) {
+    for (int w = 0; w < FRAME_WORKERS; w++) {
+        frame_worker_t *wk = &workers[w];
+        wk->free = xSemaphoreCreateCounting(FRAME_BUFS, FRAME_BUFS);
+        if (!wk->free) return;
+        for (int b = 0; b < FRAME_BUFS; b++) {
+            wk->buf[b] = strip_buf[w][b];
+            wk->trans[b] = (spi_transaction_t){
+                .tx_buffer = wk->buf[b],
+                .user = wk->free,
+            };
+        }
+    }
+#if FRAME_WORKERS > 1
+    strip_done = xQueueCreate(FRAME_BUFS, sizeof(spi_transaction_t *));
+    if (!strip_done ||
+        xTaskCreatePinnedToCore(render_task, "render", APP_RENDER_TASK_STACK, NULL,
+                                APP_RENDER_TASK_PRIO, &render_task_handle,
+                                APP_RENDER_TASK_CORE) != pdPASS) {
+        ESP_LOGW(TAG, "No render helper, frames use one core");
+        render_cores = 1;
+    }
+#endif
+    diag_stats_register_timer("display.frame", &stat_frame);
+    diag_stats_register_timer("display.raster", &stat_raster);
+    diag_stats_register("display.frame_overflow", &stat_frame_overflow);
+    frame_ready = true;
+}
+
+// Rasterize and send the recorded frame, then go back to direct drawing
+static void frame_flush(void) {
+    int64_t start = esp_timer_get_time();
+    const int cores = render_cores;
+    frame.active = false;
+
+    set_window(0, 0, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1);
+    gpio_set_level(PIN_DC, 1);  // Data mode for all strips
+    for (int w = 0; w < cores; w++) workers[w].raster_us = 0;
+#if FRAME_WORKERS > 1
+    if (cores > 1) xTaskNotifyGive(render_task_handle);
+#endif
+
+    int in_flight = 0;
+    spi_transaction_t *done;
+    for (int s = 0; s < FRAME_STRIPS; s++) {
+        spi_transaction_t *t;
+#if FRAME_WORKERS > 1
+        if (s % cores) {
+            xQueueReceive(strip_done, &t, portMAX_DELAY);
+        } else
+#endif
+        {
+            t = strip_render(0, s);
+        }
+        if (in_flight == FRAME_WORKERS * FRAME_BUFS) {
+            spi_device_get_trans_result(spi_dev, &done, portMAX_DELAY);
+            in_flight--;
+        }
+        diag_counter_add(&stat_spi_bytes, t->length / 8);
+        diag_counter_inc(&stat_spi_transactions);
+        spi_device_queue_trans(spi_dev, t, portMAX_DELAY);
+        in_flight++;
+        while (in_flight && spi_device_get_trans_result(spi_dev, &done, 0) == ESP_OK) {
+            in_flight--;
+        }
+    }
+    // Frame barrier: all strips on the screen, and the helper done with the list
+    while (in_flight) {
+        spi_device_get_trans_result(spi_dev, &done, portMAX_DELAY);
+        in_flight--;
+    }
+
+    for (int w = 0; w < cores; w++) diag_timer_record(&stat_raster, workers[w].raster_us);
+    diag_timer_record(&stat_frame, (uint32_t)(esp_timer_get_time() - start));
+}
+
+// Next free command with room for `extra` text chars or blit pixels; NULL
+// (after sending what was recorded) when the frame is full
+static frame_cmd_t *frame_add(frame_op_t op, int x, int y, int w, int h, size_t extra) {
+    bool room = frame.cmd_count < FRAME_MAX_CMDS;
+    if (op == FRAME_BLIT) {
+        room = room && extra <= (size_t)(FRAME_PIXELS - frame.pixels_used);
+    } else if (op != FRAME_FILL) {
+        room = room && extra <= (size_t)(FRAME_TEXT_SIZE - frame.text_used);
+    }
+    if (!room) {
+        diag_counter_inc(&stat_frame_overflow);
+        frame_flush();
+        return NULL;
+    }
+    frame_cmd_t *c = &frame.cmds[frame.cmd_count++];
+    c->op = op;
+    c->x = x;
+    c->y = y;
+    c->w = w;
+    c->h = h;
+    return c;
+}
+
+// Record a string; false if it has to be drawn directly
+static bool frame_text(int x, int y, const char *str, size_t len, bool large,
+                       uint16_t fg, uint16_t bg) {
+    int cw = large ? 16 : 8;
+    if (len > DISPLAY_WIDTH / 8) len = DISPLAY_WIDTH / 8;   // the rest is off the screen
+    frame_cmd_t *c = frame_add(large ? FRAME_TEXT_LARGE : FRAME_TEXT, x, y,
+                               (int)len * cw, large ? 32 : 16, len);
+    if (!c) return false;
+    c->fg = swap_bytes(fg);
+    c->bg = swap_bytes(bg);
+    c->data = frame.text_used;
+    for (size_t i = 0; i < len; i++) {
+        char ch = str[i];
+        frame.text[frame.text_used++] = (ch < 32 || ch > 126) ? '?' : ch;
+    }
+    return true;
+}
+
+void display_frame_begin(void) {
+    if (!frame_ready) return;
+    frame.cmd_count = 0;
+    frame.text_used = 0;
+    frame.pixels_used = 0;
+    frame.active = true;
+}
+
+void display_frame_end(void) {
+    if (frame.active) frame_flush();
+}
+
+bool display_frame_active(void) {
+    return frame.active;
+}
+
+void display_set_render_cores(int cores) {
+#if FRAME_WORKERS > 1
+    if (!render_task_handle) return;
+#endif
+    render_cores = (cores >= FRAME_WORKERS) ? FRAME_WORKERS : 1;
+}
+
+int display_get_render_cores(void) {
+    return render_cores;
+}
+
 esp_err_t display_init(void) {
     ESP_LOGI(TAG, "Initializing ST7796 display");
+
+    line_pool_free = xSemaphoreCreateCounting(LINE_POOL_SIZE, LINE_POOL_SIZE);
+    if (!line_pool_free) return ESP_ERR_NO_MEM;
     
     // Configure DC pin
     gpio_config_t io_conf = {
@@ -340,8 +846,14 @@ esp_err_t display_init(void) {
         .mode = 0,
         .spics_io_num = PIN_CS,
         .queue_size = 7,
+        .post_cb = frame_strip_sent,
     };
     ESP_ERROR_CHECK(spi_bus_add_device(SPI2_HOST, &devcfg, &spi_dev));
+    diag_stats_register("spi.bytes", &stat_spi_bytes);
+    diag_stats_register("spi.transactions", &stat_spi_transactions);
+    diag_stats_register("display.fill_hits", &stat_fill_hits);
+    diag_stats_register("display.fill_misses", &stat_fill_misses);
+    frame_setup();
     
     // Software reset
     spi_write_cmd(CMD_SWRESET);
@@ -359,6 +871,12 @@ esp_err_t display_init(void) {
     // Pixel format: 16bit/pixel (RGB565)
     spi_write_cmd(CMD_COLMOD);
     spi_write_data_byte(0x55);
+
+    // Scroll area: all 480 panel rows, no fixed areas (display_set_scroll_start)
+    static const uint8_t scroll_area[6] = { 0, 0, DISPLAY_WIDTH >> 8, DISPLAY_WIDTH & 0xFF, 0, 0 };
+    spi_write_cmd(CMD_VSCRDEF);
+    spi_write_data(scroll_area, sizeof(scroll_area));
+    display_set_scroll_start(0);
     
     // Normal display mode
     spi_write_cmd(CMD_NORON);
@@ -384,91 +902,175 @@ void display_fill_rect(int x, int y, int w, int h, uint16_t color) {
     if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT) return;
     if (x + w > DISPLAY_WIDTH) w = DISPLAY_WIDTH - x;
     if (y + h > DISPLAY_HEIGHT) h = DISPLAY_HEIGHT - y;
-    
-    set_window(x, y, x + w - 1, y + h - 1);
-    
-    uint16_t swapped = swap_bytes(color);
-    
-    // Send in chunks
-    #define CHUNK_SIZE 512
-    uint16_t buf[CHUNK_SIZE];
-    for (int i = 0; i < CHUNK_SIZE; i++) {
-        buf[i] = swapped;
+
+    if (frame.active) {
+        frame_cmd_t *c = frame_add(FRAME_FILL, x, y, w, h, 0);
+        if (c) {
+            c->fg = swap_bytes(color);
+            return;
+        }
     }
     
+    set_window(x, y, x + w - 1, y + h - 1);
+
+    // Send in chunks of one pre-filled line
+    const uint16_t *line = fill_line(swap_bytes(color));
     int total_pixels = w * h;
     gpio_set_level(PIN_DC, 1);  // Data mode
     
     while (total_pixels > 0) {
-        int to_send = (total_pixels > CHUNK_SIZE) ? CHUNK_SIZE : total_pixels;
+        int to_send = (total_pixels > LINE_PIXELS) ? LINE_PIXELS : total_pixels;
+        spi_transaction_t t = {
+            .length = to_send * 16,
+            .tx_buffer = line,
+        };
+        spi_tx(&t);
+        total_pixels -= to_send;
+    }
+}
+
+void display_blit(int x, int y, int w, int h, const uint16_t *pixels) {
+    if (x < 0 || y < 0 || w <= 0 || h <= 0) return;
+    if (x + w > DISPLAY_WIDTH || y + h > DISPLAY_HEIGHT) return;
+
+    if (frame.active) {
+        frame_cmd_t *c = frame_add(FRAME_BLIT, x, y, w, h, (size_t)w * h);
+        if (c) {
+            c->data = frame.pixels_used;
+            swap_pixels(&frame.pixels[frame.pixels_used], pixels, w * h);
+            frame.pixels_used += w * h;
+            return;
+        }
+    }
+
+    set_window(x, y, x + w - 1, y + h - 1);
+    gpio_set_level(PIN_DC, 1);  // Data mode
+
+    // Swap into a line buffer in chunks
+    uint16_t *buf = line_acquire();
+    int total_pixels = w * h;
+    while (total_pixels > 0) {
+        int to_send = (total_pixels > LINE_PIXELS) ? LINE_PIXELS : total_pixels;
+        swap_pixels(buf, pixels, to_send);
         spi_transaction_t t = {
             .length = to_send * 16,
             .tx_buffer = buf,
         };
-        spi_device_polling_transmit(spi_dev, &t);
+        spi_tx(&t);
+        pixels += to_send;
         total_pixels -= to_send;
     }
+    line_release(buf);
 }
 
 void display_pixel(int x, int y, uint16_t color) {
     if (x < 0 || x >= DISPLAY_WIDTH || y < 0 || y >= DISPLAY_HEIGHT) return;
+
+    if (frame.active) {
+        frame_cmd_t *c = frame_add(FRAME_FILL, x, y, 1, 1, 0);
+        if (c) {
+            c->fg = swap_bytes(color);
+            return;
+        }
+    }
     
     set_window(x, y, x, y);
-    uint16_t swapped = swap_bytes(color);
     gpio_set_level(PIN_DC, 1);
     spi_transaction_t t = {
+        .flags = SPI_TRANS_USE_TXDATA,
         .length = 16,
-        .tx_buffer = &swapped,
+        .tx_data = { color >> 8, color & 0xFF },
     };
-    spi_device_polling_transmit(spi_dev, &t);
+    spi_tx(&t);
 }
 
-void display_char(int x, int y, char c, uint16_t fg, uint16_t bg) {
+// Glyph colours of the direct primitives (only one task draws at a time)
+static glyph_lut_t direct_lut;
+
+static inline uint8_t glyph_bits(char c, int row) {
     if (c < 32 || c > 126) c = '?';
-    int idx = (c - 32) * 16;
-    
-    uint16_t line_buf[8];
-    
-    for (int row = 0; row < 16; row++) {
-        uint8_t bits = font_8x16[idx + row];
-        for (int col = 0; col < 8; col++) {
-            line_buf[col] = swap_bytes((bits & (0x80 >> col)) ? fg : bg);
+    return font_8x16[(c - 32) * 16 + row];
+}
+
+// One pixel row (glyph row `row`) of a string, w pixels: whole characters
+// through the glyph table, a character cut by the right edge pixel by pixel
+static void text_row(uint16_t *dst, int w, const char *str, int row, bool large) {
+    const int cw = large ? 16 : 8;
+    int x = 0;
+    for (; x + cw <= w; x += cw, str++) {
+        if (large) glyph_row_wide(dst + x, glyph_bits(*str, row), &direct_lut);
+        else glyph_row(dst + x, glyph_bits(*str, row), &direct_lut);
+    }
+    if (x < w) {
+        uint8_t bits = glyph_bits(*str, row);
+        for (int col = 0; x + col < w; col++) {
+            dst[x + col] = (bits & (0x80 >> (col * 8 / cw))) ? direct_lut.fg : direct_lut.bg;
+        }
+    }
+}
+
+// Draw a string as one window, clipped to the screen, in transfers of as
+// many whole rows as fit a line buffer (one row is at most 480 pixels)
+static void text_direct(int x, int y, const char *str, size_t len, bool large,
+                        uint16_t fg, uint16_t bg) {
+    const int scale = large ? 2 : 1;
+    if (x < 0 || y < 0 || x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT || len == 0) return;
+    if (len > DISPLAY_WIDTH / 8) len = DISPLAY_WIDTH / 8;
+    int w = (int)len * 8 * scale;
+    int h = 16 * scale;
+    if (x + w > DISPLAY_WIDTH) w = DISPLAY_WIDTH - x;
+    if (y + h > DISPLAY_HEIGHT) h = DISPLAY_HEIGHT - y;
+    glyph_lut_set(&direct_lut, swap_bytes(fg), swap_bytes(bg));
+
+    set_window(x, y, x + w - 1, y + h - 1);
+    gpio_set_level(PIN_DC, 1);
+    uint16_t *buf = line_acquire();
+    const int chunk_rows = LINE_PIXELS / w;
+    for (int r0 = 0; r0 < h; r0 += chunk_rows) {
+        int rows = (h - r0 < chunk_rows) ? h - r0 : chunk_rows;
+        for (int r = 0; r < rows; r++) {
+            uint16_t *dst = buf + r * w;
+            if (large && ((r0 + r) & 1) && r > 0) {
+                memcpy(dst, dst - w, w * sizeof(uint16_t));     // second row of a 2x row
+            } else {
+                text_row(dst, w, str, (r0 + r) / scale, large);
+            }
         }
-        set_window(x, y + row, x + 7, y + row);
-        gpio_set_level(PIN_DC, 1);
         spi_transaction_t t = {
-            .length = 8 * 16,
-            .tx_buffer = line_buf,
+            .length = rows * w * 16,
+            .tx_buffer = buf,
         };
-        spi_device_polling_transmit(spi_dev, &t);
+        spi_tx(&t);
     }
+    line_release(buf);
+}
+
+void display_char(int x, int y, char c, uint16_t fg, uint16_t bg) {
+    if (c < 32 || c > 126) c = '?';
+    if (frame.active && frame_text(x, y, &c, 1, false, fg, bg)) return;
+    text_direct(x, y, &c, 1, false, fg, bg);
 }
 
 void display_string(int x, int y, const char *str, uint16_t fg, uint16_t bg) {
-    while (*str) {
-        display_char(x, y, *str, fg, bg);
-        x += 8;
-        str++;
-    }
+    DIAG_SCOPE(display_string);
+    size_t len = strlen(str);
+    if (frame.active && frame_text(x, y, str, len, false, fg, bg)) return;
+    text_direct(x, y, str, len, false, fg, bg);
 }
 
 void display_string_large(int x, int y, const char *str, uint16_t fg, uint16_t bg) {
-    while (*str) {
-        char c = *str;
-        if (c < 32 || c > 126) c = '?';
-        int idx = (c - 32) * 16;
-        
-        for (int row = 0; row < 16; row++) {
-            uint8_t bits = font_8x16[idx + row];
-            for (int col = 0; col < 8; col++) {
-                uint16_t color = (bits & (0x80 >> col)) ? fg : bg;
-                // Draw 2x2 pixel block
-                display_fill_rect(x + col * 2, y + row * 2, 2, 2, color);
-            }
-        }
-        x += 16;
-        str++;
-    }
+    DIAG_SCOPE(display_string_large);
+    size_t len = strlen(str);
+    if (frame.active && frame_text(x, y, str, len, true, fg, bg)) return;
+    text_direct(x, y, str, len, true, fg, bg);
+}
+
+void display_set_scroll_start(int x) {
+    x %= DISPLAY_WIDTH;
+    if (x < 0) x += DISPLAY_WIDTH;
+    uint8_t data[2] = { x >> 8, x & 0xFF };
+    spi_write_cmd(CMD_VSCSAD);
+    spi_write_data(data, 2);
 }
 
 void display_set_brightness(int percent) {
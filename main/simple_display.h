@@ -5,6 +5,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "esp_err.h"
 
 // Colors RGB565
@@ -37,6 +38,11 @@ void display_fill(uint16_t color);
  */
 void display_fill_rect(int x, int y, int w, int h, uint16_t color);
 
+/**
+ * @brief Copy a block of RGB565 pixels (row-major, w*h) in one transfer
+ */
+void display_blit(int x, int y, int w, int h, const uint16_t *pixels);
+
 /**
  * @brief Draw a single pixel
  */
@@ -57,6 +63,43 @@ void display_string(int x, int y, const char *str, uint16_t fg, uint16_t bg);
  */
 void display_string_large(int x, int y, const char *str, uint16_t fg, uint16_t bg);
 
+/**
+ * @brief Start recording a full-screen frame
+ * Until display_frame_end() the drawing calls above are recorded instead of
+ * sent. The frame is then rasterized in horizontal strips (by one or two
+ * cores, see display_set_render_cores) and streamed with DMA. Pixels that no
+ * call covers are black, so only use this for redraws of the whole screen.
+ * When the recording space runs out, what was recorded is sent and the rest
+ * of the frame is drawn directly.
+ */
+void display_frame_begin(void);
+
+/**
+ * @brief Send the recorded frame; returns once all of it is on the screen
+ */
+void display_frame_end(void);
+
+/**
+ * @brief True between display_frame_begin() and display_frame_end()
+ */
+bool display_frame_active(void);
+
+/**
+ * @brief Number of cores that rasterize frames (1 or 2; 1 on a unicore build)
+ * Takes effect from the next frame.
+ */
+void display_set_render_cores(int cores);
+int display_get_render_cores(void);
+
+/**
+ * @brief Hardware scroll: show frame memory column x at the left edge
+ * The panel scans its native 480 rows, which are the columns of this
+ * landscape mapping (MADCTL_MV), so the ST7796 "vertical" scroll moves the
+ * picture sideways: screen column p shows memory column (p + x) % 480.
+ * Drawing calls keep addressing frame memory. The other screens expect 0.
+ */
+void display_set_scroll_start(int x);
+
 /**
  * @brief Set backlight brightness (0-100)
  */
@@ -0,0 +1,76 @@
+/**
+ * Timer Wheel - Implementation
+ */
+#include "timer_wheel.h"
+#include <stddef.h>
+
+static void unlink_node(timer_wheel_node_t *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = node->prev = NULL;
+}
+
+void timer_wheel_init(timer_wheel_t *wheel, uint32_t tick_ms, uint64_t now_ms) {
+    wheel->tick_ms = tick_ms ? tick_ms : 1;
+    wheel->now = (uint32_t)(now_ms / wheel->tick_ms);
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        wheel->slots[i].next = &wheel->slots[i];
+        wheel->slots[i].prev = &wheel->slots[i];
+    }
+}
+
+void timer_wheel_node_init(timer_wheel_node_t *node) {
+    node->next = node->prev = NULL;
+    node->expires = 0;
+}
+
+bool timer_wheel_armed(const timer_wheel_node_t *node) {
+    return node->next != NULL;
+}
+
+void timer_wheel_cancel(timer_wheel_node_t *node) {
+    if (timer_wheel_armed(node)) unlink_node(node);
+}
+
+void timer_wheel_arm(timer_wheel_t *wheel, timer_wheel_node_t *node, uint64_t now_ms, uint32_t timeout_ms) {
+    timer_wheel_cancel(node);
+
+    // Round up so a node never fires early; the tick is taken from the 64-bit
+    // time, so it wraps at 2^32 ticks like wheel->now
+    uint32_t expires = (uint32_t)((now_ms + timeout_ms + wheel->tick_ms - 1) / wheel->tick_ms);
+    if ((int32_t)(expires - wheel->now) <= 0) expires = wheel->now + 1;
+    node->expires = expires;
+
+    timer_wheel_node_t *head = &wheel->slots[expires % TIMER_WHEEL_SLOTS];
+    node->next = head;
+    node->prev = head->prev;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+void timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_ms, timer_wheel_cb_t cb, void *ctx) {
+    uint32_t target = (uint32_t)(now_ms / wheel->tick_ms);
+    uint32_t steps = target - wheel->now;
+    if ((int32_t)steps <= 0) return;
+
+    // After a long pause every slot is visited once, comparing against the target tick
+    bool capped = steps > TIMER_WHEEL_SLOTS;
+    if (capped) steps = TIMER_WHEEL_SLOTS;
+
+    for (uint32_t i = 1; i <= steps; i++) {
+        uint32_t tick = wheel->now + i;
+        uint32_t limit = capped ? target : tick;
+        timer_wheel_node_t *head = &wheel->slots[tick % TIMER_WHEEL_SLOTS];
+        timer_wheel_node_t *node = head->next;
+        while (node != head) {
+            timer_wheel_node_t *next = node->next;
+            // Nodes more than one revolution away stay for a later round
+            if ((int32_t)(node->expires - limit) <= 0) {
+                unlink_node(node);
+                if (cb) cb(node, ctx);
+            }
+            node = next;
+        }
+    }
+    wheel->now = target;
+}
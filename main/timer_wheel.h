@@ -0,0 +1,63 @@
+/**
+ * Timer Wheel - O(1) arm/re-arm/cancel timeouts on a hashed wheel
+ * Used as a watchdog: every frame re-arms its device's node, so only
+ * devices that went silent ever reach the expiry callback.
+ *
+ * Times are 64-bit milliseconds (esp_timer based), which never wrap; ticks
+ * are kept in 32 bits and compared modulo 2^32, so they wrap consistently.
+ *
+ * Not thread-safe: callers serialize access.
+ */
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMER_WHEEL_SLOTS 64
+
+typedef struct timer_wheel_node {
+    struct timer_wheel_node *next;
+    struct timer_wheel_node *prev;
+    uint32_t expires;   // absolute tick
+} timer_wheel_node_t;
+
+typedef struct {
+    timer_wheel_node_t slots[TIMER_WHEEL_SLOTS];  // list heads (sentinels)
+    uint32_t tick_ms;
+    uint32_t now;       // last processed tick
+} timer_wheel_t;
+
+typedef void (*timer_wheel_cb_t)(timer_wheel_node_t *node, void *ctx);
+
+/**
+ * @brief Initialize an empty wheel with the given tick resolution
+ */
+void timer_wheel_init(timer_wheel_t *wheel, uint32_t tick_ms, uint64_t now_ms);
+
+/**
+ * @brief Initialize a node (unarmed)
+ */
+void timer_wheel_node_init(timer_wheel_node_t *node);
+
+/**
+ * @brief Arm or re-arm a node to expire timeout_ms after now_ms
+ */
+void timer_wheel_arm(timer_wheel_t *wheel, timer_wheel_node_t *node, uint64_t now_ms, uint32_t timeout_ms);
+
+/**
+ * @brief Disarm a node (no-op if not armed)
+ */
+void timer_wheel_cancel(timer_wheel_node_t *node);
+
+/**
+ * @brief True if the node is waiting to expire
+ */
+bool timer_wheel_armed(const timer_wheel_node_t *node);
+
+/**
+ * @brief Advance to now_ms, calling cb for (and disarming) every expired node
+ */
+void timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_ms, timer_wheel_cb_t cb, void *ctx);
+
+#endif // TIMER_WHEEL_H
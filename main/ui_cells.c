@@ -0,0 +1,394 @@
+/**
+ * UI Cells - Implementation of the per-device widgets
+ */
+#include <stdio.h>
+#include <string.h>
+#include "ui_cells.h"
+#include "ui_bars.h"
+#include "simple_display.h"
+#include "victron_records.h"
+
+static const int pad = 8;
+
+const char *ui_state_string(uint8_t state) {
+    switch (state) {
+        case VIC_STATE_OFF: return "OFF";
+        case VIC_STATE_LOW_POWER: return "LOW PWR";
+        case VIC_STATE_FAULT: return "FAULT";
+        case VIC_STATE_BULK: return "BULK";
+        case VIC_STATE_ABSORPTION: return "ABSORB";
+        case VIC_STATE_FLOAT: return "FLOAT";
+        case VIC_STATE_STORAGE: return "STORAGE";
+        case VIC_STATE_EQUALIZE: return "EQUAL";
+        case VIC_STATE_POWER_SUPPLY: return "PSU";
+        default: return "---";
+    }
+}
+
+// Returns true (and remembers the value) if the field differs from what was drawn
+static bool changed(ui_cell_t *cell, int field, float value) {
+    if (cell->prev[field] == value) return false;
+    cell->prev[field] = value;
+    return true;
+}
+
+void ui_cell_bind(ui_cell_t *cell, const ui_rect_t *rect, const device_entry_t *dev) {
+    cell->rect = *rect;
+    cell->dev = dev;
+    cell->drawn = false;
+    cell->prev_status[0] = '\0';
+    for (int i = 0; i < UI_CELL_FIELDS; i++) {
+        cell->prev[i] = -999;
+    }
+
+    // Sparkline for the first MPPT (total PV) and the first SmartShunt (current)
+    cell->has_spark = false;
+    if (!dev || dev->role_index != 0 || rect->h < UI_CELL_SPARK_MIN_H) return;
+
+    ui_rect_t r = { rect->x + pad, rect->y + UI_CELL_SPARK_TOP,
+                    rect->w - pad * 2, rect->h - UI_CELL_SPARK_TOP - pad };
+    if (dev->role == VICTRON_DEVICE_MPPT) {
+        ui_chart_init(&cell->spark, &r, HISTORY_PV_POWER, HISTORY_TIER_1S, r.w, 0, 450);
+        cell->has_spark = true;
+    } else if (dev->role == VICTRON_DEVICE_SMARTSHUNT) {
+        ui_chart_init(&cell->spark, &r, HISTORY_SHUNT_CURRENT, HISTORY_TIER_1S, r.w, -10000, 5000);
+        cell->has_spark = true;
+    }
+}
+
+static void draw_header(ui_cell_t *cell) {
+    const device_entry_t *dev = cell->dev;
+    const int x = cell->rect.x;
+    const int y = cell->rect.y;
+    char buf[32];
+
+    if (device_table_count_role(dev->role) > 1) {
+        snprintf(buf, sizeof(buf), "%s %d", device_role_name(dev->role), dev->role_index + 1);
+    } else {
+        snprintf(buf, sizeof(buf), "%s", device_role_name(dev->role));
+    }
+    display_string(x + pad, y + pad, buf, COLOR_YELLOW, COLOR_BLACK);
+}
+
+// Status indicator text: "(--)" without data, blank while fresh, age once stale
+static uint16_t status_text(const device_entry_t *dev, char *buf, size_t len) {
+    if (!dev->has_data) {
+        snprintf(buf, len, "(--)");
+        return COLOR_RED;
+    }
+    if (!dev->stale) {
+        snprintf(buf, len, "    ");
+        return COLOR_BLACK;
+    }
+
+    unsigned long age_s = device_table_age_ms(dev) / 1000;
+    if (age_s < 60) {
+        snprintf(buf, len, "%2lus ", age_s);
+    } else if (age_s < 60 * 100) {
+        snprintf(buf, len, "%2lum ", age_s / 60);
+    } else if (age_s < 3600 * 100) {
+        snprintf(buf, len, "%2luh ", age_s / 3600);
+    } else {
+        snprintf(buf, len, " old");
+    }
+    return COLOR_ORANGE;
+}
+
+// === MPPT SOLAR CHARGER ===
+enum { F_PV, F_SOLAR_STATE, F_SOLAR_CURRENT, F_SOLAR_VOLTAGE, F_YIELD, F_TOTAL_PV, F_TOTAL_YIELD };
+_Static_assert(F_TOTAL_YIELD < UI_CELL_FIELDS, "MPPT fields exceed ui_cell_t.prev");
+
+static void draw_mppt(ui_cell_t *cell, char *buf, size_t len) {
+    const device_entry_t *dev = cell->dev;
+    const bool has = dev->has_data;
+    const victron_record_solar_charger_t *r = &dev->data.record.solar;
+    const int x = cell->rect.x;
+    const int inner_w = cell->rect.w - pad * 2;
+    const int bar_w = inner_w - 4;
+    int y = cell->rect.y + pad + 18;
+
+    int pv_power = has ? r->pv_power_w : 0;
+    uint8_t state = has ? r->device_state : VIC_STATE_OFF;
+    float voltage = has ? r->battery_voltage_centi / 100.0f : 0.0f;
+    float current = has ? r->battery_current_deci / 10.0f : 0.0f;
+    float yield = has ? r->yield_today_centikwh / 100.0f : 0.0f;
+
+    // PV Power - only update if changed
+    if (changed(cell, F_PV, pv_power)) {
+        snprintf(buf, len, "%4dW", pv_power);
+        display_string_large(x + pad, y, buf, COLOR_GREEN, COLOR_BLACK);
+        draw_mppt_power_bar(x + pad, y + 34, bar_w, pv_power);
+    }
+
+    // State - only update if changed
+    if (changed(cell, F_SOLAR_STATE, state)) {
+        snprintf(buf, len, "%-8s", ui_state_string(state));
+        display_string(x + pad + inner_w - 70, y + 8, buf, COLOR_WHITE, COLOR_BLACK);
+    }
+    y += 34 + 14;
+
+    // Battery Current - only update if changed
+    if (changed(cell, F_SOLAR_CURRENT, current)) {
+        snprintf(buf, len, "%.1fA ", current);
+        display_string_large(x + pad, y, buf, COLOR_CYAN, COLOR_BLACK);
+    }
+
+    // Battery Voltage - only update if changed
+    if (changed(cell, F_SOLAR_VOLTAGE, voltage)) {
+        snprintf(buf, len, "%.2fV", voltage);
+        display_string(x + pad + inner_w - 70, y + 8, buf, COLOR_WHITE, COLOR_BLACK);
+    }
+    y += 34;
+
+    // Yield Today - only update if changed
+    if (changed(cell, F_YIELD, yield)) {
+        snprintf(buf, len, "Today: %.2f kWh    ", yield);
+        display_string(x + pad, y, buf, COLOR_WHITE, COLOR_BLACK);
+    }
+    y += 18;
+
+    // Sum over all MPPTs, shown once (first MPPT) when there is more than one
+    const device_totals_t *totals = device_table_totals();
+    if (dev->role_index == 0 && device_table_count_role(VICTRON_DEVICE_MPPT) > 1) {
+        // Both fields are evaluated so each keeps its last drawn value
+        bool pv_changed = changed(cell, F_TOTAL_PV, totals->pv_power_w);
+        bool yield_changed = changed(cell, F_TOTAL_YIELD, totals->yield_today_centikwh);
+        if (pv_changed || yield_changed) {
+            snprintf(buf, len, "All PV: %ldW %.2fkWh   ",
+                     (long)totals->pv_power_w, totals->yield_today_centikwh / 100.0f);
+            display_string(x + pad, y, buf, COLOR_GREEN, COLOR_BLACK);
+        }
+    }
+}
+
+// === SMARTSHUNT ===
+enum { F_SOC, F_SHUNT_VOLTAGE, F_SHUNT_CURRENT, F_TTG, F_CONSUMED };
+
+static void draw_smartshunt(ui_cell_t *cell, char *buf, size_t len) {
+    const device_entry_t *dev = cell->dev;
+    const bool has = dev->has_data;
+    const victron_record_battery_monitor_t *r = &dev->data.record.battery;
+    const int x = cell->rect.x;
+    const int inner_w = cell->rect.w - pad * 2;
+    const int bar_w = inner_w - 4;
+    int y = cell->rect.y + pad + 18;
+
+    float soc = has ? r->soc_deci_percent / 10.0f : 0.0f;
+    float voltage = has ? r->battery_voltage_centi / 100.0f : 0.0f;
+    float curr = has ? r->battery_current_milli / 1000.0f : 0.0f;
+    uint16_t ttg = has ? r->time_to_go_minutes : 0;
+    float consumed = has ? r->consumed_ah_deci / -10.0f : 0.0f;
+
+    // SOC - only update if changed
+    if (changed(cell, F_SOC, soc)) {
+        snprintf(buf, len, "%.0f%% ", soc);
+        uint16_t soc_color = get_soc_color(soc);
+        display_string_large(x + pad, y, buf, has ? soc_color : COLOR_WHITE, COLOR_BLACK);
+        draw_smartshunt_soc_bar(x + pad, y + 34, bar_w, has ? soc : 0.0f);
+    }
+
+    // Voltage - only update if changed
+    if (changed(cell, F_SHUNT_VOLTAGE, voltage)) {
+        snprintf(buf, len, "%.2fV ", voltage);
+        display_string(x + pad + inner_w - 70, y + 8, buf, COLOR_CYAN, COLOR_BLACK);
+    }
+    y += 34 + 14;
+
+    // Current - only update if changed
+    if (changed(cell, F_SHUNT_CURRENT, curr)) {
+        snprintf(buf, len, "%+.2fA   ", curr);
+        uint16_t curr_color = get_current_color(curr);
+        display_string_large(x + pad, y, buf, has ? curr_color : COLOR_WHITE, COLOR_BLACK);
+        draw_smartshunt_current_bar(x + pad, y + 34, bar_w, has ? curr : 0.0f);
+    }
+
+    // TTG - only update if changed
+    if (changed(cell, F_TTG, ttg)) {
+        if (ttg != 0xFFFF && ttg > 0) {
+            snprintf(buf, len, "TTG:%dh%02dm ", ttg / 60, ttg % 60);
+        } else {
+            snprintf(buf, len, "TTG:---    ");
+        }
+        display_string(x + pad + inner_w - 90, y + 8, buf, COLOR_WHITE, COLOR_BLACK);
+    }
+    y += 34 + 14;
+
+    // Consumed - only update if changed
+    if (changed(cell, F_CONSUMED, consumed)) {
+        snprintf(buf, len, "Used: %.1fAh         ", consumed);
+        display_string(x + pad, y, buf, COLOR_WHITE, COLOR_BLACK);
+    }
+}
+
+// === BATTERY SENSE ===
+enum { F_BAT_TEMP, F_BAT_VOLTAGE, F_BAT_STATUS };
+
+static void draw_battery_sense(ui_cell_t *cell, char *buf, size_t len) {
+    const device_entry_t *dev = cell->dev;
+    const bool has = dev->has_data;
+    const victron_record_battery_monitor_t *r = &dev->data.record.battery;
+    const int x = cell->rect.x;
+    const int bar_w = cell->rect.w - pad * 2 - 4;
+    int y = cell->rect.y + pad + 18;
+
+    float voltage = has ? r->battery_voltage_centi / 100.0f : 0.0f;
+    float temp_k = has ? r->aux_value / 100.0f : 273.15f;
+    float temp_c = temp_k - 273.15f;
+
+    bool temp_valid = has && (r->aux_input == 2);
+    if (!temp_valid && has) {
+        temp_c = 0.0f;
+    }
+
+    // TEMPERATURE - only update if changed
+    if (changed(cell, F_BAT_TEMP, temp_c)) {
+        snprintf(buf, len, "%.1f C ", temp_c);
+        uint16_t temp_color = get_battery_temp_color(temp_c);
+        uint16_t temp_fg = has ? temp_color : COLOR_WHITE;
+        display_string_large(x + pad, y, buf, temp_fg, COLOR_BLACK);
+        display_string(x + pad + 110, y, "o", temp_fg, COLOR_BLACK);
+        draw_battery_temp_bar(x + pad, y + 34, bar_w, has ? temp_c : 0.0f);
+    }
+    y += 34 + 14;
+
+    // VOLTAGE - only update if changed
+    if (changed(cell, F_BAT_VOLTAGE, voltage)) {
+        snprintf(buf, len, "%.2fV     ", voltage);
+        display_string_large(x + pad, y, buf, COLOR_CYAN, COLOR_BLACK);
+    }
+    y += 34;
+
+    // Status line - update only on data status change
+    if (changed(cell, F_BAT_STATUS, has)) {
+        if (has) {
+            display_string(x + pad, y, "Battery OK              ", COLOR_GREEN, COLOR_BLACK);
+        } else {
+            display_string(x + pad, y, "No data                 ", COLOR_ORANGE, COLOR_BLACK);
+        }
+    }
+}
+
+// === AC CHARGER ===
+enum { F_CHG_STATE, F_CHG_VOLTAGE, F_CHG_CURRENT, F_CHG_STATUS };
+
+static void draw_ac_charger(ui_cell_t *cell, char *buf, size_t len) {
+    const device_entry_t *dev = cell->dev;
+    const int x = cell->rect.x;
+    int y = cell->rect.y + pad + 18;
+
+    if (!dev->has_data) {
+        if (changed(cell, F_CHG_STATUS, 0)) {
+            display_string(x + pad, y, "Waiting for", COLOR_ORANGE, COLOR_BLACK);
+            display_string(x + pad, y + 18, "AC Charger BLE...", COLOR_ORANGE, COLOR_BLACK);
+        }
+        return;
+    }
+
+    const victron_record_ac_charger_t *r = &dev->data.record.ac_charger;
+    uint8_t state = r->device_state;
+    float voltage = r->battery_voltage_1_centi / 100.0f;
+    float current = r->battery_current_1_deci / 10.0f;
+
+    // State - only update if changed
+    if (changed(cell, F_CHG_STATE, state)) {
+        snprintf(buf, len, "%-8s", ui_state_string(state));
+        display_string_large(x + pad, y, buf, COLOR_CYAN, COLOR_BLACK);
+    }
+    y += 34;
+
+    // Voltage - only update if changed
+    if (changed(cell, F_CHG_VOLTAGE, voltage)) {
+        snprintf(buf, len, "%.2fV     ", voltage);
+        display_string_large(x + pad, y, buf, COLOR_GREEN, COLOR_BLACK);
+    }
+    y += 34;
+
+    // Current - only update if changed
+    if (changed(cell, F_CHG_CURRENT, current)) {
+        snprintf(buf, len, "%.1fA      ", current);
+        display_string_large(x + pad, y, buf, COLOR_YELLOW, COLOR_BLACK);
+    }
+    y += 34;
+
+    // Status line
+    if (changed(cell, F_CHG_STATUS, 1)) {
+        display_string(x + pad, y, "Charging OK         ", COLOR_GREEN, COLOR_BLACK);
+    }
+}
+
+// === DC-DC CHARGER (Orion Smart) ===
+enum { F_DCDC_STATE, F_DCDC_IN, F_DCDC_OUT, F_DCDC_ERROR };
+
+static void draw_dcdc(ui_cell_t *cell, char *buf, size_t len) {
+    const device_entry_t *dev = cell->dev;
+    const bool has = dev->has_data;
+    const victron_record_dcdc_converter_t *r = &dev->data.record.dcdc;
+    const int x = cell->rect.x;
+    int y = cell->rect.y + pad + 18;
+
+    uint8_t state = has ? r->device_state : VIC_STATE_OFF;
+    float in_v = has ? r->input_voltage_centi / 100.0f : 0.0f;
+    float out_v = has ? r->output_voltage_centi / 100.0f : 0.0f;
+    uint8_t error = has ? r->charger_error : VIC_ERR_NONE;
+
+    if (changed(cell, F_DCDC_STATE, state)) {
+        snprintf(buf, len, "%-8s", ui_state_string(state));
+        display_string_large(x + pad, y, buf, COLOR_CYAN, COLOR_BLACK);
+    }
+    y += 34;
+
+    if (changed(cell, F_DCDC_OUT, out_v)) {
+        snprintf(buf, len, "%.2fV     ", out_v);
+        display_string_large(x + pad, y, buf, COLOR_GREEN, COLOR_BLACK);
+    }
+    y += 34;
+
+    if (changed(cell, F_DCDC_IN, in_v)) {
+        snprintf(buf, len, "In: %.2fV     ", in_v);
+        display_string(x + pad, y, buf, COLOR_WHITE, COLOR_BLACK);
+    }
+    y += 18;
+
+    if (changed(cell, F_DCDC_ERROR, error)) {
+        if (error == VIC_ERR_NONE) {
+            display_string(x + pad, y, "No error            ", COLOR_GREEN, COLOR_BLACK);
+        } else {
+            snprintf(buf, len, "Error %u             ", (unsigned)error);
+            display_string(x + pad, y, buf, COLOR_RED, COLOR_BLACK);
+        }
+    }
+}
+
+void ui_cell_draw(ui_cell_t *cell) {
+    char buf[64];
+
+    if (!cell->dev) return;
+
+    // First time - draw static header once
+    if (!cell->drawn) {
+        draw_header(cell);
+        cell->drawn = true;
+    }
+
+    // Only update status indicator if changed (no data / fresh / stale age)
+    char status[8];
+    uint16_t status_color = status_text(cell->dev, status, sizeof(status));
+    if (strcmp(status, cell->prev_status) != 0) {
+        display_string(cell->rect.x + cell->rect.w - pad - 32, cell->rect.y + pad,
+                       status, status_color, COLOR_BLACK);
+        strcpy(cell->prev_status, status);
+    }
+
+    switch (cell->dev->role) {
+        case VICTRON_DEVICE_MPPT: draw_mppt(cell, buf, sizeof(buf)); break;
+        case VICTRON_DEVICE_SMARTSHUNT: draw_smartshunt(cell, buf, sizeof(buf)); break;
+        case VICTRON_DEVICE_BATTERY_SENSE: draw_battery_sense(cell, buf, sizeof(buf)); break;
+        case VICTRON_DEVICE_AC_CHARGER: draw_ac_charger(cell, buf, sizeof(buf)); break;
+        case VICTRON_DEVICE_DCDC_CHARGER: draw_dcdc(cell, buf, sizeof(buf)); break;
+        default: break;
+    }
+
+    if (cell->has_spark) {
+        ui_chart_draw(&cell->spark);
+    }
+}
@@ -0,0 +1,44 @@
+/**
+ * UI Cells - Per-device widgets drawn inside a layout cell
+ * Each cell caches the values it last drew and only redraws what changed.
+ */
+#ifndef UI_CELLS_H
+#define UI_CELLS_H
+
+#include <stdbool.h>
+#include "ui_layout.h"
+#include "device_table.h"
+#include "ui_charts.h"
+
+#define UI_CELL_FIELDS 8
+
+// Cells at least this tall (1-2 devices) get a live sparkline below the values
+#define UI_CELL_SPARK_MIN_H 240
+#define UI_CELL_SPARK_TOP   160   // offset of the sparkline from the cell top
+
+typedef struct {
+    ui_rect_t             rect;
+    const device_entry_t *dev;            // NULL for an empty cell
+    bool                  drawn;          // header drawn
+    char                  prev_status[8]; // status indicator text last drawn
+    float                 prev[UI_CELL_FIELDS];
+    bool                  has_spark;
+    ui_chart_t            spark;          // 1 s history of the cell's main metric
+} ui_cell_t;
+
+/**
+ * @brief Attach a device to a cell and invalidate its cache
+ */
+void ui_cell_bind(ui_cell_t *cell, const ui_rect_t *rect, const device_entry_t *dev);
+
+/**
+ * @brief Draw the cell, updating only values that changed since the last call
+ */
+void ui_cell_draw(ui_cell_t *cell);
+
+/**
+ * @brief Short device state string ("BULK", "FLOAT", ...)
+ */
+const char *ui_state_string(uint8_t state);
+
+#endif // UI_CELLS_H
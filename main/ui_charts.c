@@ -0,0 +1,179 @@
+/**
+ * UI Charts - Implementation
+ */
+#include <string.h>
+#include "ui_charts.h"
+#include "ui_bars.h"
+#include "simple_display.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "UI_CHARTS";
+
+// One column block (col_w x h), row-major, sent with a single blit
+static uint16_t col_buf[UI_CHART_MAX_COL_W * UI_CHART_MAX_H];
+// Samples fetched for a full redraw (display task only)
+static int32_t sample_buf[UI_CHART_MAX_SAMPLES];
+
+static ui_chart_timing_t timing;
+
+// More new samples than this since the last draw → full redraw instead
+#define CHART_MAX_CATCHUP 8
+
+// Same color zones as the bars
+static uint16_t metric_color(history_metric_t metric, int32_t value) {
+    switch (metric) {
+        case HISTORY_PV_POWER: return get_mppt_color(value);
+        case HISTORY_SOC: return get_soc_color(value / 10.0f);
+        case HISTORY_SHUNT_CURRENT: return get_current_color(value / 100.0f);
+        default: return COLOR_CYAN;
+    }
+}
+
+// Plot row (0 = top) of a value, clamped to the chart range
+static int value_row(const ui_chart_t *c, int32_t value) {
+    if (value < c->min) value = c->min;
+    if (value > c->max) value = c->max;
+    int h = c->rect.h;
+    int level = (int)((int64_t)(value - c->min) * (h - 1) / (c->max - c->min));
+    return h - 1 - level;
+}
+
+// Leave a 1 px gap between wide columns so they read as bars
+static int bar_width(const ui_chart_t *c) {
+    return (c->col_w >= 3) ? c->col_w - 1 : c->col_w;
+}
+
+// Rows [*top, *bottom] of a sample's bar and its color. Bars grow from zero
+// (or from the bottom when the range is all positive); a missing sample is
+// an axis-colored dot on the base row.
+static uint16_t column_bar(const ui_chart_t *c, int32_t value, int *top, int *bottom) {
+    int base = value_row(c, (c->min < 0) ? 0 : c->min);
+    *top = *bottom = base;
+    if (value == HISTORY_NO_VALUE) return UI_CHART_AXIS_COLOR;
+
+    int row = value_row(c, value);
+    *top = (row < base) ? row : base;
+    *bottom = (row < base) ? base : row;
+    return metric_color(c->metric, value);
+}
+
+static void draw_column(const ui_chart_t *c, int col, int32_t value) {
+    const int w = c->col_w;
+    const int h = c->rect.h;
+    const int bar_w = bar_width(c);
+    const int base = value_row(c, (c->min < 0) ? 0 : c->min);
+    int top, bottom;
+    uint16_t color = column_bar(c, value, &top, &bottom);
+
+    for (int y = 0; y < h; y++) {
+        uint16_t px = COLOR_BLACK;
+        if (y >= top && y <= bottom) {
+            px = color;
+        } else if (y == base && c->min < 0) {
+            px = UI_CHART_AXIS_COLOR;   // zero line
+        }
+        uint16_t *row = &col_buf[y * w];
+        for (int x = 0; x < w; x++) {
+            row[x] = (x < bar_w) ? px : COLOR_BLACK;
+        }
+    }
+    display_blit(c->rect.x + col * w, c->rect.y, w, h, col_buf);
+}
+
+// Thin marker at the start of the column that will be overwritten next
+static void draw_cursor(const ui_chart_t *c) {
+    display_fill_rect(c->rect.x + c->cursor * c->col_w, c->rect.y, 1, c->rect.h,
+                      UI_CHART_CURSOR_COLOR);
+}
+
+void ui_chart_init(ui_chart_t *chart, const ui_rect_t *rect, history_metric_t metric,
+                   history_tier_t tier, uint16_t samples, int32_t min, int32_t max) {
+    memset(chart, 0, sizeof(*chart));
+    chart->rect = *rect;
+    if (chart->rect.h > UI_CHART_MAX_H) chart->rect.h = UI_CHART_MAX_H;
+    chart->metric = metric;
+    chart->tier = tier;
+    chart->min = min;
+    chart->max = (max > min) ? max : min + 1;
+
+    if (samples < 1) samples = 1;
+    if (samples > UI_CHART_MAX_SAMPLES) samples = UI_CHART_MAX_SAMPLES;
+    int col_w = rect->w / samples;
+    if (col_w < 1) {
+        col_w = 1;
+        samples = (uint16_t)rect->w;   // fewer samples than requested fit
+    }
+    if (col_w > UI_CHART_MAX_COL_W) col_w = UI_CHART_MAX_COL_W;
+    chart->samples = samples;
+    chart->col_w = (uint8_t)col_w;
+}
+
+void ui_chart_invalidate(ui_chart_t *chart) {
+    chart->drawn = false;
+}
+
+static int draw_full(ui_chart_t *c) {
+    size_t n = history_last_n(c->metric, c->tier, sample_buf, c->samples);
+
+    // Oldest on the left; the sweep continues right after the newest sample.
+    // A recorded frame stores every blit's pixels, so there the plot is
+    // cleared once and each sample is one bar.
+    if (display_frame_active()) {
+        display_fill_rect(c->rect.x, c->rect.y, c->samples * c->col_w, c->rect.h, COLOR_BLACK);
+        for (size_t i = 0; i < n; i++) {
+            int top, bottom;
+            uint16_t color = column_bar(c, sample_buf[i], &top, &bottom);
+            display_fill_rect(c->rect.x + (int)i * c->col_w, c->rect.y + top,
+                              bar_width(c), bottom - top + 1, color);
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            draw_column(c, (int)i, sample_buf[i]);
+        }
+    }
+    if (n < c->samples) {
+        display_fill_rect(c->rect.x + (int)n * c->col_w, c->rect.y,
+                          (c->samples - (int)n) * c->col_w, c->rect.h, COLOR_BLACK);
+    }
+    c->cursor = (uint16_t)(n % c->samples);
+    draw_cursor(c);
+    return (int)n;
+}
+
+int ui_chart_draw(ui_chart_t *chart) {
+    uint32_t count = history_sample_count(chart->metric, chart->tier);
+    uint32_t fresh = count - chart->seen;
+
+    if (!chart->drawn || fresh > CHART_MAX_CATCHUP || fresh > chart->samples) {
+        chart->seen = count;
+        chart->drawn = true;
+        return draw_full(chart);
+    }
+    if (fresh == 0) return 0;
+
+    int64_t start = esp_timer_get_time();
+
+    int32_t values[CHART_MAX_CATCHUP];
+    size_t n = history_last_n(chart->metric, chart->tier, values, fresh);
+    for (size_t i = 0; i < n; i++) {
+        draw_column(chart, chart->cursor, values[i]);
+        chart->cursor = (uint16_t)((chart->cursor + 1) % chart->samples);
+    }
+    draw_cursor(chart);
+    chart->seen = count;
+
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start) / (n ? n : 1);
+    timing.last_us = us;
+    timing.avg_us = timing.samples ? timing.avg_us + ((int32_t)(us - timing.avg_us) / 8) : us;
+    if (us > timing.max_us) timing.max_us = us;
+    timing.samples++;
+    ESP_LOGD(TAG, "metric %d: %u column(s), %lu us/sample", chart->metric, (unsigned)n,
+             (unsigned long)us);
+
+    return (int)n;
+}
+
+const ui_chart_timing_t *ui_chart_timing(void) {
+    return &timing;
+}
@@ -0,0 +1,67 @@
+/**
+ * UI Charts - Sparkline / mini-chart widgets backed by the history store
+ * Sweep ("oscilloscope") rendering: each new sample is drawn as one column
+ * blit at the cursor, which then advances and wraps. The rest of the plot is
+ * never redrawn, so the cost per sample is one small SPI transfer.
+ *
+ * Not thread-safe: callers hold the UI data mutex (history is read).
+ */
+#ifndef UI_CHARTS_H
+#define UI_CHARTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ui_layout.h"
+#include "history.h"
+
+#define UI_CHART_MAX_H        120   // plot height limit (column buffer size)
+#define UI_CHART_MAX_COL_W    8     // pixels per sample limit
+#define UI_CHART_MAX_SAMPLES  480   // one column per pixel across the display
+
+#define UI_CHART_CURSOR_COLOR 0x528A   // sweep cursor
+#define UI_CHART_AXIS_COLOR   0x2945   // zero line / gap dots
+
+typedef struct {
+    ui_rect_t        rect;       // plot area
+    history_metric_t metric;
+    history_tier_t   tier;
+    int32_t          min, max;   // value range mapped to the plot height
+    uint16_t         samples;    // columns across the plot
+    uint8_t          col_w;      // pixels per column
+    uint16_t         cursor;     // column the next sample is drawn into
+    uint32_t         seen;       // history_sample_count() at the last draw
+    bool             drawn;
+} ui_chart_t;
+
+// Render cost of incremental updates (one new sample = one column)
+typedef struct {
+    uint32_t last_us;
+    uint32_t avg_us;     // moving average, 1/8 weight per sample
+    uint32_t max_us;
+    uint32_t samples;
+} ui_chart_timing_t;
+
+/**
+ * @brief Configure a chart showing the newest `samples` samples of a tier
+ * Column width is rect->w / samples (clamped to 1..UI_CHART_MAX_COL_W).
+ */
+void ui_chart_init(ui_chart_t *chart, const ui_rect_t *rect, history_metric_t metric,
+                   history_tier_t tier, uint16_t samples, int32_t min, int32_t max);
+
+/**
+ * @brief Force a full redraw on the next ui_chart_draw()
+ */
+void ui_chart_invalidate(ui_chart_t *chart);
+
+/**
+ * @brief Draw the chart: full plot the first time, afterwards only new samples
+ * @return number of columns drawn
+ */
+int ui_chart_draw(ui_chart_t *chart);
+
+/**
+ * @brief Render timing of incremental updates across all charts
+ */
+const ui_chart_timing_t *ui_chart_timing(void);
+
+#endif // UI_CHARTS_H
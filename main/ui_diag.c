@@ -0,0 +1,71 @@
+/**
+ * UI Diag - Implementation
+ */
+#include <stdio.h>
+#include <string.h>
+#include "ui_diag.h"
+#include "simple_display.h"
+#include "victron_ble.h"
+#include "esp_timer.h"
+
+#define DIAG_ROWS      8     // devices per screen (2 text lines each)
+#define DIAG_ROW_H     36
+#define DIAG_TOP       28
+#define DIAG_COLS      60    // 8x16 font on 480 px
+
+// Last drawn text per row, so unchanged rows are not resent over SPI
+static char prev_line1[DIAG_ROWS][DIAG_COLS + 1];
+static char prev_line2[DIAG_ROWS][DIAG_COLS + 1];
+
+static void draw_line(int x, int y, char *prev, const char *text, uint16_t fg) {
+    char buf[DIAG_COLS + 1];
+    // Pad to full width so shorter text erases the previous one
+    snprintf(buf, sizeof(buf), "%-*s", DIAG_COLS - x / 8, text);
+    if (strcmp(buf, prev) == 0) return;
+    display_string(x, y, buf, fg, COLOR_BLACK);
+    strcpy(prev, buf);
+}
+
+void ui_diag_draw(bool full) {
+    if (full) {
+        display_fill(COLOR_BLACK);
+        display_string(8, 6, "BLE DEVICES (last seen)", COLOR_YELLOW, COLOR_BLACK);
+        display_fill_rect(0, DIAG_TOP - 4, DISPLAY_WIDTH, 2, 0x528A);
+        memset(prev_line1, 0, sizeof(prev_line1));
+        memset(prev_line2, 0, sizeof(prev_line2));
+    }
+
+    victron_seen_device_t seen[DIAG_ROWS];
+    size_t n = victron_ble_get_seen(seen, DIAG_ROWS);
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+
+    char buf[80];
+    for (int i = 0; i < DIAG_ROWS; i++) {
+        int y = DIAG_TOP + i * DIAG_ROW_H;
+        if ((size_t)i >= n) {
+            draw_line(8, y, prev_line1[i], "", COLOR_WHITE);
+            draw_line(24, y + 17, prev_line2[i], "", COLOR_WHITE);
+            continue;
+        }
+
+        const victron_seen_device_t *d = &seen[i];
+        unsigned long age_s = (now - d->last_seen_ms) / 1000;
+        const char *status;
+        uint16_t color;
+        switch (d->key_status) {
+            case VICTRON_KEY_OK:       status = "OK";      color = COLOR_GREEN;  break;
+            case VICTRON_KEY_MISMATCH: status = "BAD KEY"; color = COLOR_RED;    break;
+            default:                   status = "NO KEY";  color = COLOR_ORANGE; break;
+        }
+        snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X %4ddBm %4lus %s",
+                 d->mac[5], d->mac[4], d->mac[3], d->mac[2], d->mac[1], d->mac[0],
+                 d->rssi, age_s, status);
+        draw_line(8, y, prev_line1[i], buf, color);
+
+        const char *product = d->product_name;
+        snprintf(buf, sizeof(buf), "%.26s / %s (%lu)",
+                 product ? product : "Unknown product",
+                 victron_record_type_name(d->record_type), (unsigned long)d->count);
+        draw_line(24, y + 17, prev_line2[i], buf, 0x8410);
+    }
+}
@@ -0,0 +1,19 @@
+/**
+ * UI Diag - Diagnostic screen listing recently seen Victron advertisers
+ * Reads the BLE layer's lock-free "last seen" ring; unknown devices are
+ * highlighted so their MAC can be copied into the key table, and devices
+ * whose advertised key check byte does not match the configured key are
+ * flagged BAD KEY.
+ */
+#ifndef UI_DIAG_H
+#define UI_DIAG_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Draw the device list
+ * @param full Clear the screen and draw static parts (on screen switch)
+ */
+void ui_diag_draw(bool full);
+
+#endif // UI_DIAG_H
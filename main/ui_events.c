@@ -0,0 +1,82 @@
+/**
+ * UI Events - Implementation
+ */
+#include <stdio.h>
+#include "ui_events.h"
+#include "event_log.h"
+#include "simple_display.h"
+
+#define EVENTS_COL_W    160                             // separator + 19 characters
+#define EVENTS_COLS     (DISPLAY_WIDTH / EVENTS_COL_W)  // all of the scroll area
+#define EVENTS_SLOT_H   40                              // two text lines + gap
+#define EVENTS_SLOTS    (DISPLAY_HEIGHT / EVENTS_SLOT_H)
+#define EVENTS_CHARS    19
+#define EVENTS_SEPARATOR_COLOR 0x528A
+
+_Static_assert(EVENT_LOG_SIZE >= EVENTS_COLS * EVENTS_SLOTS, "the ring must cover the visible columns");
+
+static uint32_t drawn;          // events on the screen (seq of the next one)
+static uint32_t newest_column;  // rightmost column on the screen
+
+// Event seq goes to slot seq % EVENTS_SLOTS of column seq / EVENTS_SLOTS,
+// which lives at a fixed place in frame memory
+static int column_x(uint32_t column) {
+    return (int)(column % EVENTS_COLS) * EVENTS_COL_W;
+}
+
+// Scroll so that `newest` is the rightmost column
+static void scroll_to(uint32_t newest) {
+    uint32_t first = (newest >= EVENTS_COLS) ? newest - (EVENTS_COLS - 1) : 0;
+    display_set_scroll_start(column_x(first));
+}
+
+static void clear_column(uint32_t column) {
+    int x = column_x(column);
+    display_fill_rect(x, 0, 1, DISPLAY_HEIGHT, EVENTS_SEPARATOR_COLOR);
+    display_fill_rect(x + 1, 0, EVENTS_COL_W - 1, DISPLAY_HEIGHT, COLOR_BLACK);
+}
+
+static void draw_event(uint32_t seq) {
+    event_log_entry_t e;
+    if (!event_log_get(seq, &e)) return;   // overwritten before it was drawn
+
+    char head[32], text[32], line[EVENTS_CHARS + 1];
+    uint16_t color = event_log_format(&e, head, sizeof(head), text, sizeof(text));
+    int x = column_x(seq / EVENTS_SLOTS) + 6;
+    int y = (int)(seq % EVENTS_SLOTS) * EVENTS_SLOT_H + 4;
+
+    // Padded, so the slot's previous text (or the placeholder) is erased
+    snprintf(line, sizeof(line), "%-*.*s", EVENTS_CHARS, EVENTS_CHARS, head);
+    display_string(x, y, line, 0x8410, COLOR_BLACK);
+    snprintf(line, sizeof(line), "%-*.*s", EVENTS_CHARS, EVENTS_CHARS, text);
+    display_string(x, y + 18, line, color, COLOR_BLACK);
+}
+
+void ui_events_draw(bool full) {
+    uint32_t count = event_log_count();
+
+    if (full) {
+        newest_column = count ? (count - 1) / EVENTS_SLOTS : 0;
+        uint32_t first = (newest_column >= EVENTS_COLS) ? newest_column - (EVENTS_COLS - 1) : 0;
+        display_fill(COLOR_BLACK);
+        for (int c = 0; c < EVENTS_COLS; c++) {
+            display_fill_rect(c * EVENTS_COL_W, 0, 1, DISPLAY_HEIGHT, EVENTS_SEPARATOR_COLOR);
+        }
+        scroll_to(newest_column);
+        if (!count) {
+            display_string(6, 4, "No events yet", 0x8410, COLOR_BLACK);
+        }
+        drawn = first * EVENTS_SLOTS;
+    }
+
+    for (; drawn < count; drawn++) {
+        uint32_t column = drawn / EVENTS_SLOTS;
+        if (column > newest_column) {
+            // Reuse the memory of the column scrolling out, then bring it in on the right
+            if (column >= EVENTS_COLS) clear_column(column);
+            scroll_to(column);
+            newest_column = column;
+        }
+        draw_event(drawn);
+    }
+}
@@ -0,0 +1,24 @@
+/**
+ * UI Events - Rolling log of device state, error and alarm events
+ * Events (event_log.h) fill columns of 8 top to bottom, oldest column on
+ * the left. When the rightmost column is full, the panel's hardware scroll
+ * moves every column one place left and the column that wrapped around to
+ * the right is cleared, so a new event costs one slot of text and, every 8
+ * events, one register write and one fill; never a full repaint.
+ *
+ * Not thread-safe: callers hold the UI data mutex.
+ */
+#ifndef UI_EVENTS_H
+#define UI_EVENTS_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Draw the events logged since the last call
+ * @param full Clear the screen and draw the visible columns (on screen switch)
+ * Leaves the display scrolled; reset it with display_set_scroll_start(0)
+ * before drawing another screen.
+ */
+void ui_events_draw(bool full);
+
+#endif // UI_EVENTS_H
@@ -0,0 +1,56 @@
+/**
+ * UI Layout - Implementation
+ */
+#include "ui_layout.h"
+#include "simple_display.h"
+
+void ui_layout_compute(ui_layout_t *layout, int device_count, int page) {
+    if (device_count < 0) device_count = 0;
+
+    int page_count = (device_count + UI_LAYOUT_MAX_CELLS - 1) / UI_LAYOUT_MAX_CELLS;
+    if (page_count < 1) page_count = 1;
+    if (page < 0 || page >= page_count) page = 0;
+
+    int first = page * UI_LAYOUT_MAX_CELLS;
+    int on_page = device_count - first;
+    if (on_page > UI_LAYOUT_MAX_CELLS) on_page = UI_LAYOUT_MAX_CELLS;
+    if (on_page < 0) on_page = 0;
+
+    // Keep the grid stable across pages: a full first page means 2x2 everywhere
+    int grid_for = (page_count > 1) ? UI_LAYOUT_MAX_CELLS : on_page;
+    int cols = (grid_for >= 2) ? 2 : 1;
+    int rows = (grid_for >= 3) ? 2 : 1;
+
+    layout->device_count = device_count;
+    layout->page_count = page_count;
+    layout->page = page;
+    layout->cols = cols;
+    layout->rows = rows;
+    layout->cell_count = on_page;
+    layout->first = first;
+
+    const int cell_w = DISPLAY_WIDTH / cols;
+    const int cell_h = DISPLAY_HEIGHT / rows;
+    for (int i = 0; i < UI_LAYOUT_MAX_CELLS; i++) {
+        ui_rect_t *r = &layout->cells[i];
+        if (i < cols * rows) {
+            r->x = (i % cols) * cell_w;
+            r->y = (i / cols) * cell_h;
+            r->w = cell_w;
+            r->h = cell_h;
+        } else {
+            r->x = r->y = r->w = r->h = 0;
+        }
+    }
+}
+
+void ui_layout_draw_separators(const ui_layout_t *layout, uint16_t color) {
+    if (layout->cols > 1) {
+        // Vertical line (center)
+        display_fill_rect(DISPLAY_WIDTH / 2 - 1, 0, 2, DISPLAY_HEIGHT, color);
+    }
+    if (layout->rows > 1) {
+        // Horizontal line (center)
+        display_fill_rect(0, DISPLAY_HEIGHT / 2 - 1, DISPLAY_WIDTH, 2, color);
+    }
+}
@@ -0,0 +1,38 @@
+/**
+ * UI Layout - Grid allocation for a variable number of device cells
+ * Up to 4 cells per page (2x2 of 240x160); fewer devices get larger cells,
+ * more devices are split into pages that the UI rotates through.
+ */
+#ifndef UI_LAYOUT_H
+#define UI_LAYOUT_H
+
+#include <stdint.h>
+
+#define UI_LAYOUT_MAX_CELLS 4
+
+typedef struct {
+    int x, y, w, h;
+} ui_rect_t;
+
+typedef struct {
+    int device_count;       // devices the layout was computed for
+    int page_count;
+    int page;               // current page (0-based)
+    int cols, rows;         // grid of the current page
+    int cell_count;         // cells used on the current page
+    int first;              // display position of the first device on this page
+    ui_rect_t cells[UI_LAYOUT_MAX_CELLS];
+} ui_layout_t;
+
+/**
+ * @brief Compute the grid for device_count devices, showing the given page
+ * Grid: 1 device → 1x1, 2 → 2x1, 3-4 → 2x2 (per page)
+ */
+void ui_layout_compute(ui_layout_t *layout, int device_count, int page);
+
+/**
+ * @brief Draw the separator lines between the cells of the current page
+ */
+void ui_layout_draw_separators(const ui_layout_t *layout, uint16_t color);
+
+#endif // UI_LAYOUT_H
@@ -0,0 +1,143 @@
+/**
+ * UI Trends - Implementation
+ */
+#include <stdio.h>
+#include <string.h>
+#include "ui_trends.h"
+#include "ui_charts.h"
+#include "history.h"
+#include "energy.h"
+#include "simple_display.h"
+
+#define TRENDS_TOP      30
+#define TRENDS_PANEL_H  96    // label line + plot + spacing
+#define TRENDS_PLOT_H   70
+#define TRENDS_COLS     60    // 8x16 font on 480 px
+
+// Header row: title at column 1, energy from column 16, timing right-aligned
+#define ENERGY_X        128
+#define ENERGY_COLS     32
+#define TIMING_COLS     10    // "9999us/col"
+#define TIMING_X        (DISPLAY_WIDTH - 8 - 8 * TIMING_COLS)
+_Static_assert(ENERGY_X + 8 * ENERGY_COLS < TIMING_X, "energy and timing overlap");
+
+typedef struct {
+    history_metric_t metric;
+    const char      *name;
+    int32_t          min, max;   // plot range, history units
+    float            scale;      // history units → display units
+    const char      *fmt;        // printf format for one value
+} trend_def_t;
+
+// Ranges match the bars on the dashboard
+static const trend_def_t trends[] = {
+    { HISTORY_PV_POWER,      "PV",      0,      450,  1.0f,   "%.0fW" },
+    { HISTORY_SOC,           "SOC",     0,      1000, 0.1f,   "%.0f%%" },
+    { HISTORY_SHUNT_CURRENT, "Current", -10000, 5000, 0.01f,  "%+.1fA" },
+};
+#define TREND_COUNT (sizeof(trends) / sizeof(trends[0]))
+
+static ui_chart_t charts[TREND_COUNT];
+static ui_trends_span_t chart_span;
+static char prev_label[TREND_COUNT][TRENDS_COLS + 1];
+static char prev_timing[TIMING_COLS + 1];
+static char prev_energy[ENERGY_COLS + 1];
+
+static void draw_label(int i, history_tier_t tier, uint16_t samples) {
+    const trend_def_t *t = &trends[i];
+    char buf[TRENDS_COLS + 1];
+    char mn[12], mx[12], avg[12];
+    history_stats_t st;
+
+    if (history_stats(t->metric, tier, samples, &st)) {
+        snprintf(mn, sizeof(mn), t->fmt, st.min * t->scale);
+        snprintf(mx, sizeof(mx), t->fmt, st.max * t->scale);
+        snprintf(avg, sizeof(avg), t->fmt, st.avg * t->scale);
+        snprintf(buf, sizeof(buf), "%-8s min %-7s max %-7s avg %-7s", t->name, mn, mx, avg);
+    } else {
+        snprintf(buf, sizeof(buf), "%-8s no data", t->name);
+    }
+
+    // Pad to full width so shorter text erases the previous one
+    char line[TRENDS_COLS + 1];
+    snprintf(line, sizeof(line), "%-*s", TRENDS_COLS - 1, buf);
+    if (strcmp(line, prev_label[i]) == 0) return;
+    display_string(8, TRENDS_TOP + i * TRENDS_PANEL_H, line, COLOR_WHITE, COLOR_BLACK);
+    strcpy(prev_label[i], line);
+}
+
+static void draw_timing(void) {
+    const ui_chart_timing_t *tm = ui_chart_timing();
+    char buf[sizeof(prev_timing)];
+
+    if (tm->samples == 0) return;
+    unsigned long us = tm->avg_us > 9999 ? 9999 : (unsigned long)tm->avg_us;
+    snprintf(buf, sizeof(buf), "%4luus/col", us);
+    if (strcmp(buf, prev_timing) == 0) return;
+    display_string(TIMING_X, 6, buf, 0x8410, COLOR_BLACK);
+    strcpy(prev_timing, buf);
+}
+
+// kWh in at most 4 characters: 9.99, 99.9, 9999
+static void format_kwh(char *buf, size_t len, float wh) {
+    float kwh = wh / 1000.0f;
+    if (kwh < 0) kwh = 0;
+    if (kwh < 9.995f) {
+        snprintf(buf, len, "%.2f", kwh);
+    } else if (kwh < 99.95f) {
+        snprintf(buf, len, "%.1f", kwh);
+    } else {
+        snprintf(buf, len, "%.0f", kwh < 9999.0f ? kwh : 9999.0f);
+    }
+}
+
+// Today's integrated energy, between the title and the render timing; at
+// most 30 characters, padded to ENERGY_COLS so a shorter line erases the last
+static void draw_energy(void) {
+    energy_totals_t t;
+    char sol[8], chg[8], load[8];
+    char buf[sizeof(prev_energy)];
+
+    energy_get_today(&t);
+    format_kwh(sol, sizeof(sol), t.wh[ENERGY_SOLAR]);
+    format_kwh(chg, sizeof(chg), t.wh[ENERGY_CHARGER]);
+    format_kwh(load, sizeof(load), t.consumed_wh);
+    char text[48];
+    snprintf(text, sizeof(text), "Sol %s Chg %s Load %skWh", sol, chg, load);
+    snprintf(buf, sizeof(buf), "%-*s", ENERGY_COLS, text);
+    if (strcmp(buf, prev_energy) == 0) return;
+    display_string(ENERGY_X, 6, buf, COLOR_CYAN, COLOR_BLACK);
+    strcpy(prev_energy, buf);
+}
+
+void ui_trends_draw(bool full, ui_trends_span_t span) {
+    const history_tier_t tier = (span == UI_TRENDS_DAY) ? HISTORY_TIER_15MIN : HISTORY_TIER_1MIN;
+    const uint16_t samples = (span == UI_TRENDS_DAY) ? 96 : 60;
+
+    full = full || span != chart_span;
+    if (full) {
+        display_fill(COLOR_BLACK);
+        display_string(8, 6, (span == UI_TRENDS_DAY) ? "TRENDS (24 h)" : "TRENDS (1 h)",
+                       COLOR_YELLOW, COLOR_BLACK);
+        display_fill_rect(0, TRENDS_TOP - 6, DISPLAY_WIDTH, 2, 0x528A);
+        memset(prev_label, 0, sizeof(prev_label));
+        prev_timing[0] = '\0';
+        prev_energy[0] = '\0';
+
+        for (size_t i = 0; i < TREND_COUNT; i++) {
+            ui_rect_t r = { 8, TRENDS_TOP + (int)i * TRENDS_PANEL_H + 18,
+                            DISPLAY_WIDTH - 16, TRENDS_PLOT_H };
+            ui_chart_init(&charts[i], &r, trends[i].metric, tier, samples,
+                          trends[i].min, trends[i].max);
+        }
+        chart_span = span;
+    }
+
+    for (size_t i = 0; i < TREND_COUNT; i++) {
+        if (ui_chart_draw(&charts[i]) > 0 || full) {
+            draw_label((int)i, tier, samples);
+        }
+    }
+    draw_energy();
+    draw_timing();
+}
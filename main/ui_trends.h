@@ -0,0 +1,24 @@
+/**
+ * UI Trends - Screen with mini-charts of PV power, SOC and shunt current
+ * Each chart sweeps one column per history sample (see ui_charts.h); the
+ * labels show min/max/avg over the visible window.
+ *
+ * Not thread-safe: callers hold the UI data mutex.
+ */
+#ifndef UI_TRENDS_H
+#define UI_TRENDS_H
+
+#include <stdbool.h>
+
+typedef enum {
+    UI_TRENDS_HOUR,     // 1 min tier, last 60 minutes
+    UI_TRENDS_DAY,      // 15 min tier, last 24 hours
+} ui_trends_span_t;
+
+/**
+ * @brief Draw the trends screen
+ * @param full Clear the screen and redraw everything (on screen switch)
+ */
+void ui_trends_draw(bool full, ui_trends_span_t span);
+
+#endif // UI_TRENDS_H
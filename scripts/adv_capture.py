@@ -0,0 +1,447 @@
+#!/usr/bin/env python3
+"""Record, synthesize and inspect BLE advertisement captures (.vcap).
+
+A .vcap file is "VCAP", uint16 version, uint16 reserved, then records of
+victron_capture_record_t (uint32 time_ms, 6-byte MAC in BLE byte order,
+int8 rssi, uint8 len) each followed by len bytes of raw AD payload, all
+little endian (see components/victron_ble/include/victron_ble.h).
+
+  record   collect the firmware's "ADV <hex>" lines (`capture start`) from a
+           serial port or a saved log
+  gen      synthesize encrypted Victron advertisements (AES-128-CTR, the
+           nonce scheme of ble_gap_event_handler) plus non-Victron noise;
+           also writes the matching `dev add` lines to <out>.devices
+  dump     print a capture; with --devices, decrypt the Victron payloads
+
+Examples:
+    python3 scripts/adv_capture.py record --port /dev/ttyUSB0 --seconds 60 -o site.vcap
+    python3 scripts/adv_capture.py gen -o bench.vcap --devices solar=2,battery=1,ac=1 \\
+        --rate 4 --unknown 3 --noise 40 --seconds 120
+    python3 scripts/adv_capture.py dump bench.vcap --devices bench.vcap.devices
+
+Only the standard library is used (AES is implemented below).
+"""
+import argparse
+import random
+import struct
+import sys
+import time
+
+MAGIC = b"VCAP"
+VERSION = 1
+FILE_HDR = struct.Struct("<4sHH")
+RECORD = struct.Struct("<I6sbB")        # time_ms, mac, rssi, len
+MAX_AD = 31
+
+VICTRON_ID = 0x02E1
+PRODUCT_ADVERTISEMENT = 0x10
+
+# ---------------------------------------------------------------------------
+# AES-128 (encryption only; CTR mode needs nothing else)
+# ---------------------------------------------------------------------------
+
+def _sbox():
+    sbox = [0] * 256
+    p = q = 1
+    while True:
+        p = p ^ ((p << 1) & 0xFF) ^ (0x1B if p & 0x80 else 0)   # p *= 3
+        q ^= q << 1
+        q ^= q << 2
+        q ^= q << 4
+        q &= 0xFF
+        if q & 0x80:
+            q ^= 0x09                                            # q /= 3
+        x = q ^ ((q << 1) | (q >> 7)) ^ ((q << 2) | (q >> 6)) ^ ((q << 3) | (q >> 5)) ^ ((q << 4) | (q >> 4))
+        sbox[p] = (x ^ 0x63) & 0xFF
+        if p == 1:
+            break
+    sbox[0] = 0x63
+    return sbox
+
+SBOX = _sbox()
+
+
+def _xtime(a):
+    return ((a << 1) ^ 0x1B) & 0xFF if a & 0x80 else a << 1
+
+
+def _expand_key(key):
+    words = [list(key[i:i + 4]) for i in range(0, 16, 4)]
+    rcon = 1
+    for i in range(4, 44):
+        t = list(words[i - 1])
+        if i % 4 == 0:
+            t = [SBOX[b] for b in t[1:] + t[:1]]
+            t[0] ^= rcon
+            rcon = _xtime(rcon)
+        words.append([a ^ b for a, b in zip(words[i - 4], t)])
+    return [sum(words[r * 4:r * 4 + 4], []) for r in range(11)]
+
+
+def aes_encrypt_block(round_keys, block):
+    s = [b ^ k for b, k in zip(block, round_keys[0])]
+    for rnd in range(1, 11):
+        s = [SBOX[b] for b in s]
+        s = [s[(i + 4 * (i % 4)) % 16] for i in range(16)]          # ShiftRows (column-major)
+        if rnd != 10:
+            out = []
+            for c in range(4):
+                a = s[4 * c:4 * c + 4]
+                t = a[0] ^ a[1] ^ a[2] ^ a[3]
+                out += [a[i] ^ t ^ _xtime(a[i] ^ a[(i + 1) % 4]) for i in range(4)]
+            s = out
+        s = [b ^ k for b, k in zip(s, round_keys[rnd])]
+    return bytes(s)
+
+
+def aes_ctr(key, nonce, data):
+    """Victron AES-CTR: counter block = nonce (LE) in bytes 0-1, rest zero,
+    incremented as a big-endian 128-bit integer (mbedTLS/esp_aes)."""
+    rk = _expand_key(key)
+    counter = int.from_bytes(struct.pack("<H", nonce) + bytes(14), "big")
+    out = bytearray()
+    for i in range(0, len(data), 16):
+        stream = aes_encrypt_block(rk, counter.to_bytes(16, "big"))
+        out += bytes(a ^ b for a, b in zip(data[i:i + 16], stream))
+        counter = (counter + 1) % (1 << 128)
+    return bytes(out)
+
+# ---------------------------------------------------------------------------
+# Record payloads (bit layouts as decoded in components/victron_ble/victron_decode.c)
+# ---------------------------------------------------------------------------
+
+class Bits:
+    """Little-endian, LSB-first bit packer."""
+
+    def __init__(self):
+        self.value = 0
+        self.n = 0
+
+    def put(self, v, bits):
+        self.value |= (int(v) & ((1 << bits) - 1)) << self.n
+        self.n += bits
+        return self
+
+    def bytes(self):
+        return self.value.to_bytes((self.n + 7) // 8, "little")
+
+
+def walk(state, key, lo, hi, step):
+    state[key] = min(hi, max(lo, state[key] + random.uniform(-step, step)))
+    return state[key]
+
+
+def solar(st):
+    v = walk(st, "v", 12.0, 14.6, 0.05)
+    pv = walk(st, "pv", 0, 450, 15)
+    return (Bits().put(random.choice([3, 4, 5]), 8).put(0, 8)
+            .put(round(v * 100), 16).put(round(pv / v * 10), 16)
+            .put(round(walk(st, "yield", 0, 300, 0.5)), 16).put(round(pv), 16)
+            .put(round(walk(st, "load", 0, 20, 0.2) * 10), 9).bytes())
+
+
+def battery(st):
+    v = walk(st, "v", 11.8, 14.4, 0.03)
+    i = walk(st, "i", -40, 30, 0.8)
+    return (Bits().put(random.randint(60, 6000), 16).put(round(v * 100), 16).put(0, 16)
+            .put(round((walk(st, "t", -5, 45, 0.2) + 273.15) * 100), 16).put(2, 2)
+            .put(round(i * 1000), 22).put(round(walk(st, "ah", -200, 0, 0.5) * 10), 20)
+            .put(round(walk(st, "soc", 10, 100, 0.2) * 10), 10).bytes())
+
+
+def inverter(st):
+    return (Bits().put(9, 8).put(0, 16).put(round(walk(st, "v", 11.5, 14.0, 0.03) * 100), 16)
+            .put(round(walk(st, "va", 0, 1200, 20)), 16).put(round(walk(st, "acv", 225, 235, 0.5) * 100), 15)
+            .put(round(walk(st, "aci", 0, 5, 0.1) * 10), 11).bytes())
+
+
+def dcdc(st):
+    return (Bits().put(random.choice([3, 4, 5]), 8).put(0, 8)
+            .put(round(walk(st, "vin", 12.5, 14.5, 0.05) * 100), 16)
+            .put(round(walk(st, "vout", 13.2, 14.4, 0.02) * 100), 16).put(0, 32).bytes())
+
+
+def lithium(st):
+    b = Bits().put(0, 32).put(0, 16)
+    cells = [walk(st, f"c{n}", 3.20, 3.45, 0.005) for n in range(4)]
+    for n in range(8):
+        b.put(round((cells[n] - 2.60) * 100) if n < 4 else 0x7F, 7)
+    return (b.put(round(sum(cells) * 100), 12).put(1, 4)
+            .put(round(walk(st, "t", 0, 40, 0.2)) + 40, 7).put(0, 1).bytes())
+
+
+def ac_charger(st):
+    v = walk(st, "v", 12.8, 14.4, 0.02)
+    i = walk(st, "i", 0, 30, 0.5)
+    return (Bits().put(random.choice([3, 4, 5]), 8).put(0, 8)
+            .put(round(v * 100), 13).put(round(i * 10), 11)
+            .put(0x1FFF, 13).put(0x7FF, 11).put(0x1FFF, 13).put(0x7FF, 11)
+            .put(round(walk(st, "t", 15, 45, 0.2)) + 40, 7)
+            .put(round(walk(st, "ac", 0, 8, 0.1) * 10), 9).bytes())
+
+
+def other(st):
+    # A record type the firmware does not decode (Smart BatteryProtect)
+    return bytes(random.getrandbits(8) for _ in range(14))
+
+
+# name: (record type, product id, encoder, console role)
+KINDS = {
+    "solar":    (0x01, 0xA060, solar, "mppt"),
+    "battery":  (0x02, 0xA389, battery, "shunt"),
+    "inverter": (0x03, 0xA231, inverter, "ac"),
+    "dcdc":     (0x04, 0xA3F0, dcdc, "dcdc"),
+    "lithium":  (0x05, 0xA3E0, lithium, "battsense"),
+    "ac":       (0x08, 0xA340, ac_charger, "ac"),
+    "other":    (0x09, 0xA3B0, other, "dcdc"),
+}
+
+
+class Device:
+    def __init__(self, kind, index, configured):
+        self.kind = kind
+        self.record_type, self.product_id, self.encode, self.role = KINDS[kind]
+        self.mac = bytes(random.getrandbits(8) for _ in range(6))
+        self.key = bytes(random.getrandbits(8) for _ in range(16))
+        self.nonce = random.getrandbits(16)
+        self.state = {k: 0.0 for k in ("v", "i", "pv", "yield", "load", "t", "ah", "soc", "va",
+                                       "acv", "aci", "vin", "vout", "ac")}
+        self.state.update({f"c{n}": 3.3 for n in range(4)})
+        self.state.update(v=13.0, soc=80, acv=230, vin=13.5, vout=13.8)
+        self.name = f"{kind}{index}"
+        self.configured = configured
+        self.listed_key = self.key          # key written to the .devices file
+
+    def advertisement(self):
+        plain = self.encode(self.state)
+        self.nonce = (self.nonce + 1) & 0xFFFF
+        body = (struct.pack("<HBBHBHB", VICTRON_ID, PRODUCT_ADVERTISEMENT, 0x02, self.product_id,
+                            self.record_type, self.nonce, self.key[0])
+                + aes_ctr(self.key, self.nonce, plain))
+        ad = bytes([len(body) + 1, 0xFF]) + body
+        flags = bytes([0x02, 0x01, 0x06])
+        return flags + ad if len(flags) + len(ad) <= MAX_AD else ad
+
+    def dev_add(self):
+        mac = ":".join(f"{b:02x}" for b in reversed(self.mac))
+        return f"dev add {mac} {self.listed_key.hex()} {self.role} {self.name}"
+
+
+def beacon():
+    """A non-Victron advertisement: iBeacon, Eddystone-UID or other vendor data."""
+    flags = bytes([0x02, 0x01, 0x06])
+    kind = random.randrange(3)
+    if kind == 0:
+        body = struct.pack("<HBB", 0x004C, 0x02, 0x15) + bytes(random.getrandbits(8) for _ in range(21))
+        return flags + bytes([len(body) + 1, 0xFF]) + body
+    if kind == 1:
+        body = struct.pack("<HBb", 0xFEAA, 0x00, -20) + bytes(random.getrandbits(8) for _ in range(16))
+        return flags + bytes([len(body) + 1, 0x16]) + body
+    body = struct.pack("<H", random.choice([0x0006, 0x0075, 0x0499, 0x0087])) + \
+        bytes(random.getrandbits(8) for _ in range(random.randint(2, 20)))
+    return flags + bytes([len(body) + 1, 0xFF]) + body
+
+# ---------------------------------------------------------------------------
+# File I/O
+# ---------------------------------------------------------------------------
+
+def write_capture(path, records):
+    with open(path, "wb") as f:
+        f.write(FILE_HDR.pack(MAGIC, VERSION, 0))
+        for time_ms, mac, rssi, ad in records:
+            f.write(RECORD.pack(time_ms & 0xFFFFFFFF, mac, rssi, len(ad)) + ad)
+
+
+def read_capture(path):
+    data = open(path, "rb").read()
+    magic, version, _ = FILE_HDR.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION:
+        sys.exit(f"{path}: not a capture (magic {magic!r}, version {version})")
+    pos = FILE_HDR.size
+    records = []
+    while pos + RECORD.size <= len(data):
+        time_ms, mac, rssi, n = RECORD.unpack_from(data, pos)
+        pos += RECORD.size
+        if pos + n > len(data):
+            sys.exit(f"{path}: truncated record at offset {pos - RECORD.size}")
+        records.append((time_ms, mac, rssi, data[pos:pos + n]))
+        pos += n
+    return records
+
+
+def parse_adv_lines(text):
+    records, bad = [], 0
+    for line in text.splitlines():
+        i = line.find(b"ADV ")
+        if i < 0:
+            continue
+        try:
+            raw = bytes.fromhex(line[i + 4:].strip().decode())
+            time_ms, mac, rssi, n = RECORD.unpack_from(raw, 0)
+        except (ValueError, struct.error):
+            bad += 1
+            continue
+        if len(raw) != RECORD.size + n:
+            bad += 1
+            continue
+        records.append((time_ms, mac, rssi, raw[RECORD.size:]))
+    return records, bad
+
+
+def read_devices(path):
+    keys = {}
+    for line in open(path):
+        parts = line.split()
+        if len(parts) >= 4 and parts[:2] == ["dev", "add"]:
+            keys[bytes.fromhex(parts[2].replace(":", ""))[::-1]] = bytes.fromhex(parts[3])
+    return keys
+
+# ---------------------------------------------------------------------------
+# Commands
+# ---------------------------------------------------------------------------
+
+def cmd_record(args):
+    if args.port:
+        import serial  # pyserial, only needed for --port
+
+        with serial.Serial(args.port, args.baud, timeout=0.5) as ser:
+            ser.write(b"capture start all\n" if args.all else b"capture start\n")
+            text, deadline = b"", time.time() + args.seconds
+            while time.time() < deadline:
+                text += ser.read(4096)
+            ser.write(b"capture stop\n")
+            text += ser.read(65536)
+    elif args.input:
+        text = open(args.input, "rb").read()
+    else:
+        sys.exit("give a log file or --port")
+
+    records, bad = parse_adv_lines(text)
+    write_capture(args.output, records)
+    print(f"{len(records)} advertisements -> {args.output}" + (f" ({bad} malformed lines)" if bad else ""))
+
+
+def cmd_gen(args):
+    random.seed(args.seed)
+    devices = []
+    for spec in filter(None, args.devices.split(",")):
+        kind, _, count = spec.partition("=")
+        if kind not in KINDS:
+            sys.exit(f"unknown device kind '{kind}' (one of {', '.join(KINDS)})")
+        for i in range(int(count or 1)):
+            devices.append(Device(kind, i + 1, configured=True))
+    for i in range(args.unknown):
+        devices.append(Device(random.choice(list(KINDS)), 100 + i, configured=False))
+    for i in range(args.bad_key):
+        dev = Device(random.choice(list(KINDS)), 200 + i, configured=True)
+        dev.listed_key = bytes([dev.key[0] ^ 0xA5]) + dev.key[1:]   # fails the key check
+        devices.append(dev)
+
+    events = []   # (time_ms, source); devices start at a random phase and jitter 10%
+    end_ms = args.seconds * 1000
+    for dev in devices:
+        period = 1000.0 / args.rate
+        t = random.uniform(0, period)
+        while t < end_ms:
+            events.append((t, dev))
+            t += period * random.uniform(0.9, 1.1)
+    beacons = [bytes(random.getrandbits(8) for _ in range(6)) for _ in range(max(1, args.beacons))]
+    if args.noise > 0:
+        t = random.expovariate(args.noise / 1000.0)
+        while t < end_ms:
+            events.append((t, random.choice(beacons)))
+            t += random.expovariate(args.noise / 1000.0)
+    events.sort(key=lambda e: e[0])
+
+    records = []
+    for t, src in events:
+        if isinstance(src, Device):
+            records.append((int(t), src.mac, random.randint(-90, -50), src.advertisement()))
+        else:
+            records.append((int(t), src, random.randint(-100, -60), beacon()))
+    write_capture(args.output, records)
+
+    with open(args.output + ".devices", "w") as f:
+        for dev in devices:
+            if dev.configured:
+                f.write(dev.dev_add() + "\n")
+
+    n_victron = sum(1 for _, src in events if isinstance(src, Device))
+    print(f"{len(records)} advertisements ({n_victron} Victron from {len(devices)} devices, "
+          f"{len(records) - n_victron} noise) over {args.seconds} s -> {args.output}, "
+          f"{args.output}.devices")
+
+
+def victron_fields(ad):
+    """Yield (product_id, record_type, nonce, key_check, encrypted) of Victron manufacturer data."""
+    pos = 0
+    while pos + 1 < len(ad):
+        n = ad[pos]
+        if n == 0 or pos + 1 + n > len(ad):
+            return None
+        if ad[pos + 1] == 0xFF and n >= 11:
+            vendor, rtype, _, pid, rec, nonce, check = struct.unpack_from("<HBBHBHB", ad, pos + 2)
+            if vendor == VICTRON_ID and rtype == PRODUCT_ADVERTISEMENT:
+                return pid, rec, nonce, check, ad[pos + 12:pos + 1 + n]
+        pos += 1 + n
+    return None
+
+
+def cmd_dump(args):
+    keys = read_devices(args.devices) if args.devices else {}
+    for time_ms, mac, rssi, ad in read_capture(args.input)[:args.limit or None]:
+        mac_s = ":".join(f"{b:02x}" for b in reversed(mac))
+        v = victron_fields(ad)
+        if not v:
+            print(f"{time_ms:10d} {mac_s} {rssi:4d}  other   {ad.hex()}")
+            continue
+        pid, rec, nonce, check, enc = v
+        line = f"{time_ms:10d} {mac_s} {rssi:4d}  0x{pid:04X} rec 0x{rec:02X} nonce 0x{nonce:04X} key {check:02x}"
+        key = keys.get(mac)
+        if key and key[0] == check:
+            line += f"  plain {aes_ctr(key, nonce, enc).hex()}"
+        elif key:
+            line += "  BAD KEY"
+        else:
+            line += f"  enc {enc.hex()}"
+        print(line)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("record", help="collect ADV lines from a port or a log")
+    p.add_argument("input", nargs="?", help="saved serial log")
+    p.add_argument("--port")
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--seconds", type=float, default=30)
+    p.add_argument("--all", action="store_true", help="capture non-Victron advertisements too")
+    p.add_argument("-o", "--output", default="capture.vcap")
+    p.set_defaults(func=cmd_record)
+
+    p = sub.add_parser("gen", help="synthesize a capture")
+    p.add_argument("-o", "--output", default="synthetic.vcap")
+    p.add_argument("--devices", default="solar=1,battery=1,ac=1",
+                   help=f"kind=count,... kinds: {', '.join(KINDS)}")
+    p.add_argument("--rate", type=float, default=1.0, help="advertisements per second per device")
+    p.add_argument("--unknown", type=int, default=0, help="Victron advertisers without a configured key")
+    p.add_argument("--bad-key", type=int, default=0, help="devices configured with the wrong key")
+    p.add_argument("--noise", type=float, default=0.0, help="non-Victron advertisements per second")
+    p.add_argument("--beacons", type=int, default=20, help="distinct non-Victron MACs")
+    p.add_argument("--seconds", type=int, default=60)
+    p.add_argument("--seed", type=int, default=1)
+    p.set_defaults(func=cmd_gen)
+
+    p = sub.add_parser("dump", help="print a capture")
+    p.add_argument("input")
+    p.add_argument("--devices", help="`dev add` lines with the keys")
+    p.add_argument("--limit", type=int, default=0)
+    p.set_defaults(func=cmd_dump)
+
+    args = ap.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
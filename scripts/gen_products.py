@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Generate components/victron_ble/victron_products.c from the product enum.
+
+The enum in include/victron_products.h is the single source of truth:
+
+    VICTRON_PRODUCT_<NAME> = 0xA060, // SmartSolar MPPT 100/20 48V
+
+Each entry's id and trailing comment become one row of the name table. Rows
+are emitted sorted by id, because victron_product_name() binary-searches the
+table. Duplicate ids are rejected.
+
+Usage: python3 scripts/gen_products.py [--check]
+  --check  exit 1 if the checked-in file is out of date (no write)
+"""
+import os
+import re
+import sys
+
+ROOT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+HEADER = os.path.join(ROOT_DIR, "components/victron_ble/include/victron_products.h")
+SOURCE = os.path.join(ROOT_DIR, "components/victron_ble/victron_products.c")
+
+ENTRY = re.compile(r"^\s*VICTRON_PRODUCT_\w+\s*=\s*(0x[0-9A-Fa-f]+)\s*,\s*//\s*(.+?)\s*$")
+
+TEMPLATE = """\
+// Generated by scripts/gen_products.py from include/victron_products.h - do not edit
+#include "victron_products.h"
+#include <stddef.h>
+
+typedef struct {{
+    uint16_t id;
+    const char *name;
+}} victron_product_name_entry_t;
+
+// Sorted by id (binary search below)
+static const victron_product_name_entry_t kProductNames[] = {{
+{rows}
+}};
+
+#define PRODUCT_COUNT (sizeof(kProductNames) / sizeof(kProductNames[0]))
+
+const char *victron_product_name(uint16_t product_id)
+{{
+    size_t lo = 0, hi = PRODUCT_COUNT;
+    while (lo < hi) {{
+        size_t mid = (lo + hi) / 2;
+        if (kProductNames[mid].id < product_id) {{
+            lo = mid + 1;
+        }} else {{
+            hi = mid;
+        }}
+    }}
+    if (lo < PRODUCT_COUNT && kProductNames[lo].id == product_id) {{
+        return kProductNames[lo].name;
+    }}
+    return NULL;
+}}
+"""
+
+
+def c_string(s):
+    return '"' + s.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def main():
+    entries = {}
+    with open(HEADER, encoding="utf-8") as f:
+        for line in f:
+            m = ENTRY.match(line)
+            if not m:
+                continue
+            pid = int(m.group(1), 16)
+            if pid in entries:
+                sys.exit(f"duplicate product id 0x{pid:04X}: '{entries[pid]}' and '{m.group(2)}'")
+            entries[pid] = m.group(2)
+
+    if not entries:
+        sys.exit(f"no products found in {HEADER}")
+
+    rows = "\n".join(f"    {{ 0x{pid:04X}, {c_string(name)} }}," for pid, name in sorted(entries.items()))
+    text = TEMPLATE.format(rows=rows)
+
+    if "--check" in sys.argv[1:]:
+        with open(SOURCE, encoding="utf-8") as f:
+            if f.read() != text:
+                sys.exit(f"{SOURCE} is out of date; run scripts/gen_products.py")
+        return
+
+    with open(SOURCE, "w", encoding="utf-8") as f:
+        f.write(text)
+    print(f"{len(entries)} products -> {os.path.relpath(SOURCE, ROOT_DIR)}")
+
+
+if __name__ == "__main__":
+    main()
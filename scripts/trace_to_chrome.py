@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Convert a `trace dump` capture into Chrome trace JSON (open in ui.perfetto.dev).
+
+The firmware prints "TRACE <len>\\n", <len> raw bytes, then "TRACE END". The
+input may be any serial capture containing that frame (other log lines around
+it are skipped), or the script can fetch it itself:
+
+    python3 scripts/trace_to_chrome.py capture.log -o trace.json
+    python3 scripts/trace_to_chrome.py --port /dev/ttyUSB0 -o trace.json   # needs pyserial
+
+Blob layout: see components/diag/include/diag_trace.h.
+"""
+import argparse
+import json
+import struct
+import sys
+import time
+import zlib
+
+HDR = struct.Struct("<4sHBBIIHH")        # magic, version, cores, flags, ticks/us, events, names, tasks
+CLOCK = struct.Struct("<IIq")            # cycles, reserved, time_us
+TASK = struct.Struct("<I16s")            # handle, name
+EVENT = struct.Struct("<IIHBBI")         # cycles, task, name, type, core, arg
+VERSION = 2
+FLAG_WRAPPED = 0x01                     # the ring overwrote older events
+FLAG_END_CLOCKS = 0x02                  # clocks sampled at the stop, after the last event
+
+
+def extract_blob(data):
+    start = data.find(b"TRACE ")
+    while start >= 0:
+        eol = data.find(b"\n", start)
+        try:
+            length = int(data[start + 6:eol].strip())
+        except ValueError:
+            start = data.find(b"TRACE ", start + 1)
+            continue
+        blob = data[eol + 1:eol + 1 + length]
+        if len(blob) == length:
+            return blob
+        sys.exit(f"capture truncated: {len(blob)} of {length} bytes")
+    sys.exit("no 'TRACE <len>' frame in the input")
+
+
+def fetch_from_port(port, baud):
+    import serial  # pyserial, only needed for --port
+
+    with serial.Serial(port, baud, timeout=2) as ser:
+        ser.reset_input_buffer()
+        ser.write(b"trace dump\n")
+        data = b""
+        deadline = time.time() + 30
+        while b"TRACE END" not in data and time.time() < deadline:
+            data += ser.read(4096)
+    return data
+
+
+def parse(blob):
+    body, (crc,) = blob[:-4], struct.unpack("<I", blob[-4:])
+    if zlib.crc32(body) != crc:
+        sys.exit("CRC mismatch: the capture is corrupted")
+
+    magic, version, cores, flags, ticks_per_us, n_events, n_names, n_tasks = HDR.unpack_from(body, 0)
+    if magic != b"VTRC" or version != VERSION:
+        sys.exit(f"not a trace blob (magic {magic!r}, version {version})")
+    pos = HDR.size
+
+    clocks = []
+    for _ in range(cores):
+        cycles, _, time_us = CLOCK.unpack_from(body, pos)
+        clocks.append((cycles, time_us))
+        pos += CLOCK.size
+
+    names = [None]   # ids are 1-based
+    for _ in range(n_names):
+        n = body[pos]
+        names.append(body[pos + 1:pos + 1 + n].decode("utf-8", "replace"))
+        pos += 1 + n
+
+    tasks = {}
+    for _ in range(n_tasks):
+        handle, name = TASK.unpack_from(body, pos)
+        tasks[handle] = name.split(b"\0", 1)[0].decode("utf-8", "replace")
+        pos += TASK.size
+
+    events = [EVENT.unpack_from(body, pos + i * EVENT.size) for i in range(n_events)]
+    return ticks_per_us, flags, clocks, names, tasks, events
+
+
+def event_times(ticks_per_us, flags, clocks, events):
+    """esp_timer microseconds of each event (None for an unknown core).
+
+    Cycle counters are per core and 32 bit: unwrap each core's events in
+    order from the clock sample taken at capture start, or backwards from
+    the one taken at the stop when the ring dropped the start."""
+    backwards = bool(flags & FLAG_END_CLOCKS)
+    last = {core: cycles for core, (cycles, _) in enumerate(clocks)}
+    elapsed = {core: 0 for core in range(len(clocks))}
+    times = [None] * len(events)
+    order = range(len(events) - 1, -1, -1) if backwards else range(len(events))
+    for i in order:
+        cycles, core = events[i][0], events[i][4]
+        if core >= len(clocks):
+            continue
+        if backwards:
+            elapsed[core] -= (last[core] - cycles) & 0xFFFFFFFF
+        else:
+            elapsed[core] += (cycles - last[core]) & 0xFFFFFFFF
+        last[core] = cycles
+        times[i] = clocks[core][1] + elapsed[core] / ticks_per_us
+    return times
+
+
+def to_chrome(ticks_per_us, flags, clocks, names, tasks, events):
+    times = event_times(ticks_per_us, flags, clocks, events)
+    known = [t for t in times if t is not None]
+    if flags & FLAG_END_CLOCKS:
+        t0 = min(known) if known else 0
+    else:
+        t0 = min(us for _, us in clocks) if clocks else 0
+
+    tids = {handle: i + 1 for i, handle in enumerate(sorted(tasks))}
+    out = [{"name": "process_name", "ph": "M", "pid": 1, "args": {"name": "esp32"}}]
+    for handle, tid in tids.items():
+        out.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid,
+                    "args": {"name": tasks[handle]}})
+
+    for (cycles, task, name_id, etype, core, arg), t in zip(events, times):
+        if t is None:
+            continue
+        ts = t - t0
+
+        name = names[name_id] if 0 < name_id < len(names) else f"#{name_id}"
+        ev = {"name": name, "ph": chr(etype), "ts": round(ts, 3), "pid": 1,
+              "tid": tids.get(task, 0), "args": {"core": core}}
+        if chr(etype) == "i":
+            ev["s"] = "t"
+            ev["args"]["arg"] = arg
+        out.append(ev)
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("input", nargs="?", help="serial capture containing a trace dump")
+    ap.add_argument("--port", help="fetch the dump from this serial port instead")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("-o", "--output", default="trace.json")
+    args = ap.parse_args()
+
+    if args.port:
+        data = fetch_from_port(args.port, args.baud)
+    elif args.input:
+        with open(args.input, "rb") as f:
+            data = f.read()
+    else:
+        ap.error("give a capture file or --port")
+
+    ticks_per_us, flags, clocks, names, tasks, events = parse(extract_blob(data))
+    trace = to_chrome(ticks_per_us, flags, clocks, names, tasks, events)
+    with open(args.output, "w") as f:
+        json.dump(trace, f)
+
+    print(f"{len(events)} events, {len(tasks)} tasks, {len(names) - 1} names"
+          f"{' (newest kept, ring wrapped)' if flags & FLAG_WRAPPED else ''} -> {args.output}")
+    if flags & FLAG_WRAPPED and not flags & FLAG_END_CLOCKS:
+        print("warning: the ring wrapped but the capture was not stopped with 'trace stop' or "
+              "'trace dump' (safe mode?); times are counted from the start and may be off by "
+              "counter wraps", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
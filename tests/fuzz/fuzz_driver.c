@@ -0,0 +1,157 @@
+// Stand-in for libFuzzer where clang is not available (the target is built
+// with gcc and ASan/UBSan). Replays the files given on the command line;
+// without files it mutates built-in seeds: a product advertisement and a
+// bare record of every decoded type at its nominal length. Each input is an
+// exact-size heap copy, so any read past its end faults. On a fault the
+// input is written to ./crash-input for replay.
+//
+//   fuzz_victron_decode [-runs=N] [-seed=N] [file ...]
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sanitizer/common_interface_defs.h>
+#include "victron_decode.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define MAX_INPUT 48
+
+static const struct {
+    uint8_t type;
+    uint8_t len;
+} record_types[] = {
+    { VICTRON_BLE_RECORD_SOLAR_CHARGER,   12 },
+    { VICTRON_BLE_RECORD_BATTERY_MONITOR, 15 },
+    { VICTRON_BLE_RECORD_INVERTER,        11 },
+    { VICTRON_BLE_RECORD_DCDC_CONVERTER,  10 },
+    { VICTRON_BLE_RECORD_SMART_LITHIUM,   16 },
+    { VICTRON_BLE_RECORD_AC_CHARGER,      13 },
+    { VICTRON_BLE_RECORD_ORION_XS,        16 },   // no decoder
+};
+#define SEEDS (2 * sizeof(record_types) / sizeof(record_types[0]))
+
+static uint64_t rng;
+static uint32_t next_rand(void)
+{
+    rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+    return (uint32_t)(rng >> 33);
+}
+
+static uint8_t current[MAX_INPUT];
+static size_t current_len;
+
+static void save_crash(void)
+{
+    FILE *f = fopen("crash-input", "wb");
+    if (f) {
+        fwrite(current, 1, current_len, f);
+        fclose(f);
+        fprintf(stderr, "input written to crash-input (%zu bytes)\n", current_len);
+    }
+}
+
+static void run_one(const uint8_t *data, size_t size)
+{
+    memcpy(current, data, size);
+    current_len = size;
+    uint8_t *copy = malloc(size ? size : 1);
+    memcpy(copy, data, size);
+    LLVMFuzzerTestOneInput(copy, size);
+    free(copy);
+}
+
+// Seed i: even = manufacturer data, odd = bare record
+static size_t make_seed(size_t i, uint8_t *out)
+{
+    uint8_t type = record_types[i / 2].type;
+    size_t len = record_types[i / 2].len;
+
+    if (i % 2) {
+        out[0] = type;
+        for (size_t k = 0; k < len; k++) out[1 + k] = (uint8_t)next_rand();
+        return 1 + len;
+    }
+    const uint8_t hdr[VICTRON_ADV_HEADER_SIZE] = {
+        VICTRON_MANUFACTURER_ID & 0xFF, VICTRON_MANUFACTURER_ID >> 8,
+        VICTRON_MANUFACTURER_RECORD_PRODUCT_ADVERTISEMENT, 0x00,
+        0x89, 0xA3, type, 0x34, 0x12, 0x5A,
+    };
+    memcpy(out, hdr, sizeof(hdr));
+    for (size_t k = 0; k < len; k++) out[sizeof(hdr) + k] = (uint8_t)next_rand();
+    return sizeof(hdr) + len;
+}
+
+static size_t mutate(uint8_t *buf, size_t len)
+{
+    int n = 1 + next_rand() % 4;
+    while (n--) {
+        switch (next_rand() % 6) {
+            case 0:     // flip a bit
+                if (len) buf[next_rand() % len] ^= (uint8_t)(1u << (next_rand() % 8));
+                break;
+            case 1:     // random byte
+                if (len) buf[next_rand() % len] = (uint8_t)next_rand();
+                break;
+            case 2:     // record type (header or bare)
+                if (len > 6) buf[6] = record_types[next_rand() % (SEEDS / 2)].type;
+                else if (len) buf[0] = (uint8_t)next_rand();
+                break;
+            case 3:     // grow
+                if (len < MAX_INPUT) buf[len++] = (uint8_t)next_rand();
+                break;
+            case 4:     // shrink
+                if (len) len -= 1 + next_rand() % (len < 4 ? len : 4);
+                break;
+            default:    // any length up to MAX_INPUT
+                len = next_rand() % (MAX_INPUT + 1);
+                break;
+        }
+    }
+    return len;
+}
+
+static int replay(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    uint8_t buf[4096];
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    run_one(buf, n < MAX_INPUT ? n : MAX_INPUT);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    long runs = 1000000;
+    unsigned long seed = 1;
+    int files = 0, fails = 0;
+
+    __sanitizer_set_death_callback(save_crash);
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-runs=", 6) == 0) {
+            runs = strtol(argv[i] + 6, NULL, 10);
+        } else if (strncmp(argv[i], "-seed=", 6) == 0) {
+            seed = strtoul(argv[i] + 6, NULL, 10);
+        } else {
+            files++;
+            fails += replay(argv[i]);
+        }
+    }
+    if (files)
+        return fails != 0;
+
+    rng = seed;
+    uint8_t buf[MAX_INPUT];
+    for (long r = 0; r < runs; r++) {
+        size_t len = make_seed(next_rand() % SEEDS, buf);
+        run_one(buf, len);
+        run_one(buf, mutate(buf, len));
+    }
+    printf("fuzz_victron_decode: %ld runs, seed %lu, clean\n", runs, seed);
+    return 0;
+}
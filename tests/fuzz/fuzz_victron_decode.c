@@ -0,0 +1,40 @@
+// Fuzz target for the advertisement path minus the radio and AES: header
+// parse, payload bound and every record decoder
+//
+// Built with -fsanitize=fuzzer,address,undefined under clang; with gcc,
+// fuzz_driver.c supplies main() and a mutation loop instead.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "victron_decode.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static void decode(uint8_t type, const uint8_t plain[VICTRON_ENCRYPTED_DATA_MAX_SIZE], size_t len)
+{
+    victron_record_t rec;
+    if (victron_decode_record(type, plain, len, &rec) == VICTRON_DECODE_OK && rec.type != type)
+        __builtin_trap();
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    uint8_t plain[VICTRON_ENCRYPTED_DATA_MAX_SIZE];
+    victron_adv_t adv;
+
+    // As manufacturer data. AES-CTR maps payloads one to one, so the
+    // ciphertext stands in for the plaintext
+    if (victron_parse_adv(data, size, &adv) == VICTRON_ADV_OK &&
+        victron_adv_load_payload(&adv, plain)) {
+        decode(adv.record_type, plain, adv.encrypted_len);
+    }
+
+    // As a bare record, the first byte selecting the decoder, so every
+    // decoder sees every input whatever the header
+    if (size >= 1 && size - 1 <= VICTRON_ENCRYPTED_DATA_MAX_SIZE) {
+        memset(plain, 0, sizeof(plain));
+        memcpy(plain, data + 1, size - 1);
+        decode(data[0], plain, size - 1);
+    }
+    return 0;
+}
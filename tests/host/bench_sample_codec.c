@@ -0,0 +1,211 @@
+// sample_codec benchmark: bytes per sample and encode/decode throughput,
+// packed into flash log pages the way flash_log.c does
+//
+//   bench_sample_codec [--quick] [trace.csv ...]
+//
+// Without files it runs synthetic 7-day traces of an MPPT, a SmartShunt and
+// a BatterySense at the flash log interval, plus a worst case of random
+// noise. A CSV trace holds one sample per line:
+//   time_s,voltage_centi,current_milli,power_w,soc_deci,state,error,aux
+// MB/s is counted in flash_log_record_t bytes. The first line is the
+// baseline of storing those records uncompressed, one page header each.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "flash_log.h"
+#include "sample_codec.h"
+
+#define PAGE_PAYLOAD (FLASH_LOG_PAGE_SIZE - sizeof(flash_log_page_hdr_t) - sizeof(flash_log_block_id_t))
+#define MAX_SAMPLES  (1 << 16)
+#define WEEK_SAMPLES (7 * 24 * 3600 / FLASH_LOG_INTERVAL_S)
+
+static codec_sample_t trace[MAX_SAMPLES];
+static uint8_t pages[MAX_SAMPLES][PAGE_PAYLOAD];
+static size_t page_len[MAX_SAMPLES];
+static codec_sample_t decoded[MAX_SAMPLES];
+
+static uint32_t rng = 1;
+static double noise(void) {   // uniform in [-1, 1)
+    rng = rng * 1664525u + 1013904223u;
+    return (rng >> 8) / (double)(1 << 23) - 1.0;
+}
+
+static double now_s(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// MPPT: daylight power curve with clouds, bulk/absorption/float, yield in aux
+static size_t gen_mppt(void) {
+    double yield = 0;
+    for (int i = 0; i < WEEK_SAMPLES; i++) {
+        codec_sample_t *s = &trace[i];
+        double h = fmod(i * FLASH_LOG_INTERVAL_S / 3600.0, 24.0);
+        double sun = (h > 6 && h < 20) ? sin((h - 6) / 14 * M_PI) : 0;
+        double pv = sun * 380 * (0.8 + 0.2 * noise());
+        int state = sun == 0 ? 0 : (h < 11 ? 3 : (h < 14 ? 4 : 5));
+        double v = state == 0 ? 12.9 : (state == 3 ? 13.6 + h * 0.05 : (state == 4 ? 14.4 : 13.8));
+        if (h < 0.02) yield = 0;
+        yield += pv * FLASH_LOG_INTERVAL_S / 3600.0 / 10.0;   // 0.01 kWh
+        s->time_s = 1700000000u + i * FLASH_LOG_INTERVAL_S;
+        s->col[CODEC_COL_VOLTAGE] = (int32_t)lround(v * 100 + noise() * 2);
+        s->col[CODEC_COL_CURRENT] = (int32_t)lround(pv / v * 10) * 100;   // 0.1 A resolution
+        s->col[CODEC_COL_POWER] = (int32_t)lround(pv);
+        s->col[CODEC_COL_SOC] = 0xFFFF;
+        s->col[CODEC_COL_STATE] = state;
+        s->col[CODEC_COL_ERROR] = 0;
+        s->col[CODEC_COL_AUX] = (int32_t)yield;
+    }
+    return WEEK_SAMPLES;
+}
+
+// SmartShunt: charge by day, load at night, SOC and consumed Ah following
+static size_t gen_shunt(void) {
+    double soc = 800, consumed = -400;
+    for (int i = 0; i < WEEK_SAMPLES; i++) {
+        codec_sample_t *s = &trace[i];
+        double h = fmod(i * FLASH_LOG_INTERVAL_S / 3600.0, 24.0);
+        double amps = (h > 8 && h < 17) ? 18 + 6 * noise() : -4 + 2 * noise();
+        if (soc >= 1000 && amps > 0) amps = 0.3;
+        soc += amps * FLASH_LOG_INTERVAL_S / 3600.0 / 200 * 1000;
+        if (soc > 1000) soc = 1000;
+        consumed += amps * FLASH_LOG_INTERVAL_S / 3600.0 * 10;
+        s->time_s = 1700000000u + i * FLASH_LOG_INTERVAL_S;
+        s->col[CODEC_COL_VOLTAGE] = (int32_t)lround(1250 + soc / 10 + amps * 2);
+        s->col[CODEC_COL_CURRENT] = (int32_t)lround(amps * 1000);
+        s->col[CODEC_COL_POWER] = 0;
+        s->col[CODEC_COL_SOC] = (int32_t)soc;
+        s->col[CODEC_COL_STATE] = 0xFF;
+        s->col[CODEC_COL_ERROR] = 0;
+        s->col[CODEC_COL_AUX] = (int32_t)consumed;
+    }
+    return WEEK_SAMPLES;
+}
+
+// BatterySense: voltage and a slow temperature swing
+static size_t gen_sense(void) {
+    for (int i = 0; i < WEEK_SAMPLES; i++) {
+        codec_sample_t *s = &trace[i];
+        double h = fmod(i * FLASH_LOG_INTERVAL_S / 3600.0, 24.0);
+        s->time_s = 1700000000u + i * FLASH_LOG_INTERVAL_S;
+        memset(s->col, 0, sizeof(s->col));
+        s->col[CODEC_COL_VOLTAGE] = (int32_t)lround(1330 + 60 * sin(h / 24 * 2 * M_PI) + noise());
+        s->col[CODEC_COL_SOC] = 0xFFFF;
+        s->col[CODEC_COL_STATE] = 0xFF;
+        s->col[CODEC_COL_AUX] = (int32_t)lround(1800 + 600 * sin((h - 9) / 24 * 2 * M_PI));
+    }
+    return WEEK_SAMPLES;
+}
+
+// Worst case: uncorrelated noise in every column, jittered timestamps
+static size_t gen_noise(void) {
+    for (int i = 0; i < WEEK_SAMPLES; i++) {
+        codec_sample_t *s = &trace[i];
+        s->time_s = 1700000000u + i * FLASH_LOG_INTERVAL_S + (uint32_t)(5 + 5 * noise());
+        s->col[CODEC_COL_VOLTAGE] = (int32_t)(1300 + 200 * noise());
+        s->col[CODEC_COL_CURRENT] = (int32_t)(50000 * noise());
+        s->col[CODEC_COL_POWER] = (int32_t)(200 + 200 * noise());
+        s->col[CODEC_COL_SOC] = (int32_t)(500 + 500 * noise());
+        s->col[CODEC_COL_STATE] = (int32_t)(6 + 5 * noise());
+        s->col[CODEC_COL_ERROR] = (int32_t)(10 + 10 * noise());
+        s->col[CODEC_COL_AUX] = (int32_t)(30000 * noise());
+    }
+    return WEEK_SAMPLES;
+}
+
+static size_t load_csv(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+    size_t n = 0;
+    char line[256];
+    while (n < MAX_SAMPLES && fgets(line, sizeof(line), f)) {
+        codec_sample_t *s = &trace[n];
+        if (sscanf(line, "%u,%d,%d,%d,%d,%d,%d,%d", &s->time_s, &s->col[0], &s->col[1], &s->col[2],
+                   &s->col[3], &s->col[4], &s->col[5], &s->col[6]) == 8) {
+            n++;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+// Pack the trace into pages; returns the page count
+static size_t encode_all(size_t n) {
+    size_t pos = 0, p = 0;
+    while (pos < n) {
+        size_t used = 0;
+        page_len[p] = codec_encode_block(trace + pos, n - pos, pages[p], PAGE_PAYLOAD, &used);
+        if (!used) {
+            fprintf(stderr, "sample %zu does not fit a page\n", pos);
+            exit(1);
+        }
+        pos += used;
+        p++;
+    }
+    return p;
+}
+
+static size_t decode_all(size_t page_count) {
+    size_t n = 0;
+    for (size_t p = 0; p < page_count; p++) {
+        n += codec_decode_block(pages[p], page_len[p], decoded + n, CODEC_BLOCK_MAX_SAMPLES);
+    }
+    return n;
+}
+
+static int run(const char *name, size_t n, int reps) {
+    if (n == 0) return 1;
+    size_t page_count = encode_all(n);
+    size_t payload = 0;
+    for (size_t p = 0; p < page_count; p++) payload += page_len[p];
+
+    // Lossless
+    if (decode_all(page_count) != n || memcmp(decoded, trace, n * sizeof(trace[0])) != 0) {
+        printf("%-12s round trip FAILED\n", name);
+        return 1;
+    }
+
+    double t0 = now_s();
+    for (int r = 0; r < reps; r++) encode_all(n);
+    double t_enc = (now_s() - t0) / reps;
+    t0 = now_s();
+    for (int r = 0; r < reps; r++) decode_all(page_count);
+    double t_dec = (now_s() - t0) / reps;
+
+    double raw = (double)n * sizeof(flash_log_record_t);
+    printf("%-12s %6zu samples  %5.2f B/sample block  %5.2f B/sample flash  "
+           "encode %6.1f MB/s  decode %6.1f MB/s\n",
+           name, n, (double)payload / n, (double)page_count * FLASH_LOG_PAGE_SIZE / n,
+           raw / t_enc / 1e6, raw / t_dec / 1e6);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int reps = 20, fails = 0, files = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) reps = 1;
+    }
+
+    size_t per_page = (FLASH_LOG_PAGE_SIZE - sizeof(flash_log_page_hdr_t)) / sizeof(flash_log_record_t);
+    printf("fixed records: %u B/sample flash (%u records of %u B per %u B page)\n",
+           (unsigned)(FLASH_LOG_PAGE_SIZE / per_page), (unsigned)per_page,
+           (unsigned)sizeof(flash_log_record_t), (unsigned)FLASH_LOG_PAGE_SIZE);
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') continue;
+        files++;
+        fails += run(argv[i], load_csv(argv[i]), reps);
+    }
+    if (!files) {
+        fails += run("mppt", gen_mppt(), reps);
+        fails += run("smartshunt", gen_shunt(), reps);
+        fails += run("battsense", gen_sense(), reps);
+        fails += run("noise", gen_noise(), reps);
+    }
+    return fails != 0;
+}
@@ -0,0 +1,250 @@
+// victron_decode benchmark: ns per record for the bit reader against the
+// struct-cast and byte-shift decoders it replaced
+//
+//   bench_victron_decode [--quick]
+//
+// Built twice: -O2, and -Os like the firmware (bench_victron_decode_os).
+// Both decoders run over the same random records and must agree on the
+// record types whose layout did not change (solar, battery, inverter,
+// DC/DC); the SmartLithium and AC charger layouts were fixed with the bit
+// reader, so they are timed only.
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "victron_decode.h"
+
+// Wire layouts the old decoders cast to
+typedef struct __attribute__((packed)) {
+    uint8_t  device_state;
+    uint8_t  charger_error;
+    int16_t  battery_voltage_centi;
+    int16_t  battery_current_deci;
+    uint16_t yield_today_centikwh;
+    uint16_t pv_power_w;
+} wire_solar_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t  device_state;
+    uint8_t  charger_error;
+    uint16_t battery_voltage_1_centi : 13;
+    uint16_t battery_current_1_deci : 11;
+    uint16_t battery_voltage_2_centi : 13;
+    uint16_t battery_current_2_deci : 11;
+    uint16_t battery_voltage_3_centi : 13;
+    uint16_t battery_current_3_deci : 11;
+    int8_t   temperature_c;
+    uint16_t ac_current_deci : 9;
+} wire_ac_charger_t;
+
+static inline int32_t sign_extend(uint32_t value, uint8_t bits)
+{
+    uint32_t shift = 32u - bits;
+    return (int32_t)(value << shift) >> shift;
+}
+
+// The decoder before the bit reader, kept here as the baseline
+__attribute__((noinline))
+static victron_decode_status_t decode_struct_cast(uint8_t record_type,
+                                                  const uint8_t plain[VICTRON_ENCRYPTED_DATA_MAX_SIZE],
+                                                  size_t len, victron_record_t *out)
+{
+    const uint8_t *b = plain;
+
+    switch (record_type) {
+        case VICTRON_BLE_RECORD_SOLAR_CHARGER: {
+            const wire_solar_t *r = (const wire_solar_t *)plain;
+            uint16_t load_raw = (uint16_t)b[10] | ((uint16_t)(b[11] & 0x01) << 8);
+
+            out->solar.device_state = r->device_state;
+            out->solar.charger_error = r->charger_error;
+            out->solar.battery_voltage_centi = r->battery_voltage_centi;
+            out->solar.battery_current_deci = r->battery_current_deci;
+            out->solar.yield_today_centikwh = r->yield_today_centikwh;
+            out->solar.pv_power_w = r->pv_power_w;
+            out->solar.load_current_deci = load_raw;
+            break;
+        }
+
+        case VICTRON_BLE_RECORD_BATTERY_MONITOR: {
+            uint64_t tail = 0;
+            for (int i = 0; i < 7; i++)
+                tail |= ((uint64_t)b[8 + i]) << (8 * i);
+
+            out->battery.time_to_go_minutes = victron_le16(b);
+            out->battery.battery_voltage_centi = victron_le16(b + 2);
+            out->battery.alarm_reason = victron_le16(b + 4);
+            out->battery.aux_value = victron_le16(b + 6);
+            out->battery.aux_input = tail & 0x03; tail >>= 2;
+            out->battery.battery_current_milli = sign_extend(tail & ((1u << 22) - 1u), 22); tail >>= 22;
+            out->battery.consumed_ah_deci = sign_extend(tail & ((1u << 20) - 1u), 20); tail >>= 20;
+            out->battery.soc_deci_percent = tail & ((1u << 10) - 1u);
+            break;
+        }
+
+        case VICTRON_BLE_RECORD_INVERTER: {
+            if (len < 11)
+                return VICTRON_DECODE_TOO_SHORT;
+
+            uint32_t tail = (uint32_t)b[7]
+                          | ((uint32_t)b[8] << 8)
+                          | ((uint32_t)b[9] << 16)
+                          | ((uint32_t)b[10] << 24);
+            out->inverter.device_state = b[0];
+            out->inverter.alarm_reason = victron_le16(b + 1);
+            out->inverter.battery_voltage_centi = (int16_t)victron_le16(b + 3);
+            out->inverter.ac_apparent_power_va = victron_le16(b + 5);
+            out->inverter.ac_voltage_centi = (uint16_t)(tail & 0x7FFFu);
+            out->inverter.ac_current_deci = (uint16_t)((tail >> 15) & 0x7FFu);
+            break;
+        }
+
+        case VICTRON_BLE_RECORD_DCDC_CONVERTER: {
+            if (len < 10)
+                return VICTRON_DECODE_TOO_SHORT;
+
+            out->dcdc.device_state = b[0];
+            out->dcdc.charger_error = b[1];
+            out->dcdc.input_voltage_centi = victron_le16(b + 2);
+            out->dcdc.output_voltage_centi = victron_le16(b + 4);
+            out->dcdc.off_reason = (uint32_t)b[6]
+                                 | ((uint32_t)b[7] << 8)
+                                 | ((uint32_t)b[8] << 16)
+                                 | ((uint32_t)b[9] << 24);
+            break;
+        }
+
+        case VICTRON_BLE_RECORD_SMART_LITHIUM: {
+            if (len < 16)
+                return VICTRON_DECODE_TOO_SHORT;
+
+            uint16_t packed_voltage = victron_le16(b + 14);
+            out->lithium.bms_flags = (uint32_t)b[0]
+                                   | ((uint32_t)b[1] << 8)
+                                   | ((uint32_t)b[2] << 16)
+                                   | ((uint32_t)b[3] << 24);
+            out->lithium.error_flags = victron_le16(b + 4);
+            out->lithium.cell1_centi = b[6];
+            out->lithium.cell2_centi = b[7];
+            out->lithium.cell3_centi = b[8];
+            out->lithium.cell4_centi = b[9];
+            out->lithium.cell5_centi = b[10];
+            out->lithium.cell6_centi = b[11];
+            out->lithium.cell7_centi = b[12];
+            out->lithium.cell8_centi = b[13];
+            out->lithium.battery_voltage_centi = packed_voltage & 0x0FFFu;
+            out->lithium.balancer_status = (packed_voltage >> 12) & 0x0Fu;
+            out->lithium.temperature_c = (len > 16) ? b[16] : 0;
+            break;
+        }
+
+        case VICTRON_BLE_RECORD_AC_CHARGER: {
+            if (len < 11)
+                return VICTRON_DECODE_TOO_SHORT;
+
+            const wire_ac_charger_t *r = (const wire_ac_charger_t *)plain;
+            out->ac_charger.device_state = r->device_state;
+            out->ac_charger.charger_error = r->charger_error;
+            out->ac_charger.battery_voltage_1_centi = r->battery_voltage_1_centi;
+            out->ac_charger.battery_current_1_deci = r->battery_current_1_deci;
+            out->ac_charger.battery_voltage_2_centi = r->battery_voltage_2_centi;
+            out->ac_charger.battery_current_2_deci = r->battery_current_2_deci;
+            out->ac_charger.battery_voltage_3_centi = r->battery_voltage_3_centi;
+            out->ac_charger.battery_current_3_deci = r->battery_current_3_deci;
+            out->ac_charger.temperature_c = r->temperature_c;
+            out->ac_charger.ac_current_deci = r->ac_current_deci;
+            break;
+        }
+
+        default:
+            return VICTRON_DECODE_UNSUPPORTED;
+    }
+
+    out->type = (victron_record_type_t)record_type;
+    return VICTRON_DECODE_OK;
+}
+
+typedef victron_decode_status_t (*decode_fn)(uint8_t, const uint8_t *, size_t, victron_record_t *);
+
+#define RECORDS 256
+
+static uint8_t plain[RECORDS][VICTRON_ENCRYPTED_DATA_MAX_SIZE];
+
+static double now_s(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static uint32_t sink;
+
+static double ns_per_record(decode_fn fn, uint8_t type, size_t len, int reps) {
+    victron_record_t rec;
+    double t0 = now_s();
+    for (int r = 0; r < reps; r++) {
+        for (int i = 0; i < RECORDS; i++) {
+            fn(type, plain[i], len, &rec);
+            sink += rec.raw[i % 8];
+        }
+    }
+    return (now_s() - t0) * 1e9 / ((double)reps * RECORDS);
+}
+
+static const struct {
+    const char *name;
+    uint8_t     type;
+    size_t      len;
+    bool        same_layout;
+} types[] = {
+    { "solar",      VICTRON_BLE_RECORD_SOLAR_CHARGER,   12, true },
+    { "battery",    VICTRON_BLE_RECORD_BATTERY_MONITOR, 15, true },
+    { "inverter",   VICTRON_BLE_RECORD_INVERTER,        11, true },
+    { "dcdc",       VICTRON_BLE_RECORD_DCDC_CONVERTER,  10, true },
+    { "lithium",    VICTRON_BLE_RECORD_SMART_LITHIUM,   16, false },
+    { "ac_charger", VICTRON_BLE_RECORD_AC_CHARGER,      13, false },
+};
+
+int main(int argc, char **argv) {
+    int reps = (argc > 1 && strcmp(argv[1], "--quick") == 0) ? 10 : 20000;
+    uint32_t rng = 7;
+    int fails = 0;
+
+    for (int i = 0; i < RECORDS; i++) {
+        for (int k = 0; k < VICTRON_ENCRYPTED_DATA_MAX_SIZE; k++) {
+            rng = rng * 1664525u + 1013904223u;
+            plain[i][k] = (uint8_t)(rng >> 24);
+        }
+    }
+
+    printf("%-10s %12s %12s   ns/record\n", "record", "struct cast", "bit reader");
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        // Zero past len, as victron_ble.c hands the decoders
+        uint8_t saved[RECORDS][VICTRON_ENCRYPTED_DATA_MAX_SIZE];
+        memcpy(saved, plain, sizeof(plain));
+        for (int i = 0; i < RECORDS; i++) {
+            memset(plain[i] + types[t].len, 0, VICTRON_ENCRYPTED_DATA_MAX_SIZE - types[t].len);
+        }
+
+        if (types[t].same_layout) {
+            for (int i = 0; i < RECORDS; i++) {
+                victron_record_t a, b;
+                memset(&a, 0, sizeof(a));
+                memset(&b, 0, sizeof(b));
+                decode_struct_cast(types[t].type, plain[i], types[t].len, &a);
+                victron_decode_record(types[t].type, plain[i], types[t].len, &b);
+                if (memcmp(&a, &b, sizeof(a)) != 0) {
+                    printf("%s: decoders disagree on record %d\n", types[t].name, i);
+                    fails++;
+                    break;
+                }
+            }
+        }
+
+        double old_ns = ns_per_record(decode_struct_cast, types[t].type, types[t].len, reps);
+        double new_ns = ns_per_record(victron_decode_record, types[t].type, types[t].len, reps);
+        printf("%-10s %12.1f %12.1f\n", types[t].name, old_ns, new_ns);
+        memcpy(plain, saved, sizeof(plain));
+    }
+    return fails != 0;
+}
@@ -0,0 +1,32 @@
+// Minimal assertions for the host tests: count failures, report at the end
+#pragma once
+#include <stdio.h>
+
+static int check_failures;
+
+#define CHECK(cond) do {                                                      \
+    if (!(cond)) {                                                            \
+        printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);       \
+        check_failures++;                                                     \
+    }                                                                         \
+} while (0)
+
+#define CHECK_EQ(a, b) do {                                                   \
+    long long check_a_ = (long long)(a), check_b_ = (long long)(b);           \
+    if (check_a_ != check_b_) {                                               \
+        printf("%s:%d: CHECK_EQ failed: %s = %lld, %s = %lld\n", __FILE__,    \
+               __LINE__, #a, check_a_, #b, check_b_);                         \
+        check_failures++;                                                     \
+    }                                                                         \
+} while (0)
+
+// Return value of main()
+static inline int check_report(const char *name)
+{
+    if (check_failures) {
+        printf("%s: %d check(s) failed\n", name, check_failures);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
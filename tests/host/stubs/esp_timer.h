@@ -0,0 +1,5 @@
+// Host stub: tests define esp_timer_get_time() to control the clock
+#pragma once
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,129 @@
+// diag_scope: host clock, log2 bucket placement, percentiles, registration
+// and a build with DIAG_SCOPE_ENABLE=0 (test_diag_scope_off.c)
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "check.h"
+#include "diag_scope.h"
+
+// test_diag_scope_off.c, compiled with DIAG_SCOPE_ENABLE=0
+int scoped_off(int x);
+
+static int scoped_on(int x) {
+    DIAG_SCOPE(scope_on);
+    DIAG_SCOPE_BEGIN(pair_on);
+    x *= 3;
+    DIAG_SCOPE_END(pair_on);
+    return x;
+}
+
+static const diag_hist_t *find(const char *name) {
+    for (const diag_hist_t *h = diag_hist_first(); h; h = h->next) {
+        if (strcmp(h->name, name) == 0) return h;
+    }
+    return NULL;
+}
+
+static int registered(void) {
+    int n = 0;
+    for (const diag_hist_t *h = diag_hist_first(); h; h = h->next) n++;
+    return n;
+}
+
+// On the host a tick is a CLOCK_MONOTONIC nanosecond
+static void host_clock(void) {
+    CHECK_EQ(diag_ticks_per_us(), 1000);
+
+    struct timespec pause = { 0, 2000000 };   // 2 ms
+    uint32_t t0 = diag_ticks();
+    nanosleep(&pause, NULL);
+    uint32_t dt = diag_ticks() - t0;
+    CHECK(dt >= 2000000);
+    CHECK(dt < 1000000000);   // well under the 4.29 s wrap of the 32-bit tick
+
+    uint32_t prev = diag_ticks();
+    for (int i = 0; i < 1000; i++) {
+        uint32_t now = diag_ticks();
+        CHECK(now - prev < 1000000000);   // never runs backwards
+        prev = now;
+    }
+}
+
+// Bucket i counts [2^i, 2^(i+1)) ticks; 0 shares bucket 0 with 1
+static void buckets(void) {
+    static const struct { uint32_t ticks; int bucket; } cases[] = {
+        { 0, 0 }, { 1, 0 }, { 2, 1 }, { 3, 1 }, { 4, 2 }, { 1023, 9 }, { 1024, 10 },
+        { 1025, 10 }, { 0x7FFFFFFFu, 30 }, { 0x80000000u, 31 }, { UINT32_MAX, 31 },
+    };
+    // Recording links a histogram into the global list: keep them static
+    static diag_hist_t h[sizeof(cases) / sizeof(cases[0])];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        h[i].name = "bucket";
+        diag_hist_record(&h[i], cases[i].ticks);
+        for (int b = 0; b < DIAG_HIST_BUCKETS; b++) {
+            if (h[i].bucket[b] != (b == cases[i].bucket ? 1u : 0u)) {
+                printf("ticks %lu: bucket %d holds %lu\n", (unsigned long)cases[i].ticks, b,
+                       (unsigned long)h[i].bucket[b]);
+                check_failures++;
+            }
+        }
+        CHECK_EQ(h[i].max_ticks, cases[i].ticks);
+        CHECK_EQ(diag_hist_count(&h[i]), 1);
+    }
+}
+
+// Percentiles are the upper bucket edge, capped at the largest sample
+static void percentiles(void) {
+    static diag_hist_t h = DIAG_HIST_INIT("percentile");
+    CHECK_EQ(diag_hist_percentile(&h, 50), 0);
+    for (int i = 0; i < 90; i++) diag_hist_record(&h, 1);
+    for (int i = 0; i < 10; i++) diag_hist_record(&h, 1000);
+    CHECK_EQ(diag_hist_count(&h), 100);
+    CHECK_EQ(diag_hist_percentile(&h, 50), 1);
+    CHECK_EQ(diag_hist_percentile(&h, 90), 1);
+    CHECK_EQ(diag_hist_percentile(&h, 91), 1000);   // bucket 9 edge 1023, capped
+    CHECK_EQ(diag_hist_percentile(&h, 100), 1000);
+
+    diag_hist_record(&h, 700);
+    CHECK_EQ(h.max_ticks, 1000);
+    diag_hist_record(&h, UINT32_MAX);
+    CHECK_EQ(diag_hist_percentile(&h, 100), UINT32_MAX);
+}
+
+// Scopes register their histogram once, on first use; reset keeps them
+static void registration(void) {
+    int before = registered();
+    CHECK(find("scope_on") == NULL);
+    for (int i = 0; i < 5; i++) CHECK_EQ(scoped_on(i), 3 * i);
+    CHECK_EQ(registered(), before + 2);
+    // Registered at the first record: DIAG_SCOPE records at the end of the block
+    CHECK(diag_hist_first() == find("scope_on"));
+    CHECK_EQ(diag_hist_count(find("scope_on")), 5);
+    CHECK_EQ(diag_hist_count(find("pair_on")), 5);
+
+    diag_hist_reset();
+    CHECK_EQ(registered(), before + 2);
+    CHECK_EQ(diag_hist_count(find("scope_on")), 0);
+    CHECK_EQ(find("percentile")->max_ticks, 0);
+    scoped_on(1);
+    CHECK_EQ(registered(), before + 2);
+    CHECK_EQ(diag_hist_count(find("scope_on")), 1);
+}
+
+// DIAG_SCOPE_ENABLE=0 compiles the scopes out: nothing is recorded
+static void disabled(void) {
+    int before = registered();
+    CHECK_EQ(scoped_off(4), 12);
+    CHECK_EQ(registered(), before);
+    CHECK(find("scope_off") == NULL);
+    CHECK(find("pair_off") == NULL);
+}
+
+int main(void) {
+    host_clock();
+    buckets();
+    percentiles();
+    registration();
+    disabled();
+    return check_report("test_diag_scope");
+}
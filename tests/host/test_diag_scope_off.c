@@ -0,0 +1,16 @@
+// Built with DIAG_SCOPE_ENABLE=0: the scope macros must still compile
+#include "diag_scope.h"
+
+#if DIAG_SCOPE_ENABLE
+#error "test_diag_scope_off.c must be built with DIAG_SCOPE_ENABLE=0"
+#endif
+
+int scoped_off(int x);
+
+int scoped_off(int x) {
+    DIAG_SCOPE(scope_off);
+    DIAG_SCOPE_BEGIN(pair_off);
+    x *= 3;
+    DIAG_SCOPE_END(pair_off);
+    return x;
+}
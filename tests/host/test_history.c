@@ -0,0 +1,152 @@
+// history: 1 s -> 1 min -> 15 min rollup, min/max/avg and last-N queries,
+// gaps, skipped seconds, and the SRAM footprint report
+#include <stdint.h>
+#include <stdbool.h>
+#include "check.h"
+#include "history.h"
+
+#define T0 1000u
+
+static int32_t values[HISTORY_METRIC_COUNT];
+static bool valid[HISTORY_METRIC_COUNT];
+
+// Metric 0 = f(second), the others stay invalid
+static void record(uint32_t s, bool ok, int32_t v) {
+    values[0] = v;
+    valid[0] = ok;
+    history_record(T0 + s, values, valid);
+}
+
+// Average of f over [from, from + n) the way the rollup computes it
+static int32_t avg_linear(int64_t from, int64_t n) {
+    int64_t sum = 0;
+    for (int64_t i = 0; i < n; i++) sum += from + i;
+    return (int32_t)(sum / n);
+}
+
+static void test_rollup(void) {
+    history_init(T0);
+    // f(s) = s for 4 hours: 240 minutes, 16 quarter hours
+    for (uint32_t s = 0; s < 4 * 3600; s++) record(s, true, (int32_t)s);
+
+    CHECK_EQ(history_sample_count(0, HISTORY_TIER_1S), 4 * 3600);
+    CHECK_EQ(history_sample_count(0, HISTORY_TIER_1MIN), 240);
+    CHECK_EQ(history_sample_count(0, HISTORY_TIER_15MIN), 16);
+
+    // 1 s tier: the last 600 seconds, oldest first
+    static int32_t out[HISTORY_1MIN_SAMPLES];
+    CHECK_EQ(history_last_n(0, HISTORY_TIER_1S, out, 1000), HISTORY_1S_SAMPLES);
+    for (int i = 0; i < HISTORY_1S_SAMPLES; i++) CHECK_EQ(out[i], 4 * 3600 - HISTORY_1S_SAMPLES + i);
+
+    // 1 min tier: average of each minute
+    CHECK_EQ(history_last_n(0, HISTORY_TIER_1MIN, out, 240), 240);
+    for (int k = 0; k < 240; k++) CHECK_EQ(out[k], avg_linear(60 * k, 60));
+
+    // 15 min tier: average of 15 minute averages
+    CHECK_EQ(history_last_n(0, HISTORY_TIER_15MIN, out, 16), 16);
+    for (int q = 0; q < 16; q++) {
+        int64_t sum = 0;
+        for (int k = 0; k < 15; k++) sum += avg_linear(60 * (15 * q + k), 60);
+        CHECK_EQ(out[q], sum / 15);
+    }
+
+    // Invalid metrics are gaps in every tier
+    CHECK(!history_stats(1, HISTORY_TIER_1S, 600, NULL));
+    CHECK_EQ(history_last_n(1, HISTORY_TIER_1MIN, out, 2), 2);
+    CHECK_EQ(out[0], HISTORY_NO_VALUE);
+}
+
+static void test_stats(void) {
+    history_init(T0);
+    // Triangle: 0..99 then 99..0, repeated
+    for (uint32_t s = 0; s < 600; s++) {
+        int32_t p = (int32_t)(s % 200);
+        record(s, true, p < 100 ? p : 199 - p);
+    }
+
+    history_stats_t st;
+    CHECK(history_stats(0, HISTORY_TIER_1S, 600, &st));
+    CHECK_EQ(st.min, 0);
+    CHECK_EQ(st.max, 99);
+    CHECK_EQ(st.count, 600);
+    CHECK_EQ(st.avg, 49);   // 3 * 2 * (0 + .. + 99) / 600 = 49.5
+
+    // Newest 10: seconds 590..599 = values 9..0
+    CHECK(history_stats(0, HISTORY_TIER_1S, 10, &st));
+    CHECK_EQ(st.min, 0);
+    CHECK_EQ(st.max, 9);
+    CHECK_EQ(st.count, 10);
+    CHECK_EQ(st.avg, 4);
+
+    // Window in seconds picks the finest tier that covers it
+    CHECK(history_stats_window(0, 600, &st));
+    CHECK_EQ(st.count, 600);
+    CHECK(history_stats_window(0, 601, &st));   // 1 min tier, 10 minutes so far
+    CHECK_EQ(st.count, 10);
+    CHECK(!history_stats_window(0, 24 * 3600 + 1, &st));   // 15 min tier, still empty
+}
+
+static void test_gaps(void) {
+    history_init(T0);
+    // Minute 0: valid; minute 1: first half valid (100), rest missing;
+    // minute 2: no data at all
+    for (uint32_t s = 0; s < 60; s++) record(s, true, 50);
+    for (uint32_t s = 60; s < 120; s++) record(s, s < 90, 100);
+    for (uint32_t s = 120; s < 180; s++) record(s, false, 0);
+
+    int32_t out[3];
+    CHECK_EQ(history_last_n(0, HISTORY_TIER_1MIN, out, 3), 3);
+    CHECK_EQ(out[0], 50);
+    CHECK_EQ(out[1], 100);                 // averaged over the valid half only
+    CHECK_EQ(out[2], HISTORY_NO_VALUE);
+
+    // A gap does not break the delta chain of the samples around it
+    record(180, true, 70);
+    int32_t last[62];
+    CHECK_EQ(history_last_n(0, HISTORY_TIER_1S, last, 62), 62);
+    CHECK_EQ(last[0], HISTORY_NO_VALUE);   // second 119
+    CHECK_EQ(last[61], 70);
+    history_stats_t st;
+    CHECK(history_stats(0, HISTORY_TIER_1S, 60, &st));   // seconds 121..180
+    CHECK_EQ(st.count, 1);
+    CHECK_EQ(st.avg, 70);
+
+    // Seconds skipped between calls are filled with the same values
+    record(190, true, 80);
+    CHECK_EQ(history_last_n(0, HISTORY_TIER_1S, last, 10), 10);
+    for (int i = 0; i < 10; i++) CHECK_EQ(last[i], 80);
+    CHECK_EQ(history_sample_count(0, HISTORY_TIER_1S), 191);
+
+    // The same second twice is recorded once
+    record(190, true, 90);
+    CHECK_EQ(history_sample_count(0, HISTORY_TIER_1S), 191);
+
+    // Jumps larger than an int16 delta converge over the next samples
+    record(191, true, 100000);
+    record(192, true, 100000);
+    record(193, true, 100000);
+    record(194, true, 100000);
+    CHECK_EQ(history_last_n(0, HISTORY_TIER_1S, last, 1), 1);
+    CHECK_EQ(last[0], 100000);
+}
+
+static void test_footprint(void) {
+    // Sample rings are target-independent; ring headers and accumulators hold
+    // a pointer and an int64, so they are wider on 64-bit hosts
+    const size_t samples = HISTORY_METRIC_COUNT *
+        (HISTORY_1S_SAMPLES + HISTORY_1MIN_SAMPLES + HISTORY_15MIN_SAMPLES) * sizeof(int16_t);
+    CHECK_EQ(samples, 21696);
+    CHECK(history_footprint() >= samples);
+    CHECK(history_footprint() <= HISTORY_SRAM_BUDGET);
+    history_log_footprint();
+    printf("sample rings %zu B, headers and accumulators %zu B (host layout)\n",
+           samples, history_footprint() - samples);
+}
+
+int main(void) {
+    test_rollup();
+    test_stats();
+    test_gaps();
+    test_footprint();
+    return check_report("history");
+}
@@ -0,0 +1,124 @@
+// sample_codec: lossless round trip, page-sized caps, extreme values and
+// malformed blocks
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "check.h"
+#include "sample_codec.h"
+
+static uint32_t rng = 12345;
+static uint32_t next_rand(void) {
+    rng = rng * 1664525u + 1013904223u;
+    return rng >> 8;
+}
+
+static bool samples_equal(const codec_sample_t *a, const codec_sample_t *b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (a[i].time_s != b[i].time_s) return false;
+        if (memcmp(a[i].col, b[i].col, sizeof(a[i].col)) != 0) return false;
+    }
+    return true;
+}
+
+// Encode everything into blocks of at most cap bytes and decode it back
+static void round_trip(const codec_sample_t *in, size_t n, size_t cap) {
+    uint8_t block[1024];
+    codec_sample_t out[CODEC_BLOCK_MAX_SAMPLES];
+    size_t pos = 0;
+    while (pos < n) {
+        size_t used = 0;
+        size_t len = codec_encode_block(in + pos, n - pos, block, cap, &used);
+        CHECK(used > 0);
+        CHECK(len <= cap);
+        if (!used) return;
+        CHECK_EQ(codec_decode_block(block, len, out, CODEC_BLOCK_MAX_SAMPLES), used);
+        CHECK(samples_equal(in + pos, out, used));
+
+        // Header ranges cover the measurement columns
+        codec_block_hdr_t hdr;
+        memcpy(&hdr, block, sizeof(hdr));
+        CHECK_EQ(hdr.t_first, in[pos].time_s);
+        CHECK_EQ(hdr.t_last, in[pos + used - 1].time_s);
+        for (size_t i = 0; i < used; i++) {
+            for (int c = 0; c < CODEC_RANGE_COLUMNS; c++) {
+                CHECK(in[pos + i].col[c] >= hdr.min[c] && in[pos + i].col[c] <= hdr.max[c]);
+            }
+        }
+        pos += used;
+    }
+}
+
+int main(void) {
+    static codec_sample_t s[4096];
+
+    // Regular series: time every 60 s, slow ramps, constant columns
+    for (int i = 0; i < 4096; i++) {
+        s[i].time_s = 1700000000u + 60u * i;
+        s[i].col[CODEC_COL_VOLTAGE] = 1320 + i % 50;
+        s[i].col[CODEC_COL_CURRENT] = -5000 + 3 * i;
+        s[i].col[CODEC_COL_POWER] = (i / 100) % 400;
+        s[i].col[CODEC_COL_SOC] = 1000 - i / 10;
+        s[i].col[CODEC_COL_STATE] = 3 + (i / 500) % 3;
+        s[i].col[CODEC_COL_ERROR] = 0;
+        s[i].col[CODEC_COL_AUX] = i;
+    }
+    round_trip(s, 4096, 240);
+    round_trip(s, 4096, 1024);
+
+    // A regular block is small: 32 samples of constant deltas fit in few bytes
+    uint8_t block[1024];
+    size_t used;
+    size_t len = codec_encode_block(s, 32, block, sizeof(block), &used);
+    CHECK_EQ(used, 32);
+    CHECK(len < sizeof(codec_block_hdr_t) + 8 * 8);
+
+    // Random noise over the full int32 range, irregular time
+    for (int i = 0; i < 4096; i++) {
+        s[i].time_s = (i ? s[i - 1].time_s : 0) + next_rand() % 100000;
+        for (int c = 0; c < CODEC_VALUE_COLUMNS; c++) s[i].col[c] = (int32_t)(next_rand() << 8 ^ next_rand());
+    }
+    round_trip(s, 4096, 240);
+
+    // Extremes: INT32_MIN/MAX alternating, time wrapping
+    for (int i = 0; i < 64; i++) {
+        s[i].time_s = UINT32_MAX - 31 + i;
+        for (int c = 0; c < CODEC_VALUE_COLUMNS; c++) s[i].col[c] = (i + c) & 1 ? INT32_MAX : INT32_MIN;
+    }
+    round_trip(s, 64, 240);
+
+    // Single sample, and a cap too small for even one
+    round_trip(s, 1, 240);
+    CHECK_EQ(codec_encode_block(s, 1, block, sizeof(codec_block_hdr_t), &used), 0);
+    CHECK_EQ(used, 0);
+
+    // Malformed blocks are rejected
+    codec_sample_t out[CODEC_BLOCK_MAX_SAMPLES];
+    for (int i = 0; i < 32; i++) {
+        s[i].time_s = 60u * i;
+        for (int c = 0; c < CODEC_VALUE_COLUMNS; c++) s[i].col[c] = c * i;
+    }
+    len = codec_encode_block(s, 32, block, sizeof(block), &used);
+    CHECK_EQ(used, 32);
+    CHECK_EQ(codec_decode_block(block, len, out, 16), 0);                 // more samples than room
+    CHECK_EQ(codec_decode_block(block, len - 1, out, 32), 0);             // truncated
+    CHECK_EQ(codec_decode_block(block, sizeof(codec_block_hdr_t) - 1, out, 32), 0);
+    codec_block_hdr_t hdr;
+    memcpy(&hdr, block, sizeof(hdr));
+    hdr.count = 0;
+    memcpy(block, &hdr, sizeof(hdr));
+    CHECK_EQ(codec_decode_block(block, len, out, 32), 0);
+    hdr.count = CODEC_BLOCK_MAX_SAMPLES + 1;
+    memcpy(block, &hdr, sizeof(hdr));
+    CHECK_EQ(codec_decode_block(block, len, out, 64), 0);
+
+    // Random bytes never decode out of bounds (ASan) and are mostly rejected
+    for (int k = 0; k < 20000; k++) {
+        uint8_t junk[256];
+        size_t n = next_rand() % sizeof(junk);
+        for (size_t i = 0; i < n; i++) junk[i] = (uint8_t)next_rand();
+        if (n >= 1) junk[0] = (uint8_t)(1 + next_rand() % CODEC_BLOCK_MAX_SAMPLES);
+        codec_decode_block(junk, n, out, CODEC_BLOCK_MAX_SAMPLES);
+    }
+
+    return check_report("sample_codec");
+}
@@ -0,0 +1,83 @@
+// timer_wheel: expiry timing, re-arming, long pauses and the 32-bit
+// millisecond wrap (49.7 days of uptime)
+#include <stdint.h>
+#include "check.h"
+#include "timer_wheel.h"
+
+#define TICK_MS    1000
+#define TIMEOUT_MS 60000
+
+static int expired;
+static void on_expired(timer_wheel_node_t *node, void *ctx) { expired++; }
+
+// A device re-armed every second from start_ms for frames_s seconds, then
+// silent: it must not expire while frames arrive, and must expire within one
+// tick after the timeout once they stop
+static void silent_device(uint64_t start_ms, int frames_s) {
+    timer_wheel_t wheel;
+    timer_wheel_node_t node;
+    timer_wheel_init(&wheel, TICK_MS, start_ms);
+    timer_wheel_node_init(&node);
+    expired = 0;
+
+    uint64_t t = start_ms;
+    for (int s = 0; s < frames_s; s++, t += 1000) {
+        timer_wheel_arm(&wheel, &node, t, TIMEOUT_MS);
+        timer_wheel_advance(&wheel, t, on_expired, NULL);
+    }
+    CHECK_EQ(expired, 0);
+    CHECK(timer_wheel_armed(&node));
+
+    uint64_t last = t - 1000;
+    uint64_t fired_at = 0;
+    for (; t < last + 3 * TIMEOUT_MS; t += 250) {
+        timer_wheel_advance(&wheel, t, on_expired, NULL);
+        if (expired && !fired_at) fired_at = t;
+    }
+    CHECK_EQ(expired, 1);
+    CHECK(fired_at >= last + TIMEOUT_MS);
+    CHECK(fired_at <= last + TIMEOUT_MS + TICK_MS);
+}
+
+int main(void) {
+    // From boot
+    silent_device(0, 300);
+
+    // Across the 32-bit millisecond wrap: frames from 2 min before to 3 min after
+    silent_device((1ULL << 32) - 120000, 300);
+
+    // Ticks wrap at 2^32 too (136 years at 1 s, immediately at 1 ms)
+    timer_wheel_t wheel;
+    timer_wheel_node_t node;
+    timer_wheel_init(&wheel, 1, (1ULL << 32) - 10);
+    timer_wheel_node_init(&node);
+    expired = 0;
+    timer_wheel_arm(&wheel, &node, (1ULL << 32) - 10, 20);
+    timer_wheel_advance(&wheel, (1ULL << 32) + 9, on_expired, NULL);
+    CHECK_EQ(expired, 0);
+    timer_wheel_advance(&wheel, (1ULL << 32) + 10, on_expired, NULL);
+    CHECK_EQ(expired, 1);
+
+    // A pause longer than one revolution: due nodes fire, later ones stay
+    timer_wheel_node_t early, late;
+    timer_wheel_init(&wheel, TICK_MS, 0);
+    timer_wheel_node_init(&early);
+    timer_wheel_node_init(&late);
+    expired = 0;
+    timer_wheel_arm(&wheel, &early, 0, 10000);
+    timer_wheel_arm(&wheel, &late, 0, 500000);
+    timer_wheel_advance(&wheel, 200000, on_expired, NULL);
+    CHECK_EQ(expired, 1);
+    CHECK(!timer_wheel_armed(&early));
+    CHECK(timer_wheel_armed(&late));
+    timer_wheel_advance(&wheel, 500000, on_expired, NULL);
+    CHECK_EQ(expired, 2);
+
+    // Cancel
+    timer_wheel_arm(&wheel, &early, 500000, 1000);
+    timer_wheel_cancel(&early);
+    timer_wheel_advance(&wheel, 600000, on_expired, NULL);
+    CHECK_EQ(expired, 2);
+
+    return check_report("timer_wheel");
+}
@@ -0,0 +1,309 @@
+// victron_decode: every field of every record decoder against the bit tables
+// in docs/extra-manufacturer-data-2022-12-14.txt (record-relative: spec
+// start bit - 32), hand-encoded spec vectors, length checks and
+// victron_parse_adv
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "check.h"
+#include "victron_decode.h"
+
+typedef struct {
+    const char *name;
+    uint16_t    pos, width;
+    bool        is_signed;   // two's complement on the wire
+    int8_t      bias;        // added after extraction (temperature offsets)
+    uint8_t     off, size;   // decoded member in victron_record_t
+    bool        out_signed;
+} field_t;
+
+#define MEMBER(m) (((victron_record_t *)0)->m)
+#define FIELD(m, pos, width, sgn, bias)                                      \
+    { #m, pos, width, sgn, bias, offsetof(victron_record_t, m), sizeof(MEMBER(m)), \
+      (__typeof__(MEMBER(m)))-1 < (__typeof__(MEMBER(m)))1 }
+
+typedef struct {
+    uint8_t        type;
+    size_t         min_len;   // shorter is VICTRON_DECODE_TOO_SHORT (0: no check)
+    const field_t *fields;
+    size_t         count;
+} layout_t;
+
+static const field_t solar[] = {
+    FIELD(solar.device_state,           0,  8, false, 0),
+    FIELD(solar.charger_error,          8,  8, false, 0),
+    FIELD(solar.battery_voltage_centi, 16, 16, true,  0),
+    FIELD(solar.battery_current_deci,  32, 16, true,  0),
+    FIELD(solar.yield_today_centikwh,  48, 16, false, 0),
+    FIELD(solar.pv_power_w,            64, 16, false, 0),
+    FIELD(solar.load_current_deci,     80,  9, false, 0),
+};
+
+static const field_t battery[] = {
+    FIELD(battery.time_to_go_minutes,     0, 16, false, 0),
+    FIELD(battery.battery_voltage_centi, 16, 16, false, 0),
+    FIELD(battery.alarm_reason,          32, 16, false, 0),
+    FIELD(battery.aux_value,             48, 16, false, 0),
+    FIELD(battery.aux_input,             64,  2, false, 0),
+    FIELD(battery.battery_current_milli, 66, 22, true,  0),
+    FIELD(battery.consumed_ah_deci,      88, 20, true,  0),
+    FIELD(battery.soc_deci_percent,     108, 10, false, 0),
+};
+
+static const field_t inverter[] = {
+    FIELD(inverter.device_state,           0,  8, false, 0),
+    FIELD(inverter.alarm_reason,           8, 16, false, 0),
+    FIELD(inverter.battery_voltage_centi, 24, 16, true,  0),
+    FIELD(inverter.ac_apparent_power_va,  40, 16, false, 0),
+    FIELD(inverter.ac_voltage_centi,      56, 15, false, 0),
+    FIELD(inverter.ac_current_deci,       71, 11, false, 0),
+};
+
+static const field_t dcdc[] = {
+    FIELD(dcdc.device_state,          0,  8, false, 0),
+    FIELD(dcdc.charger_error,         8,  8, false, 0),
+    FIELD(dcdc.input_voltage_centi,  16, 16, false, 0),
+    FIELD(dcdc.output_voltage_centi, 32, 16, false, 0),
+    FIELD(dcdc.off_reason,           48, 32, false, 0),
+};
+
+static const field_t lithium[] = {
+    FIELD(lithium.bms_flags,               0, 32, false, 0),
+    FIELD(lithium.error_flags,            32, 16, false, 0),
+    FIELD(lithium.cell1_centi,            48,  7, false, 0),
+    FIELD(lithium.cell2_centi,            55,  7, false, 0),
+    FIELD(lithium.cell3_centi,            62,  7, false, 0),
+    FIELD(lithium.cell4_centi,            69,  7, false, 0),
+    FIELD(lithium.cell5_centi,            76,  7, false, 0),
+    FIELD(lithium.cell6_centi,            83,  7, false, 0),
+    FIELD(lithium.cell7_centi,            90,  7, false, 0),
+    FIELD(lithium.cell8_centi,            97,  7, false, 0),
+    FIELD(lithium.battery_voltage_centi, 104, 12, false, 0),
+    FIELD(lithium.balancer_status,       116,  4, false, 0),
+    FIELD(lithium.temperature_c,         120,  7, false, 0),   // decoder keeps the raw value
+};
+
+static const field_t ac_charger[] = {
+    FIELD(ac_charger.device_state,             0,  8, false, 0),
+    FIELD(ac_charger.charger_error,            8,  8, false, 0),
+    FIELD(ac_charger.battery_voltage_1_centi, 16, 13, false, 0),
+    FIELD(ac_charger.battery_current_1_deci,  29, 11, false, 0),
+    FIELD(ac_charger.battery_voltage_2_centi, 40, 13, false, 0),
+    FIELD(ac_charger.battery_current_2_deci,  53, 11, false, 0),
+    FIELD(ac_charger.battery_voltage_3_centi, 64, 13, false, 0),
+    FIELD(ac_charger.battery_current_3_deci,  77, 11, false, 0),
+    FIELD(ac_charger.temperature_c,           88,  7, false, -40),
+    FIELD(ac_charger.ac_current_deci,         95,  9, false, 0),
+};
+
+#define LAYOUT(type, min_len, f) { type, min_len, f, sizeof(f) / sizeof(f[0]) }
+
+static const layout_t layouts[] = {
+    LAYOUT(VICTRON_BLE_RECORD_SOLAR_CHARGER,   0,  solar),
+    LAYOUT(VICTRON_BLE_RECORD_BATTERY_MONITOR, 0,  battery),
+    LAYOUT(VICTRON_BLE_RECORD_INVERTER,        11, inverter),
+    LAYOUT(VICTRON_BLE_RECORD_DCDC_CONVERTER,  10, dcdc),
+    LAYOUT(VICTRON_BLE_RECORD_SMART_LITHIUM,   16, lithium),
+    LAYOUT(VICTRON_BLE_RECORD_AC_CHARGER,      11, ac_charger),
+};
+
+static uint32_t rng = 4242;
+static uint32_t next_rand(void) {
+    rng = rng * 1664525u + 1013904223u;
+    return rng ^ (rng >> 15);
+}
+
+// One bit at a time, deliberately unlike the decoder's window loads
+static void put_bits(uint8_t *b, unsigned pos, unsigned width, uint32_t v) {
+    for (unsigned i = 0; i < width; i++) {
+        unsigned bit = pos + i;
+        b[bit / 8] = (uint8_t)((b[bit / 8] & ~(1u << (bit % 8))) | (((v >> i) & 1u) << (bit % 8)));
+    }
+}
+
+static int64_t expected(const field_t *f, uint32_t raw) {
+    int64_t v = raw;
+    if (f->is_signed && (raw >> (f->width - 1)) & 1u) v -= (int64_t)1 << f->width;
+    return v + f->bias;
+}
+
+static int64_t decoded(const field_t *f, const victron_record_t *rec) {
+    const uint8_t *p = (const uint8_t *)rec + f->off;
+    switch (f->size) {
+        case 1: { uint8_t v; memcpy(&v, p, 1); return f->out_signed ? (int64_t)(int8_t)v : (int64_t)v; }
+        case 2: { uint16_t v; memcpy(&v, p, 2); return f->out_signed ? (int64_t)(int16_t)v : (int64_t)v; }
+        default: { uint32_t v; memcpy(&v, p, 4); return f->out_signed ? (int64_t)(int32_t)v : (int64_t)v; }
+    }
+}
+
+static unsigned record_len(const layout_t *l) {
+    unsigned end = 0;
+    for (size_t i = 0; i < l->count; i++) {
+        unsigned e = l->fields[i].pos + l->fields[i].width;
+        if (e > end) end = e;
+    }
+    return (end + 7) / 8;
+}
+
+enum { PAT_ZERO, PAT_ONES, PAT_SIGN, PAT_LOW, PAT_ALT, PAT_RANDOM };
+
+static uint32_t pattern(int pat, unsigned width) {
+    uint32_t mask = (uint32_t)((1ull << width) - 1);
+    switch (pat) {
+        case PAT_ZERO: return 0;
+        case PAT_ONES: return mask;                       // "not available"
+        case PAT_SIGN: return 1u << (width - 1);          // most negative when signed
+        case PAT_LOW:  return 1;
+        case PAT_ALT:  return 0x55555555u & mask;
+        default:       return next_rand() & mask;
+    }
+}
+
+// Fill with noise, write every field, decode, compare each field
+static int vectors, fields_checked;
+
+static void check_layout(const layout_t *l, int pat) {
+    uint8_t plain[VICTRON_ENCRYPTED_DATA_MAX_SIZE] = { 0 };
+    uint32_t raw[16];
+    unsigned len = record_len(l);
+
+    // Bits the layout does not cover carry noise: masks must not leak them
+    for (unsigned i = 0; i < len; i++) plain[i] = (uint8_t)next_rand();
+    for (size_t i = 0; i < l->count; i++) {
+        raw[i] = pattern(pat, l->fields[i].width);
+        put_bits(plain, l->fields[i].pos, l->fields[i].width, raw[i]);
+    }
+    // Unused bits inside the last byte stay noisy; nothing past len
+    victron_record_t rec;
+    memset(&rec, 0xA5, sizeof(rec));
+    CHECK_EQ(victron_decode_record(l->type, plain, len, &rec), VICTRON_DECODE_OK);
+    CHECK_EQ(rec.type, l->type);
+    for (size_t i = 0; i < l->count; i++) {
+        int64_t want = expected(&l->fields[i], raw[i]);
+        int64_t got = decoded(&l->fields[i], &rec);
+        if (got != want) {
+            printf("type 0x%02X %s raw 0x%X: got %lld, want %lld\n", l->type, l->fields[i].name,
+                   (unsigned)raw[i], (long long)got, (long long)want);
+        }
+        CHECK_EQ(got, want);
+        fields_checked++;
+    }
+    vectors++;
+}
+
+// Hand-encoded records; the comments give the decoded values
+static void test_spec_vectors(void) {
+    victron_record_t rec;
+
+    // SmartShunt: 600 min, 12.85 V, aux = temperature, -1.500 A, -12.3 Ah, 87.6 %
+    static const uint8_t bmv[VICTRON_ENCRYPTED_DATA_MAX_SIZE] = {
+        0x58, 0x02, 0x05, 0x05, 0x00, 0x00, 0x77, 0x74,
+        0x92, 0xE8, 0xFF, 0x85, 0xFF, 0xCF, 0x36,
+    };
+    CHECK_EQ(victron_decode_record(VICTRON_BLE_RECORD_BATTERY_MONITOR, bmv, 15, &rec), VICTRON_DECODE_OK);
+    CHECK_EQ(rec.battery.time_to_go_minutes, 600);
+    CHECK_EQ(rec.battery.battery_voltage_centi, 1285);
+    CHECK_EQ(rec.battery.alarm_reason, 0);
+    CHECK_EQ(rec.battery.aux_value, 29815);
+    CHECK_EQ(rec.battery.aux_input, 2);
+    CHECK_EQ(rec.battery.battery_current_milli, -1500);
+    CHECK_EQ(rec.battery.consumed_ah_deci, -123);
+    CHECK_EQ(rec.battery.soc_deci_percent, 876);
+
+    // 22-bit current extremes: +2097.151 A, -2097.152 A, -0.001 A
+    uint8_t b[VICTRON_ENCRYPTED_DATA_MAX_SIZE] = { 0 };
+    put_bits(b, 66, 22, 0x1FFFFF);
+    victron_decode_record(VICTRON_BLE_RECORD_BATTERY_MONITOR, b, 15, &rec);
+    CHECK_EQ(rec.battery.battery_current_milli, 2097151);
+    put_bits(b, 66, 22, 0x200000);
+    victron_decode_record(VICTRON_BLE_RECORD_BATTERY_MONITOR, b, 15, &rec);
+    CHECK_EQ(rec.battery.battery_current_milli, -2097152);
+    put_bits(b, 66, 22, 0x3FFFFF);
+    victron_decode_record(VICTRON_BLE_RECORD_BATTERY_MONITOR, b, 15, &rec);
+    CHECK_EQ(rec.battery.battery_current_milli, -1);
+    CHECK_EQ(rec.battery.aux_input, 0);          // neighbours untouched
+    CHECK_EQ(rec.battery.consumed_ah_deci, 0);
+
+    // AC charger, bulk: 13.40 V / 2.5 A, output 2 not available, 28.80 V /
+    // 100.0 A, 25 C, 12.3 A AC
+    static const uint8_t ac[VICTRON_ENCRYPTED_DATA_MAX_SIZE] = {
+        0x03, 0x00, 0x3C, 0x25, 0x03, 0xFF, 0xFF, 0xFF,
+        0x40, 0x0B, 0x7D, 0xC1, 0x3D,
+    };
+    CHECK_EQ(victron_decode_record(VICTRON_BLE_RECORD_AC_CHARGER, ac, 13, &rec), VICTRON_DECODE_OK);
+    CHECK_EQ(rec.ac_charger.device_state, 3);
+    CHECK_EQ(rec.ac_charger.battery_voltage_1_centi, 1340);
+    CHECK_EQ(rec.ac_charger.battery_current_1_deci, 25);
+    CHECK_EQ(rec.ac_charger.battery_voltage_2_centi, 0x1FFF);
+    CHECK_EQ(rec.ac_charger.battery_current_2_deci, 0x7FF);
+    CHECK_EQ(rec.ac_charger.battery_voltage_3_centi, 2880);
+    CHECK_EQ(rec.ac_charger.battery_current_3_deci, 1000);
+    CHECK_EQ(rec.ac_charger.temperature_c, 25);
+    CHECK_EQ(rec.ac_charger.ac_current_deci, 123);
+
+    // MPPT, absorption: 13.56 V, -0.5 A, 1.23 kWh, 250 W, load not available
+    static const uint8_t mppt[VICTRON_ENCRYPTED_DATA_MAX_SIZE] = {
+        0x04, 0x00, 0x4C, 0x05, 0xFB, 0xFF, 0x7B, 0x00, 0xFA, 0x00, 0xFF, 0x01,
+    };
+    CHECK_EQ(victron_decode_record(VICTRON_BLE_RECORD_SOLAR_CHARGER, mppt, 12, &rec), VICTRON_DECODE_OK);
+    CHECK_EQ(rec.solar.device_state, 4);
+    CHECK_EQ(rec.solar.battery_voltage_centi, 1356);
+    CHECK_EQ(rec.solar.battery_current_deci, -5);
+    CHECK_EQ(rec.solar.yield_today_centikwh, 123);
+    CHECK_EQ(rec.solar.pv_power_w, 250);
+    CHECK_EQ(rec.solar.load_current_deci, 0x1FF);
+}
+
+static void test_lengths(void) {
+    uint8_t plain[VICTRON_ENCRYPTED_DATA_MAX_SIZE] = { 0 };
+    victron_record_t rec;
+
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        const layout_t *l = &layouts[i];
+        if (l->min_len == 0) continue;
+        CHECK_EQ(victron_decode_record(l->type, plain, l->min_len - 1, &rec), VICTRON_DECODE_TOO_SHORT);
+        CHECK_EQ(victron_decode_record(l->type, plain, l->min_len, &rec), VICTRON_DECODE_OK);
+    }
+    CHECK_EQ(victron_decode_record(VICTRON_BLE_RECORD_TEST, plain, 16, &rec), VICTRON_DECODE_UNSUPPORTED);
+    CHECK_EQ(victron_decode_record(VICTRON_BLE_RECORD_ORION_XS, plain, 16, &rec), VICTRON_DECODE_UNSUPPORTED);
+    CHECK_EQ(victron_decode_record(0xFF, plain, 16, &rec), VICTRON_DECODE_UNSUPPORTED);
+}
+
+static void test_parse_adv(void) {
+    // Vendor 0x02E1, product advertisement, product 0xA389, solar, nonce 0x1234, key check 0x5A
+    const uint8_t mfg[] = { 0xE1, 0x02, 0x10, 0x00, 0x89, 0xA3, 0x01, 0x34, 0x12, 0x5A, 0xAA, 0xBB };
+    victron_adv_t adv;
+
+    CHECK_EQ(victron_parse_adv(mfg, sizeof(mfg), &adv), VICTRON_ADV_OK);
+    CHECK_EQ(adv.product_id, 0xA389);
+    CHECK_EQ(adv.record_type, VICTRON_BLE_RECORD_SOLAR_CHARGER);
+    CHECK_EQ(adv.nonce, 0x1234);
+    CHECK_EQ(adv.key_check, 0x5A);
+    CHECK(adv.encrypted == mfg + VICTRON_ADV_HEADER_SIZE);
+    CHECK_EQ(adv.encrypted_len, 2);
+
+    CHECK_EQ(victron_parse_adv(mfg, VICTRON_ADV_HEADER_SIZE, &adv), VICTRON_ADV_NOT_VICTRON);
+    CHECK_EQ(victron_parse_adv(mfg, VICTRON_ADV_HEADER_SIZE + 1, &adv), VICTRON_ADV_OK);
+    uint8_t other[sizeof(mfg)];
+    memcpy(other, mfg, sizeof(mfg));
+    other[0] = 0x4C;   // another vendor
+    CHECK_EQ(victron_parse_adv(other, sizeof(other), &adv), VICTRON_ADV_NOT_VICTRON);
+    memcpy(other, mfg, sizeof(mfg));
+    other[2] = 0x11;   // Victron, not a product advertisement
+    CHECK_EQ(victron_parse_adv(other, sizeof(other), &adv), VICTRON_ADV_OTHER_RECORD);
+    CHECK_EQ(adv.manufacturer_record_type, 0x11);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        for (int pat = PAT_ZERO; pat < PAT_RANDOM; pat++) check_layout(&layouts[i], pat);
+        for (int k = 0; k < 300; k++) check_layout(&layouts[i], PAT_RANDOM);
+    }
+    printf("%d vectors, %d fields\n", vectors, fields_checked);
+
+    test_spec_vectors();
+    test_lengths();
+    test_parse_adv();
+    return check_report("victron_decode");
+}
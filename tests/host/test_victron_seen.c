@@ -0,0 +1,93 @@
+// victron_seen: the snapshot holds the most recently seen advertisers,
+// newest first, whatever their ring slots; a full ring evicts the least
+// recently seen
+#include <stdbool.h>
+#include <string.h>
+#include "check.h"
+#include "victron_ble.h"
+#include "victron_seen.h"
+
+static int64_t now_us;
+int64_t esp_timer_get_time(void) { return now_us; }
+
+static bool publish(uint8_t id, uint32_t at_ms) {
+    uint8_t mac[6] = { id, 0, 0, 0, 0, 0xC0 };
+    now_us = (int64_t)at_ms * 1000;
+    return victron_seen_publish(mac, -60, VICTRON_BLE_RECORD_SOLAR_CHARGER, 0xA053, 0x11,
+                                VICTRON_KEY_NONE, NULL);
+}
+
+static bool seen(uint8_t id) {
+    victron_seen_device_t out[VICTRON_SEEN_RING_SIZE];
+    size_t n = victron_ble_get_seen(out, VICTRON_SEEN_RING_SIZE);
+    for (size_t k = 0; k < n; k++) {
+        if (out[k].mac[0] == id) return true;
+    }
+    return false;
+}
+
+// A full ring evicts the least recently seen device, so devices that keep
+// advertising are never reported as new again while strangers pass by
+static void eviction(void) {
+    uint32_t t = 100000;
+    for (int i = 0; i < VICTRON_SEEN_RING_SIZE; i++) CHECK(publish((uint8_t)(100 + i), t++));
+
+    // Devices 100..103 stay active; a stream of one-off advertisers passes
+    for (int round = 0; round < 3 * VICTRON_SEEN_RING_SIZE; round++) {
+        for (int a = 0; a < 4; a++) CHECK(!publish((uint8_t)(100 + a), t++));
+        CHECK(publish((uint8_t)(200 + round % 50), t++));
+    }
+    for (int a = 0; a < 4; a++) CHECK(seen((uint8_t)(100 + a)));
+
+    // The oldest one-off advertiser goes first
+    uint8_t oldest = 0;
+    uint32_t oldest_ms = UINT32_MAX;
+    victron_seen_device_t out[VICTRON_SEEN_RING_SIZE];
+    size_t n = victron_ble_get_seen(out, VICTRON_SEEN_RING_SIZE);
+    CHECK_EQ(n, VICTRON_SEEN_RING_SIZE);
+    for (size_t k = 0; k < n; k++) {
+        if (out[k].last_seen_ms < oldest_ms) {
+            oldest_ms = out[k].last_seen_ms;
+            oldest = out[k].mac[0];
+        }
+    }
+    CHECK(publish(250, t++));
+    CHECK(!seen(oldest));
+    CHECK(seen(250));
+}
+
+int main(void) {
+    victron_seen_device_t out[VICTRON_SEEN_RING_SIZE];
+    CHECK_EQ(victron_ble_get_seen(out, 8), 0);
+
+    // Fill the ring; then refresh the devices in the upper half of the ring
+    // so the newest 8 are not the first 8 slots
+    for (int i = 0; i < VICTRON_SEEN_RING_SIZE; i++) publish((uint8_t)i, 1000 + i);
+    for (int i = VICTRON_SEEN_RING_SIZE / 2; i < VICTRON_SEEN_RING_SIZE; i++) publish((uint8_t)i, 5000 + i);
+
+    size_t n = victron_ble_get_seen(out, 8);
+    CHECK_EQ(n, 8);
+    for (size_t k = 0; k < n; k++) {
+        CHECK_EQ(out[k].mac[0], VICTRON_SEEN_RING_SIZE - 1 - k);
+        CHECK_EQ(out[k].count, 2);
+    }
+
+    // All of them, newest first
+    n = victron_ble_get_seen(out, VICTRON_SEEN_RING_SIZE);
+    CHECK_EQ(n, VICTRON_SEEN_RING_SIZE);
+    for (size_t k = 1; k < n; k++) CHECK((int32_t)(out[k - 1].last_seen_ms - out[k].last_seen_ms) > 0);
+
+    // Order across the 32-bit millisecond wrap
+    for (int i = 0; i < VICTRON_SEEN_RING_SIZE; i++) publish((uint8_t)i, UINT32_MAX - 2000 + i);
+    publish(3, UINT32_MAX - 5);
+    publish(4, 10);
+    n = victron_ble_get_seen(out, 2);
+    CHECK_EQ(n, 2);
+    CHECK_EQ(out[0].mac[0], 4);
+    CHECK_EQ(out[1].mac[0], 3);
+
+    CHECK_EQ(victron_ble_get_seen(out, 0), 0);
+
+    eviction();
+    return check_report("victron_seen");
+}